@@ -67,6 +67,142 @@ typedef enum {
     TEXT2IMAGE_BACKGROUND_IMAGE = 1   ///< Image background
 } Text2Image_BackgroundType;
 
+/**
+ * @brief Input content formats
+ */
+typedef enum {
+    TEXT2IMAGE_INPUT_AUTO = 0,        ///< Use the plain-text fast path when the input allows it, HTML otherwise
+    TEXT2IMAGE_INPUT_HTML = 1,        ///< Always parse the input as HTML
+    TEXT2IMAGE_INPUT_PLAIN_TEXT = 2,  ///< Plain text; only <br>, <b>, <strong>, <i> and <em> are interpreted
+    TEXT2IMAGE_INPUT_MARKDOWN = 3     ///< Markdown (CommonMark subset with GFM tables)
+} Text2Image_InputFormat;
+
+/**
+ * @brief What an atlas task produces
+ */
+typedef enum {
+    TEXT2IMAGE_ATLAS_SHEET = 0,       ///< One image holding every item; see Text2Image_GetAtlasRect
+    TEXT2IMAGE_ATLAS_CROPS = 1        ///< One image per item, returned as pages in item order
+} Text2Image_AtlasOutput;
+
+/**
+ * @brief Render quality tiers
+ *
+ * A draft keeps the full-quality layout, so text wraps the same way, but
+ * rasterizes at half the output size, skips shadows, draws shapes and images
+ * without anti-aliasing and encodes with the fastest settings. Pagination,
+ * incremental and overdraw renders, atlas tasks and animation tasks are
+ * always rendered at full quality.
+ */
+typedef enum {
+    TEXT2IMAGE_RENDER_QUALITY_FULL = 0,   ///< Output at the requested size and quality
+    TEXT2IMAGE_RENDER_QUALITY_DRAFT = 1   ///< Fast approximate preview at half size
+} Text2Image_RenderQuality;
+
+/**
+ * @brief One small render of an atlas task
+ */
+typedef struct {
+    const char* html;                 ///< Content to render
+    const char* css;                  ///< CSS styles to apply, or NULL
+    int width;                        ///< Item width in pixels
+    int height;                       ///< Item height in pixels
+} Text2Image_AtlasItem;
+
+/**
+ * @brief Position of an item in an atlas image
+ */
+typedef struct {
+    int x;
+    int y;
+    int width;
+    int height;
+} Text2Image_AtlasRect;
+
+/**
+ * @brief One frame of an animation task
+ */
+typedef struct {
+    const char* html;                 ///< Complete content of the frame
+    int duration;                     ///< How long the frame shows, in milliseconds
+} Text2Image_Frame;
+
+/**
+ * @brief One smaller size of a thumbnail task
+ * 
+ * The thumbnail is the full image scaled by scale, further reduced so its
+ * longer side is at most maxSide pixels. Either may be 0 to leave it out.
+ */
+typedef struct {
+    float scale;                      ///< Fraction of the full size (0-1], or 0 for none
+    int maxSide;                      ///< Largest width or height in pixels, or 0 for none
+} Text2Image_Thumbnail;
+
+/**
+ * @brief Font that Text2Image_MeasureText measures in
+ */
+typedef struct {
+    const char* fontFamily;           ///< Family name, or NULL for the default font
+    float fontSize;                   ///< Size in pixels
+    int fontWeight;                   ///< 100-900, 400 for normal
+    bool italic;
+    float lineHeight;                 ///< Multiple of fontSize, or 0 for normal (1.2)
+} Text2Image_FontSpec;
+
+/**
+ * @brief Size and line breaks of one measured string
+ * 
+ * lineEnds and lineEndCapacity are set by the caller; the other fields are
+ * filled in. lineCount is the full count even when lineEnds is shorter.
+ */
+typedef struct {
+    float width;                      ///< Widest line in pixels
+    float height;                     ///< Height of all lines in pixels
+    int lineCount;
+    size_t* lineEnds;                 ///< Receives the byte offset just past each line's last character, or NULL
+    int lineEndCapacity;              ///< Entries lineEnds can hold
+} Text2Image_TextMetrics;
+
+/**
+ * @brief Library-wide cache statistics
+ * 
+ * Skia's font cache holds one strike per typeface, size and rendering
+ * setting, with the rasterized glyphs and metrics used at that size. Skia
+ * keeps no hit counters for it, so it is described by its usage against its
+ * limits; lookups are counted for the library's own font caches.
+ */
+typedef struct {
+    size_t fontCacheBytesUsed;        ///< Bytes held by Skia's font cache
+    size_t fontCacheByteLimit;
+    int fontCacheCountUsed;           ///< Strikes in Skia's font cache
+    int fontCacheCountLimit;
+    uint64_t fontCachePurges;         ///< Purges through Text2Image_PurgeFontCache
+    uint64_t typefaceHits;            ///< Typefaces found by family, weight and slant
+    uint64_t typefaceMisses;          ///< Typefaces opened through the font manager
+    uint64_t typefaceEvictions;       ///< Typefaces dropped to bound the cache
+    uint64_t glyphTableHits;          ///< Code-block glyph tables found by font and size
+    uint64_t glyphTableMisses;        ///< Code-block glyph tables built
+    uint64_t glyphTableEvictions;
+    uint64_t fallbackPagesBuilt;      ///< Font fallback pages of 256 codepoints resolved
+    uint64_t fallbackTypefacesOpened; ///< Fallback typefaces opened for missing characters
+} Text2Image_Metrics;
+
+/**
+ * @brief Resource resolver callback
+ * 
+ * Fetches the bytes of an image a document embeds with <img src>. data:
+ * URIs are decoded by the library and never reach the resolver. It is
+ * called from render threads, possibly several at once, and at most once
+ * per URL while the result stays cached.
+ * 
+ * @param url The src attribute as written in the document
+ * @param data Pointer to receive a buffer allocated with malloc; the library frees it
+ * @param size Pointer to receive the buffer size in bytes
+ * @param userData The pointer passed to Text2Image_SetResourceResolver
+ * @return true if the resource was found
+ */
+typedef bool (*Text2Image_ResourceResolver)(const char* url, uint8_t** data, size_t* size, void* userData);
+
 /**
  * @brief Task handle type
  */
@@ -106,6 +242,24 @@ typedef struct {
     // Additional rendering options
     bool enableJavaScript;              ///< Enable JavaScript execution
     int timeout;                        ///< Render timeout in milliseconds
+    
+    // Input settings
+    Text2Image_InputFormat inputFormat; ///< Format of the html argument
+    
+    // Pagination
+    bool paginate;                      ///< Split the document into pages of the output size
+    
+    // Debugging
+    bool debugOverdraw;                 ///< Output a map of how often each pixel is drawn instead of the content
+    
+    // Incremental rendering
+    bool incremental;                   ///< Keep layout and pixels so a later task can re-render only what changed
+    
+    // Quality tier
+    Text2Image_RenderQuality renderQuality;  ///< Full output or a fast draft preview
+    
+    // High-DPI output
+    float devicePixelRatio;             ///< Output pixels per CSS pixel (1-4); layout stays at the CSS size
 } Text2Image_RenderOptions;
 
 /**
@@ -130,6 +284,125 @@ void Text2Image_Shutdown();
  */
 Text2Image_TaskHandle Text2Image_CreateTask(const char* html, const char* css, const Text2Image_RenderOptions* options);
 
+/**
+ * @brief Create a task that renders many small items in one pass
+ * 
+ * The items are packed into one surface and drawn in a single pass, which
+ * saves a surface, a background fill and an encoder run per item. The
+ * result is either the whole sheet, with each item's position available
+ * from Text2Image_GetAtlasRect, or one image per item, cropped from the
+ * sheet and encoded in parallel. Background, border radius, input format
+ * and output format options apply to every item; each item is at most
+ * 8192 pixels on a side, and so is the sheet.
+ * 
+ * @param items Items to render
+ * @param count Number of items
+ * @param output Sheet or per-item output
+ * @param options Render options
+ * @return Task handle or NULL on error
+ */
+Text2Image_TaskHandle Text2Image_CreateAtlasTask(const Text2Image_AtlasItem* items, int count, Text2Image_AtlasOutput output,
+                                                 const Text2Image_RenderOptions* options);
+
+/**
+ * @brief Get where an item was placed in a rendered atlas
+ * 
+ * @param task Atlas task handle
+ * @param index Zero-based item index
+ * @param rect Pointer to receive the item's position in the sheet
+ * @return true if successful, false otherwise
+ */
+bool Text2Image_GetAtlasRect(Text2Image_TaskHandle task, int index, Text2Image_AtlasRect* rect);
+
+/**
+ * @brief Create a task that renders frames into one animated image
+ * 
+ * Each frame is a complete document, laid out and compared with the frame
+ * before it; only the area that changed is drawn and stored, and frames
+ * with no change lengthen the previous one. The format option selects the
+ * container: PNG produces an animated PNG and WebP an animated WebP, lossy
+ * or lossless by quality as for still images. Other formats are rejected.
+ * The animation loops forever, and at most 1024 frames are accepted.
+ * 
+ * @param frames Frames to render, in order
+ * @param count Number of frames
+ * @param css CSS styles to apply to every frame
+ * @param options Render options
+ * @return Task handle or NULL on error
+ */
+Text2Image_TaskHandle Text2Image_CreateAnimationTask(const Text2Image_Frame* frames, int count, const char* css,
+                                                     const Text2Image_RenderOptions* options);
+
+/**
+ * @brief Create a task that renders a document once and returns it at several sizes
+ * 
+ * The document is rasterized once at the full output size. Each thumbnail
+ * is derived from that raster by 2x2 box halvings, which all thumbnails
+ * share, and a Lanczos filter for the remaining factor. The full image is
+ * page 0 and thumbnail i is page i + 1; all pages are encoded in parallel.
+ * Pagination and incremental rendering are not available for thumbnail
+ * tasks, and at most 16 thumbnails are accepted.
+ * 
+ * @param html HTML content to render
+ * @param css CSS styles to apply
+ * @param thumbnails Smaller sizes to produce, in page order
+ * @param count Number of thumbnails
+ * @param options Render options
+ * @return Task handle or NULL on error
+ */
+Text2Image_TaskHandle Text2Image_CreateThumbnailTask(const char* html, const char* css, const Text2Image_Thumbnail* thumbnails,
+                                                     int count, const Text2Image_RenderOptions* options);
+
+/**
+ * @brief Create a render task that re-renders only what changed since a base task
+ * 
+ * When the task renders, its document is laid out and compared with the
+ * base task's retained layout. Only the areas whose content differs are
+ * drawn again, over a copy of the base task's pixels, and PNG output reuses
+ * the compressed rows that did not change. The base must have rendered with
+ * the incremental option; otherwise, or when the size or background differ,
+ * the task renders in full. Set the incremental option on this task too to
+ * chain further renders from it.
+ * 
+ * @param baseTask Previously rendered task
+ * @param html HTML content to render
+ * @param css CSS styles to apply
+ * @param options Render options
+ * @return Task handle or NULL on error
+ */
+Text2Image_TaskHandle Text2Image_CreateIncrementalTask(Text2Image_TaskHandle baseTask, const char* html, const char* css,
+                                                       const Text2Image_RenderOptions* options);
+
+/**
+ * @brief Create a render task from a compiled document
+ * 
+ * The file is mapped into memory and checked, and rendering draws from it
+ * directly: no parsing, styling or layout takes place. The canvas size is
+ * the one the document was compiled for; output options such as format,
+ * quality, background and border radius apply as usual.
+ * 
+ * @param compiledPath Path of a file written by Text2Image_Compile
+ * @param options Render options
+ * @return Task handle or NULL on error, including when the file comes from
+ *         another library version or architecture, or uses fonts that are
+ *         not installed here
+ */
+Text2Image_TaskHandle Text2Image_CreateTaskFromCompiled(const char* compiledPath, const Text2Image_RenderOptions* options);
+
+/**
+ * @brief Compile a task's document for reuse
+ * 
+ * Parses, styles and lays out the document at the task's output size, and
+ * writes the result as a compact binary file that Text2Image_CreateTaskFromCompiled
+ * loads without parsing. Compile templates once at build time and render them in
+ * any number of processes.
+ * 
+ * @param task Task handle
+ * @param outputPath Path of the compiled document to write
+ * @return true if the document was compiled and written, false otherwise
+ */
+bool Text2Image_Compile(Text2Image_TaskHandle task, const char* outputPath);
+
 /**
  * @brief Render a task synchronously
  * 
@@ -162,7 +435,27 @@ bool Text2Image_RenderAsync(Text2Image_TaskHandle task, const char* outputPath,
 bool Text2Image_GetResult(Text2Image_TaskHandle task, uint8_t** buffer, size_t* size);
 
 /**
- * @brief Free a buffer returned by Text2Image_GetResult
+ * @brief Get the number of pages produced by a render
+ * 
+ * @param task Task handle
+ * @return Number of pages, 1 for a render without pagination, 0 if the task has no result
+ */
+int Text2Image_GetPageCount(Text2Image_TaskHandle task);
+
+/**
+ * @brief Get the image data of one page in memory
+ * 
+ * @param task Task handle
+ * @param pageIndex Zero-based page index
+ * @param buffer Pointer to receive the image data buffer
+ * @param size Pointer to receive the image data size
+ * @return true if successful, false otherwise
+ * @note The caller is responsible for freeing the buffer with Text2Image_FreeBuffer
+ */
+bool Text2Image_GetPageResult(Text2Image_TaskHandle task, int pageIndex, uint8_t** buffer, size_t* size);
+
+/**
+ * @brief Free a buffer returned by Text2Image_GetResult or Text2Image_GetPageResult
  * 
  * @param buffer Buffer to free
  */
@@ -189,6 +482,94 @@ const char* Text2Image_GetLastError();
  */
 void Text2Image_SetMaxThreads(int numThreads);
 
+/**
+ * @brief Set how images embedded with <img> are fetched
+ * 
+ * By default only data: URIs and files inside the directory given to
+ * Text2Image_SetLocalImageDirectory are read. A resolver replaces that
+ * entirely, so it also decides which files a document may read. Images
+ * fetched so far are dropped.
+ * 
+ * @param resolver Resolver callback, or NULL to restore the default
+ * @param userData Pointer passed to every resolver call
+ * @return true if successful, false if the library is not initialized
+ */
+bool Text2Image_SetResourceResolver(Text2Image_ResourceResolver resolver, void* userData);
+
+/**
+ * @brief Allow documents to embed local image files from a directory
+ * 
+ * Local files are off by default. Once a directory is set, relative paths
+ * resolve against it, and absolute paths or file:// URLs are read only when
+ * they lead inside it; ".." and symbolic links cannot leave it. Has no
+ * effect while a resolver is set. Images fetched so far are dropped.
+ * 
+ * @param directory Existing directory, or NULL or "" to disable local files
+ * @return true if successful, false if the library is not initialized or
+ *         the directory does not exist
+ */
+bool Text2Image_SetLocalImageDirectory(const char* directory);
+
+/**
+ * @brief Set the budget of Skia's font cache
+ * 
+ * Skia's defaults suit one browser tab; a renderer working through many
+ * fonts and sizes on many threads usually wants more. Larger budgets trade
+ * resident memory for fewer glyphs rasterized again; purging happens as soon
+ * as usage exceeds either limit.
+ * 
+ * @param byteLimit Most bytes the cache may hold, or 0 to keep the current limit
+ * @param countLimit Most strikes the cache may hold, or 0 to keep the current limit
+ * @return true if successful, false if the library is not initialized
+ */
+bool Text2Image_SetFontCacheLimits(size_t byteLimit, int countLimit);
+
+/**
+ * @brief Empty Skia's font cache
+ */
+void Text2Image_PurgeFontCache();
+
+/**
+ * @brief Get cache statistics
+ * 
+ * @param metrics Pointer to receive the statistics
+ * @return true if successful, false if the library is not initialized
+ */
+bool Text2Image_GetMetrics(Text2Image_Metrics* metrics);
+
+/**
+ * @brief Measure text without rendering it
+ * 
+ * The text is laid out as one paragraph, with the fonts, font fallback and
+ * line breaking that rendering uses, but no glyph is shaped or rasterized.
+ * Newlines break lines and other white space collapses, as in HTML.
+ * Thread-safe.
+ * 
+ * @param text UTF-8 text
+ * @param font Font to measure in
+ * @param maxWidth Width lines wrap at in pixels, or 0 to never wrap
+ * @param metrics Pointer to receive the size and line breaks
+ * @return true if successful, false otherwise
+ */
+bool Text2Image_MeasureText(const char* text, const Text2Image_FontSpec* font, float maxWidth,
+                            Text2Image_TextMetrics* metrics);
+
+/**
+ * @brief Measure many strings in one font
+ * 
+ * Like Text2Image_MeasureText for each string, sharing the font setup;
+ * large batches are measured on the render threads.
+ * 
+ * @param texts Array of UTF-8 strings
+ * @param count Number of strings
+ * @param font Font to measure in
+ * @param maxWidth Width lines wrap at in pixels, or 0 to never wrap
+ * @param metrics Array of count entries to receive each string's size and line breaks
+ * @return true if successful, false otherwise
+ */
+bool Text2Image_MeasureTextBatch(const char* const* texts, int count, const Text2Image_FontSpec* font, float maxWidth,
+                                 Text2Image_TextMetrics* metrics);
+
 /**
  * @brief Get the default render options
  * 
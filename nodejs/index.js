@@ -31,6 +31,85 @@ class Text2Image {
     return native.createTask(html, css, options);
   }
 
+  /**
+   * Create a task that renders many small items into one sheet in one pass
+   * @param {Object[]} items - Items as { html, css, width, height }
+   * @param {number} [output=AtlasOutput.SHEET] - SHEET for one image, CROPS for one image per item (as pages)
+   * @param {Object} [options={}] - Render options
+   * @returns {Object} Task object
+   */
+  createAtlasTask(items, output = native.AtlasOutput.SHEET, options = {}) {
+    return native.createAtlasTask(items, output, options);
+  }
+
+  /**
+   * Get where each item was placed in a rendered atlas
+   * @param {Object} task - Atlas task object
+   * @returns {Object[]} Rects as { x, y, width, height }, in item order
+   */
+  getAtlasRects(task) {
+    const rects = [];
+    for (let rect = native.getAtlasRect(task, 0); rect; rect = native.getAtlasRect(task, rects.length)) {
+      rects.push(rect);
+    }
+    return rects;
+  }
+
+  /**
+   * Create a render task that re-renders only what changed since a base task
+   * @param {Object} baseTask - Task rendered with the incremental option
+   * @param {string} html - HTML content
+   * @param {string} [css=''] - CSS styles
+   * @param {Object} [options={}] - Render options; set incremental to chain further renders
+   * @returns {Object} Task object
+   */
+  createIncrementalTask(baseTask, html, css = '', options = {}) {
+    return native.createIncrementalTask(baseTask, html, css, options);
+  }
+
+  /**
+   * Create a task that renders frames into one animated PNG or WebP
+   * @param {Object[]} frames - Frames as { html, duration }, duration in milliseconds (default 100)
+   * @param {string} [css=''] - CSS styles applied to every frame
+   * @param {Object} [options={}] - Render options; format must be PNG or WEBP
+   * @returns {Object} Task object
+   */
+  createAnimationTask(frames, css = '', options = {}) {
+    return native.createAnimationTask(frames, css, options);
+  }
+
+  /**
+   * Create a task that renders once and also returns smaller copies of the image
+   * @param {string} html - HTML content
+   * @param {string} css - CSS styles
+   * @param {Object[]} thumbnails - Sizes as { scale, maxSide }; either may be omitted
+   * @param {Object} [options={}] - Render options; paginate and incremental are not allowed
+   * @returns {Object} Task object; page 0 is the full image, page i + 1 is thumbnail i
+   */
+  createThumbnailTask(html, css, thumbnails, options = {}) {
+    return native.createThumbnailTask(html, css, thumbnails, options);
+  }
+
+  /**
+   * Create a render task from a compiled document
+   * @param {string} compiledPath - File written by compile()
+   * @param {Object} [options={}] - Render options; the canvas size comes from the compiled document
+   * @returns {Object} Task object
+   */
+  createTaskFromCompiled(compiledPath, options = {}) {
+    return native.createTaskFromCompiled(compiledPath, options);
+  }
+
+  /**
+   * Parse, style and lay out a task's document and save it for reuse
+   * @param {Object} task - Task object
+   * @param {string} outputPath - Path of the compiled document
+   * @returns {boolean} True if the document was written
+   */
+  compile(task, outputPath) {
+    return native.compile(task, outputPath);
+  }
+
   /**
    * Render a task synchronously
    * @param {Object} task - Task object
@@ -64,6 +143,39 @@ class Text2Image {
     return native.getResult(task);
   }
 
+  /**
+   * Get the number of pages produced by a render
+   * @param {Object} task - Task object
+   * @returns {number} Page count (1 without pagination)
+   */
+  getPageCount(task) {
+    return native.getPageCount(task);
+  }
+
+  /**
+   * Get the image data of one page
+   * @param {Object} task - Task object
+   * @param {number} pageIndex - Zero-based page index
+   * @returns {Buffer} Image data buffer
+   */
+  getPageResult(task, pageIndex) {
+    return native.getPageResult(task, pageIndex);
+  }
+
+  /**
+   * Get the image data of every page
+   * @param {Object} task - Task object
+   * @returns {Buffer[]} Image data buffers in page order
+   */
+  getPages(task) {
+    const pages = [];
+    const count = native.getPageCount(task);
+    for (let i = 0; i < count; i++) {
+      pages.push(native.getPageResult(task, i));
+    }
+    return pages;
+  }
+
   /**
    * Free a task
    * @param {Object} task - Task object
@@ -88,6 +200,49 @@ class Text2Image {
     native.setMaxThreads(numThreads);
   }
 
+  /**
+   * Allow documents to embed local image files from a directory
+   * @param {string|null} directory - Existing directory, or null to disable local files (the default)
+   */
+  setLocalImageDirectory(directory) {
+    native.setLocalImageDirectory(directory);
+  }
+
+  /**
+   * Set the budget of the font cache
+   * @param {number} byteLimit - Most bytes the cache may hold (0 = keep current)
+   * @param {number} countLimit - Most font strikes the cache may hold (0 = keep current)
+   */
+  setFontCacheLimits(byteLimit, countLimit) {
+    native.setFontCacheLimits(byteLimit, countLimit);
+  }
+
+  /**
+   * Empty the font cache
+   */
+  purgeFontCache() {
+    native.purgeFontCache();
+  }
+
+  /**
+   * Get cache statistics
+   * @returns {Object} Font cache usage, limits and hit/miss counters
+   */
+  getMetrics() {
+    return native.getMetrics();
+  }
+
+  /**
+   * Measure text without rendering it
+   * @param {string|string[]} text - Text, or an array of texts measured in one call
+   * @param {Object} font - Font: {family, size, weight, italic, lineHeight}
+   * @param {number} [maxWidth=0] - Width lines wrap at in pixels (0 = never wrap)
+   * @returns {Object|Object[]} {width, height, lineCount, lineEnds} per text; lineEnds are string indices, so text.slice(0, lineEnds[0]) is the first line
+   */
+  measureText(text, font, maxWidth = 0) {
+    return native.measureText(text, font, maxWidth);
+  }
+
   /**
    * Get default render options
    * @returns {Object} Default render options
@@ -111,6 +266,9 @@ class Text2Image {
 const Resolution = native.Resolution;
 const Format = native.Format;
 const BackgroundType = native.BackgroundType;
+const InputFormat = native.InputFormat;
+const AtlasOutput = native.AtlasOutput;
+const RenderQuality = native.RenderQuality;
 
 // Export the module
 module.exports = {
@@ -118,18 +276,36 @@ module.exports = {
   Resolution,
   Format,
   BackgroundType,
+  InputFormat,
+  AtlasOutput,
+  RenderQuality,
   
   // Create a default instance
   instance: new Text2Image(),
   
   // Export methods for convenience (using default instance)
   createTask: (html, css, options) => module.exports.instance.createTask(html, css, options),
+  createAtlasTask: (items, output, options) => module.exports.instance.createAtlasTask(items, output, options),
+  getAtlasRects: (task) => module.exports.instance.getAtlasRects(task),
+  createIncrementalTask: (baseTask, html, css, options) => module.exports.instance.createIncrementalTask(baseTask, html, css, options),
+  createAnimationTask: (frames, css, options) => module.exports.instance.createAnimationTask(frames, css, options),
+  createThumbnailTask: (html, css, thumbnails, options) => module.exports.instance.createThumbnailTask(html, css, thumbnails, options),
+  createTaskFromCompiled: (compiledPath, options) => module.exports.instance.createTaskFromCompiled(compiledPath, options),
+  compile: (task, outputPath) => module.exports.instance.compile(task, outputPath),
   render: (task, outputPath) => module.exports.instance.render(task, outputPath),
   renderAsync: (task, outputPath, callback) => module.exports.instance.renderAsync(task, outputPath, callback),
   getResult: (task) => module.exports.instance.getResult(task),
+  getPageCount: (task) => module.exports.instance.getPageCount(task),
+  getPageResult: (task, pageIndex) => module.exports.instance.getPageResult(task, pageIndex),
+  getPages: (task) => module.exports.instance.getPages(task),
   freeTask: (task) => module.exports.instance.freeTask(task),
   getLastError: () => module.exports.instance.getLastError(),
   setMaxThreads: (numThreads) => module.exports.instance.setMaxThreads(numThreads),
+  setLocalImageDirectory: (directory) => module.exports.instance.setLocalImageDirectory(directory),
+  setFontCacheLimits: (byteLimit, countLimit) => module.exports.instance.setFontCacheLimits(byteLimit, countLimit),
+  purgeFontCache: () => module.exports.instance.purgeFontCache(),
+  getMetrics: () => module.exports.instance.getMetrics(),
+  measureText: (text, font, maxWidth) => module.exports.instance.measureText(text, font, maxWidth),
   getDefaultOptions: () => module.exports.instance.getDefaultOptions(),
   shutdown: () => module.exports.instance.shutdown()
 };
\ No newline at end of file
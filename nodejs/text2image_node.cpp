@@ -16,12 +16,26 @@
 Napi::Value Initialize(const Napi::CallbackInfo& info);
 Napi::Value Shutdown(const Napi::CallbackInfo& info);
 Napi::Value CreateTask(const Napi::CallbackInfo& info);
+Napi::Value CreateAtlasTask(const Napi::CallbackInfo& info);
+Napi::Value GetAtlasRect(const Napi::CallbackInfo& info);
+Napi::Value CreateIncrementalTask(const Napi::CallbackInfo& info);
+Napi::Value CreateAnimationTask(const Napi::CallbackInfo& info);
+Napi::Value CreateThumbnailTask(const Napi::CallbackInfo& info);
+Napi::Value CreateTaskFromCompiled(const Napi::CallbackInfo& info);
+Napi::Value Compile(const Napi::CallbackInfo& info);
 Napi::Value Render(const Napi::CallbackInfo& info);
 Napi::Value RenderAsync(const Napi::CallbackInfo& info);
 Napi::Value GetResult(const Napi::CallbackInfo& info);
+Napi::Value GetPageCount(const Napi::CallbackInfo& info);
+Napi::Value GetPageResult(const Napi::CallbackInfo& info);
 Napi::Value FreeTask(const Napi::CallbackInfo& info);
 Napi::Value GetLastError(const Napi::CallbackInfo& info);
 Napi::Value SetMaxThreads(const Napi::CallbackInfo& info);
+Napi::Value SetLocalImageDirectory(const Napi::CallbackInfo& info);
+Napi::Value SetFontCacheLimits(const Napi::CallbackInfo& info);
+Napi::Value PurgeFontCache(const Napi::CallbackInfo& info);
+Napi::Value GetMetrics(const Napi::CallbackInfo& info);
+Napi::Value MeasureText(const Napi::CallbackInfo& info);
 Napi::Value GetDefaultOptions(const Napi::CallbackInfo& info);
 
 // Task reference management
@@ -72,12 +86,26 @@ Napi::Object InitModule(Napi::Env env, Napi::Object exports) {
     exports.Set("initialize", Napi::Function::New<Initialize>(env));
     exports.Set("shutdown", Napi::Function::New<Shutdown>(env));
     exports.Set("createTask", Napi::Function::New<CreateTask>(env));
+    exports.Set("createAtlasTask", Napi::Function::New<CreateAtlasTask>(env));
+    exports.Set("getAtlasRect", Napi::Function::New<GetAtlasRect>(env));
+    exports.Set("createIncrementalTask", Napi::Function::New<CreateIncrementalTask>(env));
+    exports.Set("createAnimationTask", Napi::Function::New<CreateAnimationTask>(env));
+    exports.Set("createThumbnailTask", Napi::Function::New<CreateThumbnailTask>(env));
+    exports.Set("createTaskFromCompiled", Napi::Function::New<CreateTaskFromCompiled>(env));
+    exports.Set("compile", Napi::Function::New<Compile>(env));
     exports.Set("render", Napi::Function::New<Render>(env));
     exports.Set("renderAsync", Napi::Function::New<RenderAsync>(env));
     exports.Set("getResult", Napi::Function::New<GetResult>(env));
+    exports.Set("getPageCount", Napi::Function::New<GetPageCount>(env));
+    exports.Set("getPageResult", Napi::Function::New<GetPageResult>(env));
     exports.Set("freeTask", Napi::Function::New<FreeTask>(env));
     exports.Set("getLastError", Napi::Function::New<GetLastError>(env));
     exports.Set("setMaxThreads", Napi::Function::New<SetMaxThreads>(env));
+    exports.Set("setLocalImageDirectory", Napi::Function::New<SetLocalImageDirectory>(env));
+    exports.Set("setFontCacheLimits", Napi::Function::New<SetFontCacheLimits>(env));
+    exports.Set("purgeFontCache", Napi::Function::New<PurgeFontCache>(env));
+    exports.Set("getMetrics", Napi::Function::New<GetMetrics>(env));
+    exports.Set("measureText", Napi::Function::New<MeasureText>(env));
     exports.Set("getDefaultOptions", Napi::Function::New<GetDefaultOptions>(env));
 
     // Export constants
@@ -108,6 +136,23 @@ Napi::Object InitModule(Napi::Env env, Napi::Object exports) {
     backgroundType.Set("IMAGE", Napi::Number::New(env, TEXT2IMAGE_BACKGROUND_IMAGE));
     exports.Set("BackgroundType", backgroundType);
 
+    Napi::Object inputFormat = Napi::Object::New(env);
+    inputFormat.Set("AUTO", Napi::Number::New(env, TEXT2IMAGE_INPUT_AUTO));
+    inputFormat.Set("HTML", Napi::Number::New(env, TEXT2IMAGE_INPUT_HTML));
+    inputFormat.Set("PLAIN_TEXT", Napi::Number::New(env, TEXT2IMAGE_INPUT_PLAIN_TEXT));
+    inputFormat.Set("MARKDOWN", Napi::Number::New(env, TEXT2IMAGE_INPUT_MARKDOWN));
+    exports.Set("InputFormat", inputFormat);
+
+    Napi::Object atlasOutput = Napi::Object::New(env);
+    atlasOutput.Set("SHEET", Napi::Number::New(env, TEXT2IMAGE_ATLAS_SHEET));
+    atlasOutput.Set("CROPS", Napi::Number::New(env, TEXT2IMAGE_ATLAS_CROPS));
+    exports.Set("AtlasOutput", atlasOutput);
+
+    Napi::Object renderQuality = Napi::Object::New(env);
+    renderQuality.Set("FULL", Napi::Number::New(env, TEXT2IMAGE_RENDER_QUALITY_FULL));
+    renderQuality.Set("DRAFT", Napi::Number::New(env, TEXT2IMAGE_RENDER_QUALITY_DRAFT));
+    exports.Set("RenderQuality", renderQuality);
+
     return exports;
 }
 
@@ -178,9 +223,72 @@ Text2Image_RenderOptions ConvertOptions(const Napi::Object& jsOptions) {
         options.timeout = jsOptions.Get("timeout").ToNumber().Int32Value();
     }
 
+    // Input format
+    if (jsOptions.Has("inputFormat")) {
+        options.inputFormat = static_cast<Text2Image_InputFormat>(jsOptions.Get("inputFormat").ToNumber().Int32Value());
+    }
+
+    // Pagination
+    if (jsOptions.Has("paginate")) {
+        options.paginate = jsOptions.Get("paginate").ToBoolean().Value();
+    }
+
+    // Debugging
+    if (jsOptions.Has("debugOverdraw")) {
+        options.debugOverdraw = jsOptions.Get("debugOverdraw").ToBoolean().Value();
+    }
+
+    // Incremental rendering
+    if (jsOptions.Has("incremental")) {
+        options.incremental = jsOptions.Get("incremental").ToBoolean().Value();
+    }
+
+    // Quality tier
+    if (jsOptions.Has("renderQuality")) {
+        options.renderQuality = static_cast<Text2Image_RenderQuality>(jsOptions.Get("renderQuality").ToNumber().Int32Value());
+    }
+
+    // High-DPI output
+    if (jsOptions.Has("devicePixelRatio")) {
+        options.devicePixelRatio = jsOptions.Get("devicePixelRatio").ToNumber().FloatValue();
+    }
+
     return options;
 }
 
+// Wrap a task handle in a JavaScript object. The handle is copied to the
+// heap, since the External outlives the caller's stack frame.
+Napi::Object WrapTask(Napi::Env env, Text2Image_TaskHandle task) {
+    Napi::Object taskObj = Napi::Object::New(env);
+    taskObj.Set("handle", Napi::External<Text2Image_TaskHandle>::New(env, new Text2Image_TaskHandle(task),
+        [](Napi::Env, Text2Image_TaskHandle* handle) { delete handle; }));
+
+    // Store a reference to the task object
+    {
+        std::lock_guard<std::mutex> lock(g_taskRefsMutex);
+        g_taskRefs[task] = Napi::ObjectReference::New(taskObj);
+    }
+
+    return taskObj;
+}
+
+// Convert ascending UTF-8 byte offsets into text to UTF-16 code unit
+// indices, as JavaScript strings count them, in one pass over the text
+void ConvertToUtf16Offsets(const std::string& text, size_t* offsets, int count) {
+    size_t byte = 0;
+    size_t units = 0;
+    for (int i = 0; i < count; ++i) {
+        for (; byte < offsets[i] && byte < text.size(); ++byte) {
+            unsigned char c = static_cast<unsigned char>(text[byte]);
+            if ((c & 0xC0) != 0x80) {
+                // Characters past the BMP take a surrogate pair
+                units += c >= 0xF0 ? 2 : 1;
+            }
+        }
+        offsets[i] = units;
+    }
+}
+
 // CreateTask function
 Napi::Value CreateTask(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
@@ -213,17 +321,305 @@ Napi::Value CreateTask(const Napi::CallbackInfo& info) {
         return env.Null();
     }
 
-    // Create a JavaScript object to hold the task handle
-    Napi::Object taskObj = Napi::Object::New(env);
-    taskObj.Set("handle", Napi::External<Text2Image_TaskHandle>::New(env, &task));
+    return WrapTask(env, task);
+}
 
-    // Store a reference to the task object
-    {
-        std::lock_guard<std::mutex> lock(g_taskRefsMutex);
-        g_taskRefs[task] = Napi::ObjectReference::New(taskObj);
+// CreateAtlasTask function
+Napi::Value CreateAtlasTask(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    // Check arguments
+    if (info.Length() < 1 || !info[0].IsArray()) {
+        Napi::Error::New(env, "Expected an array of atlas items").ThrowAsJavaScriptException();
+        return env.Null();
     }
 
-    return taskObj;
+    // Copy the items; the strings must outlive the call below
+    Napi::Array jsItems = info[0].As<Napi::Array>();
+    std::vector<std::string> strings;
+    strings.reserve(jsItems.Length() * 2);
+    std::vector<Text2Image_AtlasItem> items(jsItems.Length());
+    for (uint32_t i = 0; i < jsItems.Length(); ++i) {
+        Napi::Value value = jsItems.Get(i);
+        if (!value.IsObject()) {
+            Napi::Error::New(env, "Atlas items must be objects").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        Napi::Object jsItem = value.ToObject();
+        strings.push_back(jsItem.Has("html") ? jsItem.Get("html").ToString().Utf8Value() : "");
+        strings.push_back(jsItem.Has("css") && !jsItem.Get("css").IsNull() && !jsItem.Get("css").IsUndefined()
+                              ? jsItem.Get("css").ToString().Utf8Value() : "");
+        items[i].width = jsItem.Has("width") ? jsItem.Get("width").ToNumber().Int32Value() : 0;
+        items[i].height = jsItem.Has("height") ? jsItem.Get("height").ToNumber().Int32Value() : 0;
+    }
+    for (size_t i = 0; i < items.size(); ++i) {
+        items[i].html = strings[i * 2].c_str();
+        items[i].css = strings[i * 2 + 1].c_str();
+    }
+
+    // Get output mode (optional)
+    Text2Image_AtlasOutput output = TEXT2IMAGE_ATLAS_SHEET;
+    if (info.Length() > 1 && info[1].IsNumber()) {
+        output = static_cast<Text2Image_AtlasOutput>(info[1].ToNumber().Int32Value());
+    }
+
+    // Get options (optional)
+    Text2Image_RenderOptions options = Text2Image_GetDefaultOptions();
+    if (info.Length() > 2 && info[2].IsObject()) {
+        options = ConvertOptions(info[2].ToObject());
+    }
+
+    Text2Image_TaskHandle task = Text2Image_CreateAtlasTask(items.data(), static_cast<int>(items.size()), output, &options);
+    if (!task) {
+        Napi::Error::New(env, Text2Image_GetLastError()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    return WrapTask(env, task);
+}
+
+// GetAtlasRect function
+Napi::Value GetAtlasRect(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    // Check arguments
+    if (info.Length() < 2) {
+        Napi::Error::New(env, "Expected 2 arguments (task, index)").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    // Get task handle
+    Text2Image_TaskHandle task = nullptr;
+    if (info[0].IsObject()) {
+        Napi::Object taskObj = info[0].ToObject();
+        if (taskObj.Has("handle") && taskObj.Get("handle").IsExternal()) {
+            task = *taskObj.Get("handle").As<Napi::External<Text2Image_TaskHandle>>().Data();
+        }
+    }
+
+    if (!task) {
+        Napi::Error::New(env, "Invalid task object").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    // Past the last item there is nothing to return
+    Text2Image_AtlasRect rect;
+    if (!Text2Image_GetAtlasRect(task, info[1].ToNumber().Int32Value(), &rect)) {
+        return env.Null();
+    }
+
+    Napi::Object jsRect = Napi::Object::New(env);
+    jsRect.Set("x", Napi::Number::New(env, rect.x));
+    jsRect.Set("y", Napi::Number::New(env, rect.y));
+    jsRect.Set("width", Napi::Number::New(env, rect.width));
+    jsRect.Set("height", Napi::Number::New(env, rect.height));
+    return jsRect;
+}
+
+// CreateIncrementalTask function
+Napi::Value CreateIncrementalTask(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    // Check arguments
+    if (info.Length() < 2) {
+        Napi::Error::New(env, "Expected at least 2 arguments (baseTask, html)").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    // Get base task handle
+    Text2Image_TaskHandle baseTask = nullptr;
+    if (info[0].IsObject()) {
+        Napi::Object taskObj = info[0].ToObject();
+        if (taskObj.Has("handle") && taskObj.Get("handle").IsExternal()) {
+            baseTask = *taskObj.Get("handle").As<Napi::External<Text2Image_TaskHandle>>().Data();
+        }
+    }
+
+    if (!baseTask) {
+        Napi::Error::New(env, "Invalid base task object").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    std::string html = info[1].ToString().Utf8Value();
+
+    // Get CSS content (optional)
+    std::string css = "";
+    if (info.Length() > 2 && !info[2].IsUndefined() && !info[2].IsNull()) {
+        css = info[2].ToString().Utf8Value();
+    }
+
+    // Get options (optional)
+    Text2Image_RenderOptions options = Text2Image_GetDefaultOptions();
+    if (info.Length() > 3 && info[3].IsObject()) {
+        options = ConvertOptions(info[3].ToObject());
+    }
+
+    Text2Image_TaskHandle task = Text2Image_CreateIncrementalTask(baseTask, html.c_str(), css.c_str(), &options);
+    if (!task) {
+        Napi::Error::New(env, Text2Image_GetLastError()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    return WrapTask(env, task);
+}
+
+// CreateAnimationTask function
+Napi::Value CreateAnimationTask(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    // Check arguments
+    if (info.Length() < 1 || !info[0].IsArray()) {
+        Napi::Error::New(env, "Expected an array of frames").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    // Copy the frames; the strings must outlive the call below
+    Napi::Array jsFrames = info[0].As<Napi::Array>();
+    std::vector<std::string> strings;
+    strings.reserve(jsFrames.Length());
+    std::vector<Text2Image_Frame> frames(jsFrames.Length());
+    for (uint32_t i = 0; i < jsFrames.Length(); ++i) {
+        Napi::Value value = jsFrames.Get(i);
+        if (!value.IsObject()) {
+            Napi::Error::New(env, "Frames must be objects").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        Napi::Object jsFrame = value.ToObject();
+        strings.push_back(jsFrame.Has("html") ? jsFrame.Get("html").ToString().Utf8Value() : "");
+        frames[i].duration = jsFrame.Has("duration") ? jsFrame.Get("duration").ToNumber().Int32Value() : 100;
+    }
+    for (size_t i = 0; i < frames.size(); ++i) {
+        frames[i].html = strings[i].c_str();
+    }
+
+    // Get CSS content (optional)
+    std::string css = "";
+    if (info.Length() > 1 && !info[1].IsUndefined() && !info[1].IsNull()) {
+        css = info[1].ToString().Utf8Value();
+    }
+
+    // Get options (optional)
+    Text2Image_RenderOptions options = Text2Image_GetDefaultOptions();
+    if (info.Length() > 2 && info[2].IsObject()) {
+        options = ConvertOptions(info[2].ToObject());
+    }
+
+    Text2Image_TaskHandle task = Text2Image_CreateAnimationTask(frames.data(), static_cast<int>(frames.size()), css.c_str(), &options);
+    if (!task) {
+        Napi::Error::New(env, Text2Image_GetLastError()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    return WrapTask(env, task);
+}
+
+// CreateThumbnailTask function
+Napi::Value CreateThumbnailTask(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    // Check arguments
+    if (info.Length() < 3 || !info[2].IsArray()) {
+        Napi::Error::New(env, "Expected html, css and an array of thumbnails").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    // Get HTML content
+    std::string html = info[0].ToString().Utf8Value();
+
+    // Get CSS content (optional)
+    std::string css = "";
+    if (!info[1].IsUndefined() && !info[1].IsNull()) {
+        css = info[1].ToString().Utf8Value();
+    }
+
+    // Copy the thumbnail sizes
+    Napi::Array jsThumbnails = info[2].As<Napi::Array>();
+    std::vector<Text2Image_Thumbnail> thumbnails(jsThumbnails.Length());
+    for (uint32_t i = 0; i < jsThumbnails.Length(); ++i) {
+        Napi::Value value = jsThumbnails.Get(i);
+        if (!value.IsObject()) {
+            Napi::Error::New(env, "Thumbnails must be objects").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        Napi::Object jsThumbnail = value.ToObject();
+        thumbnails[i].scale = jsThumbnail.Has("scale") ? jsThumbnail.Get("scale").ToNumber().FloatValue() : 0.0f;
+        thumbnails[i].maxSide = jsThumbnail.Has("maxSide") ? jsThumbnail.Get("maxSide").ToNumber().Int32Value() : 0;
+    }
+
+    // Get options (optional)
+    Text2Image_RenderOptions options = Text2Image_GetDefaultOptions();
+    if (info.Length() > 3 && info[3].IsObject()) {
+        options = ConvertOptions(info[3].ToObject());
+    }
+
+    Text2Image_TaskHandle task = Text2Image_CreateThumbnailTask(html.c_str(), css.c_str(), thumbnails.data(),
+                                                                static_cast<int>(thumbnails.size()), &options);
+    if (!task) {
+        Napi::Error::New(env, Text2Image_GetLastError()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    return WrapTask(env, task);
+}
+
+// CreateTaskFromCompiled function
+Napi::Value CreateTaskFromCompiled(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    // Check arguments
+    if (info.Length() < 1) {
+        Napi::Error::New(env, "Expected at least 1 argument (compiledPath)").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    std::string compiledPath = info[0].ToString().Utf8Value();
+
+    // Get options (optional)
+    Text2Image_RenderOptions options = Text2Image_GetDefaultOptions();
+    if (info.Length() > 1 && info[1].IsObject()) {
+        options = ConvertOptions(info[1].ToObject());
+    }
+
+    Text2Image_TaskHandle task = Text2Image_CreateTaskFromCompiled(compiledPath.c_str(), &options);
+    if (!task) {
+        Napi::Error::New(env, Text2Image_GetLastError()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    return WrapTask(env, task);
+}
+
+// Compile function
+Napi::Value Compile(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    // Check arguments
+    if (info.Length() < 2) {
+        Napi::Error::New(env, "Expected 2 arguments (task, outputPath)").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    // Get task handle
+    Text2Image_TaskHandle task = nullptr;
+    if (info[0].IsObject()) {
+        Napi::Object taskObj = info[0].ToObject();
+        if (taskObj.Has("handle") && taskObj.Get("handle").IsExternal()) {
+            task = *taskObj.Get("handle").As<Napi::External<Text2Image_TaskHandle>>().Data();
+        }
+    }
+
+    if (!task) {
+        Napi::Error::New(env, "Invalid task object").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    std::string outputPath = info[1].ToString().Utf8Value();
+    if (!Text2Image_Compile(task, outputPath.c_str())) {
+        Napi::Error::New(env, Text2Image_GetLastError()).ThrowAsJavaScriptException();
+        return Napi::Boolean::New(env, false);
+    }
+
+    return Napi::Boolean::New(env, true);
 }
 
 // Render function
@@ -348,6 +744,73 @@ Napi::Value GetResult(const Napi::CallbackInfo& info) {
     return bufferObj;
 }
 
+// GetPageCount function
+Napi::Value GetPageCount(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    // Check arguments
+    if (info.Length() < 1) {
+        Napi::Error::New(env, "Expected at least 1 argument (task)").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    // Get task handle
+    Text2Image_TaskHandle task = nullptr;
+    if (info[0].IsObject()) {
+        Napi::Object taskObj = info[0].ToObject();
+        if (taskObj.Has("handle") && taskObj.Get("handle").IsExternal()) {
+            task = *taskObj.Get("handle").As<Napi::External<Text2Image_TaskHandle>>().Data();
+        }
+    }
+
+    if (!task) {
+        Napi::Error::New(env, "Invalid task object").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    return Napi::Number::New(env, Text2Image_GetPageCount(task));
+}
+
+// GetPageResult function
+Napi::Value GetPageResult(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    // Check arguments
+    if (info.Length() < 2) {
+        Napi::Error::New(env, "Expected at least 2 arguments (task, pageIndex)").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    // Get task handle
+    Text2Image_TaskHandle task = nullptr;
+    if (info[0].IsObject()) {
+        Napi::Object taskObj = info[0].ToObject();
+        if (taskObj.Has("handle") && taskObj.Get("handle").IsExternal()) {
+            task = *taskObj.Get("handle").As<Napi::External<Text2Image_TaskHandle>>().Data();
+        }
+    }
+
+    if (!task) {
+        Napi::Error::New(env, "Invalid task object").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    // Get the page
+    int pageIndex = info[1].ToNumber().Int32Value();
+    uint8_t* buffer = nullptr;
+    size_t size = 0;
+    if (!Text2Image_GetPageResult(task, pageIndex, &buffer, &size)) {
+        Napi::Error::New(env, Text2Image_GetLastError()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    // Copy into a Buffer so the native allocation can be released here
+    Napi::Buffer<uint8_t> bufferObj = Napi::Buffer<uint8_t>::Copy(env, buffer, size);
+    Text2Image_FreeBuffer(buffer);
+
+    return bufferObj;
+}
+
 // FreeTask function
 Napi::Value FreeTask(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
@@ -417,6 +880,168 @@ Napi::Value SetMaxThreads(const Napi::CallbackInfo& info) {
     return env.Undefined();
 }
 
+// SetLocalImageDirectory function
+Napi::Value SetLocalImageDirectory(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    // null, undefined or "" turns local images off
+    std::string directory;
+    if (info.Length() >= 1 && info[0].IsString()) {
+        directory = info[0].As<Napi::String>().Utf8Value();
+    }
+
+    if (!Text2Image_SetLocalImageDirectory(directory.c_str())) {
+        Napi::Error::New(env, Text2Image_GetLastError()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    return env.Undefined();
+}
+
+// SetFontCacheLimits function
+Napi::Value SetFontCacheLimits(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    // Check arguments
+    if (info.Length() < 2) {
+        Napi::Error::New(env, "Expected at least 2 arguments (byteLimit, countLimit)").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    // Get limits; 0 keeps the current one
+    size_t byteLimit = static_cast<size_t>(info[0].ToNumber().Int64Value());
+    int countLimit = info[1].ToNumber().Int32Value();
+
+    // Set limits
+    if (!Text2Image_SetFontCacheLimits(byteLimit, countLimit)) {
+        Napi::Error::New(env, Text2Image_GetLastError()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    return env.Undefined();
+}
+
+// PurgeFontCache function
+Napi::Value PurgeFontCache(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    Text2Image_PurgeFontCache();
+    return env.Undefined();
+}
+
+// GetMetrics function
+Napi::Value GetMetrics(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    // Get metrics
+    Text2Image_Metrics metrics;
+    if (!Text2Image_GetMetrics(&metrics)) {
+        Napi::Error::New(env, Text2Image_GetLastError()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    // Create JavaScript object
+    Napi::Object jsMetrics = Napi::Object::New(env);
+    jsMetrics.Set("fontCacheBytesUsed", Napi::Number::New(env, static_cast<double>(metrics.fontCacheBytesUsed)));
+    jsMetrics.Set("fontCacheByteLimit", Napi::Number::New(env, static_cast<double>(metrics.fontCacheByteLimit)));
+    jsMetrics.Set("fontCacheCountUsed", Napi::Number::New(env, metrics.fontCacheCountUsed));
+    jsMetrics.Set("fontCacheCountLimit", Napi::Number::New(env, metrics.fontCacheCountLimit));
+    jsMetrics.Set("fontCachePurges", Napi::Number::New(env, static_cast<double>(metrics.fontCachePurges)));
+    jsMetrics.Set("typefaceHits", Napi::Number::New(env, static_cast<double>(metrics.typefaceHits)));
+    jsMetrics.Set("typefaceMisses", Napi::Number::New(env, static_cast<double>(metrics.typefaceMisses)));
+    jsMetrics.Set("typefaceEvictions", Napi::Number::New(env, static_cast<double>(metrics.typefaceEvictions)));
+    jsMetrics.Set("glyphTableHits", Napi::Number::New(env, static_cast<double>(metrics.glyphTableHits)));
+    jsMetrics.Set("glyphTableMisses", Napi::Number::New(env, static_cast<double>(metrics.glyphTableMisses)));
+    jsMetrics.Set("glyphTableEvictions", Napi::Number::New(env, static_cast<double>(metrics.glyphTableEvictions)));
+    jsMetrics.Set("fallbackPagesBuilt", Napi::Number::New(env, static_cast<double>(metrics.fallbackPagesBuilt)));
+    jsMetrics.Set("fallbackTypefacesOpened", Napi::Number::New(env, static_cast<double>(metrics.fallbackTypefacesOpened)));
+
+    return jsMetrics;
+}
+
+// MeasureText function
+Napi::Value MeasureText(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    // Check arguments
+    if (info.Length() < 2 || !info[1].IsObject()) {
+        Napi::Error::New(env, "Expected text or an array of texts, and a font").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    // Get texts; a single string gives a single result
+    const bool batch = info[0].IsArray();
+    std::vector<std::string> texts;
+    if (batch) {
+        Napi::Array jsTexts = info[0].As<Napi::Array>();
+        texts.reserve(jsTexts.Length());
+        for (uint32_t i = 0; i < jsTexts.Length(); ++i) {
+            texts.push_back(jsTexts.Get(i).ToString().Utf8Value());
+        }
+    }
+    else {
+        texts.push_back(info[0].ToString().Utf8Value());
+    }
+    if (texts.empty()) {
+        return Napi::Array::New(env, 0);
+    }
+
+    // Get font
+    Napi::Object jsFont = info[1].ToObject();
+    std::string family = jsFont.Has("family") ? jsFont.Get("family").ToString().Utf8Value() : "";
+    Text2Image_FontSpec font;
+    font.fontFamily = family.empty() ? nullptr : family.c_str();
+    font.fontSize = jsFont.Has("size") ? jsFont.Get("size").ToNumber().FloatValue() : 16.0f;
+    font.fontWeight = jsFont.Has("weight") ? jsFont.Get("weight").ToNumber().Int32Value() : 400;
+    font.italic = jsFont.Has("italic") ? jsFont.Get("italic").ToBoolean().Value() : false;
+    font.lineHeight = jsFont.Has("lineHeight") ? jsFont.Get("lineHeight").ToNumber().FloatValue() : 0.0f;
+
+    // Get max width (optional)
+    float maxWidth = 0.0f;
+    if (info.Length() > 2 && info[2].IsNumber()) {
+        maxWidth = info[2].ToNumber().FloatValue();
+    }
+
+    // A string has at most one line per byte, plus one
+    std::vector<const char*> pointers;
+    std::vector<Text2Image_TextMetrics> metrics(texts.size());
+    size_t totalEnds = 0;
+    for (const std::string& text : texts) {
+        totalEnds += text.size() + 1;
+    }
+    std::vector<size_t> lineEnds(totalEnds);
+    size_t next = 0;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        pointers.push_back(texts[i].c_str());
+        metrics[i].lineEnds = lineEnds.data() + next;
+        metrics[i].lineEndCapacity = static_cast<int>(texts[i].size() + 1);
+        next += texts[i].size() + 1;
+    }
+
+    // Measure
+    if (!Text2Image_MeasureTextBatch(pointers.data(), static_cast<int>(pointers.size()), &font, maxWidth, metrics.data())) {
+        Napi::Error::New(env, Text2Image_GetLastError()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    // Create JavaScript objects
+    Napi::Array results = Napi::Array::New(env, metrics.size());
+    for (size_t i = 0; i < metrics.size(); ++i) {
+        ConvertToUtf16Offsets(texts[i], metrics[i].lineEnds, metrics[i].lineCount);
+        Napi::Array jsLineEnds = Napi::Array::New(env, metrics[i].lineCount);
+        for (int line = 0; line < metrics[i].lineCount; ++line) {
+            jsLineEnds.Set(static_cast<uint32_t>(line), Napi::Number::New(env, static_cast<double>(metrics[i].lineEnds[line])));
+        }
+        Napi::Object jsMetrics = Napi::Object::New(env);
+        jsMetrics.Set("width", Napi::Number::New(env, metrics[i].width));
+        jsMetrics.Set("height", Napi::Number::New(env, metrics[i].height));
+        jsMetrics.Set("lineCount", Napi::Number::New(env, metrics[i].lineCount));
+        jsMetrics.Set("lineEnds", jsLineEnds);
+        results.Set(static_cast<uint32_t>(i), jsMetrics);
+    }
+
+    return batch ? Napi::Value(results) : results.Get(0u);
+}
+
 // GetDefaultOptions function
 Napi::Value GetDefaultOptions(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
@@ -437,6 +1062,12 @@ Napi::Value GetDefaultOptions(const Napi::CallbackInfo& info) {
     jsOptions.Set("borderRadius", Napi::Number::New(env, options.borderRadius));
     jsOptions.Set("enableJavaScript", Napi::Boolean::New(env, options.enableJavaScript));
     jsOptions.Set("timeout", Napi::Number::New(env, options.timeout));
+    jsOptions.Set("inputFormat", Napi::Number::New(env, options.inputFormat));
+    jsOptions.Set("paginate", Napi::Boolean::New(env, options.paginate));
+    jsOptions.Set("debugOverdraw", Napi::Boolean::New(env, options.debugOverdraw));
+    jsOptions.Set("incremental", Napi::Boolean::New(env, options.incremental));
+    jsOptions.Set("renderQuality", Napi::Number::New(env, options.renderQuality));
+    jsOptions.Set("devicePixelRatio", Napi::Number::New(env, options.devicePixelRatio));
 
     return jsOptions;
 }
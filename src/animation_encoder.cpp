@@ -0,0 +1,193 @@
+/*
+ * Text2Image Animation Encoder Implementation
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the implementation of the AnimationEncoder class.
+ */
+
+#include "animation_encoder.h"
+#include "png_band_encoder.h"
+#include "text2image_internal.h"
+
+#include <webp/encode.h>
+#include <webp/mux.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+
+namespace text2image {
+
+namespace {
+
+const uint8_t kPngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+void putUint32(uint8_t* out, uint32_t value) {
+    out[0] = static_cast<uint8_t>(value >> 24);
+    out[1] = static_cast<uint8_t>(value >> 16);
+    out[2] = static_cast<uint8_t>(value >> 8);
+    out[3] = static_cast<uint8_t>(value);
+}
+
+void putUint16(uint8_t* out, uint16_t value) {
+    out[0] = static_cast<uint8_t>(value >> 8);
+    out[1] = static_cast<uint8_t>(value);
+}
+
+void forEachFrame(ThreadPool* pool, size_t count, const std::function<void(size_t)>& body) {
+    if (pool && count > 1) {
+        pool->parallelFor(count, body);
+    }
+    else {
+        for (size_t i = 0; i < count; ++i) {
+            body(i);
+        }
+    }
+}
+
+} // namespace
+
+bool AnimationEncoder::encodeApng(int width, int height, const std::vector<AnimationFrame>& frames, ThreadPool* pool,
+                                  std::vector<uint8_t>& output) {
+    if (frames.empty() || frames.front().width != width || frames.front().height != height) {
+        return false;
+    }
+
+    // One color type for every frame
+    bool opaque = true;
+    for (const AnimationFrame& frame : frames) {
+        opaque = opaque && frame.opaque;
+    }
+    const int channels = opaque ? 3 : 4;
+
+    std::vector<std::vector<uint8_t>> streams(frames.size());
+    std::atomic<bool> failed(false);
+    forEachFrame(pool, frames.size(), [&](size_t i) {
+        const AnimationFrame& frame = frames[i];
+        if (!PngBandEncoder::compress(frame.rgba, frame.width, frame.height, channels, streams[i])) {
+            failed = true;
+        }
+    });
+    if (failed) {
+        return false;
+    }
+
+    output.assign(kPngSignature, kPngSignature + sizeof(kPngSignature));
+    uint8_t header[13];
+    putUint32(header, static_cast<uint32_t>(width));
+    putUint32(header + 4, static_cast<uint32_t>(height));
+    header[8] = 8;                               // Bit depth
+    header[9] = opaque ? 2 : 6;                  // Truecolor, with alpha unless opaque
+    header[10] = 0;                              // Deflate
+    header[11] = 0;                              // Adaptive filtering
+    header[12] = 0;                              // No interlace
+    PngBandEncoder::appendChunk(output, "IHDR", header, sizeof(header));
+
+    uint8_t control[8];
+    putUint32(control, static_cast<uint32_t>(frames.size()));
+    putUint32(control + 4, 0);                   // Loop forever
+    PngBandEncoder::appendChunk(output, "acTL", control, sizeof(control));
+
+    // Frame controls and frame data share one sequence. The first frame is
+    // also the still image shown by decoders without APNG support.
+    uint32_t sequence = 0;
+    std::vector<uint8_t> data;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const AnimationFrame& frame = frames[i];
+        uint8_t frameControl[26];
+        putUint32(frameControl, sequence++);
+        putUint32(frameControl + 4, static_cast<uint32_t>(frame.width));
+        putUint32(frameControl + 8, static_cast<uint32_t>(frame.height));
+        putUint32(frameControl + 12, static_cast<uint32_t>(frame.x));
+        putUint32(frameControl + 16, static_cast<uint32_t>(frame.y));
+        putUint16(frameControl + 20, static_cast<uint16_t>(std::min(frame.duration, 65535)));
+        putUint16(frameControl + 22, 1000);      // Delay in milliseconds
+        frameControl[24] = 0;                    // Dispose: keep the frame
+        frameControl[25] = 0;                    // Blend: replace the area
+        PngBandEncoder::appendChunk(output, "fcTL", frameControl, sizeof(frameControl));
+
+        if (i == 0) {
+            PngBandEncoder::appendChunk(output, "IDAT", streams[i].data(), streams[i].size());
+        }
+        else {
+            data.resize(4 + streams[i].size());
+            putUint32(data.data(), sequence++);
+            std::memcpy(data.data() + 4, streams[i].data(), streams[i].size());
+            PngBandEncoder::appendChunk(output, "fdAT", data.data(), data.size());
+        }
+    }
+
+    PngBandEncoder::appendChunk(output, "IEND", nullptr, 0);
+    return true;
+}
+
+bool AnimationEncoder::encodeWebp(int width, int height, const std::vector<AnimationFrame>& frames, int quality,
+                                  ThreadPool* pool, std::vector<uint8_t>& output) {
+    if (frames.empty() || frames.front().width != width || frames.front().height != height) {
+        return false;
+    }
+
+    // Each frame becomes a still WebP first; the mux wraps them as ANMF chunks
+    std::vector<std::vector<uint8_t>> bitstreams(frames.size());
+    std::atomic<bool> failed(false);
+    forEachFrame(pool, frames.size(), [&](size_t i) {
+        const AnimationFrame& frame = frames[i];
+        uint8_t* encoded = nullptr;
+        size_t size;
+        if (quality >= 100) {
+            size = WebPEncodeLosslessRGBA(frame.rgba.data(), frame.width, frame.height, frame.width * 4, &encoded);
+        }
+        else {
+            size = WebPEncodeRGBA(frame.rgba.data(), frame.width, frame.height, frame.width * 4,
+                                  static_cast<float>(quality), &encoded);
+        }
+        if (size == 0 || !encoded) {
+            failed = true;
+        }
+        else {
+            bitstreams[i].assign(encoded, encoded + size);
+        }
+        WebPFree(encoded);
+    });
+    if (failed) {
+        return false;
+    }
+
+    WebPMux* mux = WebPMuxNew();
+    if (!mux) {
+        return false;
+    }
+
+    bool ok = WebPMuxSetCanvasSize(mux, width, height) == WEBP_MUX_OK;
+    for (size_t i = 0; ok && i < frames.size(); ++i) {
+        WebPMuxFrameInfo info;
+        std::memset(&info, 0, sizeof(info));
+        info.bitstream.bytes = bitstreams[i].data();
+        info.bitstream.size = bitstreams[i].size();
+        info.x_offset = frames[i].x;
+        info.y_offset = frames[i].y;
+        info.duration = frames[i].duration;
+        info.id = WEBP_CHUNK_ANMF;
+        info.dispose_method = WEBP_MUX_DISPOSE_NONE;
+        info.blend_method = WEBP_MUX_NO_BLEND;
+        ok = WebPMuxPushFrame(mux, &info, 0) == WEBP_MUX_OK;
+    }
+
+    WebPMuxAnimParams params;
+    params.bgcolor = 0;                          // Transparent
+    params.loop_count = 0;                       // Loop forever
+    ok = ok && WebPMuxSetAnimationParams(mux, &params) == WEBP_MUX_OK;
+
+    WebPData assembled;
+    WebPDataInit(&assembled);
+    ok = ok && WebPMuxAssemble(mux, &assembled) == WEBP_MUX_OK;
+    if (ok) {
+        output.assign(assembled.bytes, assembled.bytes + assembled.size);
+    }
+    WebPDataClear(&assembled);
+    WebPMuxDelete(mux);
+    return ok;
+}
+
+} // namespace text2image
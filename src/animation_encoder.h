@@ -0,0 +1,46 @@
+/*
+ * Text2Image Animation Encoder
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the writers for animated PNG and animated WebP, which
+ * store every frame after the first as the rectangle that changed.
+ */
+
+#ifndef TEXT2IMAGE_ANIMATION_ENCODER_H
+#define TEXT2IMAGE_ANIMATION_ENCODER_H
+
+#include <cstdint>
+#include <vector>
+
+namespace text2image {
+
+class ThreadPool;
+
+// Area of the canvas that changed since the previous frame
+struct AnimationFrame {
+    int x;
+    int y;
+    int width;
+    int height;
+    int duration;                 // Milliseconds
+    bool opaque;                  // Every pixel in the area has full alpha
+    std::vector<uint8_t> rgba;    // Unpremultiplied, width * 4 bytes per row
+};
+
+class AnimationEncoder {
+public:
+    // The first frame covers the whole canvas; each later one replaces only
+    // its area, and the animation loops forever. Frames are compressed in
+    // parallel on pool when one is given.
+    static bool encodeApng(int width, int height, const std::vector<AnimationFrame>& frames, ThreadPool* pool,
+                           std::vector<uint8_t>& output);
+
+    // Lossless at quality 100, lossy below, as for still WebP output. Frame
+    // offsets must be even.
+    static bool encodeWebp(int width, int height, const std::vector<AnimationFrame>& frames, int quality,
+                           ThreadPool* pool, std::vector<uint8_t>& output);
+};
+
+} // namespace text2image
+
+#endif // TEXT2IMAGE_ANIMATION_ENCODER_H
@@ -0,0 +1,174 @@
+/*
+ * Text2Image Base64 Implementation
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the implementation of the base64 decoder.
+ */
+
+#include "base64.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXT2IMAGE_BASE64_SSE2 1
+#include <emmintrin.h>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+#endif
+
+namespace text2image {
+
+namespace {
+
+// Scalar table values besides 0-63
+const int8_t kInvalid = -1;
+const int8_t kSpace = -2;
+const int8_t kPad = -3;
+
+struct DecodeTable {
+    int8_t values[256];
+
+    DecodeTable() {
+        for (int i = 0; i < 256; ++i) values[i] = kInvalid;
+        const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        for (int i = 0; i < 64; ++i) values[static_cast<unsigned char>(alphabet[i])] = static_cast<int8_t>(i);
+        values[' '] = values['\t'] = values['\n'] = values['\r'] = values['\f'] = kSpace;
+        values['='] = kPad;
+    }
+};
+
+const DecodeTable kTable;
+
+#ifdef TEXT2IMAGE_BASE64_SSE2
+
+int countTrailingZeros(unsigned value) {
+    int count = 0;
+    while (!(value & 1)) {
+        value >>= 1;
+        ++count;
+    }
+    return count;
+}
+
+// Decode 16 alphabet characters into 12 bytes at out, which must have 16
+// bytes of room. Returns a bit per input byte that is not in the alphabet;
+// nothing is written unless it is zero.
+unsigned decodeBlock(const char* in, uint8_t* out) {
+    const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+
+    // Signed compares leave bytes from 0x80 up outside every range
+    auto inRange = [&input](char low, char high) {
+        return _mm_and_si128(_mm_cmpgt_epi8(input, _mm_set1_epi8(static_cast<char>(low - 1))),
+                             _mm_cmplt_epi8(input, _mm_set1_epi8(static_cast<char>(high + 1))));
+    };
+    const __m128i upper = inRange('A', 'Z');
+    const __m128i lower = inRange('a', 'z');
+    const __m128i digit = inRange('0', '9');
+    const __m128i plus = _mm_cmpeq_epi8(input, _mm_set1_epi8('+'));
+    const __m128i slash = _mm_cmpeq_epi8(input, _mm_set1_epi8('/'));
+
+    const __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(_mm_or_si128(digit, plus), slash));
+    unsigned invalid = ~static_cast<unsigned>(_mm_movemask_epi8(valid)) & 0xFFFF;
+    if (invalid) {
+        return invalid;
+    }
+
+    // Each class moves to its alphabet index by a constant
+    __m128i offset = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+    offset = _mm_or_si128(offset, _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+    offset = _mm_or_si128(offset, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+    offset = _mm_or_si128(offset, _mm_and_si128(plus, _mm_set1_epi8(62 - '+')));
+    offset = _mm_or_si128(offset, _mm_and_si128(slash, _mm_set1_epi8(63 - '/')));
+    const __m128i sextets = _mm_add_epi8(input, offset);
+
+    // Merge pairs of 6 bits into 12, then pairs of 12 into 24, per 32-bit lane
+    const __m128i pairs = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(sextets, _mm_set1_epi16(0x00FF)), 6),
+                                       _mm_srli_epi16(sextets, 8));
+    const __m128i words = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(pairs, _mm_set1_epi32(0x0000FFFF)), 12),
+                                       _mm_srli_epi32(pairs, 16));
+
+    // Each lane holds its three bytes in reverse order
+#ifdef __SSSE3__
+    const __m128i order = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(words, order));
+#else
+    alignas(16) uint32_t lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), words);
+    for (int i = 0; i < 4; ++i) {
+        out[i * 3] = static_cast<uint8_t>(lanes[i] >> 16);
+        out[i * 3 + 1] = static_cast<uint8_t>(lanes[i] >> 8);
+        out[i * 3 + 2] = static_cast<uint8_t>(lanes[i]);
+    }
+#endif
+    return 0;
+}
+
+#endif // TEXT2IMAGE_BASE64_SSE2
+
+} // namespace
+
+bool decodeBase64(const char* text, size_t length, std::vector<uint8_t>& out) {
+    // Room for every character being data, plus the slack a block store writes past its bytes
+    out.resize(length / 4 * 3 + 3 + 16);
+    uint8_t* output = out.data();
+    size_t written = 0;
+
+    uint32_t bits = 0;
+    int pending = 0;          // Characters of the current group of four
+    bool padded = false;
+    size_t i = 0;
+#ifdef TEXT2IMAGE_BASE64_SSE2
+    size_t blockFrom = 0;     // Blocks are retried once past the character that stopped the last one
+#endif
+
+    while (i < length) {
+#ifdef TEXT2IMAGE_BASE64_SSE2
+        if (pending == 0 && !padded && i >= blockFrom && length - i >= 16) {
+            unsigned invalid = decodeBlock(text + i, output + written);
+            if (!invalid) {
+                i += 16;
+                written += 12;
+                continue;
+            }
+            blockFrom = i + countTrailingZeros(invalid) + 1;
+        }
+#endif
+
+        int8_t value = kTable.values[static_cast<unsigned char>(text[i++])];
+        if (value == kSpace) {
+            continue;
+        }
+        if (value == kPad) {
+            padded = true;
+            continue;
+        }
+        if (value == kInvalid || padded) {
+            return false;
+        }
+
+        bits = (bits << 6) | static_cast<uint32_t>(value);
+        if (++pending == 4) {
+            output[written++] = static_cast<uint8_t>(bits >> 16);
+            output[written++] = static_cast<uint8_t>(bits >> 8);
+            output[written++] = static_cast<uint8_t>(bits);
+            bits = 0;
+            pending = 0;
+        }
+    }
+
+    // A final group of two or three characters carries one or two bytes
+    if (pending == 1) {
+        return false;
+    }
+    if (pending >= 2) {
+        bits <<= 6 * (4 - pending);
+        output[written++] = static_cast<uint8_t>(bits >> 16);
+        if (pending == 3) {
+            output[written++] = static_cast<uint8_t>(bits >> 8);
+        }
+    }
+
+    out.resize(written);
+    return true;
+}
+
+} // namespace text2image
@@ -0,0 +1,24 @@
+/*
+ * Text2Image Base64
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the base64 decoder used for data: URIs.
+ */
+
+#ifndef TEXT2IMAGE_BASE64_H
+#define TEXT2IMAGE_BASE64_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace text2image {
+
+// Decode base64 text into out. ASCII white space is skipped and trailing
+// padding is optional; any other character outside the alphabet fails.
+// Runs of plain alphabet characters are decoded 16 at a time with SSE2.
+bool decodeBase64(const char* text, size_t length, std::vector<uint8_t>& out);
+
+} // namespace text2image
+
+#endif // TEXT2IMAGE_BASE64_H
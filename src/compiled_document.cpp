@@ -0,0 +1,498 @@
+/*
+ * Text2Image Compiled Document Implementation
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the implementation of the CompiledDocument class.
+ */
+
+#include "compiled_document.h"
+
+#include <SkData.h>
+#include <SkFontStyle.h>
+#include <SkImageInfo.h>
+#include <SkString.h>
+#include <SkTypeface.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace text2image {
+
+namespace {
+
+const char kMagic[4] = {'T', '2', 'I', 'C'};
+const uint32_t kVersion = 2;
+
+// Written as a number and compared on load, so files never cross byte orders
+const uint32_t kByteOrderMark = 0x01020304;
+
+// Every section starts on this boundary so its array can be used in place
+const size_t kSectionAlignment = 8;
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t itemSize;        // Struct sizes of the writer; a mismatch means another ABI
+    uint32_t pointSize;
+    uint32_t shadowSize;
+    int32_t width;
+    int32_t height;
+    float cover[4];           // Left, top, right, bottom
+    uint32_t itemCount;
+    uint32_t fontCount;
+    uint32_t glyphCount;
+    uint32_t shadowCount;
+    uint32_t imageCount;
+    uint64_t itemsOffset;
+    uint64_t fontsOffset;
+    uint64_t glyphsOffset;
+    uint64_t positionsOffset;
+    uint64_t shadowsOffset;
+    uint64_t imagesOffset;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+    uint64_t fileSize;
+};
+
+enum FontFlag : uint8_t {
+    FONT_SUBPIXEL = 1 << 0,
+    FONT_EMBOLDEN = 1 << 1,
+    FONT_LINEAR_METRICS = 1 << 2,
+    FONT_BASELINE_SNAP = 1 << 3,
+    FONT_FORCE_AUTO_HINTING = 1 << 4
+};
+
+// SkFont with its typeface named instead of referenced
+struct FontRecord {
+    uint32_t familyOffset;    // NUL-terminated, in the string section
+    int32_t weight;
+    int32_t width;
+    int32_t slant;
+    float size;
+    float scaleX;
+    float skewX;
+    uint8_t edging;
+    uint8_t hinting;
+    uint8_t flags;            // FontFlag bits
+    uint8_t reserved;
+    uint32_t glyphTotal;      // Glyphs in the typeface
+    uint32_t headChecksum;    // Identifies the font file; 0 when it has no 'head' table
+};
+
+// Decoded image; its pixels are a section of their own, used in place on load
+struct ImageRecord {
+    int32_t width;
+    int32_t height;
+    uint32_t rowBytes;
+    uint32_t colorType;       // SkColorType, premultiplied
+    uint64_t pixelsOffset;
+};
+
+uint32_t headChecksum(const SkTypeface* typeface) {
+    // checkSumAdjustment sits 8 bytes into 'head' and changes with any edit to the file
+    uint8_t bytes[4];
+    if (!typeface || typeface->getTableData(SkSetFourByteTag('h', 'e', 'a', 'd'), 8, 4, bytes) != 4) {
+        return 0;
+    }
+    return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) |
+           (static_cast<uint32_t>(bytes[2]) << 8) | static_cast<uint32_t>(bytes[3]);
+}
+
+// Append count elements at the next section boundary and return their offset
+template <typename T>
+uint64_t appendSection(std::vector<uint8_t>& out, const T* data, size_t count) {
+    out.resize((out.size() + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment);
+    uint64_t offset = out.size();
+    if (count > 0) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+        out.insert(out.end(), bytes, bytes + count * sizeof(T));
+    }
+    return offset;
+}
+
+// Whether count elements of size bytes fit at offset, which must be aligned for them
+bool sectionFits(uint64_t offset, uint64_t count, size_t size, size_t alignment, size_t fileSize) {
+    return offset % alignment == 0 && offset <= fileSize && count <= (fileSize - offset) / size;
+}
+
+} // namespace
+
+CompiledDocument::CompiledDocument()
+    : m_data(nullptr),
+      m_size(0),
+#ifdef _WIN32
+      m_file(nullptr),
+      m_mapping(nullptr),
+#endif
+      m_width(0),
+      m_height(0),
+      m_cover(SkRect::MakeEmpty()) {
+    std::memset(&m_view, 0, sizeof(m_view));
+}
+
+CompiledDocument::~CompiledDocument() {
+    m_images.clear();
+#ifdef _WIN32
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping) {
+        CloseHandle(m_mapping);
+    }
+    if (m_file) {
+        CloseHandle(m_file);
+    }
+#else
+    if (m_data) {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+#endif
+}
+
+bool CompiledDocument::write(const std::string& path, const DisplayList& list, int width, int height,
+                             const SkRect& cover, std::string& error) {
+    const std::vector<SkFont>& fonts = list.getFonts();
+    std::vector<FontRecord> records;
+    std::vector<char> strings;
+    for (const SkFont& font : fonts) {
+        FontRecord record;
+        std::memset(&record, 0, sizeof(record));
+
+        SkTypeface* typeface = font.getTypeface();
+        SkString family;
+        SkFontStyle style;
+        if (typeface) {
+            typeface->getFamilyName(&family);
+            style = typeface->fontStyle();
+        }
+        record.familyOffset = static_cast<uint32_t>(strings.size());
+        strings.insert(strings.end(), family.c_str(), family.c_str() + family.size() + 1);
+
+        record.weight = style.weight();
+        record.width = style.width();
+        record.slant = static_cast<int32_t>(style.slant());
+        record.size = font.getSize();
+        record.scaleX = font.getScaleX();
+        record.skewX = font.getSkewX();
+        record.edging = static_cast<uint8_t>(font.getEdging());
+        record.hinting = static_cast<uint8_t>(font.getHinting());
+        record.flags = (font.isSubpixel() ? FONT_SUBPIXEL : 0) |
+                       (font.isEmbolden() ? FONT_EMBOLDEN : 0) |
+                       (font.isLinearMetrics() ? FONT_LINEAR_METRICS : 0) |
+                       (font.isBaselineSnap() ? FONT_BASELINE_SNAP : 0) |
+                       (font.isForceAutoHinting() ? FONT_FORCE_AUTO_HINTING : 0);
+        record.glyphTotal = typeface ? static_cast<uint32_t>(typeface->countGlyphs()) : 0;
+        record.headChecksum = headChecksum(typeface);
+        records.push_back(record);
+    }
+
+    // Images are stored decoded, so loading never touches a codec
+    std::vector<ImageRecord> images;
+    std::vector<std::vector<uint8_t>> pixels;
+    for (const sk_sp<SkImage>& image : list.getImages()) {
+        ImageRecord record;
+        std::memset(&record, 0, sizeof(record));
+        SkImageInfo info = SkImageInfo::MakeN32Premul(image->width(), image->height());
+        record.width = info.width();
+        record.height = info.height();
+        record.rowBytes = static_cast<uint32_t>(info.minRowBytes());
+        record.colorType = static_cast<uint32_t>(info.colorType());
+
+        std::vector<uint8_t> data(info.computeMinByteSize());
+        if (!image->readPixels(info, data.data(), record.rowBytes, 0, 0)) {
+            error = "Failed to read image pixels";
+            return false;
+        }
+        images.push_back(record);
+        pixels.push_back(std::move(data));
+    }
+
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byteOrder = kByteOrderMark;
+    header.itemSize = sizeof(DisplayItem);
+    header.pointSize = sizeof(SkPoint);
+    header.shadowSize = sizeof(BoxShadowSpec);
+    header.width = width;
+    header.height = height;
+    header.cover[0] = cover.fLeft;
+    header.cover[1] = cover.fTop;
+    header.cover[2] = cover.fRight;
+    header.cover[3] = cover.fBottom;
+    header.itemCount = static_cast<uint32_t>(list.getItems().size());
+    header.fontCount = static_cast<uint32_t>(records.size());
+    header.glyphCount = static_cast<uint32_t>(list.getGlyphs().size());
+    header.shadowCount = static_cast<uint32_t>(list.getShadows().size());
+    header.imageCount = static_cast<uint32_t>(images.size());
+
+    std::vector<uint8_t> out(sizeof(FileHeader));
+    header.itemsOffset = appendSection(out, list.getItems().data(), list.getItems().size());
+    header.fontsOffset = appendSection(out, records.data(), records.size());
+    header.glyphsOffset = appendSection(out, list.getGlyphs().data(), list.getGlyphs().size());
+    header.positionsOffset = appendSection(out, list.getPositions().data(), list.getPositions().size());
+    header.shadowsOffset = appendSection(out, list.getShadows().data(), list.getShadows().size());
+    for (size_t i = 0; i < images.size(); ++i) {
+        images[i].pixelsOffset = appendSection(out, pixels[i].data(), pixels[i].size());
+    }
+    header.imagesOffset = appendSection(out, images.data(), images.size());
+    header.stringsOffset = appendSection(out, strings.data(), strings.size());
+    header.stringsSize = strings.size();
+    header.fileSize = out.size();
+    std::memcpy(out.data(), &header, sizeof(header));
+
+    // Written aside and renamed, so a worker never maps a half-written file
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            error = "Failed to open output file: " + temporary;
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(out.data()), out.size());
+        if (!file) {
+            error = "Failed to write to output file: " + temporary;
+            return false;
+        }
+    }
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        error = "Failed to replace output file: " + path;
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<const CompiledDocument> CompiledDocument::open(const std::string& path, std::string& error) {
+    std::shared_ptr<CompiledDocument> document(new CompiledDocument());
+    if (!document->map(path, error) || !document->validate(error) || !document->loadFonts(error) ||
+        !document->loadImages(error)) {
+        return nullptr;
+    }
+    return document;
+}
+
+bool CompiledDocument::map(const std::string& path, std::string& error) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        error = "Failed to open compiled document: " + path;
+        return false;
+    }
+    m_file = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < static_cast<LONGLONG>(sizeof(FileHeader))) {
+        error = "Not a compiled document: " + path;
+        return false;
+    }
+
+    m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mapping) {
+        error = "Failed to map compiled document: " + path;
+        return false;
+    }
+    m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_data) {
+        error = "Failed to map compiled document: " + path;
+        return false;
+    }
+    m_size = static_cast<size_t>(size.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "Failed to open compiled document: " + path;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(FileHeader))) {
+        ::close(fd);
+        error = "Not a compiled document: " + path;
+        return false;
+    }
+
+    // The mapping outlives the descriptor
+    void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        error = "Failed to map compiled document: " + path;
+        return false;
+    }
+    m_data = static_cast<const uint8_t*>(data);
+    m_size = static_cast<size_t>(info.st_size);
+#endif
+    return true;
+}
+
+bool CompiledDocument::validate(std::string& error) {
+    const FileHeader& header = *reinterpret_cast<const FileHeader*>(m_data);
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        error = "Not a compiled document";
+        return false;
+    }
+    if (header.version != kVersion || header.byteOrder != kByteOrderMark || header.itemSize != sizeof(DisplayItem) ||
+        header.pointSize != sizeof(SkPoint) || header.shadowSize != sizeof(BoxShadowSpec)) {
+        error = "Compiled document was written by another version or architecture";
+        return false;
+    }
+    if (header.fileSize != m_size || header.width <= 0 || header.height <= 0 ||
+        !sectionFits(header.itemsOffset, header.itemCount, sizeof(DisplayItem), alignof(DisplayItem), m_size) ||
+        !sectionFits(header.fontsOffset, header.fontCount, sizeof(FontRecord), alignof(FontRecord), m_size) ||
+        !sectionFits(header.glyphsOffset, header.glyphCount, sizeof(SkGlyphID), alignof(SkGlyphID), m_size) ||
+        !sectionFits(header.positionsOffset, header.glyphCount, sizeof(SkPoint), alignof(SkPoint), m_size) ||
+        !sectionFits(header.shadowsOffset, header.shadowCount, sizeof(BoxShadowSpec), alignof(BoxShadowSpec), m_size) ||
+        !sectionFits(header.imagesOffset, header.imageCount, sizeof(ImageRecord), alignof(ImageRecord), m_size) ||
+        !sectionFits(header.stringsOffset, header.stringsSize, 1, 1, m_size)) {
+        error = "Compiled document is truncated or corrupt";
+        return false;
+    }
+
+    m_width = header.width;
+    m_height = header.height;
+    m_cover = SkRect::MakeLTRB(header.cover[0], header.cover[1], header.cover[2], header.cover[3]);
+
+    m_view.items = reinterpret_cast<const DisplayItem*>(m_data + header.itemsOffset);
+    m_view.itemCount = header.itemCount;
+    m_view.glyphs = reinterpret_cast<const SkGlyphID*>(m_data + header.glyphsOffset);
+    m_view.positions = reinterpret_cast<const SkPoint*>(m_data + header.positionsOffset);
+    m_view.glyphCount = header.glyphCount;
+    m_view.shadows = reinterpret_cast<const BoxShadowSpec*>(m_data + header.shadowsOffset);
+    m_view.shadowCount = header.shadowCount;
+
+    // Indices are checked once here so playback can trust them
+    int depth = 0;
+    for (size_t i = 0; i < m_view.itemCount; ++i) {
+        const DisplayItem& item = m_view.items[i];
+        bool valid = true;
+        switch (item.type) {
+            case DisplayItemType::TEXT:
+                valid = item.index < header.fontCount &&
+                        static_cast<uint64_t>(item.glyphOffset) + item.glyphCount <= header.glyphCount;
+                break;
+            case DisplayItemType::SHADOW:
+                valid = item.index < header.shadowCount;
+                break;
+            case DisplayItemType::IMAGE:
+                valid = item.index < header.imageCount;
+                break;
+            case DisplayItemType::CLIP_RECT:
+            case DisplayItemType::CLIP_RRECT:
+                ++depth;
+                break;
+            case DisplayItemType::RESTORE:
+                valid = --depth >= 0;
+                break;
+            case DisplayItemType::FILL_RECT:
+            case DisplayItemType::FILL_RRECT:
+            case DisplayItemType::STROKE_RRECT:
+                break;
+            default:
+                valid = false;
+                break;
+        }
+        if (!valid) {
+            error = "Compiled document is truncated or corrupt";
+            return false;
+        }
+    }
+    if (depth != 0) {
+        error = "Compiled document is truncated or corrupt";
+        return false;
+    }
+    return true;
+}
+
+bool CompiledDocument::loadFonts(std::string& error) {
+    const FileHeader& header = *reinterpret_cast<const FileHeader*>(m_data);
+    const FontRecord* records = reinterpret_cast<const FontRecord*>(m_data + header.fontsOffset);
+    const char* strings = reinterpret_cast<const char*>(m_data + header.stringsOffset);
+
+    m_fonts.reserve(header.fontCount);
+    for (uint32_t i = 0; i < header.fontCount; ++i) {
+        const FontRecord& record = records[i];
+        if (record.familyOffset >= header.stringsSize ||
+            !std::memchr(strings + record.familyOffset, '\0', header.stringsSize - record.familyOffset)) {
+            error = "Compiled document is truncated or corrupt";
+            return false;
+        }
+        const char* family = strings + record.familyOffset;
+
+        SkFontStyle style(record.weight, record.width, static_cast<SkFontStyle::Slant>(record.slant));
+        sk_sp<SkTypeface> typeface = SkTypeface::MakeFromName(*family ? family : nullptr, style);
+        if (!typeface || static_cast<uint32_t>(typeface->countGlyphs()) != record.glyphTotal ||
+            headChecksum(typeface.get()) != record.headChecksum) {
+            error = "Font used by the compiled document is not available: " + std::string(family);
+            return false;
+        }
+
+        SkFont font;
+        font.setTypeface(typeface);
+        font.setSize(record.size);
+        font.setScaleX(record.scaleX);
+        font.setSkewX(record.skewX);
+        font.setEdging(static_cast<SkFont::Edging>(record.edging));
+        font.setHinting(static_cast<SkFontHinting>(record.hinting));
+        font.setSubpixel((record.flags & FONT_SUBPIXEL) != 0);
+        font.setEmbolden((record.flags & FONT_EMBOLDEN) != 0);
+        font.setLinearMetrics((record.flags & FONT_LINEAR_METRICS) != 0);
+        font.setBaselineSnap((record.flags & FONT_BASELINE_SNAP) != 0);
+        font.setForceAutoHinting((record.flags & FONT_FORCE_AUTO_HINTING) != 0);
+        m_fonts.push_back(font);
+    }
+
+    m_view.fonts = m_fonts.data();
+    m_view.fontCount = m_fonts.size();
+    return true;
+}
+
+bool CompiledDocument::loadImages(std::string& error) {
+    const FileHeader& header = *reinterpret_cast<const FileHeader*>(m_data);
+    const ImageRecord* records = reinterpret_cast<const ImageRecord*>(m_data + header.imagesOffset);
+
+    m_images.reserve(header.imageCount);
+    for (uint32_t i = 0; i < header.imageCount; ++i) {
+        const ImageRecord& record = records[i];
+        const SkColorType colorType = static_cast<SkColorType>(record.colorType);
+        if (record.width <= 0 || record.height <= 0 ||
+            (colorType != kRGBA_8888_SkColorType && colorType != kBGRA_8888_SkColorType) ||
+            record.rowBytes / 4 < static_cast<uint32_t>(record.width) ||
+            !sectionFits(record.pixelsOffset, record.height, record.rowBytes, 4, m_size)) {
+            error = "Compiled document is truncated or corrupt";
+            return false;
+        }
+
+        // The pixels stay in the mapping; the images are dropped before it is unmapped
+        SkImageInfo info = SkImageInfo::Make(record.width, record.height, colorType, kPremul_SkAlphaType);
+        sk_sp<SkData> pixels = SkData::MakeWithoutCopy(m_data + record.pixelsOffset,
+                                                        static_cast<size_t>(record.height) * record.rowBytes);
+        sk_sp<SkImage> image = SkImage::MakeRasterData(info, std::move(pixels), record.rowBytes);
+        if (!image) {
+            error = "Compiled document is truncated or corrupt";
+            return false;
+        }
+        m_images.push_back(std::move(image));
+    }
+
+    m_view.images = m_images.data();
+    m_view.imageCount = m_images.size();
+    return true;
+}
+
+} // namespace text2image
@@ -0,0 +1,73 @@
+/*
+ * Text2Image Compiled Document
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the binary form of a laid-out, recorded document. The
+ * file holds the display list arrays as they sit in memory, so loading maps
+ * the file and draws from it without parsing, styling or layout.
+ */
+
+#ifndef TEXT2IMAGE_COMPILED_DOCUMENT_H
+#define TEXT2IMAGE_COMPILED_DOCUMENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <SkFont.h>
+#include <SkImage.h>
+#include <SkRect.h>
+
+#include "display_list.h"
+
+namespace text2image {
+
+class CompiledDocument {
+public:
+    ~CompiledDocument();
+
+    // Write list, recorded for a width x height canvas, to path. cover is the
+    // opaque area reported by the occlusion pass.
+    static bool write(const std::string& path, const DisplayList& list, int width, int height,
+                      const SkRect& cover, std::string& error);
+
+    // Map a compiled document. Fails for files written by another version or
+    // architecture, and when a font it was laid out with is not available
+    // here, since glyph ids are only meaningful for the same font file.
+    static std::shared_ptr<const CompiledDocument> open(const std::string& path, std::string& error);
+
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+    const SkRect& getCover() const { return m_cover; }
+
+    // Arrays for playback; they point into the mapping
+    const DisplayListView& view() const { return m_view; }
+
+private:
+    CompiledDocument();
+
+    bool map(const std::string& path, std::string& error);
+    bool validate(std::string& error);
+    bool loadFonts(std::string& error);
+    bool loadImages(std::string& error);
+
+    const uint8_t* m_data;
+    size_t m_size;
+#ifdef _WIN32
+    void* m_file;
+    void* m_mapping;
+#endif
+
+    int m_width;
+    int m_height;
+    SkRect m_cover;
+    std::vector<SkFont> m_fonts;  // Resolved from the descriptors in the file
+    std::vector<sk_sp<SkImage>> m_images;  // Over pixels in the mapping
+    DisplayListView m_view;
+};
+
+} // namespace text2image
+
+#endif // TEXT2IMAGE_COMPILED_DOCUMENT_H
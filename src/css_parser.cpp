@@ -0,0 +1,395 @@
+/*
+ * Text2Image CSS Parser Implementation
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the implementation of the CSS tokenizing helpers.
+ */
+
+#include "css_parser.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+namespace text2image {
+
+namespace {
+
+struct NamedColor {
+    const char* name;
+    uint32_t argb;
+};
+
+// Commonly used CSS named colors, sorted by name for binary search
+const NamedColor kNamedColors[] = {
+    {"aqua", 0xFF00FFFF},
+    {"black", 0xFF000000},
+    {"blue", 0xFF0000FF},
+    {"brown", 0xFFA52A2A},
+    {"cyan", 0xFF00FFFF},
+    {"darkgray", 0xFFA9A9A9},
+    {"darkgrey", 0xFFA9A9A9},
+    {"fuchsia", 0xFFFF00FF},
+    {"gold", 0xFFFFD700},
+    {"gray", 0xFF808080},
+    {"green", 0xFF008000},
+    {"grey", 0xFF808080},
+    {"lightgray", 0xFFD3D3D3},
+    {"lightgrey", 0xFFD3D3D3},
+    {"lime", 0xFF00FF00},
+    {"magenta", 0xFFFF00FF},
+    {"maroon", 0xFF800000},
+    {"navy", 0xFF000080},
+    {"olive", 0xFF808000},
+    {"orange", 0xFFFFA500},
+    {"pink", 0xFFFFC0CB},
+    {"purple", 0xFF800080},
+    {"red", 0xFFFF0000},
+    {"silver", 0xFFC0C0C0},
+    {"teal", 0xFF008080},
+    {"transparent", 0x00000000},
+    {"white", 0xFFFFFFFF},
+    {"yellow", 0xFFFFFF00},
+};
+
+std::string toLower(const std::string& value) {
+    std::string result(value);
+    std::transform(result.begin(), result.end(), result.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return result;
+}
+
+int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Parse one rgb()/rgba() component, accepting percentages
+bool parseColorComponent(const std::string& text, bool isAlpha, float& out) {
+    std::string value = trimCss(text);
+    if (value.empty()) {
+        return false;
+    }
+
+    char* end = nullptr;
+    float number = std::strtof(value.c_str(), &end);
+    if (end == value.c_str()) {
+        return false;
+    }
+
+    if (*end == '%') {
+        out = isAlpha ? number / 100.0f : number * 255.0f / 100.0f;
+    }
+    else {
+        out = number;
+    }
+
+    float maxValue = isAlpha ? 1.0f : 255.0f;
+    out = std::max(0.0f, std::min(out, maxValue));
+    return true;
+}
+
+} // namespace
+
+std::string trimCss(const std::string& value) {
+    size_t start = 0;
+    size_t end = value.size();
+    while (start < end && std::isspace(static_cast<unsigned char>(value[start]))) {
+        ++start;
+    }
+    while (end > start && std::isspace(static_cast<unsigned char>(value[end - 1]))) {
+        --end;
+    }
+    return value.substr(start, end - start);
+}
+
+void parseCssRules(const std::string& css, std::vector<CssRule>& rules) {
+    size_t pos = 0;
+    const size_t length = css.size();
+    std::string selector;
+
+    while (pos < length) {
+        // Skip comments
+        if (css.compare(pos, 2, "/*") == 0) {
+            size_t end = css.find("*/", pos + 2);
+            pos = (end == std::string::npos) ? length : end + 2;
+            continue;
+        }
+
+        char c = css[pos];
+        if (c == '@') {
+            // At-rules are not supported; skip the statement or the whole block
+            size_t semicolon = css.find(';', pos);
+            size_t brace = css.find('{', pos);
+            if (brace != std::string::npos && (semicolon == std::string::npos || brace < semicolon)) {
+                int depth = 0;
+                for (pos = brace; pos < length; ++pos) {
+                    if (css[pos] == '{') ++depth;
+                    else if (css[pos] == '}' && --depth == 0) break;
+                }
+                ++pos;
+            }
+            else {
+                pos = (semicolon == std::string::npos) ? length : semicolon + 1;
+            }
+            selector.clear();
+            continue;
+        }
+
+        if (c == '{') {
+            size_t end = css.find('}', pos + 1);
+            if (end == std::string::npos) {
+                end = length;
+            }
+
+            CssRule rule;
+            rule.selector = trimCss(selector);
+            rule.declarations = css.substr(pos + 1, end - pos - 1);
+            if (!rule.selector.empty()) {
+                rules.push_back(std::move(rule));
+            }
+
+            selector.clear();
+            pos = end + 1;
+            continue;
+        }
+
+        selector.push_back(c);
+        ++pos;
+    }
+}
+
+std::vector<std::string> splitCssSelectorList(const std::string& selector) {
+    std::vector<std::string> selectors;
+
+    size_t pos = 0;
+    while (pos <= selector.size()) {
+        size_t comma = selector.find(',', pos);
+        if (comma == std::string::npos) {
+            comma = selector.size();
+        }
+
+        std::string item = trimCss(selector.substr(pos, comma - pos));
+        if (!item.empty()) {
+            selectors.push_back(item);
+        }
+
+        pos = comma + 1;
+    }
+
+    return selectors;
+}
+
+CssDeclarations parseCssDeclarations(const std::string& block) {
+    CssDeclarations declarations;
+
+    size_t pos = 0;
+    while (pos < block.size()) {
+        // Find the end of the declaration, ignoring semicolons inside parentheses or quotes
+        size_t end = pos;
+        int depth = 0;
+        char quote = 0;
+        for (; end < block.size(); ++end) {
+            char c = block[end];
+            if (quote) {
+                if (c == quote) quote = 0;
+            }
+            else if (c == '"' || c == '\'') {
+                quote = c;
+            }
+            else if (c == '(') {
+                ++depth;
+            }
+            else if (c == ')') {
+                --depth;
+            }
+            else if (c == ';' && depth <= 0) {
+                break;
+            }
+        }
+
+        std::string declaration = block.substr(pos, end - pos);
+        size_t colon = declaration.find(':');
+        if (colon != std::string::npos) {
+            std::string name = toLower(trimCss(declaration.substr(0, colon)));
+            std::string value = trimCss(declaration.substr(colon + 1));
+
+            // Drop !important, the cascade here is source order only
+            size_t important = value.find("!important");
+            if (important != std::string::npos) {
+                value = trimCss(value.substr(0, important));
+            }
+
+            if (!name.empty() && !value.empty()) {
+                declarations.emplace_back(std::move(name), std::move(value));
+            }
+        }
+
+        pos = end + 1;
+    }
+
+    return declarations;
+}
+
+bool parseCssColor(const std::string& text, uint32_t& argb) {
+    std::string value = toLower(trimCss(text));
+    if (value.empty()) {
+        return false;
+    }
+
+    if (value[0] == '#') {
+        size_t digits = value.size() - 1;
+        uint32_t components[4] = {0, 0, 0, 255};
+
+        if (digits == 3 || digits == 4) {
+            for (size_t i = 0; i < digits; ++i) {
+                int d = hexDigit(value[i + 1]);
+                if (d < 0) return false;
+                components[i] = static_cast<uint32_t>(d * 17);
+            }
+        }
+        else if (digits == 6 || digits == 8) {
+            for (size_t i = 0; i < digits / 2; ++i) {
+                int hi = hexDigit(value[2 * i + 1]);
+                int lo = hexDigit(value[2 * i + 2]);
+                if (hi < 0 || lo < 0) return false;
+                components[i] = static_cast<uint32_t>(hi * 16 + lo);
+            }
+        }
+        else {
+            return false;
+        }
+
+        argb = (components[3] << 24) | (components[0] << 16) | (components[1] << 8) | components[2];
+        return true;
+    }
+
+    if (value.compare(0, 4, "rgb(") == 0 || value.compare(0, 5, "rgba(") == 0) {
+        size_t open = value.find('(');
+        size_t close = value.find(')', open);
+        if (close == std::string::npos) {
+            return false;
+        }
+
+        // Accept both comma and space/slash separated syntax
+        std::string args = value.substr(open + 1, close - open - 1);
+        std::replace(args.begin(), args.end(), ',', ' ');
+        std::replace(args.begin(), args.end(), '/', ' ');
+
+        std::vector<std::string> parts;
+        size_t pos = 0;
+        while (pos < args.size()) {
+            while (pos < args.size() && args[pos] == ' ') ++pos;
+            size_t end = args.find(' ', pos);
+            if (end == std::string::npos) end = args.size();
+            if (end > pos) parts.push_back(args.substr(pos, end - pos));
+            pos = end;
+        }
+
+        if (parts.size() != 3 && parts.size() != 4) {
+            return false;
+        }
+
+        float rgba[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+        for (size_t i = 0; i < parts.size(); ++i) {
+            if (!parseColorComponent(parts[i], i == 3, rgba[i])) {
+                return false;
+            }
+        }
+
+        argb = (static_cast<uint32_t>(rgba[3] * 255.0f + 0.5f) << 24) |
+               (static_cast<uint32_t>(rgba[0] + 0.5f) << 16) |
+               (static_cast<uint32_t>(rgba[1] + 0.5f) << 8) |
+               static_cast<uint32_t>(rgba[2] + 0.5f);
+        return true;
+    }
+
+    const NamedColor* begin = std::begin(kNamedColors);
+    const NamedColor* end = std::end(kNamedColors);
+    const NamedColor* it = std::lower_bound(begin, end, value,
+        [](const NamedColor& entry, const std::string& name) { return std::strcmp(entry.name, name.c_str()) < 0; });
+    if (it != end && value == it->name) {
+        argb = it->argb;
+        return true;
+    }
+
+    return false;
+}
+
+bool parseCssLength(const std::string& text, float fontSize, float& px) {
+    std::string value = toLower(trimCss(text));
+    if (value.empty()) {
+        return false;
+    }
+
+    char* end = nullptr;
+    float number = std::strtof(value.c_str(), &end);
+    if (end == value.c_str()) {
+        return false;
+    }
+
+    std::string unit(end);
+    if (unit.empty() || unit == "px") {
+        px = number;
+    }
+    else if (unit == "em") {
+        px = number * fontSize;
+    }
+    else if (unit == "rem") {
+        px = number * 16.0f;
+    }
+    else if (unit == "pt") {
+        px = number * 4.0f / 3.0f;
+    }
+    else if (unit == "%") {
+        px = number * fontSize / 100.0f;
+    }
+    else {
+        return false;
+    }
+
+    return true;
+}
+
+std::vector<std::string> parseCssFontFamilies(const std::string& value) {
+    std::vector<std::string> families;
+
+    size_t pos = 0;
+    while (pos <= value.size()) {
+        size_t comma = value.find(',', pos);
+        if (comma == std::string::npos) {
+            comma = value.size();
+        }
+
+        std::string family = trimCss(value.substr(pos, comma - pos));
+        if (family.size() >= 2 && (family.front() == '"' || family.front() == '\'') && family.back() == family.front()) {
+            family = family.substr(1, family.size() - 2);
+        }
+        if (!family.empty()) {
+            families.push_back(family);
+        }
+
+        pos = comma + 1;
+    }
+
+    return families;
+}
+
+int parseCssFontWeight(const std::string& text, int inheritedWeight) {
+    std::string value = toLower(trimCss(text));
+    if (value == "normal") return 400;
+    if (value == "bold") return 700;
+    if (value == "bolder") return std::min(inheritedWeight + 300, 900);
+    if (value == "lighter") return std::max(inheritedWeight - 300, 100);
+
+    int weight = std::atoi(value.c_str());
+    if (weight >= 1 && weight <= 1000) {
+        return weight;
+    }
+    return inheritedWeight;
+}
+
+} // namespace text2image
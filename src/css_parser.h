@@ -0,0 +1,54 @@
+/*
+ * Text2Image CSS Parser
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the lightweight CSS tokenizing helpers shared by the
+ * render paths: rule splitting, declaration parsing and value conversion.
+ */
+
+#ifndef TEXT2IMAGE_CSS_PARSER_H
+#define TEXT2IMAGE_CSS_PARSER_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace text2image {
+
+// A single rule as written in the stylesheet
+struct CssRule {
+    std::string selector;      // Selector text, may be a comma separated list
+    std::string declarations;  // Raw declaration block without braces
+};
+
+// Property name/value pairs in source order (names are lowercased)
+typedef std::vector<std::pair<std::string, std::string>> CssDeclarations;
+
+// Split a stylesheet into rules, skipping comments and at-rules
+void parseCssRules(const std::string& css, std::vector<CssRule>& rules);
+
+// Split a selector list on commas, trimming each selector
+std::vector<std::string> splitCssSelectorList(const std::string& selector);
+
+// Parse a declaration block ("color: red; font-size: 12px")
+CssDeclarations parseCssDeclarations(const std::string& block);
+
+// Trim leading and trailing whitespace
+std::string trimCss(const std::string& value);
+
+// Parse a color value into ARGB. Returns false for unsupported values.
+bool parseCssColor(const std::string& value, uint32_t& argb);
+
+// Parse a length into pixels. Relative units resolve against fontSize.
+bool parseCssLength(const std::string& value, float fontSize, float& px);
+
+// Parse a font-family list into unquoted family names
+std::vector<std::string> parseCssFontFamilies(const std::string& value);
+
+// Parse a font-weight value into a numeric weight (100-900)
+int parseCssFontWeight(const std::string& value, int inheritedWeight);
+
+} // namespace text2image
+
+#endif // TEXT2IMAGE_CSS_PARSER_H
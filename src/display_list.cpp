@@ -0,0 +1,606 @@
+/*
+ * Text2Image Display List Implementation
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the implementation of the DisplayList class.
+ */
+
+#include "display_list.h"
+
+#include <SkRRect.h>
+#include <SkSamplingOptions.h>
+#include <SkTextBlob.h>
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace text2image {
+
+namespace {
+
+// Upper bound on opaque rects an occlusion pass tests against
+const size_t kMaxOccluders = 64;
+
+SkRect outset(const SkRect& rect, SkScalar amount) {
+    return SkRect::MakeLTRB(rect.fLeft - amount, rect.fTop - amount, rect.fRight + amount, rect.fBottom + amount);
+}
+
+uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+template <typename T>
+uint64_t hashValue(uint64_t hash, const T& value) {
+    return hashBytes(hash, &value, sizeof(value));
+}
+
+// Hash of the fields that decide what an item draws. Fonts are hashed by
+// size alone; sameItem() compares them fully.
+uint64_t hashItem(const DisplayListView& view, const DisplayItem& item) {
+    uint64_t hash = 14695981039346656037ULL;
+    hash = hashValue(hash, static_cast<uint8_t>(item.type));
+    hash = hashValue(hash, item.antiAlias);
+    hash = hashValue(hash, item.color);
+    hash = hashValue(hash, item.rect.fLeft);
+    hash = hashValue(hash, item.rect.fTop);
+    hash = hashValue(hash, item.rect.fRight);
+    hash = hashValue(hash, item.rect.fBottom);
+    hash = hashValue(hash, item.radius);
+    hash = hashValue(hash, item.strokeWidth);
+    if (item.type == DisplayItemType::TEXT) {
+        hash = hashValue(hash, item.origin.fX);
+        hash = hashValue(hash, item.origin.fY);
+        hash = hashValue(hash, view.fonts[item.index].getSize());
+        hash = hashBytes(hash, view.glyphs + item.glyphOffset, item.glyphCount * sizeof(SkGlyphID));
+        hash = hashBytes(hash, view.positions + item.glyphOffset, item.glyphCount * sizeof(SkPoint));
+    }
+    else if (item.type == DisplayItemType::SHADOW) {
+        const BoxShadowSpec& spec = view.shadows[item.index];
+        hash = hashValue(hash, spec.offsetX);
+        hash = hashValue(hash, spec.offsetY);
+        hash = hashValue(hash, spec.blur);
+        hash = hashValue(hash, spec.spread);
+        hash = hashValue(hash, spec.radius);
+        hash = hashValue(hash, spec.color);
+    }
+    else if (item.type == DisplayItemType::IMAGE) {
+        hash = hashValue(hash, view.images[item.index]->uniqueID());
+    }
+    return hash;
+}
+
+bool sameItem(const DisplayListView& a, const DisplayItem& x, const DisplayListView& b, const DisplayItem& y) {
+    if (x.type != y.type || x.antiAlias != y.antiAlias || x.color != y.color || x.rect != y.rect ||
+        x.radius != y.radius || x.strokeWidth != y.strokeWidth) {
+        return false;
+    }
+    if (x.type == DisplayItemType::TEXT) {
+        return x.origin == y.origin && x.glyphCount == y.glyphCount &&
+               a.fonts[x.index] == b.fonts[y.index] &&
+               std::memcmp(a.glyphs + x.glyphOffset, b.glyphs + y.glyphOffset, x.glyphCount * sizeof(SkGlyphID)) == 0 &&
+               std::memcmp(a.positions + x.glyphOffset, b.positions + y.glyphOffset, x.glyphCount * sizeof(SkPoint)) == 0;
+    }
+    if (x.type == DisplayItemType::SHADOW) {
+        const BoxShadowSpec& s = a.shadows[x.index];
+        const BoxShadowSpec& t = b.shadows[y.index];
+        return s.offsetX == t.offsetX && s.offsetY == t.offsetY && s.blur == t.blur &&
+               s.spread == t.spread && s.radius == t.radius && s.color == t.color;
+    }
+    if (x.type == DisplayItemType::IMAGE) {
+        return a.images[x.index]->uniqueID() == b.images[y.index]->uniqueID();
+    }
+    return true;
+}
+
+// Per drawing item, a hash of its content combined with the clips it is
+// drawn under; zero for clip and restore items
+std::vector<uint64_t> itemKeys(const DisplayListView& view) {
+    std::vector<uint64_t> keys(view.itemCount, 0);
+    std::vector<uint64_t> clips(1, 14695981039346656037ULL);
+    for (size_t i = 0; i < view.itemCount; ++i) {
+        const DisplayItem& item = view.items[i];
+        if (item.type == DisplayItemType::CLIP_RECT || item.type == DisplayItemType::CLIP_RRECT) {
+            clips.push_back(hashValue(clips.back(), hashItem(view, item)));
+        }
+        else if (item.type == DisplayItemType::RESTORE) {
+            if (clips.size() > 1) {
+                clips.pop_back();
+            }
+        }
+        else {
+            keys[i] = hashValue(clips.back(), hashItem(view, item)) | 1;
+        }
+    }
+    return keys;
+}
+
+// Fully covered area of an opaque fill; the pixel of inset keeps partial
+// edge coverage out whatever the canvas translation
+SkRect opaqueInterior(const DisplayItem& item) {
+    if (SkColorGetA(item.color) != 0xFF) {
+        return SkRect::MakeEmpty();
+    }
+
+    SkRect interior;
+    if (item.type == DisplayItemType::FILL_RECT) {
+        interior = item.rect.makeInset(1, 1);
+    }
+    else if (item.type == DisplayItemType::FILL_RRECT) {
+        // The corner arcs stay outside an inset of r * (1 - 1/sqrt(2))
+        SkScalar inset = item.radius * 0.3f + 1;
+        interior = item.rect.makeInset(inset, inset);
+    }
+    else {
+        return SkRect::MakeEmpty();
+    }
+    return interior.isEmpty() ? SkRect::MakeEmpty() : interior;
+}
+
+} // namespace
+
+SkFontHinting deviceHinting(const SkFont& font, const SkMatrix& matrix) {
+    if (font.getHinting() > SkFontHinting::kSlight && std::min(matrix.getScaleX(), matrix.getScaleY()) >= 2) {
+        return SkFontHinting::kSlight;
+    }
+    return font.getHinting();
+}
+
+DisplayList::DisplayList() {
+}
+
+DisplayItem& DisplayList::append(DisplayItemType type, const SkRect& rect, SkColor color) {
+    DisplayItem item = DisplayItem();
+    item.type = type;
+    item.antiAlias = true;
+    item.color = color;
+    item.rect = rect;
+    m_items.push_back(item);
+    return m_items.back();
+}
+
+uint32_t DisplayList::fontIndex(const SkFont& font) {
+    // Documents use a handful of fonts, and the latest one is the likeliest
+    for (size_t i = m_fonts.size(); i > 0; --i) {
+        if (m_fonts[i - 1] == font) {
+            return static_cast<uint32_t>(i - 1);
+        }
+    }
+    m_fonts.push_back(font);
+    return static_cast<uint32_t>(m_fonts.size() - 1);
+}
+
+void DisplayList::fillRect(const SkRect& rect, SkColor color, bool antiAlias) {
+    append(DisplayItemType::FILL_RECT, rect, color).antiAlias = antiAlias;
+}
+
+void DisplayList::fillRRect(const SkRect& rect, SkScalar radius, SkColor color) {
+    append(DisplayItemType::FILL_RRECT, rect, color).radius = radius;
+}
+
+void DisplayList::strokeRRect(const SkRect& rect, SkScalar radius, SkScalar width, SkColor color) {
+    DisplayItem& item = append(DisplayItemType::STROKE_RRECT, rect, color);
+    item.radius = radius;
+    item.strokeWidth = width;
+}
+
+void DisplayList::shadow(const SkRect& box, const BoxShadowSpec& spec) {
+    append(DisplayItemType::SHADOW, box, spec.color).index = static_cast<uint32_t>(m_shadows.size());
+    m_shadows.push_back(spec);
+}
+
+void DisplayList::image(const sk_sp<SkImage>& image, const SkRect& rect) {
+    if (!image) {
+        return;
+    }
+    append(DisplayItemType::IMAGE, rect, SK_ColorBLACK).index = static_cast<uint32_t>(m_images.size());
+    m_images.push_back(image);
+}
+
+void DisplayList::text(const SkFont& font, const SkGlyphID* glyphs, const SkPoint* positions, size_t count,
+                       const SkPoint& origin, const SkRect& bounds, SkColor color) {
+    if (count == 0) {
+        return;
+    }
+
+    DisplayItem& item = append(DisplayItemType::TEXT, bounds, color);
+    item.origin = origin;
+    item.index = fontIndex(font);
+    item.glyphOffset = static_cast<uint32_t>(m_glyphs.size());
+    item.glyphCount = static_cast<uint32_t>(count);
+    m_glyphs.insert(m_glyphs.end(), glyphs, glyphs + count);
+    m_positions.insert(m_positions.end(), positions, positions + count);
+}
+
+void DisplayList::clipRect(const SkRect& rect) {
+    append(DisplayItemType::CLIP_RECT, rect, 0);
+}
+
+void DisplayList::clipRRect(const SkRect& rect, SkScalar radius) {
+    append(DisplayItemType::CLIP_RRECT, rect, 0).radius = radius;
+}
+
+void DisplayList::restore() {
+    append(DisplayItemType::RESTORE, SkRect::MakeEmpty(), 0);
+}
+
+SkRect DisplayList::footprint(const DisplayItem& item, const BoxShadowSpec* shadows) {
+    switch (item.type) {
+        case DisplayItemType::FILL_RECT:
+        case DisplayItemType::FILL_RRECT:
+            return outset(item.rect, 1);
+        case DisplayItemType::STROKE_RRECT:
+            return outset(item.rect, item.strokeWidth / 2 + 1);
+        case DisplayItemType::SHADOW:
+            return outset(ShadowCache::shadowBounds(item.rect, shadows[item.index]), 1);
+        case DisplayItemType::TEXT:
+            return item.rect;
+        case DisplayItemType::IMAGE:
+            return outset(item.rect, 1);
+        default:
+            return SkRect::MakeEmpty();
+    }
+}
+
+void DisplayList::clear() {
+    m_items.clear();
+    m_fonts.clear();
+    m_glyphs.clear();
+    m_positions.clear();
+    m_shadows.clear();
+    m_images.clear();
+}
+
+DisplayListView DisplayList::view() const {
+    DisplayListView view;
+    view.items = m_items.data();
+    view.itemCount = m_items.size();
+    view.fonts = m_fonts.data();
+    view.fontCount = m_fonts.size();
+    view.glyphs = m_glyphs.data();
+    view.positions = m_positions.data();
+    view.glyphCount = m_glyphs.size();
+    view.shadows = m_shadows.data();
+    view.shadowCount = m_shadows.size();
+    view.images = m_images.data();
+    view.imageCount = m_images.size();
+    return view;
+}
+
+DisplayListStats DisplayList::playback(SkCanvas* canvas, ShadowCache& shadows, bool draft) const {
+    return playback(view(), canvas, shadows, draft);
+}
+
+DisplayListStats DisplayList::playback(const DisplayListView& view, SkCanvas* canvas, ShadowCache& shadows,
+                                       bool draft) {
+    DisplayListStats stats;
+    stats.items = 0;
+    stats.textRuns = 0;
+    stats.textDraws = 0;
+
+    const SkMatrix matrix = canvas->getTotalMatrix();
+
+    // Pending text runs, all of one color, drawn as a single blob
+    std::vector<const DisplayItem*> batch;
+    SkColor batchColor = 0;
+    SkRect batchBounds = SkRect::MakeEmpty();
+
+    auto flush = [&]() {
+        if (batch.empty()) {
+            return;
+        }
+
+        // Adjacent runs in the same font share one blob run
+        SkTextBlobBuilder builder;
+        size_t i = 0;
+        while (i < batch.size()) {
+            const uint32_t font = batch[i]->index;
+            size_t end = i;
+            int count = 0;
+            while (end < batch.size() && batch[end]->index == font) {
+                count += static_cast<int>(batch[end]->glyphCount);
+                ++end;
+            }
+
+            SkFont runFont(view.fonts[font]);
+            runFont.setHinting(deviceHinting(runFont, matrix));
+            const SkTextBlobBuilder::RunBuffer& buffer = builder.allocRunPos(runFont, count);
+            SkGlyphID* glyphs = buffer.glyphs;
+            SkPoint* points = buffer.points();
+            for (; i < end; ++i) {
+                const DisplayItem& item = *batch[i];
+                std::memcpy(glyphs, view.glyphs + item.glyphOffset, item.glyphCount * sizeof(SkGlyphID));
+                for (uint32_t k = 0; k < item.glyphCount; ++k) {
+                    const SkPoint& position = view.positions[item.glyphOffset + k];
+                    points[k] = SkPoint::Make(position.fX + item.origin.fX, position.fY + item.origin.fY);
+                }
+                glyphs += item.glyphCount;
+                points += item.glyphCount;
+            }
+        }
+
+        sk_sp<SkTextBlob> blob = builder.make();
+        if (blob) {
+            SkPaint paint;
+            paint.setAntiAlias(true);
+            paint.setColor(batchColor);
+            canvas->drawTextBlob(blob, 0, 0, paint);
+            ++stats.textDraws;
+        }
+        batch.clear();
+    };
+
+    // Text may be drawn after a fill that came later only if they do not overlap
+    auto flushIfOverlapping = [&](const SkRect& bounds) {
+        if (!batch.empty() && batchBounds.intersects(bounds)) {
+            flush();
+        }
+    };
+
+    for (size_t i = 0; i < view.itemCount; ++i) {
+        const DisplayItem& item = view.items[i];
+        ++stats.items;
+
+        SkPaint paint;
+        paint.setAntiAlias(item.antiAlias && !draft);
+        paint.setColor(item.color);
+
+        switch (item.type) {
+            case DisplayItemType::TEXT:
+                ++stats.textRuns;
+                if (!batch.empty() && item.color != batchColor) {
+                    flush();
+                }
+                if (batch.empty()) {
+                    batchColor = item.color;
+                    batchBounds = item.rect;
+                }
+                else {
+                    batchBounds.join(item.rect);
+                }
+                batch.push_back(&item);
+                break;
+
+            case DisplayItemType::FILL_RECT:
+                flushIfOverlapping(item.rect);
+                canvas->drawRect(item.rect, paint);
+                break;
+
+            case DisplayItemType::FILL_RRECT:
+                flushIfOverlapping(item.rect);
+                canvas->drawRRect(SkRRect::MakeRectXY(item.rect, item.radius, item.radius), paint);
+                break;
+
+            case DisplayItemType::STROKE_RRECT: {
+                SkScalar half = item.strokeWidth / 2;
+                flushIfOverlapping(SkRect::MakeLTRB(item.rect.fLeft - half, item.rect.fTop - half,
+                                                    item.rect.fRight + half, item.rect.fBottom + half));
+                paint.setStyle(SkPaint::kStroke_Style);
+                paint.setStrokeWidth(item.strokeWidth);
+                canvas->drawRRect(SkRRect::MakeRectXY(item.rect, item.radius, item.radius), paint);
+                break;
+            }
+
+            case DisplayItemType::SHADOW: {
+                if (draft) {
+                    break;
+                }
+                const BoxShadowSpec& spec = view.shadows[item.index];
+                flushIfOverlapping(ShadowCache::shadowBounds(item.rect, spec));
+                shadows.drawShadow(canvas, item.rect, spec);
+                break;
+            }
+
+            case DisplayItemType::IMAGE:
+                // Images are decoded at their layout size, so this is usually a straight copy
+                flushIfOverlapping(item.rect);
+                canvas->drawImageRect(view.images[item.index], item.rect,
+                                      SkSamplingOptions(draft ? SkFilterMode::kNearest : SkFilterMode::kLinear), &paint);
+                break;
+
+            case DisplayItemType::CLIP_RECT:
+                flush();
+                canvas->save();
+                canvas->clipRect(item.rect);
+                break;
+
+            case DisplayItemType::CLIP_RRECT:
+                flush();
+                canvas->save();
+                canvas->clipRRect(SkRRect::MakeRectXY(item.rect, item.radius, item.radius), !draft);
+                break;
+
+            case DisplayItemType::RESTORE:
+                flush();
+                canvas->restore();
+                break;
+        }
+    }
+    flush();
+
+    return stats;
+}
+
+OcclusionStats DisplayList::cullOccluded() {
+    OcclusionStats stats;
+    stats.culled = 0;
+    stats.cover = SkRect::MakeEmpty();
+
+    // Fills inside a clip may paint less than their rect, so they never occlude
+    std::vector<bool> clipped(m_items.size(), false);
+    int depth = 0;
+    for (size_t i = 0; i < m_items.size(); ++i) {
+        DisplayItemType type = m_items[i].type;
+        if (type == DisplayItemType::CLIP_RECT || type == DisplayItemType::CLIP_RRECT) {
+            ++depth;
+        }
+        else if (type == DisplayItemType::RESTORE) {
+            --depth;
+        }
+        clipped[i] = depth > 0;
+    }
+
+    // Walk back to front; whatever a later opaque fill contains is never seen
+    std::vector<SkRect> occluders;
+    std::vector<bool> hidden(m_items.size(), false);
+    for (size_t i = m_items.size(); i > 0; --i) {
+        const DisplayItem& item = m_items[i - 1];
+        SkRect bounds = footprint(item, m_shadows.data());
+        if (bounds.isEmpty()) {
+            continue;
+        }
+
+        bool covered = false;
+        for (const SkRect& occluder : occluders) {
+            if (occluder.contains(bounds)) {
+                covered = true;
+                break;
+            }
+        }
+        if (covered) {
+            hidden[i - 1] = true;
+            ++stats.culled;
+            continue;
+        }
+
+        SkRect interior = clipped[i - 1] ? SkRect::MakeEmpty() : opaqueInterior(item);
+        if (interior.isEmpty()) {
+            continue;
+        }
+        if (interior.width() * interior.height() > stats.cover.width() * stats.cover.height()) {
+            stats.cover = interior;
+        }
+        if (occluders.size() < kMaxOccluders) {
+            occluders.push_back(interior);
+        }
+        else {
+            // Keep the larger rect; big backgrounds hide the most
+            auto smallest = std::min_element(occluders.begin(), occluders.end(), [](const SkRect& a, const SkRect& b) {
+                return a.width() * a.height() < b.width() * b.height();
+            });
+            if (smallest->width() * smallest->height() < interior.width() * interior.height()) {
+                *smallest = interior;
+            }
+        }
+    }
+
+    if (stats.culled > 0) {
+        size_t kept = 0;
+        for (size_t i = 0; i < m_items.size(); ++i) {
+            if (!hidden[i]) {
+                m_items[kept++] = m_items[i];
+            }
+        }
+        m_items.resize(kept);
+    }
+
+    return stats;
+}
+
+void DisplayList::drawCoverage(SkCanvas* canvas, const SkPaint& paint) const {
+    drawCoverage(view(), canvas, paint);
+}
+
+void DisplayList::drawCoverage(const DisplayListView& view, SkCanvas* canvas, const SkPaint& paint) {
+    for (size_t i = 0; i < view.itemCount; ++i) {
+        const DisplayItem& item = view.items[i];
+        switch (item.type) {
+            case DisplayItemType::FILL_RECT:
+            case DisplayItemType::TEXT:
+            case DisplayItemType::IMAGE:
+                canvas->drawRect(item.rect, paint);
+                break;
+
+            case DisplayItemType::FILL_RRECT:
+                canvas->drawRRect(SkRRect::MakeRectXY(item.rect, item.radius, item.radius), paint);
+                break;
+
+            case DisplayItemType::STROKE_RRECT: {
+                SkPaint stroke(paint);
+                stroke.setStyle(SkPaint::kStroke_Style);
+                stroke.setStrokeWidth(item.strokeWidth);
+                canvas->drawRRect(SkRRect::MakeRectXY(item.rect, item.radius, item.radius), stroke);
+                break;
+            }
+
+            case DisplayItemType::SHADOW:
+                canvas->drawRect(ShadowCache::shadowBounds(item.rect, view.shadows[item.index]), paint);
+                break;
+
+            case DisplayItemType::CLIP_RECT:
+                canvas->save();
+                canvas->clipRect(item.rect);
+                break;
+
+            case DisplayItemType::CLIP_RRECT:
+                canvas->save();
+                canvas->clipRRect(SkRRect::MakeRectXY(item.rect, item.radius, item.radius), true);
+                break;
+
+            case DisplayItemType::RESTORE:
+                canvas->restore();
+                break;
+        }
+    }
+}
+
+std::vector<SkRect> DisplayList::damage(const DisplayListView& before, const DisplayListView& after) {
+    std::vector<uint64_t> beforeKeys = itemKeys(before);
+    std::vector<uint64_t> afterKeys = itemKeys(after);
+
+    // Indices of each key in the old list, in painter's order
+    std::unordered_map<uint64_t, std::vector<size_t>> candidates;
+    for (size_t i = 0; i < before.itemCount; ++i) {
+        if (beforeKeys[i] != 0) {
+            candidates[beforeKeys[i]].push_back(i);
+        }
+    }
+    std::unordered_map<uint64_t, size_t> cursors;
+
+    // Matches only move forward through the old list, so a reordered item
+    // is damage rather than a match
+    std::vector<SkRect> rects;
+    std::vector<bool> matched(before.itemCount, false);
+    size_t next = 0;
+    for (size_t j = 0; j < after.itemCount; ++j) {
+        if (afterKeys[j] == 0) {
+            continue;
+        }
+        const DisplayItem& item = after.items[j];
+
+        bool found = false;
+        auto it = candidates.find(afterKeys[j]);
+        if (it != candidates.end()) {
+            const std::vector<size_t>& indices = it->second;
+            size_t& cursor = cursors[afterKeys[j]];
+            while (cursor < indices.size() && indices[cursor] < next) {
+                ++cursor;
+            }
+            if (cursor < indices.size() && sameItem(before, before.items[indices[cursor]], after, item)) {
+                matched[indices[cursor]] = true;
+                next = indices[cursor] + 1;
+                ++cursor;
+                found = true;
+            }
+        }
+        if (!found) {
+            rects.push_back(footprint(item, after.shadows));
+        }
+    }
+
+    for (size_t i = 0; i < before.itemCount; ++i) {
+        if (beforeKeys[i] != 0 && !matched[i]) {
+            rects.push_back(footprint(before.items[i], before.shadows));
+        }
+    }
+
+    rects.erase(std::remove_if(rects.begin(), rects.end(), [](const SkRect& rect) { return rect.isEmpty(); }),
+                rects.end());
+    return rects;
+}
+
+} // namespace text2image
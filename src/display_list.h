@@ -0,0 +1,153 @@
+/*
+ * Text2Image Display List
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the flat list of draw operations recorded from a laid-out
+ * box tree, and its playback onto a canvas with text batching.
+ */
+
+#ifndef TEXT2IMAGE_DISPLAY_LIST_H
+#define TEXT2IMAGE_DISPLAY_LIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <SkCanvas.h>
+#include <SkFont.h>
+#include <SkImage.h>
+#include <SkPaint.h>
+
+#include "shadow_cache.h"
+
+namespace text2image {
+
+// Hinting for font drawn through matrix. Glyphs are rasterized, and cached,
+// at the device scale; from 2x up, full grid-fitting distorts outlines more
+// than it sharpens them, so it drops to slight hinting there.
+SkFontHinting deviceHinting(const SkFont& font, const SkMatrix& matrix);
+
+enum class DisplayItemType : uint8_t {
+    FILL_RECT = 0,
+    FILL_RRECT,
+    STROKE_RRECT,
+    SHADOW,
+    TEXT,
+    CLIP_RECT,                // Saves, then clips until the matching RESTORE
+    CLIP_RRECT,
+    RESTORE,
+    IMAGE                     // Drawn to fill rect
+};
+
+struct DisplayItem {
+    DisplayItemType type;
+    bool antiAlias;
+    SkColor color;
+    SkRect rect;              // Geometry; for TEXT the area the run covers
+    SkScalar radius;          // Corner radius of RRECT kinds
+    SkScalar strokeWidth;
+    SkPoint origin;           // TEXT: added to every glyph position
+    uint32_t index;           // TEXT: font, SHADOW: shadow, IMAGE: image
+    uint32_t glyphOffset;     // TEXT: range in the glyph and position arrays
+    uint32_t glyphCount;
+};
+
+// Counters from one playback
+struct DisplayListStats {
+    size_t items;             // Items played
+    size_t textRuns;          // TEXT items
+    size_t textDraws;         // drawTextBlob calls after batching
+};
+
+// Result of one occlusion pass
+struct OcclusionStats {
+    size_t culled;            // Items dropped as fully hidden
+    SkRect cover;             // Largest area opaque content hides unconditionally; may be empty
+};
+
+// Read-only arrays of a recorded list. They belong to a DisplayList or to a
+// mapped compiled document.
+struct DisplayListView {
+    const DisplayItem* items;
+    size_t itemCount;
+    const SkFont* fonts;
+    size_t fontCount;
+    const SkGlyphID* glyphs;
+    const SkPoint* positions; // One per glyph
+    size_t glyphCount;
+    const BoxShadowSpec* shadows;
+    size_t shadowCount;
+    const sk_sp<SkImage>* images;
+    size_t imageCount;
+};
+
+class DisplayList {
+public:
+    DisplayList();
+
+    // Recording, in painter's order
+    void fillRect(const SkRect& rect, SkColor color, bool antiAlias);
+    void fillRRect(const SkRect& rect, SkScalar radius, SkColor color);
+    void strokeRRect(const SkRect& rect, SkScalar radius, SkScalar width, SkColor color);
+    void shadow(const SkRect& box, const BoxShadowSpec& spec);
+    void image(const sk_sp<SkImage>& image, const SkRect& rect);
+    void text(const SkFont& font, const SkGlyphID* glyphs, const SkPoint* positions, size_t count,
+              const SkPoint& origin, const SkRect& bounds, SkColor color);
+    void clipRect(const SkRect& rect);
+    void clipRRect(const SkRect& rect, SkScalar radius);
+    void restore();
+
+    // Draw every item. Consecutive text runs with the same color are merged
+    // into one text blob; runs may be held back past fills they do not
+    // overlap, so the result matches drawing the items one by one. A draft
+    // playback skips shadows and draws shapes, clips and images without
+    // anti-aliasing or filtering; text stays anti-aliased to stay legible.
+    DisplayListStats playback(SkCanvas* canvas, ShadowCache& shadows, bool draft = false) const;
+    static DisplayListStats playback(const DisplayListView& view, SkCanvas* canvas, ShadowCache& shadows,
+                                     bool draft = false);
+
+    // Drop items hidden entirely under later opaque fills. Only unclipped
+    // fills hide anything, and each is shrunk by a pixel so anti-aliased
+    // edges never cover what they only partly paint.
+    OcclusionStats cullOccluded();
+
+    // Add paint once over the footprint of every item, honoring clips, so
+    // an additive paint counts how often each pixel is written. Text counts
+    // its whole run bounds.
+    void drawCoverage(SkCanvas* canvas, const SkPaint& paint) const;
+    static void drawCoverage(const DisplayListView& view, SkCanvas* canvas, const SkPaint& paint);
+
+    // Areas whose pixels may differ between two recordings. An item is
+    // unchanged when the other list draws an identical item under the same
+    // clips and in the same order relative to the other unchanged items;
+    // every other item damages its footprint.
+    static std::vector<SkRect> damage(const DisplayListView& before, const DisplayListView& after);
+
+    DisplayListView view() const;
+
+    const std::vector<DisplayItem>& getItems() const { return m_items; }
+    const std::vector<SkFont>& getFonts() const { return m_fonts; }
+    const std::vector<SkGlyphID>& getGlyphs() const { return m_glyphs; }
+    const std::vector<SkPoint>& getPositions() const { return m_positions; }
+    const std::vector<BoxShadowSpec>& getShadows() const { return m_shadows; }
+    const std::vector<sk_sp<SkImage>>& getImages() const { return m_images; }
+
+    bool empty() const { return m_items.empty(); }
+    void clear();
+
+private:
+    DisplayItem& append(DisplayItemType type, const SkRect& rect, SkColor color);
+    uint32_t fontIndex(const SkFont& font);
+    static SkRect footprint(const DisplayItem& item, const BoxShadowSpec* shadows);
+
+    std::vector<DisplayItem> m_items;
+    std::vector<SkFont> m_fonts;
+    std::vector<SkGlyphID> m_glyphs;
+    std::vector<SkPoint> m_positions;
+    std::vector<BoxShadowSpec> m_shadows;
+    std::vector<sk_sp<SkImage>> m_images;
+};
+
+} // namespace text2image
+
+#endif // TEXT2IMAGE_DISPLAY_LIST_H
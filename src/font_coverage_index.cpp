@@ -0,0 +1,581 @@
+/*
+ * Text2Image Font Coverage Index Implementation
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the implementation of the FontCoverageIndex class.
+ */
+
+#include "font_coverage_index.h"
+
+#include <SkFontMgr.h>
+#include <SkFontStyle.h>
+#include <SkString.h>
+#include <SkTypeface.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace text2image {
+
+namespace {
+
+const char kMagic[4] = {'T', '2', 'I', 'F'};
+const uint32_t kVersion = 1;
+
+// Written as a number and compared on load, so files never cross byte orders
+const uint32_t kByteOrderMark = 0x01020304;
+
+// Every section starts on this boundary so its array can be used in place
+const size_t kSectionAlignment = 8;
+
+const uint32_t kPageCount = 0x110000 >> 8;
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t familyCount;
+    uint32_t pageCount;       // Distinct pages stored; the directory always has kPageCount entries
+    uint32_t reserved;
+    uint64_t fingerprint;     // Of the installed family names the index was built from
+    uint64_t directoryOffset;
+    uint64_t pagesOffset;
+    uint64_t familiesOffset;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+    uint64_t fileSize;
+};
+
+// Append count elements at the next section boundary and return their offset
+template <typename T>
+uint64_t appendSection(std::vector<uint8_t>& out, const T* data, size_t count) {
+    out.resize((out.size() + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment);
+    uint64_t offset = out.size();
+    if (count > 0) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+        out.insert(out.end(), bytes, bytes + count * sizeof(T));
+    }
+    return offset;
+}
+
+// Whether count elements of size bytes fit at offset, which must be aligned for them
+bool sectionFits(uint64_t offset, uint64_t count, size_t size, size_t alignment, size_t fileSize) {
+    return offset % alignment == 0 && offset <= fileSize && count <= (fileSize - offset) / size;
+}
+
+// FNV-1a over the family names, so installing or removing a family rebuilds the index
+uint64_t fingerprintFamilies(const std::vector<std::string>& families) {
+    uint64_t hash = 14695981039346656037ULL ^ kVersion;
+    for (const std::string& family : families) {
+        for (size_t i = 0; i <= family.size(); ++i) {
+            hash ^= static_cast<unsigned char>(family.c_str()[i]);
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+uint16_t readUint16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+uint32_t readUint32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+// Covered codepoints as inclusive ranges, in cmap order
+typedef std::vector<std::pair<uint32_t, uint32_t>> CodepointRanges;
+
+void addCovered(CodepointRanges& ranges, uint32_t first, uint32_t last) {
+    if (!ranges.empty() && ranges.back().second + 1 == first) {
+        ranges.back().second = last;
+    }
+    else {
+        ranges.emplace_back(first, last);
+    }
+}
+
+// Segment mapping to delta values: the BMP-only subtable every font has
+bool readFormat4(const uint8_t* table, size_t size, CodepointRanges& ranges) {
+    if (size < 14) {
+        return false;
+    }
+    const size_t segments = readUint16(table + 6) / 2;
+    const uint8_t* ends = table + 14;
+    const uint8_t* starts = ends + segments * 2 + 2;
+    const uint8_t* deltas = starts + segments * 2;
+    const uint8_t* rangeOffsets = deltas + segments * 2;
+    if (static_cast<size_t>(rangeOffsets + segments * 2 - table) > size) {
+        return false;
+    }
+
+    for (size_t i = 0; i < segments; ++i) {
+        const uint32_t start = readUint16(starts + i * 2);
+        const uint32_t end = std::min<uint32_t>(readUint16(ends + i * 2), 0xFFFE);
+        const uint16_t delta = readUint16(deltas + i * 2);
+        const uint16_t rangeOffset = readUint16(rangeOffsets + i * 2);
+        for (uint32_t c = start; c <= end; ++c) {
+            uint16_t glyph;
+            if (rangeOffset == 0) {
+                glyph = static_cast<uint16_t>(c + delta);
+            }
+            else {
+                // The offset is relative to its own slot in the idRangeOffset array
+                const uint8_t* entry = rangeOffsets + i * 2 + rangeOffset + (c - start) * 2;
+                if (static_cast<size_t>(entry + 2 - table) > size) {
+                    break;
+                }
+                glyph = readUint16(entry);
+                if (glyph != 0) {
+                    glyph = static_cast<uint16_t>(glyph + delta);
+                }
+            }
+            if (glyph != 0) {
+                addCovered(ranges, c, c);
+            }
+        }
+    }
+    return true;
+}
+
+// Segmented coverage: the full-repertoire subtable of CJK and emoji fonts
+bool readFormat12(const uint8_t* table, size_t size, CodepointRanges& ranges) {
+    if (size < 16) {
+        return false;
+    }
+    const uint32_t groups = readUint32(table + 12);
+    if (groups > (size - 16) / 12) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < groups; ++i) {
+        const uint8_t* group = table + 16 + static_cast<size_t>(i) * 12;
+        const uint32_t start = readUint32(group);
+        const uint32_t end = std::min<uint32_t>(readUint32(group + 4), 0x10FFFF);
+        const uint32_t glyph = readUint32(group + 8);
+
+        // Only the first character of a group starting at glyph 0 is unmapped
+        const uint32_t first = glyph == 0 ? start + 1 : start;
+        if (first <= end) {
+            addCovered(ranges, first, end);
+        }
+    }
+    return true;
+}
+
+// Codepoints the typeface maps to a glyph; returns how many
+size_t readCoverage(const SkTypeface* typeface, CodepointRanges& ranges) {
+    const SkFontTableTag tag = SkSetFourByteTag('c', 'm', 'a', 'p');
+    const size_t size = typeface->getTableSize(tag);
+    if (size < 4) {
+        return 0;
+    }
+    std::vector<uint8_t> cmap(size);
+    if (typeface->getTableData(tag, 0, size, cmap.data()) != size) {
+        return 0;
+    }
+
+    // Prefer a full-repertoire subtable, then a BMP one, among the Unicode encodings
+    const uint8_t* best = nullptr;
+    size_t bestSize = 0;
+    int bestRank = 0;
+    const size_t records = readUint16(cmap.data() + 2);
+    for (size_t i = 0; i < records && 4 + (i + 1) * 8 <= size; ++i) {
+        const uint8_t* record = cmap.data() + 4 + i * 8;
+        const uint16_t platform = readUint16(record);
+        const uint16_t encoding = readUint16(record + 2);
+        const uint32_t offset = readUint32(record + 4);
+        if (offset + 2 > size || !(platform == 0 || (platform == 3 && (encoding == 1 || encoding == 10)))) {
+            continue;
+        }
+        const uint16_t format = readUint16(cmap.data() + offset);
+        const int rank = format == 12 ? 2 : format == 4 ? 1 : 0;
+        if (rank > bestRank) {
+            best = cmap.data() + offset;
+            bestSize = size - offset;
+            bestRank = rank;
+        }
+    }
+
+    ranges.clear();
+    if (!best || !(bestRank == 2 ? readFormat12(best, bestSize, ranges) : readFormat4(best, bestSize, ranges))) {
+        return 0;
+    }
+
+    size_t count = 0;
+    for (const auto& range : ranges) {
+        count += range.second - range.first + 1;
+    }
+    return count;
+}
+
+// Write data to a new file at path, readable only by the current user
+bool writeFile(const std::string& path, const std::vector<uint8_t>& data) {
+#ifdef _WIN32
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    file.close();
+    return static_cast<bool>(file);
+#else
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t result = ::write(fd, data.data() + written, data.size() - written);
+        if (result < 0) {
+            ::close(fd);
+            return false;
+        }
+        written += static_cast<size_t>(result);
+    }
+    return ::close(fd) == 0;
+#endif
+}
+
+} // namespace
+
+FontCoverageIndex::FontCoverageIndex()
+    : m_data(nullptr),
+      m_size(0),
+#ifdef _WIN32
+      m_file(nullptr),
+      m_mapping(nullptr),
+#endif
+      m_directory(nullptr),
+      m_pages(nullptr),
+      m_familyOffsets(nullptr),
+      m_strings(nullptr),
+      m_familyCount(0),
+      m_stringsSize(0) {
+}
+
+FontCoverageIndex::~FontCoverageIndex() {
+    unmap();
+}
+
+std::string FontCoverageIndex::defaultPath() {
+    // Per-user cache directory, never the shared temporary directory, where
+    // another user could plant an index first
+    std::filesystem::path directory;
+#ifdef _WIN32
+    const char* base = std::getenv("LOCALAPPDATA");
+    if (!base || !*base) {
+        return "";
+    }
+    directory = std::filesystem::path(base) / "text2image";
+#else
+    const char* cache = std::getenv("XDG_CACHE_HOME");
+    const char* home = std::getenv("HOME");
+    if (cache && *cache == '/') {
+        directory = std::filesystem::path(cache) / "text2image";
+    }
+    else if (home && *home == '/') {
+        directory = std::filesystem::path(home) / ".cache" / "text2image";
+    }
+    else {
+        return "";
+    }
+#endif
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        return "";
+    }
+#ifndef _WIN32
+    // Only the owner may add files next to the index
+    struct stat info;
+    if (stat(directory.c_str(), &info) != 0 || info.st_uid != geteuid()) {
+        return "";
+    }
+    if ((info.st_mode & 0777) != 0700) {
+        chmod(directory.c_str(), 0700);
+    }
+#endif
+    return (directory / "font-coverage.idx").string();
+}
+
+bool FontCoverageIndex::open(const std::string& path) {
+    unmap();
+    m_memory.clear();
+
+    std::vector<std::string> families;
+    sk_sp<SkFontMgr> fontManager = SkFontMgr::RefDefault();
+    if (fontManager) {
+        for (int i = 0; i < fontManager->countFamilies(); ++i) {
+            SkString name;
+            fontManager->getFamilyName(i, &name);
+            families.push_back(name.c_str());
+        }
+    }
+    const uint64_t fingerprint = fingerprintFamilies(families);
+
+    // Later starts only map the file; an empty path keeps the index in memory
+    if (!path.empty() && map(path) && validate(m_data, m_size, fingerprint)) {
+        return true;
+    }
+    unmap();
+
+    std::vector<uint8_t> index;
+    if (!build(families, fingerprint, index)) {
+        return false;
+    }
+
+    // Written under a private name and renamed, so concurrent starts never see a partial file
+    if (!path.empty()) {
+        std::string temporary = path + "." + std::to_string(std::random_device()());
+        bool written = writeFile(temporary, index);
+#ifdef _WIN32
+        // rename does not replace an existing file here, e.g. a stale index
+        if (written) {
+            std::remove(path.c_str());
+        }
+#endif
+        if (!written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+            std::remove(temporary.c_str());
+        }
+        if (map(path) && validate(m_data, m_size, fingerprint)) {
+            return true;
+        }
+        unmap();
+    }
+
+    m_memory.swap(index);
+    return validate(m_memory.data(), m_memory.size(), fingerprint);
+}
+
+const char* FontCoverageIndex::getFamilyName(uint16_t font) const {
+    if (font >= m_familyCount) {
+        return "";
+    }
+    return m_strings + m_familyOffsets[font];
+}
+
+bool FontCoverageIndex::build(const std::vector<std::string>& families, uint64_t fingerprint, std::vector<uint8_t>& out) {
+    struct Coverage {
+        std::string family;
+        size_t count;
+        CodepointRanges ranges;
+    };
+
+    // Each family is read once, in its regular style
+    std::vector<Coverage> coverage;
+    for (const std::string& family : families) {
+        sk_sp<SkTypeface> typeface = SkTypeface::MakeFromName(family.c_str(), SkFontStyle::Normal());
+        Coverage entry{family, 0, {}};
+        entry.count = typeface ? readCoverage(typeface.get(), entry.ranges) : 0;
+        if (entry.count > 0) {
+            coverage.push_back(std::move(entry));
+        }
+    }
+
+    // Broad families first: a run of CJK text then stays in one fallback font,
+    // and only the narrowest are dropped when there are too many to number
+    std::stable_sort(coverage.begin(), coverage.end(), [](const Coverage& a, const Coverage& b) {
+        return a.count > b.count;
+    });
+    if (coverage.size() >= kNoFont) {
+        coverage.resize(kNoFont - 1);
+    }
+
+    std::vector<uint16_t> owners(static_cast<size_t>(kMaxCodepoint) + 1, kNoFont);
+    for (size_t font = 0; font < coverage.size(); ++font) {
+        for (const auto& range : coverage[font].ranges) {
+            for (uint32_t c = range.first; c <= range.second; ++c) {
+                if (owners[c] == kNoFont) {
+                    owners[c] = static_cast<uint16_t>(font);
+                }
+            }
+        }
+    }
+
+    // Identical pages, such as those inside one CJK block, are stored once
+    std::vector<uint16_t> directory(kPageCount, 0);
+    std::vector<uint16_t> pages;
+    std::unordered_map<std::string, uint16_t> distinct;
+    for (uint32_t index = 0; index < kPageCount; ++index) {
+        const uint16_t* page = owners.data() + (static_cast<size_t>(index) << 8);
+        if (std::all_of(page, page + 256, [](uint16_t font) { return font == kNoFont; })) {
+            continue;
+        }
+
+        std::string key(reinterpret_cast<const char*>(page), 256 * sizeof(uint16_t));
+        auto it = distinct.find(key);
+        if (it == distinct.end()) {
+            it = distinct.emplace(std::move(key), static_cast<uint16_t>(pages.size() / 256 + 1)).first;
+            pages.insert(pages.end(), page, page + 256);
+        }
+        directory[index] = it->second;
+    }
+
+    std::vector<uint32_t> familyOffsets;
+    std::vector<char> strings;
+    for (const Coverage& entry : coverage) {
+        familyOffsets.push_back(static_cast<uint32_t>(strings.size()));
+        strings.insert(strings.end(), entry.family.begin(), entry.family.end());
+        strings.push_back('\0');
+    }
+
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byteOrder = kByteOrderMark;
+    header.familyCount = static_cast<uint32_t>(coverage.size());
+    header.pageCount = static_cast<uint32_t>(pages.size() / 256);
+    header.fingerprint = fingerprint;
+
+    out.assign(sizeof(FileHeader), 0);
+    header.directoryOffset = appendSection(out, directory.data(), directory.size());
+    header.pagesOffset = appendSection(out, pages.data(), pages.size());
+    header.familiesOffset = appendSection(out, familyOffsets.data(), familyOffsets.size());
+    header.stringsOffset = appendSection(out, strings.data(), strings.size());
+    header.stringsSize = strings.size();
+    header.fileSize = out.size();
+    std::memcpy(out.data(), &header, sizeof(header));
+    return true;
+}
+
+bool FontCoverageIndex::validate(const uint8_t* data, size_t size, uint64_t fingerprint) {
+    if (size < sizeof(FileHeader)) {
+        return false;
+    }
+    const FileHeader& header = *reinterpret_cast<const FileHeader*>(data);
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        header.byteOrder != kByteOrderMark || header.fingerprint != fingerprint || header.fileSize != size ||
+        header.familyCount >= kNoFont || header.pageCount > kPageCount ||
+        !sectionFits(header.directoryOffset, kPageCount, sizeof(uint16_t), alignof(uint16_t), size) ||
+        !sectionFits(header.pagesOffset, static_cast<uint64_t>(header.pageCount) * 256, sizeof(uint16_t), alignof(uint16_t), size) ||
+        !sectionFits(header.familiesOffset, header.familyCount, sizeof(uint32_t), alignof(uint32_t), size) ||
+        !sectionFits(header.stringsOffset, header.stringsSize, 1, 1, size)) {
+        return false;
+    }
+
+    const uint16_t* directory = reinterpret_cast<const uint16_t*>(data + header.directoryOffset);
+    const uint16_t* pages = reinterpret_cast<const uint16_t*>(data + header.pagesOffset);
+    const uint32_t* familyOffsets = reinterpret_cast<const uint32_t*>(data + header.familiesOffset);
+    const char* strings = reinterpret_cast<const char*>(data + header.stringsOffset);
+
+    // Checked once here so lookups need no bounds checks
+    for (uint32_t i = 0; i < kPageCount; ++i) {
+        if (directory[i] > header.pageCount) {
+            return false;
+        }
+    }
+    for (uint64_t i = 0; i < static_cast<uint64_t>(header.pageCount) * 256; ++i) {
+        if (pages[i] != kNoFont && pages[i] >= header.familyCount) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header.familyCount; ++i) {
+        if (familyOffsets[i] >= header.stringsSize ||
+            !std::memchr(strings + familyOffsets[i], '\0', header.stringsSize - familyOffsets[i])) {
+            return false;
+        }
+    }
+
+    m_directory = directory;
+    m_pages = pages;
+    m_familyOffsets = familyOffsets;
+    m_strings = strings;
+    m_familyCount = header.familyCount;
+    m_stringsSize = header.stringsSize;
+    return true;
+}
+
+bool FontCoverageIndex::map(const std::string& path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    m_file = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < static_cast<LONGLONG>(sizeof(FileHeader))) {
+        return false;
+    }
+
+    m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mapping) {
+        return false;
+    }
+    m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_data) {
+        return false;
+    }
+    m_size = static_cast<size_t>(size.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    // A file another user owns or can write is rebuilt rather than trusted
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(FileHeader)) ||
+        info.st_uid != geteuid() || (info.st_mode & (S_IWGRP | S_IWOTH))) {
+        ::close(fd);
+        return false;
+    }
+
+    // The mapping outlives the descriptor
+    void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    m_data = static_cast<const uint8_t*>(data);
+    m_size = static_cast<size_t>(info.st_size);
+#endif
+    return true;
+}
+
+void FontCoverageIndex::unmap() {
+#ifdef _WIN32
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping) {
+        CloseHandle(m_mapping);
+    }
+    if (m_file) {
+        CloseHandle(m_file);
+    }
+    m_file = nullptr;
+    m_mapping = nullptr;
+#else
+    if (m_data) {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_directory = nullptr;
+    m_pages = nullptr;
+    m_familyOffsets = nullptr;
+    m_strings = nullptr;
+    m_familyCount = 0;
+    m_stringsSize = 0;
+}
+
+} // namespace text2image
@@ -0,0 +1,82 @@
+/*
+ * Text2Image Font Coverage Index
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains a file-backed table of which installed font family
+ * first covers each Unicode codepoint, built once from the fonts' cmap
+ * tables and mapped into memory on later starts.
+ */
+
+#ifndef TEXT2IMAGE_FONT_COVERAGE_INDEX_H
+#define TEXT2IMAGE_FONT_COVERAGE_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace text2image {
+
+class FontCoverageIndex {
+public:
+    // Returned by lookup for codepoints no installed family covers
+    static const uint16_t kNoFont = 0xFFFF;
+
+    FontCoverageIndex();
+    ~FontCoverageIndex();
+
+    FontCoverageIndex(const FontCoverageIndex&) = delete;
+    FontCoverageIndex& operator=(const FontCoverageIndex&) = delete;
+
+    // Map the index at path. When it is missing, corrupt or was built for
+    // another set of installed families, it is rebuilt and written there
+    // first; when it cannot be written, or path is empty, the rebuilt index
+    // is kept in memory.
+    bool open(const std::string& path);
+
+    // Index file in the user's cache directory ($XDG_CACHE_HOME or
+    // ~/.cache, %LOCALAPPDATA% on Windows), or empty when there is none
+    static std::string defaultPath();
+
+    bool isOpen() const { return m_directory != nullptr; }
+
+    // Family covering codepoint, preferring families that cover the most
+    // characters, or kNoFont. One table lookup; safe from any thread.
+    uint16_t lookup(uint32_t codepoint) const {
+        if (!m_directory || codepoint > kMaxCodepoint) {
+            return kNoFont;
+        }
+        uint16_t page = m_directory[codepoint >> 8];
+        return page ? m_pages[(static_cast<size_t>(page - 1) << 8) | (codepoint & 0xFF)] : kNoFont;
+    }
+
+    // Name of a family returned by lookup
+    const char* getFamilyName(uint16_t font) const;
+
+private:
+    static const uint32_t kMaxCodepoint = 0x10FFFF;
+
+    bool map(const std::string& path);
+    void unmap();
+    bool validate(const uint8_t* data, size_t size, uint64_t fingerprint);
+    static bool build(const std::vector<std::string>& families, uint64_t fingerprint, std::vector<uint8_t>& out);
+
+    const uint8_t* m_data;        // Mapping of the index file
+    size_t m_size;
+#ifdef _WIN32
+    void* m_file;
+    void* m_mapping;
+#endif
+    std::vector<uint8_t> m_memory;  // Index kept in memory when it could not be written
+
+    const uint16_t* m_directory;  // Page number plus one per 256 codepoints, 0 for none covered
+    const uint16_t* m_pages;      // Family per codepoint, 256 per page
+    const uint32_t* m_familyOffsets;
+    const char* m_strings;
+    uint32_t m_familyCount;
+    uint64_t m_stringsSize;
+};
+
+} // namespace text2image
+
+#endif // TEXT2IMAGE_FONT_COVERAGE_INDEX_H
@@ -0,0 +1,201 @@
+/*
+ * Text2Image Font Fallback Implementation
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the implementation of the FontFallbackMap and
+ * FontFallback classes.
+ */
+
+#include "font_fallback.h"
+#include "text_normalizer.h"
+
+namespace text2image {
+
+namespace {
+
+// Upper bound on cached fallback maps before the cache is reset
+const size_t kMaxFallbackMaps = 64;
+
+} // namespace
+
+FontFallbackMap::FontFallbackMap(sk_sp<SkTypeface> primary, std::shared_ptr<const FontCoverageIndex> index,
+                                 std::shared_ptr<FontFallbackStats> stats)
+    : m_primary(std::move(primary)),
+      m_style(m_primary ? m_primary->fontStyle() : SkFontStyle::Normal()),
+      m_index(std::move(index)),
+      m_stats(std::move(stats)),
+      m_pages(new std::atomic<const uint8_t*>[kPageCount]),
+      m_slotCount(1) {
+    for (size_t i = 0; i < kPageCount; ++i) {
+        m_pages[i].store(nullptr, std::memory_order_relaxed);
+    }
+    m_typefaces[0] = m_primary;
+}
+
+FontFallbackMap::~FontFallbackMap() {
+}
+
+template <typename Visit>
+void FontFallbackMap::forEachRun(const char* text, size_t length, Visit visit) {
+    const char* end = text + length;
+    const char* p = text;
+    const char* runStart = text;
+    uint8_t runSlot = 0;
+    while (p < end) {
+        const char* charStart = p;
+        uint32_t codepoint = nextCodepoint(p, end);
+        if (codepoint == ' ' && charStart != text) {
+            continue;
+        }
+
+        uint8_t slot = getPage(codepoint >> 8)[codepoint & 0xFF];
+        if (slot != runSlot && charStart != text) {
+            visit(static_cast<size_t>(runStart - text), static_cast<size_t>(charStart - runStart), runSlot);
+            runStart = charStart;
+        }
+        runSlot = slot;
+    }
+    if (end > runStart) {
+        visit(static_cast<size_t>(runStart - text), static_cast<size_t>(end - runStart), runSlot);
+    }
+}
+
+void FontFallbackMap::split(const SkFont& font, const char* text, size_t length, std::vector<FontRun>& runs) {
+    runs.clear();
+    forEachRun(text, length, [&](size_t start, size_t runLength, uint8_t slot) {
+        FontRun run{start, runLength, font};
+        if (slot != 0) {
+            run.font.setTypeface(m_typefaces[slot]);
+        }
+        runs.push_back(std::move(run));
+    });
+}
+
+SkScalar FontFallbackMap::measure(const SkFont& font, const char* text, size_t length) {
+    SkScalar width = 0;
+    forEachRun(text, length, [&](size_t start, size_t runLength, uint8_t slot) {
+        if (slot == 0) {
+            width += font.measureText(text + start, runLength, SkTextEncoding::kUTF8);
+        }
+        else {
+            SkFont fallback(font);
+            fallback.setTypeface(m_typefaces[slot]);
+            width += fallback.measureText(text + start, runLength, SkTextEncoding::kUTF8);
+        }
+    });
+    return width;
+}
+
+const uint8_t* FontFallbackMap::getPage(uint32_t page) {
+    const uint8_t* slots = m_pages[page].load(std::memory_order_acquire);
+    if (slots) {
+        return slots;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    slots = m_pages[page].load(std::memory_order_relaxed);
+    if (slots) {
+        return slots;
+    }
+
+    // The primary is asked about the whole page at once
+    SkUnichar codepoints[256];
+    SkGlyphID glyphs[256];
+    for (int i = 0; i < 256; ++i) {
+        codepoints[i] = static_cast<SkUnichar>((page << 8) | static_cast<uint32_t>(i));
+    }
+    SkFont probe(m_primary);
+    probe.unicharsToGlyphs(codepoints, 256, glyphs);
+
+    std::unique_ptr<uint8_t[]> built(new uint8_t[256]);
+    for (int i = 0; i < 256; ++i) {
+        built[i] = 0;
+        if (glyphs[i] == 0 && m_index && codepoints[i] > ' ') {
+            uint16_t family = m_index->lookup(static_cast<uint32_t>(codepoints[i]));
+            if (family != FontCoverageIndex::kNoFont) {
+                built[i] = slotFor(family, codepoints[i]);
+            }
+        }
+    }
+
+    slots = built.get();
+    m_ownedPages.push_back(std::move(built));
+    m_stats->pagesBuilt.fetch_add(1, std::memory_order_relaxed);
+    m_pages[page].store(slots, std::memory_order_release);
+    return slots;
+}
+
+uint8_t FontFallbackMap::slotFor(uint16_t family, SkUnichar codepoint) {
+    auto it = m_familySlots.find(family);
+    uint8_t slot;
+    if (it != m_familySlots.end()) {
+        slot = it->second;
+    }
+    else {
+        // Opened in the primary's style where the family has it
+        sk_sp<SkTypeface> typeface = m_slotCount < kMaxSlots
+            ? SkTypeface::MakeFromName(m_index->getFamilyName(family), m_style) : nullptr;
+        slot = 0;
+        if (typeface) {
+            slot = static_cast<uint8_t>(m_slotCount++);
+            m_typefaces[slot] = std::move(typeface);
+            m_stats->typefacesOpened.fetch_add(1, std::memory_order_relaxed);
+        }
+        m_familySlots[family] = slot;
+    }
+
+    // The index covers the regular style; another style of the family may lack the character
+    if (slot != 0 && SkFont(m_typefaces[slot]).unicharToGlyph(codepoint) == 0) {
+        return 0;
+    }
+    return slot;
+}
+
+FontFallback::FontFallback()
+    : m_stats(std::make_shared<FontFallbackStats>()) {
+}
+
+FontFallback::~FontFallback() {
+}
+
+bool FontFallback::initialize(const std::string& indexPath) {
+    auto index = std::make_shared<FontCoverageIndex>();
+    if (!index->open(indexPath)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_index = std::move(index);
+    m_maps.clear();
+    return true;
+}
+
+std::shared_ptr<FontFallbackMap> FontFallback::getMap(const SkFont& font) {
+    sk_sp<SkTypeface> typeface = font.refTypeface();
+    SkTypefaceID key = typeface ? typeface->uniqueID() : 0;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_maps.find(key);
+    if (it != m_maps.end()) {
+        return it->second;
+    }
+
+    if (m_maps.size() >= kMaxFallbackMaps) {
+        m_maps.clear();
+    }
+    auto map = std::make_shared<FontFallbackMap>(std::move(typeface), m_index, m_stats);
+    m_maps[key] = map;
+    return map;
+}
+
+void FontFallback::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maps.clear();
+}
+
+void FontFallback::getStats(uint64_t& pagesBuilt, uint64_t& typefacesOpened) const {
+    pagesBuilt = m_stats->pagesBuilt.load(std::memory_order_relaxed);
+    typefacesOpened = m_stats->typefacesOpened.load(std::memory_order_relaxed);
+}
+
+} // namespace text2image
@@ -0,0 +1,117 @@
+/*
+ * Text2Image Font Fallback
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the per-typeface codepoint maps that pick a fallback
+ * typeface for characters the primary one lacks, and the registry that
+ * shares them between renders.
+ */
+
+#ifndef TEXT2IMAGE_FONT_FALLBACK_H
+#define TEXT2IMAGE_FONT_FALLBACK_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <SkFont.h>
+#include <SkFontStyle.h>
+#include <SkTypeface.h>
+
+#include "font_coverage_index.h"
+
+namespace text2image {
+
+// A piece of text drawn with one typeface
+struct FontRun {
+    size_t start;             // Byte offset into the text
+    size_t length;
+    SkFont font;
+};
+
+// Work done by every fallback map of one registry
+struct FontFallbackStats {
+    std::atomic<uint64_t> pagesBuilt;
+    std::atomic<uint64_t> typefacesOpened;
+
+    FontFallbackStats() : pagesBuilt(0), typefacesOpened(0) {}
+};
+
+// Typeface for every codepoint, for one primary typeface. Pages of 256
+// codepoints are resolved on first use; after that a character costs one
+// table lookup. Fallback typefaces are only opened once a character needs
+// them. Thread-safe.
+class FontFallbackMap {
+public:
+    FontFallbackMap(sk_sp<SkTypeface> primary, std::shared_ptr<const FontCoverageIndex> index,
+                    std::shared_ptr<FontFallbackStats> stats);
+    ~FontFallbackMap();
+
+    FontFallbackMap(const FontFallbackMap&) = delete;
+    FontFallbackMap& operator=(const FontFallbackMap&) = delete;
+
+    // Split UTF-8 text into runs of font, whose typeface must be the
+    // primary, switching typeface where the primary lacks a character that
+    // an installed family has. Spaces stay in the run they follow.
+    void split(const SkFont& font, const char* text, size_t length, std::vector<FontRun>& runs);
+
+    // Advance width of text as split would draw it
+    SkScalar measure(const SkFont& font, const char* text, size_t length);
+
+private:
+    static const size_t kPageCount = 0x110000 >> 8;
+    static const size_t kMaxSlots = 256;
+
+    // Slot per codepoint of one page; slot 0 is the primary
+    const uint8_t* getPage(uint32_t page);
+    uint8_t slotFor(uint16_t family, SkUnichar codepoint);
+
+    template <typename Visit>
+    void forEachRun(const char* text, size_t length, Visit visit);
+
+    sk_sp<SkTypeface> m_primary;
+    SkFontStyle m_style;
+    std::shared_ptr<const FontCoverageIndex> m_index;
+    std::shared_ptr<FontFallbackStats> m_stats;
+
+    std::unique_ptr<std::atomic<const uint8_t*>[]> m_pages;
+    std::vector<std::unique_ptr<uint8_t[]>> m_ownedPages;
+    sk_sp<SkTypeface> m_typefaces[kMaxSlots];        // Written before the page that first uses the slot
+    std::unordered_map<uint16_t, uint8_t> m_familySlots;
+    size_t m_slotCount;
+    std::mutex m_mutex;                              // Guards page building
+};
+
+class FontFallback {
+public:
+    FontFallback();
+    ~FontFallback();
+
+    // Map the coverage index at indexPath, building it on first use. Without
+    // it every character is drawn with its primary typeface.
+    bool initialize(const std::string& indexPath);
+
+    // Fallback map for the typeface of font
+    std::shared_ptr<FontFallbackMap> getMap(const SkFont& font);
+
+    // Drop the maps and the fallback typefaces they opened; the index stays
+    void clear();
+
+    // Pages resolved and fallback typefaces opened since startup
+    void getStats(uint64_t& pagesBuilt, uint64_t& typefacesOpened) const;
+
+private:
+    std::shared_ptr<const FontCoverageIndex> m_index;
+    std::shared_ptr<FontFallbackStats> m_stats;
+    std::unordered_map<SkTypefaceID, std::shared_ptr<FontFallbackMap>> m_maps;
+    std::mutex m_mutex;
+};
+
+} // namespace text2image
+
+#endif // TEXT2IMAGE_FONT_FALLBACK_H
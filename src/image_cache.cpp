@@ -0,0 +1,337 @@
+/*
+ * Text2Image Image Cache Implementation
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the implementation of the ImageCache class.
+ */
+
+#include "image_cache.h"
+#include "base64.h"
+
+#include <SkBitmap.h>
+#include <SkCodec.h>
+#include <SkImageInfo.h>
+#include <SkPixmap.h>
+#include <SkSamplingOptions.h>
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+
+namespace text2image {
+
+namespace {
+
+// Upper bound on fetched sources before the cache is reset
+const size_t kMaxImageSources = 256;
+
+// Upper bound on decoded pixels, in bytes, before the decoded images are dropped
+const size_t kMaxDecodedBytes = 128 * 1024 * 1024;
+
+// Largest side an image is decoded at; bigger layouts are not drawn
+const int kMaxImageDimension = 16384;
+
+bool startsWithNoCase(const std::string& text, const char* prefix) {
+    for (size_t i = 0; prefix[i]; ++i) {
+        if (i >= text.size() || std::tolower(static_cast<unsigned char>(text[i])) != prefix[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Undo %XX escapes; malformed escapes are kept as they are
+template <typename Output>
+void percentDecode(const char* text, size_t length, Output& out) {
+    for (size_t i = 0; i < length; ++i) {
+        if (text[i] == '%' && i + 2 < length && hexValue(text[i + 1]) >= 0 && hexValue(text[i + 2]) >= 0) {
+            out.push_back(static_cast<char>(hexValue(text[i + 1]) * 16 + hexValue(text[i + 2])));
+            i += 2;
+        }
+        else {
+            out.push_back(text[i]);
+        }
+    }
+}
+
+// Payload of a data: URI, base64 or percent-encoded
+bool decodeDataUri(const std::string& url, std::vector<uint8_t>& data) {
+    size_t comma = url.find(',');
+    if (comma == std::string::npos) {
+        return false;
+    }
+
+    std::string meta = url.substr(5, comma - 5);
+    std::transform(meta.begin(), meta.end(), meta.begin(), [](unsigned char c) { return std::tolower(c); });
+    const char* payload = url.data() + comma + 1;
+    const size_t length = url.size() - comma - 1;
+    if (meta.size() >= 7 && meta.compare(meta.size() - 7, 7, ";base64") == 0) {
+        return decodeBase64(payload, length, data);
+    }
+
+    data.clear();
+    percentDecode(payload, length, data);
+    return true;
+}
+
+} // namespace
+
+ImageCache::ImageCache()
+    : m_imageBytes(0) {
+}
+
+ImageCache::~ImageCache() {
+}
+
+void ImageCache::setResolver(ResourceResolver resolver) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_resolver = std::move(resolver);
+    m_sources.clear();
+    m_images.clear();
+    m_imageBytes = 0;
+}
+
+bool ImageCache::setLocalDirectory(const std::string& directory) {
+    std::string canonical;
+    if (!directory.empty()) {
+        std::error_code error;
+        std::filesystem::path path = std::filesystem::canonical(directory, error);
+        if (error || !std::filesystem::is_directory(path, error)) {
+            return false;
+        }
+        canonical = path.string();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_localDirectory = canonical;
+    m_sources.clear();
+    m_images.clear();
+    m_imageBytes = 0;
+    return true;
+}
+
+std::shared_ptr<const ImageSource> ImageCache::getSource(const std::string& url) {
+    std::promise<std::shared_ptr<const ImageSource>> promise;
+    std::shared_future<std::shared_ptr<const ImageSource>> future;
+    ResourceResolver resolver;
+    std::string localDirectory;
+    bool owner = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_sources.find(url);
+        if (it != m_sources.end()) {
+            future = it->second;
+        }
+        else {
+            if (m_sources.size() >= kMaxImageSources) {
+                m_sources.clear();
+            }
+            future = promise.get_future().share();
+            m_sources[url] = future;
+            resolver = m_resolver;
+            localDirectory = m_localDirectory;
+            owner = true;
+        }
+    }
+
+    // Fetched outside the lock; callers asking for the same URL meanwhile wait on the future
+    if (owner) {
+        promise.set_value(load(url, resolver, localDirectory));
+    }
+    return future.get();
+}
+
+sk_sp<SkImage> ImageCache::getImage(const std::shared_ptr<const ImageSource>& source, int width, int height) {
+    if (!source || width <= 0 || height <= 0 || width > kMaxImageDimension || height > kMaxImageDimension) {
+        return nullptr;
+    }
+
+    std::promise<sk_sp<SkImage>> promise;
+    std::shared_future<sk_sp<SkImage>> future;
+    bool owner = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ImageKey key{source.get(), width, height};
+        auto it = m_images.find(key);
+        if (it != m_images.end()) {
+            future = it->second.image;
+        }
+        else {
+            const size_t bytes = static_cast<size_t>(width) * static_cast<size_t>(height) * 4;
+            if (m_imageBytes + bytes > kMaxDecodedBytes) {
+                m_images.clear();
+                m_imageBytes = 0;
+            }
+            future = promise.get_future().share();
+            m_images[key] = {source, future};
+            m_imageBytes += bytes;
+            owner = true;
+        }
+    }
+
+    if (owner) {
+        sk_sp<SkImage> image;
+        try {
+            image = decode(*source, width, height);
+        }
+        catch (...) {
+            image = nullptr;
+        }
+        promise.set_value(image);
+    }
+    return future.get();
+}
+
+void ImageCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_sources.clear();
+    m_images.clear();
+    m_imageBytes = 0;
+}
+
+std::shared_ptr<const ImageSource> ImageCache::load(const std::string& url, const ResourceResolver& resolver,
+                                                    const std::string& localDirectory) {
+    try {
+        std::vector<uint8_t> bytes;
+        bool fetched;
+        if (startsWithNoCase(url, "data:")) {
+            fetched = decodeDataUri(url, bytes);
+        }
+        else if (resolver) {
+            fetched = resolver(url, bytes);
+        }
+        else {
+            fetched = readFile(url, localDirectory, bytes);
+        }
+        if (!fetched || bytes.empty()) {
+            return nullptr;
+        }
+
+        // Only the header is read here; pixels wait until the layout size is known
+        sk_sp<SkData> data = SkData::MakeWithCopy(bytes.data(), bytes.size());
+        std::unique_ptr<SkCodec> codec = SkCodec::MakeFromData(data);
+        if (!codec) {
+            return nullptr;
+        }
+
+        auto source = std::make_shared<ImageSource>();
+        source->url = url;
+        source->data = std::move(data);
+        source->width = codec->dimensions().width();
+        source->height = codec->dimensions().height();
+        if (source->width <= 0 || source->height <= 0) {
+            return nullptr;
+        }
+        return source;
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+sk_sp<SkImage> ImageCache::decode(const ImageSource& source, int width, int height) {
+    std::unique_ptr<SkCodec> codec = SkCodec::MakeFromData(source.data);
+    if (!codec) {
+        return nullptr;
+    }
+
+    // Use the smallest scale the codec decodes natively that still covers the target
+    SkISize decoded = codec->dimensions();
+    float scale = std::max(static_cast<float>(width) / decoded.width(), static_cast<float>(height) / decoded.height());
+    if (scale < 1) {
+        SkISize scaled = codec->getScaledDimensions(scale);
+        if (scaled.width() >= width && scaled.height() >= height) {
+            decoded = scaled;
+        }
+    }
+
+    SkBitmap bitmap;
+    SkImageInfo info = SkImageInfo::MakeN32Premul(decoded.width(), decoded.height());
+    if (!bitmap.tryAllocPixels(info)) {
+        return nullptr;
+    }
+    SkCodec::Result result = codec->getPixels(info, bitmap.getPixels(), bitmap.rowBytes());
+    if (result != SkCodec::kSuccess && result != SkCodec::kIncompleteInput) {
+        return nullptr;
+    }
+
+    if (decoded.width() == width && decoded.height() == height) {
+        bitmap.setImmutable();
+        return bitmap.asImage();
+    }
+
+    // Mipmaps keep large reductions from aliasing
+    SkBitmap resized;
+    if (!resized.tryAllocPixels(SkImageInfo::MakeN32Premul(width, height)) ||
+        !bitmap.pixmap().scalePixels(resized.pixmap(), SkSamplingOptions(SkFilterMode::kLinear, SkMipmapMode::kLinear))) {
+        return nullptr;
+    }
+    resized.setImmutable();
+    return resized.asImage();
+}
+
+bool ImageCache::readFile(const std::string& url, const std::string& localDirectory, std::vector<uint8_t>& data) {
+    // Documents read no local files unless a directory was allowed
+    if (localDirectory.empty()) {
+        return false;
+    }
+
+    std::string path;
+    if (startsWithNoCase(url, "file://")) {
+        size_t start = 7;
+        if (startsWithNoCase(url.substr(start), "localhost/")) {
+            start += 9;
+        }
+        percentDecode(url.data() + start, url.size() - start, path);
+#ifdef _WIN32
+        // file:///C:/dir/image.png names C:/dir/image.png
+        if (path.size() > 2 && path[0] == '/' && path[2] == ':') {
+            path.erase(0, 1);
+        }
+#endif
+    }
+    else if (url.find("://") != std::string::npos) {
+        // Other schemes are remote; only a custom resolver fetches those
+        return false;
+    }
+    else {
+        path = url;
+    }
+
+    // Relative paths resolve against the directory. Symlinks and ".." are
+    // resolved before the check, so neither can lead outside it.
+    std::error_code error;
+    const std::filesystem::path base(localDirectory);
+    std::filesystem::path resolved = std::filesystem::weakly_canonical(base / path, error);
+    if (error) {
+        return false;
+    }
+    std::filesystem::path relative = resolved.lexically_relative(base);
+    if (relative.empty() || relative.is_absolute() || *relative.begin() == "..") {
+        return false;
+    }
+
+    std::ifstream file(resolved, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    file.seekg(0, std::ios::end);
+    std::streamsize size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    if (size <= 0) {
+        return false;
+    }
+
+    data.resize(static_cast<size_t>(size));
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()), size));
+}
+
+} // namespace text2image
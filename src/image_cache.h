@@ -0,0 +1,110 @@
+/*
+ * Text2Image Image Cache
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the cache that loads the images documents embed and
+ * decodes them at the size they are laid out at, shared by every render.
+ */
+
+#ifndef TEXT2IMAGE_IMAGE_CACHE_H
+#define TEXT2IMAGE_IMAGE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <SkData.h>
+#include <SkImage.h>
+
+namespace text2image {
+
+// Fetch the bytes of a URL that is not a data: URI; false when unavailable.
+// Called from render threads, possibly several at once.
+using ResourceResolver = std::function<bool(const std::string& url, std::vector<uint8_t>& data)>;
+
+// Encoded bytes of one URL, with the image size read from its header
+struct ImageSource {
+    std::string url;
+    sk_sp<SkData> data;
+    int width;
+    int height;
+};
+
+// Thread-safe. A URL is fetched once, and an image is decoded once per
+// size, however many renders ask for it at the same time: the first caller
+// does the work and the others wait for its result.
+class ImageCache {
+public:
+    ImageCache();
+    ~ImageCache();
+
+    ImageCache(const ImageCache&) = delete;
+    ImageCache& operator=(const ImageCache&) = delete;
+
+    // Replace how URLs are fetched, dropping everything fetched so far. A
+    // null resolver restores the default, which reads only files inside the
+    // local directory.
+    void setResolver(ResourceResolver resolver);
+
+    // Let the default fetcher read files inside directory, named by a path
+    // relative to it or by an absolute path or file:// URL that leads into
+    // it. Empty disables local files, the default. Drops everything fetched
+    // so far; false when directory does not exist.
+    bool setLocalDirectory(const std::string& directory);
+
+    // Source for url, or null when it cannot be fetched or is not an image
+    // Skia can decode
+    std::shared_ptr<const ImageSource> getSource(const std::string& url);
+
+    // source decoded to exactly width x height pixels, or null. Codecs that
+    // can decode at a reduced scale, as JPEG can, do so; the rest decode at
+    // full size and are resampled once.
+    sk_sp<SkImage> getImage(const std::shared_ptr<const ImageSource>& source, int width, int height);
+
+    void clear();
+
+private:
+    // Sources are keyed by address; the entry holds the source, so the address stays unique
+    struct ImageKey {
+        const ImageSource* source;
+        int width;
+        int height;
+
+        bool operator==(const ImageKey& other) const {
+            return source == other.source && width == other.width && height == other.height;
+        }
+    };
+
+    struct ImageKeyHash {
+        size_t operator()(const ImageKey& key) const {
+            return std::hash<const void*>()(key.source) ^ (static_cast<size_t>(key.width) * 31 + key.height) * 0x9E3779B97F4A7C15ULL;
+        }
+    };
+
+    struct ImageEntry {
+        std::shared_ptr<const ImageSource> source;
+        std::shared_future<sk_sp<SkImage>> image;
+    };
+
+    std::shared_ptr<const ImageSource> load(const std::string& url, const ResourceResolver& resolver,
+                                            const std::string& localDirectory);
+    static sk_sp<SkImage> decode(const ImageSource& source, int width, int height);
+    static bool readFile(const std::string& url, const std::string& localDirectory, std::vector<uint8_t>& data);
+
+    ResourceResolver m_resolver;
+    std::string m_localDirectory;  // Canonical, or empty when local files are off
+    std::unordered_map<std::string, std::shared_future<std::shared_ptr<const ImageSource>>> m_sources;
+    std::unordered_map<ImageKey, ImageEntry, ImageKeyHash> m_images;
+    size_t m_imageBytes;      // Pixels of m_images, counted when each decode starts
+    std::mutex m_mutex;
+};
+
+} // namespace text2image
+
+#endif // TEXT2IMAGE_IMAGE_CACHE_H
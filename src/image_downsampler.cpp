@@ -0,0 +1,309 @@
+/*
+ * Text2Image Image Downsampler Implementation
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the implementation of the ImageDownsampler class.
+ */
+
+#include "image_downsampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXT2IMAGE_DOWNSAMPLE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace text2image {
+
+namespace {
+
+// Filter weights are fixed point with this many fraction bits
+const int kWeightBits = 14;
+
+// Lanczos window, in source pixels at a factor of 1
+const double kLanczosRadius = 3.0;
+
+double lanczos(double x) {
+    x = std::fabs(x);
+    if (x < 1e-8) {
+        return 1.0;
+    }
+    if (x >= kLanczosRadius) {
+        return 0.0;
+    }
+    const double pi = 3.14159265358979323846;
+    return kLanczosRadius * std::sin(pi * x) * std::sin(pi * x / kLanczosRadius) / (pi * pi * x * x);
+}
+
+// Source pixels, and their weights, that make up each output pixel of one axis
+struct FilterTaps {
+    std::vector<int> start;
+    std::vector<int> count;
+    std::vector<size_t> offset;      // Into weights
+    std::vector<int16_t> weights;    // Sum to 1 << kWeightBits per output pixel
+};
+
+void buildTaps(int sourceSize, int size, FilterTaps& taps) {
+    const double factor = static_cast<double>(sourceSize) / size;
+    const double scale = std::max(factor, 1.0);
+    const double support = kLanczosRadius * scale;
+
+    taps.start.resize(size);
+    taps.count.resize(size);
+    taps.offset.resize(size);
+    taps.weights.clear();
+    std::vector<double> values;
+    for (int i = 0; i < size; ++i) {
+        const double center = (i + 0.5) * factor - 0.5;
+        const int first = std::max(0, static_cast<int>(std::floor(center - support)) + 1);
+        const int last = std::min(sourceSize - 1, static_cast<int>(std::floor(center + support)));
+
+        // Taps past the edges are dropped and the rest renormalized
+        values.clear();
+        double total = 0;
+        for (int x = first; x <= last; ++x) {
+            values.push_back(lanczos((x - center) / scale));
+            total += values.back();
+        }
+
+        taps.start[i] = first;
+        taps.count[i] = static_cast<int>(values.size());
+        taps.offset[i] = taps.weights.size();
+        int sum = 0;
+        size_t largest = taps.weights.size();
+        for (double value : values) {
+            taps.weights.push_back(static_cast<int16_t>(std::lround(value / total * (1 << kWeightBits))));
+            if (taps.weights.back() > taps.weights[largest]) {
+                largest = taps.weights.size() - 1;
+            }
+            sum += taps.weights.back();
+        }
+
+        // Rounding error goes to the heaviest tap, so flat areas stay flat
+        taps.weights[largest] = static_cast<int16_t>(taps.weights[largest] + (1 << kWeightBits) - sum);
+    }
+}
+
+uint8_t clampChannel(int32_t sum) {
+    int32_t value = (sum + (1 << (kWeightBits - 1))) >> kWeightBits;
+    return static_cast<uint8_t>(std::min(255, std::max(0, value)));
+}
+
+// Negative lobes can leave a color above its alpha, which is not valid premultiplied
+void clampToAlpha(uint8_t* row, int width) {
+    for (int x = 0; x < width; ++x) {
+        uint8_t* pixel = row + x * 4;
+        pixel[0] = std::min(pixel[0], pixel[3]);
+        pixel[1] = std::min(pixel[1], pixel[3]);
+        pixel[2] = std::min(pixel[2], pixel[3]);
+    }
+}
+
+#ifdef TEXT2IMAGE_DOWNSAMPLE_SSE2
+
+// Two 16-bit weights, as _mm_madd_epi16 pairs them
+__m128i weightPair(int16_t first, int16_t second) {
+    return _mm_set1_epi32(static_cast<int>(static_cast<uint16_t>(first) | (static_cast<uint32_t>(static_cast<uint16_t>(second)) << 16)));
+}
+
+// Round four 32-bit sums per pixel down to 8 bits with saturation
+__m128i packSums(__m128i p0, __m128i p1, __m128i p2, __m128i p3) {
+    const __m128i round = _mm_set1_epi32(1 << (kWeightBits - 1));
+    p0 = _mm_srai_epi32(_mm_add_epi32(p0, round), kWeightBits);
+    p1 = _mm_srai_epi32(_mm_add_epi32(p1, round), kWeightBits);
+    p2 = _mm_srai_epi32(_mm_add_epi32(p2, round), kWeightBits);
+    p3 = _mm_srai_epi32(_mm_add_epi32(p3, round), kWeightBits);
+    return _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3));
+}
+
+#endif // TEXT2IMAGE_DOWNSAMPLE_SSE2
+
+} // namespace
+
+ImageDownsampler::ImageDownsampler(const uint8_t* pixels, size_t rowBytes, int width, int height) {
+    m_levels.push_back(Level{pixels, rowBytes, width, height});
+}
+
+ImageDownsampler::~ImageDownsampler() {
+}
+
+void ImageDownsampler::prepare(int width, int height) {
+    while (m_levels.back().width / 2 >= std::max(width, 1) && m_levels.back().height / 2 >= std::max(height, 1)) {
+        PixelLevel half;
+        halve(m_levels.back(), half);
+        m_owned.push_back(std::move(half.pixels));
+        m_levels.push_back(Level{m_owned.back().data(), static_cast<size_t>(half.width) * 4, half.width, half.height});
+    }
+}
+
+bool ImageDownsampler::downsample(int width, int height, PixelLevel& out) const {
+    const Level& source = m_levels.front();
+    if (width <= 0 || height <= 0 || width > source.width || height > source.height) {
+        return false;
+    }
+
+    // The smallest prepared level that still covers the target
+    const Level* level = &source;
+    for (const Level& candidate : m_levels) {
+        if (candidate.width >= width && candidate.height >= height) {
+            level = &candidate;
+        }
+    }
+
+    if (level->width == width && level->height == height) {
+        out.width = width;
+        out.height = height;
+        out.pixels.resize(static_cast<size_t>(width) * height * 4);
+        for (int y = 0; y < height; ++y) {
+            std::memcpy(&out.pixels[static_cast<size_t>(y) * width * 4], level->pixels + y * level->rowBytes,
+                        static_cast<size_t>(width) * 4);
+        }
+        return true;
+    }
+
+    resample(*level, width, height, out);
+    return true;
+}
+
+void ImageDownsampler::halve(const Level& source, PixelLevel& out) {
+    // An odd last row or column is dropped, as mipmaps do
+    out.width = source.width / 2;
+    out.height = source.height / 2;
+    out.pixels.resize(static_cast<size_t>(out.width) * out.height * 4);
+
+    for (int y = 0; y < out.height; ++y) {
+        const uint8_t* top = source.pixels + static_cast<size_t>(y) * 2 * source.rowBytes;
+        const uint8_t* bottom = top + source.rowBytes;
+        uint8_t* row = &out.pixels[static_cast<size_t>(y) * out.width * 4];
+        int x = 0;
+
+#ifdef TEXT2IMAGE_DOWNSAMPLE_SSE2
+        // Eight source pixels of each row make four output pixels
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i two = _mm_set1_epi16(2);
+        for (; x + 4 <= out.width; x += 4) {
+            __m128i halves[2];
+            for (int i = 0; i < 2; ++i) {
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + (x * 2 + i * 4) * 4));
+                const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + (x * 2 + i * 4) * 4));
+
+                // Column sums of pixel pairs, then each pair added across
+                const __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+                const __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+                const __m128i sums = _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+                halves[i] = _mm_srli_epi16(_mm_add_epi16(sums, two), 2);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x * 4), _mm_packus_epi16(halves[0], halves[1]));
+        }
+#endif
+
+        for (; x < out.width; ++x) {
+            const uint8_t* a = top + x * 8;
+            const uint8_t* b = bottom + x * 8;
+            for (int c = 0; c < 4; ++c) {
+                row[x * 4 + c] = static_cast<uint8_t>((a[c] + a[c + 4] + b[c] + b[c + 4] + 2) >> 2);
+            }
+        }
+    }
+}
+
+void ImageDownsampler::resample(const Level& source, int width, int height, PixelLevel& out) {
+    FilterTaps columns;
+    FilterTaps rows;
+    buildTaps(source.width, width, columns);
+    buildTaps(source.height, height, rows);
+
+    // Horizontal pass first, so the vertical pass reads fewer columns
+    std::vector<uint8_t> narrow(static_cast<size_t>(width) * source.height * 4);
+    for (int y = 0; y < source.height; ++y) {
+        const uint8_t* in = source.pixels + y * source.rowBytes;
+        uint8_t* row = &narrow[static_cast<size_t>(y) * width * 4];
+        for (int x = 0; x < width; ++x) {
+            const uint8_t* pixels = in + static_cast<size_t>(columns.start[x]) * 4;
+            const int16_t* weights = &columns.weights[columns.offset[x]];
+            const int count = columns.count[x];
+
+#ifdef TEXT2IMAGE_DOWNSAMPLE_SSE2
+            // Two neighbours at a time, channels paired as r0 r1 g0 g1 b0 b1 a0 a1
+            const __m128i zero = _mm_setzero_si128();
+            __m128i sum = _mm_setzero_si128();
+            int k = 0;
+            for (; k + 2 <= count; k += 2) {
+                const __m128i wide = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixels + k * 4)), zero);
+                const __m128i paired = _mm_unpacklo_epi16(wide, _mm_srli_si128(wide, 8));
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(paired, weightPair(weights[k], weights[k + 1])));
+            }
+            if (k < count) {
+                int32_t last;
+                std::memcpy(&last, pixels + k * 4, 4);
+                const __m128i wide = _mm_unpacklo_epi8(_mm_cvtsi32_si128(last), zero);
+                const __m128i paired = _mm_unpacklo_epi16(wide, zero);
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(paired, weightPair(weights[k], 0)));
+            }
+            alignas(16) int32_t sums[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(sums), sum);
+            for (int c = 0; c < 4; ++c) {
+                row[x * 4 + c] = clampChannel(sums[c]);
+            }
+#else
+            for (int c = 0; c < 4; ++c) {
+                int32_t sum = 0;
+                for (int k = 0; k < count; ++k) {
+                    sum += pixels[k * 4 + c] * weights[k];
+                }
+                row[x * 4 + c] = clampChannel(sum);
+            }
+#endif
+        }
+    }
+
+    out.width = width;
+    out.height = height;
+    out.pixels.resize(static_cast<size_t>(width) * height * 4);
+    const size_t stride = static_cast<size_t>(width) * 4;
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* first = &narrow[static_cast<size_t>(rows.start[y]) * stride];
+        const int16_t* weights = &rows.weights[rows.offset[y]];
+        const int count = rows.count[y];
+        uint8_t* row = &out.pixels[static_cast<size_t>(y) * stride];
+        int x = 0;
+
+#ifdef TEXT2IMAGE_DOWNSAMPLE_SSE2
+        // Four pixels at a time; two source rows are interleaved so one multiply-add takes both
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 4 <= width; x += 4) {
+            __m128i p0 = zero, p1 = zero, p2 = zero, p3 = zero;
+            for (int k = 0; k < count; k += 2) {
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + k * stride + x * 4));
+                const bool single = k + 1 == count;
+                const __m128i b = single ? zero
+                                         : _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + (k + 1) * stride + x * 4));
+                const __m128i weight = weightPair(weights[k], single ? 0 : weights[k + 1]);
+                const __m128i low = _mm_unpacklo_epi8(a, b);
+                const __m128i high = _mm_unpackhi_epi8(a, b);
+                p0 = _mm_add_epi32(p0, _mm_madd_epi16(_mm_unpacklo_epi8(low, zero), weight));
+                p1 = _mm_add_epi32(p1, _mm_madd_epi16(_mm_unpackhi_epi8(low, zero), weight));
+                p2 = _mm_add_epi32(p2, _mm_madd_epi16(_mm_unpacklo_epi8(high, zero), weight));
+                p3 = _mm_add_epi32(p3, _mm_madd_epi16(_mm_unpackhi_epi8(high, zero), weight));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x * 4), packSums(p0, p1, p2, p3));
+        }
+#endif
+
+        for (; x < width; ++x) {
+            for (int c = 0; c < 4; ++c) {
+                int32_t sum = 0;
+                for (int k = 0; k < count; ++k) {
+                    sum += first[k * stride + x * 4 + c] * weights[k];
+                }
+                row[x * 4 + c] = clampChannel(sum);
+            }
+        }
+        clampToAlpha(row, width);
+    }
+}
+
+} // namespace text2image
@@ -0,0 +1,65 @@
+/*
+ * Text2Image Image Downsampler
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the downsampler that derives thumbnails from one
+ * rendered raster instead of rendering each size again.
+ */
+
+#ifndef TEXT2IMAGE_IMAGE_DOWNSAMPLER_H
+#define TEXT2IMAGE_IMAGE_DOWNSAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace text2image {
+
+// Premultiplied RGBA pixels of one image, packed 4 bytes per pixel
+struct PixelLevel {
+    std::vector<uint8_t> pixels;
+    int width;
+    int height;
+};
+
+// Reduces one image to any number of smaller sizes. Each 2x2 box halving of
+// the source is computed once and shared; a target is taken from the
+// smallest halving still at least its size, and a Lanczos-3 filter covers
+// the remaining factor, which is below 2. Both passes use SSE2 where
+// available.
+class ImageDownsampler {
+public:
+    // pixels must outlive the downsampler
+    ImageDownsampler(const uint8_t* pixels, size_t rowBytes, int width, int height);
+    ~ImageDownsampler();
+
+    ImageDownsampler(const ImageDownsampler&) = delete;
+    ImageDownsampler& operator=(const ImageDownsampler&) = delete;
+
+    // Compute the halvings every target down to width x height needs. Not
+    // thread-safe; call it for the smallest target before downsample.
+    void prepare(int width, int height);
+
+    // Resample to exactly width x height, which must not exceed the source.
+    // Thread-safe once prepare has covered the size.
+    bool downsample(int width, int height, PixelLevel& out) const;
+
+private:
+    // Source view or an owned halving
+    struct Level {
+        const uint8_t* pixels;
+        size_t rowBytes;
+        int width;
+        int height;
+    };
+
+    static void halve(const Level& source, PixelLevel& out);
+    static void resample(const Level& source, int width, int height, PixelLevel& out);
+
+    std::vector<Level> m_levels;                 // The source first, then each halving
+    std::vector<std::vector<uint8_t>> m_owned;   // Pixels of every level after the source
+};
+
+} // namespace text2image
+
+#endif // TEXT2IMAGE_IMAGE_DOWNSAMPLER_H
@@ -0,0 +1,1725 @@
+/*
+ * Text2Image Layout Engine Implementation
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the implementation of the LayoutEngine class.
+ */
+
+#include "layout_engine.h"
+#include "text2image_internal.h"
+#include "text_arena.h"
+#include "text_normalizer.h"
+
+#include <SkFontMetrics.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string_view>
+
+namespace text2image {
+
+namespace {
+
+// Upper bound on cached typefaces and glyph tables before a cache is reset
+const size_t kMaxTypefaces = 64;
+const size_t kMaxMonospaceTables = 32;
+
+// Subtrees smaller than this many nodes are laid out serially; forking costs more than it saves
+const size_t kMinParallelLayoutNodes = 2000;
+
+// Upper bound on tasks one block's children are split into
+const size_t kMaxLayoutTasks = 16;
+
+// Font sizes text-fit searches between, in pixels
+const SkScalar kMinFitFontSize = 4.0f;
+const SkScalar kMaxFitFontSize = 1024.0f;
+
+// Share of the line width fitted text may use, covering the difference
+// between linear advances and the hinted ones layout measures
+const SkScalar kFitSlack = 0.995f;
+
+// The text-fit search stops once its bounds are this close, relatively
+const SkScalar kFitTolerance = 1.0f / 512;
+const int kMaxFitSteps = 24;
+
+// Code colors indexed by TokenKind; PLAIN uses the block's text color
+const SkColor kTokenColors[static_cast<size_t>(TokenKind::COUNT)] = {
+    0,                                       // PLAIN
+    SkColorSetARGB(0xFF, 0xCF, 0x22, 0x2E),  // KEYWORD
+    SkColorSetARGB(0xFF, 0x95, 0x38, 0x00),  // TYPE
+    SkColorSetARGB(0xFF, 0x05, 0x50, 0xAE),  // LITERAL
+    SkColorSetARGB(0xFF, 0x05, 0x50, 0xAE),  // NUMBER
+    SkColorSetARGB(0xFF, 0x0A, 0x30, 0x69),  // STRING
+    SkColorSetARGB(0xFF, 0x6E, 0x77, 0x81),  // COMMENT
+    SkColorSetARGB(0xFF, 0x82, 0x50, 0xDF),  // META
+    SkColorSetARGB(0xFF, 0x82, 0x50, 0xDF),  // FUNCTION
+    SkColorSetARGB(0xFF, 0x95, 0x38, 0x00),  // VARIABLE
+    SkColorSetARGB(0xFF, 0x05, 0x50, 0xAE)   // PROPERTY
+};
+
+bool isElement(xmlNode* node, const char* name) {
+    return node->type == XML_ELEMENT_NODE && xmlStrcasecmp(node->name, reinterpret_cast<const xmlChar*>(name)) == 0;
+}
+
+bool isTextNode(xmlNode* node) {
+    return node->type == XML_TEXT_NODE || node->type == XML_CDATA_SECTION_NODE;
+}
+
+// Text below node in document order, read in place rather than through a libxml2 copy
+void appendTextContent(xmlNode* node, std::string& out) {
+    for (xmlNode* child = node->children; child; child = child->next) {
+        if (isTextNode(child)) {
+            if (child->content) {
+                out.append(reinterpret_cast<const char*>(child->content));
+            }
+        }
+        else if (child->type == XML_ELEMENT_NODE) {
+            appendTextContent(child, out);
+        }
+    }
+}
+
+// Nodes below node, counting stops at limit
+size_t countNodes(xmlNode* node, size_t limit) {
+    size_t count = 0;
+    std::vector<xmlNode*> stack(1, node);
+    while (!stack.empty() && count < limit) {
+        xmlNode* current = stack.back();
+        stack.pop_back();
+        for (xmlNode* child = current->children; child; child = child->next) {
+            ++count;
+            if (child->children) {
+                stack.push_back(child);
+            }
+        }
+    }
+    return count;
+}
+
+// Language named by a "language-x" or "lang-x" class, or empty
+std::string codeLanguageFromClass(xmlNode* node) {
+    xmlChar* value = xmlGetProp(node, reinterpret_cast<const xmlChar*>("class"));
+    if (!value) {
+        return std::string();
+    }
+
+    std::string classes(reinterpret_cast<const char*>(value));
+    xmlFree(value);
+
+    std::istringstream stream(classes);
+    std::string name;
+    while (stream >> name) {
+        if (name.compare(0, 9, "language-") == 0) {
+            return name.substr(9);
+        }
+        if (name.compare(0, 5, "lang-") == 0) {
+            return name.substr(5);
+        }
+    }
+    return std::string();
+}
+
+// CJK ideographs, kana, hangul and fullwidth forms break between any two characters
+bool isCjkCodepoint(uint32_t c) {
+    return (c >= 0x2E80 && c <= 0x9FFF) ||
+           (c >= 0xAC00 && c <= 0xD7AF) ||
+           (c >= 0xF900 && c <= 0xFAFF) ||
+           (c >= 0xFF00 && c <= 0xFFEF) ||
+           (c >= 0x20000 && c <= 0x2FFFF);
+}
+
+// End of the word starting at p: up to the next space, or a single CJK
+// character, which is its own break opportunity
+const char* wordEnd(const char* p, const char* end) {
+    const char* cursor = p;
+    uint32_t codepoint = nextCodepoint(cursor, end);
+    if (!isCjkCodepoint(codepoint)) {
+        while (cursor < end && *cursor != ' ') {
+            const char* next = cursor;
+            if (isCjkCodepoint(nextCodepoint(next, end))) {
+                break;
+            }
+            cursor = next;
+        }
+    }
+    return cursor;
+}
+
+// Space above and below the baseline for a line box, from CSS half-leading
+void lineExtents(SkScalar lineHeight, SkScalar ascent, SkScalar descent, SkScalar& above, SkScalar& below) {
+    above = (lineHeight - (ascent + descent)) / 2 + ascent;
+    below = lineHeight - above;
+}
+
+// Vertical extent that a page break must not cut through
+struct BreakSpan {
+    SkScalar top;
+    SkScalar bottom;
+};
+
+// Length given by a width or height attribute, in CSS pixels, or 0
+SkScalar attributeLength(xmlNode* node, const char* name) {
+    xmlChar* value = xmlGetProp(node, reinterpret_cast<const xmlChar*>(name));
+    if (!value) {
+        return 0;
+    }
+
+    // Percentages need a containing size; they are treated as absent
+    std::string text(reinterpret_cast<const char*>(value));
+    xmlFree(value);
+    if (text.find('%') != std::string::npos) {
+        return 0;
+    }
+    return std::max(0.0f, std::strtof(text.c_str(), nullptr));
+}
+
+// Lines, table rows and boxes without inline content are kept whole
+void collectBreakSpans(const LayoutBox& box, SkScalar originY, std::vector<BreakSpan>& spans) {
+    SkScalar top = originY + box.frame.fTop;
+    if (box.style->display == Display::TABLE_ROW || (box.children.empty() && box.lines.empty())) {
+        spans.push_back({top, top + box.frame.height()});
+    }
+    for (const LineBox& line : box.lines) {
+        spans.push_back({top + line.top, top + line.top + line.height});
+    }
+    for (const auto& child : box.children) {
+        collectBreakSpans(*child, top, spans);
+    }
+}
+
+} // namespace
+
+// Per-call layout state. Nothing here outlives a layout() call.
+struct LayoutEngine::Context {
+    struct FontInfo {
+        std::shared_ptr<const ComputedStyle> style;  // Keeps the key alive
+        SkFont font;
+        SkScalar ascent;      // Positive distance above the baseline
+        SkScalar descent;
+        SkScalar spaceWidth;
+        std::shared_ptr<FontFallbackMap> fallback;
+    };
+
+    // Line recorded instead of shaped when measuring text
+    struct MeasuredLine {
+        size_t item;          // Item holding the last character, or the break ending an empty line
+        size_t end;           // Offset just past that character in the item's text
+        SkScalar width;
+        SkScalar height;
+    };
+
+    const StyleResolver& resolver;
+    StyleSharingCache styles;
+    SkScalar cullBottom;
+    SkScalar imageScale;      // Device pixels per CSS pixel that images are decoded at
+    bool parallel;            // Blocks may still fork their children onto the pool
+    std::unordered_map<const ComputedStyle*, FontInfo> fonts;
+    std::vector<MeasuredLine>* measuredLines;   // When set, lines are recorded here and not shaped
+    TextArena text;           // Normalized text the inline items view
+
+    Context(const StyleResolver& styleResolver, SkScalar bottom, SkScalar scale)
+        : resolver(styleResolver), styles(styleResolver), cullBottom(bottom), imageScale(scale), parallel(true),
+          measuredLines(nullptr) {
+    }
+
+    const FontInfo& fontInfo(LayoutEngine& engine, const std::shared_ptr<const ComputedStyle>& style) {
+        auto it = fonts.find(style.get());
+        if (it != fonts.end()) {
+            return it->second;
+        }
+
+        FontInfo info;
+        info.style = style;
+        info.font = engine.fontFor(*style);
+        SkFontMetrics metrics;
+        info.font.getMetrics(&metrics);
+        info.ascent = -metrics.fAscent;
+        info.descent = metrics.fDescent;
+        info.spaceWidth = info.font.measureText(" ", 1, SkTextEncoding::kUTF8);
+        info.fallback = engine.m_fontFallback.getMap(info.font);
+        return fonts.emplace(style.get(), info).first->second;
+    }
+};
+
+// Text run collected from inline content. Whitespace is already collapsed
+// unless the style preserves it. An image is an item of its own, with no text.
+struct LayoutEngine::InlineItem {
+    std::string_view text;    // In the context's text arena
+    std::shared_ptr<const ComputedStyle> style;
+    bool lineBreak;
+    bool isImage = false;
+    std::shared_ptr<const ImageSource> image = nullptr;  // Null when the image could not be fetched
+    SkSize imageSize = SkSize::Make(0, 0);
+};
+
+// Element child of a flow box whose style was resolved ahead of its turn
+struct LayoutEngine::ForkedChild {
+    xmlNode* node;
+    std::shared_ptr<const ComputedStyle> style;
+    std::unique_ptr<LayoutBox> box;   // Laid out at top 0, or null for inline content
+};
+
+LayoutEngine::LayoutEngine(SyntaxHighlighter& highlighter)
+    : m_highlighter(highlighter),
+      m_threadPool(nullptr),
+      m_typefaceHits(0),
+      m_typefaceMisses(0),
+      m_typefaceEvictions(0),
+      m_glyphTableHits(0),
+      m_glyphTableMisses(0),
+      m_glyphTableEvictions(0) {
+}
+
+LayoutEngine::~LayoutEngine() {
+}
+
+std::unique_ptr<LayoutBox> LayoutEngine::layout(xmlDocPtr doc, const StyleResolver& styles, SkScalar width, SkScalar cullBottom,
+                                                SkScalar imageScale) {
+    xmlNode* root = doc ? xmlDocGetRootElement(doc) : nullptr;
+    if (!root) {
+        return nullptr;
+    }
+
+    Context context(styles, cullBottom, imageScale);
+    std::unique_ptr<LayoutBox> box(new LayoutBox());
+    box->node = root;
+    box->style = context.styles.resolve(root, ComputedStyle::initial());
+    box->frame = SkRect::MakeXYWH(0, 0, width, 0);
+    layoutBlock(context, *box, width, 0);
+    return box;
+}
+
+void LayoutEngine::measureText(const StyleResolver& styles, const std::shared_ptr<const ComputedStyle>& style,
+                               const char* const* texts, size_t count, SkScalar width, TextMeasurement* out) {
+    // One context serves the batch, so the style's font is looked up once
+    Context context(styles, SK_ScalarInfinity, 1);
+    std::vector<Context::MeasuredLine> lines;
+    context.measuredLines = &lines;
+    const SkScalar lineWidth = width > 0 ? width : SK_ScalarInfinity;
+
+    LayoutBox box;
+    box.style = style;
+    std::vector<InlineItem> items;
+    std::vector<uint32_t> offsets;    // Index in the string of each collapsed byte, or of a break's newline
+    std::vector<size_t> firstOffset;  // Where each item's entries in offsets begin
+
+    for (size_t i = 0; i < count; ++i) {
+        const char* text = texts[i] ? texts[i] : "";
+        const size_t length = std::strlen(text);
+        items.clear();
+        offsets.clear();
+        firstOffset.clear();
+        lines.clear();
+        box.lines.clear();
+
+        // Newlines break lines as <br> would; the rest collapses as in a paragraph
+        bool lastWasSpace = true;
+        size_t start = 0;
+        while (true) {
+            const char* newline = static_cast<const char*>(std::memchr(text + start, '\n', length - start));
+            const size_t end = newline ? static_cast<size_t>(newline - text) : length;
+            InlineItem item{std::string_view(), style, false};
+            const size_t first = offsets.size();
+            offsets.resize(first + end - start);
+            char* out = context.text.reserve(item.text, end - start);
+            const size_t written = collapseWhiteSpace(text + start, end - start, lastWasSpace, out, offsets.data() + first);
+            context.text.commit(item.text, written);
+            offsets.resize(first + written);
+            for (size_t k = first; k < offsets.size(); ++k) {
+                offsets[k] += static_cast<uint32_t>(start);
+            }
+            if (!item.text.empty()) {
+                firstOffset.push_back(first);
+                items.push_back(std::move(item));
+            }
+            if (!newline) {
+                break;
+            }
+            firstOffset.push_back(offsets.size());
+            offsets.push_back(static_cast<uint32_t>(end));
+            items.push_back({std::string_view(), style, true});
+            lastWasSpace = true;
+            start = end + 1;
+        }
+
+        TextMeasurement& result = out[i];
+        result.width = 0;
+        result.height = layoutLines(context, box, style, items, 0, 0, lineWidth, 0);
+        result.lineEnds.clear();
+        for (const Context::MeasuredLine& line : lines) {
+            const size_t base = firstOffset[line.item];
+            result.lineEnds.push_back(items[line.item].lineBreak ? offsets[base] : offsets[base + line.end - 1] + 1);
+            result.width = std::max(result.width, line.width);
+        }
+    }
+}
+
+void LayoutEngine::setThreadPool(ThreadPool* pool) {
+    m_threadPool = pool;
+}
+
+void LayoutEngine::clearCaches() {
+    {
+        std::lock_guard<std::mutex> lock(m_typefacesMutex);
+        m_typefaceEvictions += m_typefaces.size();
+        m_typefaces.clear();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_monospaceTablesMutex);
+        m_glyphTableEvictions += m_monospaceTables.size();
+        m_monospaceTables.clear();
+    }
+    m_fontFallback.clear();
+    m_shadowCache.clear();
+    m_images.clear();
+}
+
+FontCacheStats LayoutEngine::getFontCacheStats() {
+    FontCacheStats stats;
+    {
+        std::lock_guard<std::mutex> lock(m_typefacesMutex);
+        stats.typefaceHits = m_typefaceHits;
+        stats.typefaceMisses = m_typefaceMisses;
+        stats.typefaceEvictions = m_typefaceEvictions;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_monospaceTablesMutex);
+        stats.glyphTableHits = m_glyphTableHits;
+        stats.glyphTableMisses = m_glyphTableMisses;
+        stats.glyphTableEvictions = m_glyphTableEvictions;
+    }
+    m_fontFallback.getStats(stats.fallbackPagesBuilt, stats.fallbackTypefacesOpened);
+    return stats;
+}
+
+void LayoutEngine::layoutBlock(Context& context, LayoutBox& box, SkScalar containingWidth, SkScalar absoluteTop) {
+    const ComputedStyle& style = *box.style;
+    const SkScalar horizontal = style.padding[SIDE_LEFT] + style.padding[SIDE_RIGHT] +
+                                style.borderWidth[SIDE_LEFT] + style.borderWidth[SIDE_RIGHT];
+
+    SkScalar width = containingWidth - style.margin[SIDE_LEFT] - style.margin[SIDE_RIGHT];
+    if (style.width > 0) {
+        width = style.width + horizontal;
+    }
+    else if (style.widthPercent > 0) {
+        width = containingWidth * style.widthPercent / 100.0f;
+    }
+    if (style.maxWidth > 0) {
+        width = std::min(width, style.maxWidth + horizontal);
+    }
+    width = std::max(width, horizontal);
+    box.frame.fRight = box.frame.fLeft + width;
+
+    const SkScalar left = style.borderWidth[SIDE_LEFT] + style.padding[SIDE_LEFT];
+    const SkScalar top = style.borderWidth[SIDE_TOP] + style.padding[SIDE_TOP];
+    const SkScalar contentWidth = width - horizontal;
+
+    // Block-level images take their own size rather than the containing width
+    if (isElement(box.node, "img")) {
+        std::shared_ptr<const ImageSource> source;
+        SkSize size = SkSize::Make(0, 0);
+        imageLayoutSize(box.node, style, containingWidth - style.margin[SIDE_LEFT] - style.margin[SIDE_RIGHT], source, size);
+        addImage(context, box, source, SkRect::MakeXYWH(left, top, size.width(), size.height()));
+        box.frame.fRight = box.frame.fLeft + size.width() + horizontal;
+        box.frame.fBottom = box.frame.fTop + top + size.height() + style.padding[SIDE_BOTTOM] + style.borderWidth[SIDE_BOTTOM];
+        return;
+    }
+
+    SkScalar bottom;
+    if (style.whiteSpace == WhiteSpace::PRE && isElement(box.node, "pre")) {
+        bottom = layoutCodeBlock(context, box, left, top, absoluteTop);
+    }
+    else if (style.display == Display::TABLE) {
+        bottom = layoutTable(context, box, left, top, contentWidth, absoluteTop);
+    }
+    else {
+        bottom = layoutFlow(context, box, left, top, contentWidth, absoluteTop);
+    }
+
+    if (style.display == Display::LIST_ITEM && style.listStyle != ListStyle::NONE) {
+        addListMarker(context, box);
+    }
+
+    // A text-fit box keeps its height however small the text ends up
+    if (style.textFit != TextFit::NONE && style.height > 0) {
+        bottom = std::max(bottom, top + style.height);
+    }
+
+    box.frame.fBottom = box.frame.fTop + bottom + style.padding[SIDE_BOTTOM] + style.borderWidth[SIDE_BOTTOM];
+}
+
+bool LayoutEngine::forkBlocks(Context& context, LayoutBox& box, SkScalar left, SkScalar width,
+                              std::vector<ForkedChild>& forked) {
+    // Only whole-document layouts fork, which means paginated renders and
+    // compiled documents. A single image has a finite cull line, and there
+    // a block's position decides whether it is laid out at all; forked
+    // blocks are laid out before they are placed, so they would run past
+    // the line and lay out everything below it that the serial pass skips.
+    if (!m_threadPool || !context.parallel || context.cullBottom != SK_ScalarInfinity) {
+        return false;
+    }
+
+    // Nothing under a small subtree is worth forking either
+    if (countNodes(box.node, kMinParallelLayoutNodes) < kMinParallelLayoutNodes) {
+        context.parallel = false;
+        return false;
+    }
+
+    std::vector<size_t> blocks;
+    for (xmlNode* child = box.node->children; child; child = child->next) {
+        if (child->type != XML_ELEMENT_NODE) {
+            continue;
+        }
+        ForkedChild entry;
+        entry.node = child;
+        entry.style = context.styles.resolve(child, *box.style);
+        if (entry.style->display != Display::NONE && entry.style->isBlockLevel() && !isElement(child, "br")) {
+            entry.box.reset(new LayoutBox());
+            entry.box->node = child;
+            entry.box->style = entry.style;
+            entry.box->frame.fLeft = left + entry.style->margin[SIDE_LEFT];
+            entry.box->frame.fTop = 0;
+            blocks.push_back(forked.size());
+        }
+        forked.push_back(std::move(entry));
+    }
+
+    // A single block gains nothing here; it may fork its own children
+    if (blocks.size() < 2) {
+        for (ForkedChild& entry : forked) {
+            entry.box.reset();
+        }
+        return true;
+    }
+
+    // Block widths depend only on the containing width, so each subtree is
+    // independent. Tasks take contiguous runs and share a context per run.
+    const size_t tasks = std::min(blocks.size(), kMaxLayoutTasks);
+    m_threadPool->parallelFor(tasks, [&](size_t task) {
+        Context subContext(context.resolver, context.cullBottom, context.imageScale);
+        subContext.parallel = false;
+        size_t begin = blocks.size() * task / tasks;
+        size_t end = blocks.size() * (task + 1) / tasks;
+        for (size_t i = begin; i < end; ++i) {
+            layoutBlock(subContext, *forked[blocks[i]].box, width, 0);
+        }
+    });
+    return true;
+}
+
+SkScalar LayoutEngine::layoutFlow(Context& context, LayoutBox& box, SkScalar left, SkScalar top, SkScalar width, SkScalar absoluteTop) {
+    std::vector<InlineItem> items;
+    bool lastWasSpace = true;
+    SkScalar cursor = top;
+    SkScalar pendingMargin = 0;
+
+    // Large documents lay out sibling blocks on the pool, then place them here in order
+    const bool parallel = context.parallel;
+    std::vector<ForkedChild> forked;
+    const bool haveForked = forkBlocks(context, box, left, width, forked);
+    size_t nextForked = 0;
+
+    // Lay out collected inline content as an anonymous block of lines
+    auto flushInline = [&]() {
+        if (items.empty()) {
+            return;
+        }
+        // Fitted text is laid out once, at the size the search settled on
+        std::shared_ptr<const ComputedStyle> blockStyle = box.style;
+        if (box.style->textFit != TextFit::NONE) {
+            blockStyle = fitInline(context, box.style, items, width, box.style->height);
+        }
+        SkScalar lineTop = cursor + pendingMargin;
+        SkScalar bottom = layoutLines(context, box, blockStyle, items, left, lineTop, width, absoluteTop);
+        if (bottom > lineTop) {
+            cursor = bottom;
+            pendingMargin = 0;
+        }
+        items.clear();
+        lastWasSpace = true;
+    };
+
+    for (xmlNode* child = box.node->children; child; child = child->next) {
+        if (isTextNode(child)) {
+            collectInline(context, child, box.style, items, lastWasSpace);
+            continue;
+        }
+        if (child->type != XML_ELEMENT_NODE) {
+            continue;
+        }
+
+        // Content below the cull line is skipped before it is even styled
+        if (absoluteTop + cursor + pendingMargin >= context.cullBottom) {
+            box.truncated = true;
+            break;
+        }
+
+        std::shared_ptr<const ComputedStyle> childStyle;
+        std::unique_ptr<LayoutBox> childBox;
+        if (haveForked) {
+            ForkedChild& entry = forked[nextForked++];
+            childStyle = entry.style;
+            childBox = std::move(entry.box);
+        }
+        else {
+            childStyle = context.styles.resolve(child, *box.style);
+        }
+        if (childStyle->display == Display::NONE) {
+            continue;
+        }
+        if (!childStyle->isBlockLevel() || isElement(child, "br")) {
+            collectInline(context, child, childStyle, items, lastWasSpace);
+            continue;
+        }
+
+        flushInline();
+
+        // Adjacent vertical margins collapse to the larger one
+        const SkScalar childTop = cursor + std::max(pendingMargin, childStyle->margin[SIDE_TOP]);
+        if (childBox) {
+            childBox->frame.offset(0, childTop);
+        }
+        else {
+            childBox.reset(new LayoutBox());
+            childBox->node = child;
+            childBox->style = childStyle;
+            childBox->frame.fLeft = left + childStyle->margin[SIDE_LEFT];
+            childBox->frame.fTop = childTop;
+            layoutBlock(context, *childBox, width, absoluteTop + childBox->frame.fTop);
+        }
+
+        cursor = childBox->frame.fBottom;
+        pendingMargin = childStyle->margin[SIDE_BOTTOM];
+        if (childBox->truncated) {
+            box.truncated = true;
+        }
+        box.children.push_back(std::move(childBox));
+    }
+
+    flushInline();
+    context.parallel = parallel;
+    return cursor + pendingMargin;
+}
+
+SkScalar LayoutEngine::layoutTable(Context& context, LayoutBox& box, SkScalar left, SkScalar top, SkScalar width, SkScalar absoluteTop) {
+    // Rows may be direct children or grouped in thead/tbody/tfoot
+    std::vector<xmlNode*> rows;
+    for (xmlNode* child = box.node->children; child; child = child->next) {
+        if (isElement(child, "tr")) {
+            rows.push_back(child);
+        }
+        else if (isElement(child, "thead") || isElement(child, "tbody") || isElement(child, "tfoot")) {
+            for (xmlNode* row = child->children; row; row = row->next) {
+                if (isElement(row, "tr")) {
+                    rows.push_back(row);
+                }
+            }
+        }
+    }
+
+    size_t columns = 0;
+    for (xmlNode* row : rows) {
+        size_t cells = 0;
+        for (xmlNode* cell = row->children; cell; cell = cell->next) {
+            if (isElement(cell, "td") || isElement(cell, "th")) {
+                ++cells;
+            }
+        }
+        columns = std::max(columns, cells);
+    }
+    if (columns == 0) {
+        return top;
+    }
+
+    // Columns share the table width equally
+    const SkScalar columnWidth = width / columns;
+    SkScalar cursor = top;
+    for (xmlNode* row : rows) {
+        if (absoluteTop + cursor >= context.cullBottom) {
+            box.truncated = true;
+            break;
+        }
+
+        std::shared_ptr<const ComputedStyle> rowStyle = context.styles.resolve(row, *box.style);
+        if (rowStyle->display == Display::NONE) {
+            continue;
+        }
+
+        std::unique_ptr<LayoutBox> rowBox(new LayoutBox());
+        rowBox->node = row;
+        rowBox->style = rowStyle;
+        rowBox->frame = SkRect::MakeXYWH(left, cursor, width, 0);
+
+        size_t column = 0;
+        SkScalar rowHeight = 0;
+        for (xmlNode* cell = row->children; cell; cell = cell->next) {
+            if (!isElement(cell, "td") && !isElement(cell, "th")) {
+                continue;
+            }
+
+            std::shared_ptr<const ComputedStyle> cellStyle = context.styles.resolve(cell, *rowStyle);
+            if (cellStyle->display == Display::NONE) {
+                continue;
+            }
+
+            std::unique_ptr<LayoutBox> cellBox(new LayoutBox());
+            cellBox->node = cell;
+            cellBox->style = cellStyle;
+            cellBox->frame = SkRect::MakeXYWH(column * columnWidth, 0, 0, 0);
+            layoutBlock(context, *cellBox, columnWidth, absoluteTop + cursor);
+            cellBox->frame.fRight = (column + 1) * columnWidth;
+
+            rowHeight = std::max(rowHeight, cellBox->frame.height());
+            if (cellBox->truncated) {
+                rowBox->truncated = true;
+            }
+            rowBox->children.push_back(std::move(cellBox));
+            ++column;
+        }
+
+        // Cells in a row share its height
+        for (auto& cellBox : rowBox->children) {
+            cellBox->frame.fBottom = cellBox->frame.fTop + rowHeight;
+        }
+        rowBox->frame.fBottom = cursor + rowHeight;
+        cursor += rowHeight;
+
+        if (rowBox->truncated) {
+            box.truncated = true;
+        }
+        box.children.push_back(std::move(rowBox));
+    }
+
+    return cursor;
+}
+
+SkScalar LayoutEngine::layoutCodeBlock(Context& context, LayoutBox& box, SkScalar left, SkScalar top, SkScalar absoluteTop) {
+    std::string code;
+    appendTextContent(box.node, code);
+
+    // The trailing newline of a block does not open another line
+    if (!code.empty() && code.back() == '\n') {
+        code.pop_back();
+    }
+
+    // Text style and language come from the <code> child when there is one
+    std::shared_ptr<const ComputedStyle> textStyle = box.style;
+    std::string language = codeLanguageFromClass(box.node);
+    for (xmlNode* child = box.node->children; child; child = child->next) {
+        if (isElement(child, "code")) {
+            textStyle = context.styles.resolve(child, *box.style);
+            if (language.empty()) {
+                language = codeLanguageFromClass(child);
+            }
+            break;
+        }
+    }
+    const ComputedStyle& style = *textStyle;
+
+    std::shared_ptr<const MonospaceGlyphTable> table = getMonospaceGlyphTable(style);
+    std::shared_ptr<const HighlightSpans> spans;
+    if (!language.empty()) {
+        spans = m_highlighter.highlight(code, language);
+    }
+
+    // Glyphs are bucketed by token kind so each color is one run
+    const size_t kindCount = static_cast<size_t>(TokenKind::COUNT);
+    std::vector<SkGlyphID> glyphs[kindCount];
+    std::vector<SkPoint> positions[kindCount];
+    SkScalar right[kindCount] = {};
+
+    SkScalar above, below;
+    lineExtents(style.lineHeight, table->ascent, table->descent, above, below);
+
+    const SkScalar tabWidth = table->advance * style.tabSize;
+    size_t spanIndex = 0;
+    SkScalar lineTop = top;
+    SkScalar penX = 0;
+    bool lineOpen = false;
+
+    const char* begin = code.data();
+    const char* end = begin + code.size();
+    const char* p = begin;
+    while (true) {
+        if (!lineOpen) {
+            // Lines below the cull line are neither mapped nor positioned
+            if (absoluteTop + lineTop >= context.cullBottom) {
+                box.truncated = true;
+                break;
+            }
+            box.lines.push_back({lineTop, style.lineHeight, lineTop + above});
+            lineOpen = true;
+        }
+        if (p >= end) {
+            break;
+        }
+
+        unsigned char c = static_cast<unsigned char>(*p);
+        if (c == '\n') {
+            lineTop += style.lineHeight;
+            lineOpen = false;
+            penX = 0;
+            ++p;
+            continue;
+        }
+        if (c == '\t') {
+            penX = (static_cast<int>(penX / tabWidth + 0.001f) + 1) * tabWidth;
+            ++p;
+            continue;
+        }
+
+        size_t offset = static_cast<size_t>(p - begin);
+        TokenKind kind = TokenKind::PLAIN;
+        if (spans) {
+            while (spanIndex < spans->size() && (*spans)[spanIndex].offset + (*spans)[spanIndex].length <= offset) {
+                ++spanIndex;
+            }
+            if (spanIndex < spans->size()) {
+                kind = (*spans)[spanIndex].kind;
+            }
+        }
+
+        SkGlyphID glyph;
+        SkScalar advance;
+        if (c < 0x80) {
+            // Fixed-pitch faces place glyphs at column x advance
+            glyph = table->glyphs[c];
+            advance = table->fixedPitch ? table->advance : table->advances[c];
+            ++p;
+        }
+        else {
+            // Rare non-ASCII characters are looked up and measured individually
+            glyph = table->font.unicharToGlyph(static_cast<SkUnichar>(nextCodepoint(p, end)));
+            table->font.getWidths(&glyph, 1, &advance);
+        }
+
+        if (c > 0x20 && c != 0x7F) {
+            size_t bucket = static_cast<size_t>(kind);
+            glyphs[bucket].push_back(glyph);
+            positions[bucket].push_back(SkPoint::Make(left + penX, lineTop + above));
+            right[bucket] = std::max(right[bucket], penX + advance);
+        }
+        penX += advance;
+    }
+
+    const SkScalar bottom = box.lines.empty() ? top : box.lines.back().top + style.lineHeight;
+    for (size_t bucket = 0; bucket < kindCount; ++bucket) {
+        if (glyphs[bucket].empty()) {
+            continue;
+        }
+
+        TextFragment fragment;
+        fragment.font = table->font;
+        fragment.glyphs.swap(glyphs[bucket]);
+        fragment.positions.swap(positions[bucket]);
+        fragment.bounds = SkRect::MakeLTRB(left, top, left + right[bucket], bottom);
+        fragment.baseline = top + above;
+        fragment.color = bucket == 0 ? style.color : kTokenColors[bucket];
+        fragment.background = SK_ColorTRANSPARENT;
+        fragment.underline = false;
+        fragment.lineThrough = false;
+        box.fragments.push_back(std::move(fragment));
+    }
+
+    return bottom;
+}
+
+void LayoutEngine::addListMarker(Context& context, LayoutBox& box) {
+    const ComputedStyle& style = *box.style;
+
+    // The marker sits on the first baseline inside the item
+    SkScalar baseline = -1;
+    SkScalar offset = 0;
+    for (const LayoutBox* current = &box; current; ) {
+        if (!current->lines.empty()) {
+            baseline = offset + current->lines.front().baseline;
+            break;
+        }
+        if (current->children.empty()) {
+            break;
+        }
+        current = current->children.front().get();
+        offset += current->frame.fTop;
+    }
+
+    const Context::FontInfo& info = context.fontInfo(*this, box.style);
+    if (baseline < 0) {
+        SkScalar above, below;
+        lineExtents(style.lineHeight, info.ascent, info.descent, above, below);
+        baseline = style.borderWidth[SIDE_TOP] + style.padding[SIDE_TOP] + above;
+    }
+
+    std::string marker;
+    if (style.listStyle == ListStyle::DECIMAL) {
+        int index = 1;
+        if (box.node->parent) {
+            xmlChar* start = xmlGetProp(box.node->parent, reinterpret_cast<const xmlChar*>("start"));
+            if (start) {
+                index = std::atoi(reinterpret_cast<const char*>(start));
+                xmlFree(start);
+            }
+        }
+        for (xmlNode* sibling = box.node->prev; sibling; sibling = sibling->prev) {
+            if (isElement(sibling, "li")) {
+                ++index;
+            }
+        }
+        marker = std::to_string(index) + ".";
+    }
+    else {
+        marker = "\xE2\x80\xA2";
+    }
+
+    TextFragment fragment;
+    fragment.font = info.font;
+    int count = info.font.textToGlyphs(marker.data(), marker.size(), SkTextEncoding::kUTF8, nullptr, 0);
+    if (count <= 0) {
+        return;
+    }
+    fragment.glyphs.resize(count);
+    info.font.textToGlyphs(marker.data(), marker.size(), SkTextEncoding::kUTF8, fragment.glyphs.data(), count);
+
+    SkScalar markerWidth = info.font.measureText(marker.data(), marker.size(), SkTextEncoding::kUTF8);
+    SkScalar x = style.borderWidth[SIDE_LEFT] + style.padding[SIDE_LEFT] - markerWidth - style.fontSize * 0.5f;
+    std::vector<SkScalar> xpos(count);
+    info.font.getXPos(fragment.glyphs.data(), count, xpos.data(), x);
+    for (SkScalar glyphX : xpos) {
+        fragment.positions.push_back(SkPoint::Make(glyphX, baseline));
+    }
+
+    fragment.bounds = SkRect::MakeLTRB(x, baseline - info.ascent, x + markerWidth, baseline + info.descent);
+    fragment.baseline = baseline;
+    fragment.color = style.color;
+    fragment.background = SK_ColorTRANSPARENT;
+    fragment.underline = false;
+    fragment.lineThrough = false;
+    box.fragments.push_back(std::move(fragment));
+}
+
+void LayoutEngine::collectInline(Context& context, xmlNode* node, const std::shared_ptr<const ComputedStyle>& style,
+                                 std::vector<InlineItem>& items, bool& lastWasSpace) {
+    if (isTextNode(node)) {
+        if (!node->content) {
+            return;
+        }
+
+        const char* text = reinterpret_cast<const char*>(node->content);
+        const size_t length = std::strlen(text);
+
+        // Consecutive text in the same style forms one item, grown in place in the arena
+        const bool extend = !items.empty() && !items.back().lineBreak && !items.back().isImage && items.back().style == style;
+        std::string_view run = extend ? items.back().text : std::string_view();
+        const size_t before = run.size();
+        if (style->whiteSpace == WhiteSpace::PRE) {
+            // Room grows one tab at a time, so it never exceeds what is written
+            const size_t tabSize = static_cast<size_t>(style->tabSize);
+            char* out = context.text.reserve(run, length);
+            size_t written = 0;
+            for (size_t i = 0; i < length; ++i) {
+                if (text[i] == '\t') {
+                    context.text.commit(run, written);
+                    out = context.text.reserve(run, length - i - 1 + tabSize);
+                    std::memset(out, ' ', tabSize);
+                    written = tabSize;
+                }
+                else if (text[i] != '\r') {
+                    out[written++] = text[i];
+                }
+            }
+            context.text.commit(run, written);
+            lastWasSpace = false;
+        }
+        else {
+            char* out = context.text.reserve(run, length);
+            context.text.commit(run, collapseWhiteSpace(text, length, lastWasSpace, out));
+        }
+
+        if (run.size() == before) {
+            return;
+        }
+        if (extend) {
+            items.back().text = run;
+        }
+        else {
+            items.push_back({run, style, false});
+        }
+        return;
+    }
+
+    if (node->type != XML_ELEMENT_NODE) {
+        return;
+    }
+
+    if (isElement(node, "br")) {
+        items.push_back({std::string_view(), style, true});
+        lastWasSpace = true;
+        return;
+    }
+
+    // Images sit on the baseline like one large character
+    if (isElement(node, "img")) {
+        InlineItem item;
+        item.style = style;
+        item.lineBreak = false;
+        item.isImage = true;
+        if (imageLayoutSize(node, *style, 0, item.image, item.imageSize)) {
+            items.push_back(std::move(item));
+            lastWasSpace = false;
+        }
+        return;
+    }
+
+    for (xmlNode* child = node->children; child; child = child->next) {
+        if (isTextNode(child)) {
+            collectInline(context, child, style, items, lastWasSpace);
+        }
+        else if (child->type == XML_ELEMENT_NODE) {
+            std::shared_ptr<const ComputedStyle> childStyle = context.styles.resolve(child, *style);
+            if (childStyle->display != Display::NONE) {
+                collectInline(context, child, childStyle, items, lastWasSpace);
+            }
+        }
+    }
+}
+
+std::shared_ptr<const ComputedStyle> LayoutEngine::fitInline(Context& context, const std::shared_ptr<const ComputedStyle>& blockStyle,
+                                                             std::vector<InlineItem>& items, SkScalar width, SkScalar height) {
+    // One measured piece of the run. Text is measured once, at the size it
+    // was specified at, with linear metrics; its advance and line extents at
+    // any scale are then multiples, so each search step only breaks lines.
+    struct FitToken {
+        enum Kind : uint8_t { WORD, SPACE, BREAK, IMAGE } kind;
+        bool wrap;
+        SkScalar advance;     // Images keep their size; text is at scale 1
+        SkScalar above;
+        SkScalar below;
+    };
+
+    // Without a height the box is one line tall, so only hard breaks start lines
+    const bool wrapLines = height > 0;
+    std::vector<FitToken> tokens;
+    SkScalar smallest = SK_ScalarInfinity;
+    SkScalar largest = 0;
+    for (const InlineItem& item : items) {
+        if (item.lineBreak) {
+            tokens.push_back({FitToken::BREAK, false, 0, 0, 0});
+            continue;
+        }
+        const bool wrap = wrapLines && item.style->whiteSpace == WhiteSpace::NORMAL;
+        if (item.isImage) {
+            tokens.push_back({FitToken::IMAGE, wrap, item.imageSize.width(), item.imageSize.height(), 0});
+            continue;
+        }
+
+        const Context::FontInfo& info = context.fontInfo(*this, item.style);
+        SkFont font(info.font);
+        font.setLinearMetrics(true);
+        SkScalar above, below;
+        lineExtents(item.style->lineHeight, info.ascent, info.descent, above, below);
+        smallest = std::min(smallest, item.style->fontSize);
+        largest = std::max(largest, item.style->fontSize);
+
+        const std::string_view text = item.text;
+        if (item.style->whiteSpace == WhiteSpace::PRE) {
+            size_t pos = 0;
+            while (pos <= text.size()) {
+                size_t newline = text.find('\n', pos);
+                size_t segmentEnd = newline == std::string_view::npos ? text.size() : newline;
+                if (segmentEnd > pos) {
+                    SkScalar advance = info.fallback->measure(font, text.data() + pos, segmentEnd - pos);
+                    tokens.push_back({FitToken::WORD, false, advance, above, below});
+                }
+                if (newline == std::string_view::npos) {
+                    break;
+                }
+                tokens.push_back({FitToken::BREAK, false, 0, 0, 0});
+                pos = newline + 1;
+            }
+            continue;
+        }
+
+        const SkScalar spaceWidth = font.measureText(" ", 1, SkTextEncoding::kUTF8);
+        const char* end = text.data() + text.size();
+        const char* p = text.data();
+        while (p < end) {
+            if (*p == ' ') {
+                tokens.push_back({FitToken::SPACE, false, spaceWidth, 0, 0});
+                ++p;
+                continue;
+            }
+            const char* wordStart = p;
+            p = wordEnd(p, end);
+            SkScalar advance = info.fallback->measure(font, wordStart, static_cast<size_t>(p - wordStart));
+            tokens.push_back({FitToken::WORD, wrap, advance, above, below});
+        }
+    }
+    if (largest <= 0) {
+        return blockStyle;
+    }
+
+    const Context::FontInfo& strut = context.fontInfo(*this, blockStyle);
+    SkScalar strutAbove, strutBelow;
+    lineExtents(blockStyle->lineHeight, strut.ascent, strut.descent, strutAbove, strutBelow);
+
+    // Break lines as layoutLines would at the given scale. Text fits when no
+    // word has to be split and the lines fit the height, if there is one.
+    const SkScalar limit = width * kFitSlack;
+    auto fits = [&](SkScalar scale) {
+        SkScalar lineX = 0;
+        SkScalar pendingSpace = 0;
+        SkScalar above = strutAbove * scale;
+        SkScalar below = strutBelow * scale;
+        SkScalar total = 0;
+        bool empty = true;
+        auto finishLine = [&](bool force) {
+            if (empty && !force) {
+                return;
+            }
+            total += above + below;
+            above = strutAbove * scale;
+            below = strutBelow * scale;
+            lineX = 0;
+            pendingSpace = 0;
+            empty = true;
+        };
+
+        for (const FitToken& token : tokens) {
+            if (token.kind == FitToken::BREAK) {
+                finishLine(true);
+                continue;
+            }
+            if (token.kind == FitToken::SPACE) {
+                pendingSpace = token.advance * scale;
+                continue;
+            }
+
+            const SkScalar factor = token.kind == FitToken::IMAGE ? 1 : scale;
+            const SkScalar advance = token.advance * factor;
+            SkScalar space = empty ? 0 : pendingSpace;
+            if (token.wrap && !empty && lineX + space + advance > limit) {
+                finishLine(false);
+                space = 0;
+            }
+            lineX += space + advance;
+            if (lineX > limit) {
+                return false;
+            }
+            above = std::max(above, token.above * factor);
+            below = std::max(below, token.below * factor);
+            pendingSpace = 0;
+            empty = false;
+        }
+        finishLine(false);
+        return height <= 0 || total <= height;
+    };
+
+    // Binary search on the scale, keeping the largest that fits
+    SkScalar high = blockStyle->textFit == TextFit::SHRINK ? 1 : kMaxFitFontSize / largest;
+    SkScalar low = std::min(high, kMinFitFontSize / smallest);
+    SkScalar scale;
+    if (fits(high)) {
+        scale = high;
+    }
+    else if (!fits(low)) {
+        scale = low;
+    }
+    else {
+        for (int step = 0; step < kMaxFitSteps && high - low > low * kFitTolerance; ++step) {
+            SkScalar middle = (low + high) / 2;
+            if (fits(middle)) low = middle;
+            else high = middle;
+        }
+        scale = low;
+    }
+    if (scale == 1) {
+        return blockStyle;
+    }
+
+    // Round the block's size down to a quarter pixel so repeated fits share glyph caches
+    const SkScalar quantized = std::floor(blockStyle->fontSize * scale * 4) / (4 * blockStyle->fontSize);
+    if (quantized > 0) {
+        scale = quantized;
+    }
+
+    // Scaled styles are interned like any other, once per distinct style of the run
+    std::unordered_map<const ComputedStyle*, std::shared_ptr<const ComputedStyle>> scaled;
+    auto scaleStyle = [&](const std::shared_ptr<const ComputedStyle>& style) {
+        auto it = scaled.find(style.get());
+        if (it != scaled.end()) {
+            return it->second;
+        }
+        ComputedStyle copy(*style);
+        copy.fontSize *= scale;
+        copy.lineHeight *= scale;
+        return scaled.emplace(style.get(), context.resolver.intern(copy)).first->second;
+    };
+
+    // Items keep their original styles, and so the map's keys, alive until every one is scaled
+    std::vector<std::shared_ptr<const ComputedStyle>> styles;
+    styles.reserve(items.size());
+    for (const InlineItem& item : items) {
+        styles.push_back(scaleStyle(item.style));
+    }
+    for (size_t i = 0; i < items.size(); ++i) {
+        items[i].style = std::move(styles[i]);
+    }
+    return scaleStyle(blockStyle);
+}
+
+SkScalar LayoutEngine::layoutLines(Context& context, LayoutBox& box, const std::shared_ptr<const ComputedStyle>& lineStyle,
+                                   std::vector<InlineItem>& items, SkScalar left, SkScalar top, SkScalar width,
+                                   SkScalar absoluteTop) {
+    // A piece of one item placed on the current line
+    struct Piece {
+        size_t item;
+        size_t start;
+        size_t length;
+        SkScalar x;
+        SkScalar width;
+    };
+
+    const ComputedStyle& blockStyle = *lineStyle;
+    const Context::FontInfo& strut = context.fontInfo(*this, lineStyle);
+
+    std::vector<Piece> line;
+    std::vector<FontRun> runs;
+    SkScalar lineX = 0;
+    SkScalar pendingSpace = 0;
+    SkScalar lineTop = top;
+    bool stopped = false;
+    size_t current = 0;       // Item being placed
+
+    auto finishLine = [&](bool force) {
+        if (stopped || (line.empty() && !force)) {
+            return;
+        }
+
+        // Lines starting below the cull line end layout of this block
+        if (absoluteTop + lineTop >= context.cullBottom) {
+            box.truncated = true;
+            stopped = true;
+            line.clear();
+            return;
+        }
+
+        SkScalar above, below;
+        lineExtents(blockStyle.lineHeight, strut.ascent, strut.descent, above, below);
+        for (const Piece& piece : line) {
+            if (items[piece.item].isImage) {
+                above = std::max(above, items[piece.item].imageSize.height());
+                continue;
+            }
+            const ComputedStyle& style = *items[piece.item].style;
+            const Context::FontInfo& info = context.fontInfo(*this, items[piece.item].style);
+            SkScalar itemAbove, itemBelow;
+            lineExtents(style.lineHeight, info.ascent, info.descent, itemAbove, itemBelow);
+            above = std::max(above, itemAbove);
+            below = std::max(below, itemBelow);
+        }
+        const SkScalar height = above + below;
+        const SkScalar baseline = lineTop + above;
+
+        SkScalar offset = 0;
+        if (lineX < width) {
+            if (blockStyle.textAlign == TextAlign::CENTER) offset = (width - lineX) / 2;
+            else if (blockStyle.textAlign == TextAlign::RIGHT) offset = width - lineX;
+        }
+
+        // Measuring records the line's extent and leaves nothing to shape
+        if (context.measuredLines) {
+            if (line.empty()) {
+                context.measuredLines->push_back({current, 0, 0, height});
+            }
+            else {
+                const Piece& last = line.back();
+                context.measuredLines->push_back({last.item, last.start + last.length, lineX, height});
+            }
+            line.clear();
+        }
+
+        // Shaping happens only for lines that are actually kept
+        for (const Piece& piece : line) {
+            const InlineItem& item = items[piece.item];
+            if (item.isImage) {
+                const SkSize& size = item.imageSize;
+                addImage(context, box, item.image, SkRect::MakeXYWH(left + offset + piece.x, baseline - size.height(),
+                                                                    size.width(), size.height()));
+                continue;
+            }
+
+            const Context::FontInfo& info = context.fontInfo(*this, item.style);
+            const char* text = item.text.data() + piece.start;
+
+            // One fragment per font run; characters the style's font lacks come from a fallback typeface
+            info.fallback->split(info.font, text, piece.length, runs);
+            SkScalar x = left + offset + piece.x;
+            const SkScalar pieceRight = x + piece.width;
+            for (size_t r = 0; r < runs.size(); ++r) {
+                const FontRun& run = runs[r];
+                TextFragment fragment;
+                fragment.font = run.font;
+                int count = run.font.textToGlyphs(text + run.start, run.length, SkTextEncoding::kUTF8, nullptr, 0);
+                if (count > 0) {
+                    fragment.glyphs.resize(count);
+                    run.font.textToGlyphs(text + run.start, run.length, SkTextEncoding::kUTF8, fragment.glyphs.data(), count);
+
+                    std::vector<SkScalar> xpos(count);
+                    run.font.getXPos(fragment.glyphs.data(), count, xpos.data(), x);
+                    fragment.positions.reserve(count);
+                    for (SkScalar glyphX : xpos) {
+                        fragment.positions.push_back(SkPoint::Make(glyphX, baseline));
+                    }
+                }
+
+                // Runs tile the piece, so backgrounds and decorations are drawn once
+                SkScalar runRight = r + 1 < runs.size()
+                    ? x + run.font.measureText(text + run.start, run.length, SkTextEncoding::kUTF8) : pieceRight;
+                fragment.bounds = SkRect::MakeLTRB(x, lineTop, runRight, lineTop + height);
+                fragment.baseline = baseline;
+                fragment.color = item.style->color;
+                fragment.background = item.style->display == Display::INLINE ? item.style->backgroundColor : SK_ColorTRANSPARENT;
+                fragment.underline = item.style->underline;
+                fragment.lineThrough = item.style->lineThrough;
+                box.fragments.push_back(std::move(fragment));
+                x = runRight;
+            }
+        }
+
+        box.lines.push_back({lineTop, height, baseline});
+        lineTop += height;
+        line.clear();
+        lineX = 0;
+        pendingSpace = 0;
+    };
+
+    // Place an unbreakable piece, extending the previous piece when contiguous
+    auto place = [&](size_t itemIndex, size_t start, size_t length, SkScalar advance, bool wrap) {
+        SkScalar space = line.empty() ? 0 : pendingSpace;
+        if (wrap && !line.empty() && lineX + space + advance > width) {
+            finishLine(false);
+            space = 0;
+        }
+        if (stopped) {
+            return;
+        }
+
+        SkScalar x = lineX + space;
+        if (!line.empty()) {
+            Piece& last = line.back();
+            size_t gap = space > 0 ? 1 : 0;
+            if (last.item == itemIndex && last.start + last.length + gap == start) {
+                last.length = start + length - last.start;
+                last.width = x + advance - last.x;
+                lineX = x + advance;
+                pendingSpace = 0;
+                return;
+            }
+        }
+
+        line.push_back({itemIndex, start, length, x, advance});
+        lineX = x + advance;
+        pendingSpace = 0;
+    };
+
+    for (size_t index = 0; index < items.size() && !stopped; ++index) {
+        const InlineItem& item = items[index];
+        current = index;
+        if (item.lineBreak) {
+            finishLine(true);
+            continue;
+        }
+        if (item.isImage) {
+            place(index, 0, 0, item.imageSize.width(), item.style->whiteSpace == WhiteSpace::NORMAL);
+            continue;
+        }
+
+        const Context::FontInfo& info = context.fontInfo(*this, item.style);
+        const SkFont& font = info.font;
+        const std::string_view text = item.text;
+
+        // Preserved white space: newlines break, nothing wraps
+        if (item.style->whiteSpace == WhiteSpace::PRE) {
+            size_t pos = 0;
+            while (pos <= text.size() && !stopped) {
+                size_t newline = text.find('\n', pos);
+                size_t segmentEnd = newline == std::string_view::npos ? text.size() : newline;
+                if (segmentEnd > pos) {
+                    SkScalar advance = info.fallback->measure(font, text.data() + pos, segmentEnd - pos);
+                    place(index, pos, segmentEnd - pos, advance, false);
+                }
+                if (newline == std::string_view::npos) {
+                    break;
+                }
+                finishLine(true);
+                pos = newline + 1;
+            }
+            continue;
+        }
+
+        const bool wrap = item.style->whiteSpace == WhiteSpace::NORMAL;
+        const char* begin = text.data();
+        const char* end = begin + text.size();
+        const char* p = begin;
+        while (p < end && !stopped) {
+            if (*p == ' ') {
+                pendingSpace = info.spaceWidth;
+                ++p;
+                continue;
+            }
+
+            const char* wordStart = p;
+            p = wordEnd(p, end);
+
+            size_t start = static_cast<size_t>(wordStart - begin);
+            size_t length = static_cast<size_t>(p - wordStart);
+            SkScalar advance = info.fallback->measure(font, wordStart, length);
+            if (!wrap || advance <= width) {
+                place(index, start, length, advance, wrap);
+                continue;
+            }
+
+            // Words wider than the line are broken between characters
+            const char* pieceStart = wordStart;
+            const char* q = wordStart;
+            SkScalar pieceWidth = 0;
+            while (q < p && !stopped) {
+                const char* charStart = q;
+                nextCodepoint(q, p);
+                SkScalar charWidth = info.fallback->measure(font, charStart, static_cast<size_t>(q - charStart));
+                if (pieceWidth > 0 && pieceWidth + charWidth > width) {
+                    place(index, static_cast<size_t>(pieceStart - begin), static_cast<size_t>(charStart - pieceStart), pieceWidth, true);
+                    finishLine(false);
+                    pieceStart = charStart;
+                    pieceWidth = 0;
+                }
+                pieceWidth += charWidth;
+            }
+            place(index, static_cast<size_t>(pieceStart - begin), static_cast<size_t>(p - pieceStart), pieceWidth, true);
+        }
+    }
+
+    finishLine(false);
+    return lineTop;
+}
+
+void LayoutEngine::paint(SkCanvas* canvas, const LayoutBox& root, const SkRect& clip) const {
+    DisplayList list;
+    record(root, clip, list);
+    list.cullOccluded();
+    list.playback(canvas, m_shadowCache);
+}
+
+void LayoutEngine::record(const LayoutBox& root, const SkRect& clip, DisplayList& list) const {
+    recordBox(list, root, 0, 0, clip);
+}
+
+void LayoutEngine::playback(SkCanvas* canvas, const DisplayList& list, bool draft) const {
+    list.playback(canvas, m_shadowCache, draft);
+}
+
+void LayoutEngine::playback(SkCanvas* canvas, const DisplayListView& view, bool draft) const {
+    DisplayList::playback(view, canvas, m_shadowCache, draft);
+}
+
+std::vector<SkScalar> LayoutEngine::findPageBreaks(const LayoutBox& root, SkScalar pageHeight, size_t maxPages) {
+    std::vector<SkScalar> pageTops(1, 0);
+    if (!(pageHeight > 0)) {
+        return pageTops;
+    }
+
+    std::vector<BreakSpan> spans;
+    collectBreakSpans(root, 0, spans);
+    const SkScalar documentBottom = root.frame.fBottom;
+
+    SkScalar top = 0;
+    while (top + pageHeight < documentBottom && pageTops.size() < maxPages) {
+        // Pull the break up to the top of anything it would cut, until nothing
+        // straddles it. Spans that start at or above the page top are taller
+        // than the page and get cut where they are.
+        SkScalar breakAt = top + pageHeight;
+        bool moved = true;
+        while (moved) {
+            moved = false;
+            for (const BreakSpan& span : spans) {
+                if (span.top > top && span.top < breakAt && span.bottom > breakAt) {
+                    breakAt = span.top;
+                    moved = true;
+                }
+            }
+        }
+
+        top = breakAt;
+        pageTops.push_back(top);
+    }
+    return pageTops;
+}
+
+void LayoutEngine::recordBox(DisplayList& list, const LayoutBox& box, SkScalar originX, SkScalar originY, const SkRect& clip) const {
+    const SkRect rect = box.frame.makeOffset(originX, originY);
+    const ComputedStyle& style = *box.style;
+
+    BoxShadowSpec shadow;
+    bool hasShadow = SkColorGetA(style.shadowColor) != 0;
+    if (hasShadow) {
+        shadow = {style.shadowOffsetX, style.shadowOffsetY, style.shadowBlur, style.shadowSpread,
+                  style.borderRadius, style.shadowColor};
+    }
+
+    // Boxes never overflow vertically, so anything outside the clip band is skipped whole
+    const SkRect visible = hasShadow ? ShadowCache::shadowBounds(rect, shadow) : rect;
+    if (visible.fTop >= clip.fBottom || visible.fBottom <= clip.fTop) {
+        return;
+    }
+
+    if (hasShadow) {
+        list.shadow(rect, shadow);
+    }
+
+    if (SkColorGetA(style.backgroundColor) != 0) {
+        if (style.borderRadius > 0) {
+            list.fillRRect(rect, style.borderRadius, style.backgroundColor);
+        }
+        else {
+            list.fillRect(rect, style.backgroundColor, true);
+        }
+    }
+
+    const float* border = style.borderWidth;
+    if (border[SIDE_TOP] > 0 || border[SIDE_RIGHT] > 0 || border[SIDE_BOTTOM] > 0 || border[SIDE_LEFT] > 0) {
+        const SkColor color = style.borderColor;
+        bool uniform = border[SIDE_TOP] == border[SIDE_RIGHT] && border[SIDE_TOP] == border[SIDE_BOTTOM] &&
+                       border[SIDE_TOP] == border[SIDE_LEFT];
+        if (uniform && style.borderRadius > 0) {
+            SkScalar half = border[SIDE_TOP] / 2;
+            list.strokeRRect(rect.makeInset(half, half), style.borderRadius, border[SIDE_TOP], color);
+        }
+        else {
+            // Zero-width sides are skipped rather than recorded as empty fills
+            if (border[SIDE_TOP] > 0) {
+                list.fillRect(SkRect::MakeLTRB(rect.fLeft, rect.fTop, rect.fRight, rect.fTop + border[SIDE_TOP]), color, true);
+            }
+            if (border[SIDE_BOTTOM] > 0) {
+                list.fillRect(SkRect::MakeLTRB(rect.fLeft, rect.fBottom - border[SIDE_BOTTOM], rect.fRight, rect.fBottom), color, true);
+            }
+            if (border[SIDE_LEFT] > 0) {
+                list.fillRect(SkRect::MakeLTRB(rect.fLeft, rect.fTop, rect.fLeft + border[SIDE_LEFT], rect.fBottom), color, true);
+            }
+            if (border[SIDE_RIGHT] > 0) {
+                list.fillRect(SkRect::MakeLTRB(rect.fRight - border[SIDE_RIGHT], rect.fTop, rect.fRight, rect.fBottom), color, true);
+            }
+        }
+    }
+
+    for (const TextFragment& fragment : box.fragments) {
+        SkScalar top = fragment.bounds.fTop + rect.fTop;
+        SkScalar bottom = fragment.bounds.fBottom + rect.fTop;
+        if (top < clip.fBottom && bottom > clip.fTop) {
+            recordFragment(list, fragment, rect.fLeft, rect.fTop);
+        }
+    }
+
+    for (const ImageFragment& image : box.images) {
+        SkRect bounds = image.bounds.makeOffset(rect.fLeft, rect.fTop);
+        if (bounds.fTop < clip.fBottom && bounds.fBottom > clip.fTop) {
+            list.image(image.image, bounds);
+        }
+    }
+
+    SkRect childClip = clip;
+    if (style.overflowHidden) {
+        if (style.borderRadius > 0) {
+            list.clipRRect(rect, style.borderRadius);
+        }
+        else {
+            list.clipRect(rect);
+        }
+        childClip = SkRect::MakeLTRB(std::max(clip.fLeft, rect.fLeft), std::max(clip.fTop, rect.fTop),
+                                     std::min(clip.fRight, rect.fRight), std::min(clip.fBottom, rect.fBottom));
+    }
+
+    // Children are in block order, so the first one below the clip ends the walk
+    for (const auto& child : box.children) {
+        if (rect.fTop + child->frame.fTop >= childClip.fBottom) {
+            break;
+        }
+        recordBox(list, *child, rect.fLeft, rect.fTop, childClip);
+    }
+
+    if (style.overflowHidden) {
+        list.restore();
+    }
+}
+
+void LayoutEngine::recordFragment(DisplayList& list, const TextFragment& fragment, SkScalar originX, SkScalar originY) const {
+    if (SkColorGetA(fragment.background) != 0) {
+        list.fillRect(fragment.bounds.makeOffset(originX, originY), fragment.background, false);
+    }
+
+    if (!fragment.glyphs.empty()) {
+        // Glyphs can overhang the line area a little, as italics and tight line heights do
+        const SkScalar overhang = fragment.font.getSize() / 4;
+        SkRect bounds = fragment.bounds.makeOffset(originX, originY).makeOutset(overhang, overhang);
+        list.text(fragment.font, fragment.glyphs.data(), fragment.positions.data(), fragment.glyphs.size(),
+                  SkPoint::Make(originX, originY), bounds, fragment.color);
+    }
+
+    if (fragment.underline || fragment.lineThrough) {
+        SkScalar size = fragment.font.getSize();
+        SkScalar thickness = std::max<SkScalar>(1, size / 14);
+        SkScalar left = originX + fragment.bounds.fLeft;
+        SkScalar right = originX + fragment.bounds.fRight;
+        SkScalar baseline = originY + fragment.baseline;
+
+        if (fragment.underline) {
+            SkScalar y = baseline + size * 0.1f;
+            list.fillRect(SkRect::MakeLTRB(left, y, right, y + thickness), fragment.color, true);
+        }
+        if (fragment.lineThrough) {
+            SkScalar y = baseline - size * 0.3f;
+            list.fillRect(SkRect::MakeLTRB(left, y, right, y + thickness), fragment.color, true);
+        }
+    }
+}
+
+bool LayoutEngine::imageLayoutSize(xmlNode* node, const ComputedStyle& style, SkScalar containingWidth,
+                                   std::shared_ptr<const ImageSource>& source, SkSize& size) {
+    xmlChar* src = xmlGetProp(node, reinterpret_cast<const xmlChar*>("src"));
+    if (src) {
+        source = m_images.getSource(reinterpret_cast<const char*>(src));
+        xmlFree(src);
+    }
+
+    // CSS sizes win over the attributes; a missing side keeps the image's aspect ratio
+    SkScalar width = style.width > 0 ? style.width : attributeLength(node, "width");
+    if (width <= 0 && style.widthPercent > 0 && containingWidth > 0) {
+        width = containingWidth * style.widthPercent / 100.0f;
+    }
+    SkScalar height = style.height > 0 ? style.height : attributeLength(node, "height");
+    const bool autoHeight = height <= 0;
+    if (source) {
+        if (width <= 0 && height <= 0) {
+            width = static_cast<SkScalar>(source->width);
+            height = static_cast<SkScalar>(source->height);
+        }
+        else if (width <= 0) {
+            width = height * source->width / source->height;
+        }
+        else if (height <= 0) {
+            height = width * source->height / source->width;
+        }
+    }
+    if (style.maxWidth > 0 && width > style.maxWidth) {
+        if (autoHeight) {
+            height = height * style.maxWidth / width;
+        }
+        width = style.maxWidth;
+    }
+
+    // An image that failed to load still holds the space it was given
+    size = SkSize::Make(std::max<SkScalar>(width, 0), std::max<SkScalar>(height, 0));
+    return size.width() > 0 && size.height() > 0;
+}
+
+void LayoutEngine::addImage(Context& context, LayoutBox& box, const std::shared_ptr<const ImageSource>& source,
+                            const SkRect& bounds) {
+    if (!source || bounds.isEmpty()) {
+        return;
+    }
+
+    // Decoded at the device size it is drawn at, so playback copies pixels instead of resampling
+    const SkScalar scale = context.imageScale;
+    sk_sp<SkImage> image = m_images.getImage(source, std::max(1, static_cast<int>(std::lround(bounds.width() * scale))),
+                                             std::max(1, static_cast<int>(std::lround(bounds.height() * scale))));
+    if (image) {
+        box.images.push_back({std::move(image), bounds});
+    }
+}
+
+SkFont LayoutEngine::fontFor(const ComputedStyle& style) {
+    SkFont font;
+    font.setTypeface(loadTypeface(style.fontFamily, style.fontWeight, style.italic));
+    font.setSize(style.fontSize);
+    font.setEdging(SkFont::Edging::kAntiAlias);
+    font.setSubpixel(true);
+    return font;
+}
+
+sk_sp<SkTypeface> LayoutEngine::loadTypeface(const std::string& family, int weight, bool italic) {
+    std::string key = family + '\0' + std::to_string(weight) + (italic ? "i" : "");
+    {
+        std::lock_guard<std::mutex> lock(m_typefacesMutex);
+        auto it = m_typefaces.find(key);
+        if (it != m_typefaces.end()) {
+            ++m_typefaceHits;
+            return it->second;
+        }
+        ++m_typefaceMisses;
+    }
+
+    SkFontStyle fontStyle(weight, SkFontStyle::kNormal_Width,
+                          italic ? SkFontStyle::kItalic_Slant : SkFontStyle::kUpright_Slant);
+    sk_sp<SkTypeface> typeface = SkTypeface::MakeFromName(family.empty() ? nullptr : family.c_str(), fontStyle);
+    if (!typeface) {
+        typeface = SkTypeface::MakeDefault();
+    }
+
+    std::lock_guard<std::mutex> lock(m_typefacesMutex);
+    if (m_typefaces.size() >= kMaxTypefaces) {
+        m_typefaceEvictions += m_typefaces.size();
+        m_typefaces.clear();
+    }
+    m_typefaces[key] = typeface;
+    return typeface;
+}
+
+std::shared_ptr<const MonospaceGlyphTable> LayoutEngine::getMonospaceGlyphTable(const ComputedStyle& style) {
+    std::string key = style.fontFamily + '\0' + std::to_string(style.fontSize) + '\0' +
+                      std::to_string(style.fontWeight) + (style.italic ? "i" : "");
+    {
+        std::lock_guard<std::mutex> lock(m_monospaceTablesMutex);
+        auto it = m_monospaceTables.find(key);
+        if (it != m_monospaceTables.end()) {
+            ++m_glyphTableHits;
+            return it->second;
+        }
+        ++m_glyphTableMisses;
+    }
+
+    auto table = std::make_shared<MonospaceGlyphTable>();
+    table->font = fontFor(style);
+
+    // Map every ASCII byte once; glyph lookup during layout is then an index
+    SkUnichar codepoints[128];
+    for (int i = 0; i < 128; ++i) {
+        codepoints[i] = i;
+    }
+    table->font.unicharsToGlyphs(codepoints, 128, table->glyphs);
+    table->font.getWidths(table->glyphs, 128, table->advances);
+
+    table->advance = table->advances[static_cast<int>('0')];
+    table->fixedPitch = true;
+    for (int i = 0x21; i < 0x7F; ++i) {
+        if (table->advances[i] != table->advance) {
+            table->fixedPitch = false;
+            break;
+        }
+    }
+
+    SkFontMetrics metrics;
+    table->font.getMetrics(&metrics);
+    table->ascent = -metrics.fAscent;
+    table->descent = metrics.fDescent;
+
+    std::lock_guard<std::mutex> lock(m_monospaceTablesMutex);
+    if (m_monospaceTables.size() >= kMaxMonospaceTables) {
+        m_glyphTableEvictions += m_monospaceTables.size();
+        m_monospaceTables.clear();
+    }
+    m_monospaceTables[key] = table;
+    return table;
+}
+
+} // namespace text2image
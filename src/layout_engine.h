@@ -0,0 +1,225 @@
+/*
+ * Text2Image Layout Engine
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the box tree produced by layout and the engine that
+ * builds it from a styled document and paints it onto a canvas.
+ */
+
+#ifndef TEXT2IMAGE_LAYOUT_ENGINE_H
+#define TEXT2IMAGE_LAYOUT_ENGINE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <SkCanvas.h>
+#include <SkFont.h>
+#include <SkTypeface.h>
+
+#include <libxml/tree.h>
+
+#include "display_list.h"
+#include "font_fallback.h"
+#include "image_cache.h"
+#include "shadow_cache.h"
+#include "style_resolver.h"
+#include "syntax_highlighter.h"
+
+namespace text2image {
+
+class ThreadPool;
+
+// Positioned glyph run. Coordinates are relative to the owning box.
+struct TextFragment {
+    SkFont font;
+    std::vector<SkGlyphID> glyphs;
+    std::vector<SkPoint> positions;
+    SkRect bounds;            // Line area covered by the run
+    SkScalar baseline;
+    SkColor color;
+    SkColor background;       // Inline background, transparent for none
+    bool underline;
+    bool lineThrough;
+};
+
+// Decoded image placed in a box. Coordinates are relative to the owning box.
+struct ImageFragment {
+    sk_sp<SkImage> image;     // Decoded at the size of bounds
+    SkRect bounds;
+};
+
+// Geometry of one line, used for culling and for choosing break points
+struct LineBox {
+    SkScalar top;             // Relative to the owning box
+    SkScalar height;
+    SkScalar baseline;
+};
+
+struct LayoutBox {
+    xmlNode* node;
+    std::shared_ptr<const ComputedStyle> style;
+    SkRect frame;             // Border box, relative to the parent's border box
+    std::vector<std::unique_ptr<LayoutBox>> children;
+    std::vector<LineBox> lines;
+    std::vector<TextFragment> fragments;
+    std::vector<ImageFragment> images;
+    bool truncated;           // Layout stopped at the cull line
+
+    LayoutBox() : node(nullptr), frame(SkRect::MakeEmpty()), truncated(false) {}
+};
+
+// Byte-to-glyph table for one typeface and size, used by the monospace fast path
+struct MonospaceGlyphTable {
+    SkFont font;
+    SkGlyphID glyphs[128];    // Indexed by ASCII byte
+    SkScalar advances[128];
+    SkScalar advance;         // Column width (advance of '0')
+    bool fixedPitch;          // Every printable ASCII glyph has the column width
+    SkScalar ascent;
+    SkScalar descent;
+};
+
+// Size of one string laid out as inline text
+struct TextMeasurement {
+    SkScalar width;                 // Widest line
+    SkScalar height;                // Sum of the line heights
+    std::vector<size_t> lineEnds;   // Byte offset just past the last character of each line
+};
+
+// Lookups in the layout engine's font caches since startup
+struct FontCacheStats {
+    uint64_t typefaceHits;
+    uint64_t typefaceMisses;
+    uint64_t typefaceEvictions;
+    uint64_t glyphTableHits;
+    uint64_t glyphTableMisses;
+    uint64_t glyphTableEvictions;
+    uint64_t fallbackPagesBuilt;
+    uint64_t fallbackTypefacesOpened;
+};
+
+class LayoutEngine {
+public:
+    explicit LayoutEngine(SyntaxHighlighter& highlighter);
+    ~LayoutEngine();
+
+    // Lay out a document at the given width. Content that starts below
+    // cullBottom is not styled, shaped or laid out; pass SK_ScalarInfinity
+    // to lay out the whole document. Layout is in CSS pixels; images are
+    // decoded at imageScale device pixels per CSS pixel.
+    std::unique_ptr<LayoutBox> layout(xmlDocPtr doc, const StyleResolver& styles, SkScalar width, SkScalar cullBottom,
+                                      SkScalar imageScale = 1);
+
+    // Measure strings in one style with the fonts and line breaking layout
+    // uses, without shaping glyphs. Newlines break lines and other white
+    // space collapses, as in a paragraph; a width of 0 or less never wraps.
+    // Thread-safe.
+    void measureText(const StyleResolver& styles, const std::shared_ptr<const ComputedStyle>& style,
+                     const char* const* texts, size_t count, SkScalar width, TextMeasurement* out);
+
+    // Paint the boxes that intersect clip, given in root coordinates
+    void paint(SkCanvas* canvas, const LayoutBox& root, const SkRect& clip) const;
+
+    // The halves of paint: record draws for the boxes that intersect clip,
+    // then play a recorded list back with text batching. paint culls
+    // occluded items in between. A draft playback trades shadows and
+    // anti-aliasing for speed.
+    void record(const LayoutBox& root, const SkRect& clip, DisplayList& list) const;
+    void playback(SkCanvas* canvas, const DisplayList& list, bool draft = false) const;
+    void playback(SkCanvas* canvas, const DisplayListView& view, bool draft = false) const;
+
+    // Top edge of each page when a fully laid-out tree is cut into pages of
+    // pageHeight. Breaks avoid splitting lines and table rows unless one is
+    // taller than a page.
+    static std::vector<SkScalar> findPageBreaks(const LayoutBox& root, SkScalar pageHeight, size_t maxPages);
+
+    // Pool used to lay out independent blocks of large documents in
+    // parallel; layout stays serial without one
+    void setThreadPool(ThreadPool* pool);
+
+    // Drop cached typefaces, fallback maps, glyph tables, shadow masks and images
+    void clearCaches();
+
+    // Fallback typefaces for characters a style's font lacks
+    FontFallback& getFontFallback() { return m_fontFallback; }
+
+    // Images embedded with <img>; internally synchronized
+    ImageCache& getImageCache() { return m_images; }
+
+    // Hit, miss and eviction counts of the font caches
+    FontCacheStats getFontCacheStats();
+
+private:
+    struct Context;
+    struct InlineItem;
+    struct ForkedChild;
+
+    // Block formatting
+    bool forkBlocks(Context& context, LayoutBox& box, SkScalar left, SkScalar width, std::vector<ForkedChild>& forked);
+    void layoutBlock(Context& context, LayoutBox& box, SkScalar containingWidth, SkScalar absoluteTop);
+    SkScalar layoutFlow(Context& context, LayoutBox& box, SkScalar left, SkScalar top, SkScalar width, SkScalar absoluteTop);
+    SkScalar layoutTable(Context& context, LayoutBox& box, SkScalar left, SkScalar top, SkScalar width, SkScalar absoluteTop);
+    SkScalar layoutCodeBlock(Context& context, LayoutBox& box, SkScalar left, SkScalar top, SkScalar absoluteTop);
+    void addListMarker(Context& context, LayoutBox& box);
+
+    // Images
+    bool imageLayoutSize(xmlNode* node, const ComputedStyle& style, SkScalar containingWidth,
+                         std::shared_ptr<const ImageSource>& source, SkSize& size);
+    void addImage(Context& context, LayoutBox& box, const std::shared_ptr<const ImageSource>& source, const SkRect& bounds);
+
+    // Inline formatting
+    void collectInline(Context& context, xmlNode* node, const std::shared_ptr<const ComputedStyle>& style,
+                       std::vector<InlineItem>& items, bool& lastWasSpace);
+    SkScalar layoutLines(Context& context, LayoutBox& box, const std::shared_ptr<const ComputedStyle>& lineStyle,
+                         std::vector<InlineItem>& items, SkScalar left, SkScalar top, SkScalar width,
+                         SkScalar absoluteTop);
+
+    // Scale a text-fit run to the largest size that fits width by height, or
+    // one line of width when height is 0. Rewrites the item styles and
+    // returns the block style the lines take their strut from.
+    std::shared_ptr<const ComputedStyle> fitInline(Context& context, const std::shared_ptr<const ComputedStyle>& blockStyle,
+                                                   std::vector<InlineItem>& items, SkScalar width, SkScalar height);
+
+    // Display list recording
+    void recordBox(DisplayList& list, const LayoutBox& box, SkScalar originX, SkScalar originY, const SkRect& clip) const;
+    void recordFragment(DisplayList& list, const TextFragment& fragment, SkScalar originX, SkScalar originY) const;
+
+    // Fonts
+    SkFont fontFor(const ComputedStyle& style);
+    sk_sp<SkTypeface> loadTypeface(const std::string& family, int weight, bool italic);
+    std::shared_ptr<const MonospaceGlyphTable> getMonospaceGlyphTable(const ComputedStyle& style);
+
+    SyntaxHighlighter& m_highlighter;
+    ThreadPool* m_threadPool;
+
+    // Typefaces keyed by family, weight and slant
+    std::unordered_map<std::string, sk_sp<SkTypeface>> m_typefaces;
+    std::mutex m_typefacesMutex;
+    uint64_t m_typefaceHits;                     // Guarded by m_typefacesMutex
+    uint64_t m_typefaceMisses;
+    uint64_t m_typefaceEvictions;
+
+    // Per-typeface fallback maps; internally synchronized
+    FontFallback m_fontFallback;
+
+    // Monospace glyph tables keyed by family and size
+    std::unordered_map<std::string, std::shared_ptr<const MonospaceGlyphTable>> m_monospaceTables;
+    std::mutex m_monospaceTablesMutex;
+    uint64_t m_glyphTableHits;                   // Guarded by m_monospaceTablesMutex
+    uint64_t m_glyphTableMisses;
+    uint64_t m_glyphTableEvictions;
+
+    // Pre-blurred box-shadow masks; internally synchronized, so const paint can use it
+    mutable ShadowCache m_shadowCache;
+
+    // Fetched and decoded <img> sources
+    ImageCache m_images;
+};
+
+} // namespace text2image
+
+#endif // TEXT2IMAGE_LAYOUT_ENGINE_H
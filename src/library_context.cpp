@@ -6,6 +6,7 @@
  */
 
 #include "text2image_internal.h"
+#include "compiled_document.h"
 
 #include <cstdlib>
 #include <ctime>
@@ -15,6 +16,20 @@
 
 namespace text2image {
 
+namespace {
+
+// "out.png" becomes "out-1.png", "out-2.png", ... for paginated renders and atlas crops
+std::string pageOutputPath(const std::string& path, size_t index) {
+    size_t slash = path.find_last_of("/\\");
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        dot = path.size();
+    }
+    return path.substr(0, dot) + "-" + std::to_string(index + 1) + path.substr(dot);
+}
+
+} // namespace
+
 LibraryContext& LibraryContext::getInstance() {
     static LibraryContext instance;
     return instance;
@@ -112,6 +127,133 @@ std::shared_ptr<Task> LibraryContext::createTask(const char* html, const char* c
     }
 }
 
+std::shared_ptr<Task> LibraryContext::createAtlasTask(const Text2Image_AtlasItem* items, int count, Text2Image_AtlasOutput output,
+                                                     const Text2Image_RenderOptions* options) {
+    std::vector<AtlasItem> atlasItems;
+    atlasItems.reserve(static_cast<size_t>(count));
+    for (int i = 0; i < count; ++i) {
+        if (!items[i].html || items[i].width <= 0 || items[i].height <= 0 ||
+            items[i].width > kMaxAtlasSide || items[i].height > kMaxAtlasSide) {
+            setLastError("Invalid atlas item " + std::to_string(i));
+            return nullptr;
+        }
+        atlasItems.push_back(AtlasItem{items[i].html, items[i].css ? items[i].css : "", items[i].width, items[i].height});
+    }
+
+    std::shared_ptr<Task> task = createTask("", "", options);
+    if (task) {
+        task->setAtlas(std::move(atlasItems), output);
+    }
+    return task;
+}
+
+std::shared_ptr<Task> LibraryContext::createIncrementalTask(Text2Image_TaskHandle base, const char* html, const char* css,
+                                                           const Text2Image_RenderOptions* options) {
+    std::shared_ptr<Task> baseTask = getTask(base);
+    if (!baseTask) {
+        setLastError("Invalid base task");
+        return nullptr;
+    }
+
+    // The base's snapshot is read when this task renders, not now, so the
+    // base may still be rendering
+    std::shared_ptr<Task> task = createTask(html, css, options);
+    if (task) {
+        task->setBase(std::move(baseTask));
+    }
+    return task;
+}
+
+std::shared_ptr<Task> LibraryContext::createAnimationTask(const Text2Image_Frame* frames, int count, const char* css,
+                                                         const Text2Image_RenderOptions* options) {
+    if (options->format != TEXT2IMAGE_FORMAT_PNG && options->format != TEXT2IMAGE_FORMAT_WEBP) {
+        setLastError("Animation needs PNG or WebP output");
+        return nullptr;
+    }
+    if (count > kMaxAnimationFrames) {
+        setLastError("Too many animation frames");
+        return nullptr;
+    }
+
+    std::vector<AnimationFrameSource> sources;
+    sources.reserve(static_cast<size_t>(count));
+    for (int i = 0; i < count; ++i) {
+        if (!frames[i].html || frames[i].duration < 0) {
+            setLastError("Invalid animation frame " + std::to_string(i));
+            return nullptr;
+        }
+        sources.push_back(AnimationFrameSource{frames[i].html, frames[i].duration});
+    }
+
+    std::shared_ptr<Task> task = createTask("", css, options);
+    if (task) {
+        task->setFrames(std::move(sources));
+    }
+    return task;
+}
+
+std::shared_ptr<Task> LibraryContext::createThumbnailTask(const char* html, const char* css, const Text2Image_Thumbnail* thumbnails,
+                                                         int count, const Text2Image_RenderOptions* options) {
+    if (options->paginate || options->incremental) {
+        setLastError("Thumbnails need a single unpaginated render");
+        return nullptr;
+    }
+    if (count > kMaxThumbnails) {
+        setLastError("Too many thumbnails");
+        return nullptr;
+    }
+
+    std::vector<Text2Image_Thumbnail> sizes(thumbnails, thumbnails + count);
+    for (int i = 0; i < count; ++i) {
+        const Text2Image_Thumbnail& size = sizes[i];
+        if (!(size.scale >= 0 && size.scale <= 1) || size.maxSide < 0 || (size.scale == 0 && size.maxSide == 0)) {
+            setLastError("Invalid thumbnail " + std::to_string(i));
+            return nullptr;
+        }
+    }
+
+    std::shared_ptr<Task> task = createTask(html, css, options);
+    if (task) {
+        task->setThumbnails(std::move(sizes));
+    }
+    return task;
+}
+
+std::shared_ptr<Task> LibraryContext::createTaskFromCompiled(const char* compiledPath, const Text2Image_RenderOptions* options) {
+    if (!m_initialized.load()) {
+        setLastError("Library not initialized");
+        return nullptr;
+    }
+
+    try {
+        // Mapping and checking the file here surfaces a stale or foreign file before any render
+        std::string error;
+        std::shared_ptr<const CompiledDocument> document = CompiledDocument::open(compiledPath, error);
+        if (!document) {
+            setLastError(error);
+            return nullptr;
+        }
+
+        auto task = std::make_shared<Task>("", "", *options);
+        task->setCompiled(std::move(document));
+
+        {
+            std::lock_guard<std::mutex> lock(m_tasksMutex);
+            m_tasks[task->getHandle()] = task;
+        }
+
+        return task;
+    }
+    catch (const std::exception& e) {
+        setLastError("Exception creating task: " + std::string(e.what()));
+        return nullptr;
+    }
+    catch (...) {
+        setLastError("Unknown exception creating task");
+        return nullptr;
+    }
+}
+
 void LibraryContext::freeTask(Text2Image_TaskHandle handle) {
     if (!handle) {
         return;
@@ -156,16 +298,21 @@ bool LibraryContext::renderSync(std::shared_ptr<Task> task, const char* outputPa
 
             // Save to file if output path is provided
             if (outputPath) {
-                const auto& result = task->getResult();
-                if (!result.empty()) {
-                    std::ofstream file(outputPath, std::ios::binary);
+                size_t pageCount = task->getPageCount();
+                for (size_t i = 0; i < pageCount; ++i) {
+                    const auto& result = task->getPage(i);
+                    if (result.empty()) {
+                        continue;
+                    }
+                    std::string path = task->hasPages() ? pageOutputPath(outputPath, i) : std::string(outputPath);
+                    std::ofstream file(path, std::ios::binary);
                     if (!file) {
-                        setLastError("Failed to open output file: " + std::string(outputPath));
+                        setLastError("Failed to open output file: " + path);
                         return false;
                     }
                     file.write(reinterpret_cast<const char*>(result.data()), result.size());
                     if (!file) {
-                        setLastError("Failed to write to output file: " + std::string(outputPath));
+                        setLastError("Failed to write to output file: " + path);
                         return false;
                     }
                 }
@@ -262,6 +409,130 @@ bool LibraryContext::renderAsync(std::shared_ptr<Task> task, const char* outputP
     }
 }
 
+bool LibraryContext::compile(std::shared_ptr<Task> task, const char* outputPath) {
+    if (!m_initialized.load()) {
+        setLastError("Library not initialized");
+        return false;
+    }
+
+    if (!task || !outputPath) {
+        setLastError("Invalid parameters");
+        return false;
+    }
+
+    if (task->getCompiled()) {
+        setLastError("Task is already compiled");
+        return false;
+    }
+
+    try {
+        if (!m_renderEngine->compile(task, outputPath)) {
+            setLastError("Compilation failed: " + task->getErrorMessage());
+            return false;
+        }
+        return true;
+    }
+    catch (const std::exception& e) {
+        setLastError("Exception during compilation: " + std::string(e.what()));
+        return false;
+    }
+    catch (...) {
+        setLastError("Unknown exception during compilation");
+        return false;
+    }
+}
+
+bool LibraryContext::setResourceResolver(Text2Image_ResourceResolver resolver, void* userData) {
+    if (!m_initialized.load()) {
+        setLastError("Library not initialized");
+        return false;
+    }
+
+    std::function<bool(const std::string&, std::vector<uint8_t>&)> function;
+    if (resolver) {
+        function = [resolver, userData](const std::string& url, std::vector<uint8_t>& data) {
+            uint8_t* buffer = nullptr;
+            size_t size = 0;
+            bool found = resolver(url.c_str(), &buffer, &size, userData) && buffer;
+            if (found) {
+                data.assign(buffer, buffer + size);
+            }
+            std::free(buffer);
+            return found;
+        };
+    }
+    m_renderEngine->setResourceResolver(std::move(function));
+    return true;
+}
+
+bool LibraryContext::setLocalImageDirectory(const char* directory) {
+    if (!m_initialized.load()) {
+        setLastError("Library not initialized");
+        return false;
+    }
+
+    if (!m_renderEngine->setLocalImageDirectory(directory ? directory : "")) {
+        setLastError("Invalid parameters");
+        return false;
+    }
+    return true;
+}
+
+bool LibraryContext::setFontCacheLimits(size_t byteLimit, int countLimit) {
+    if (!m_initialized.load()) {
+        setLastError("Library not initialized");
+        return false;
+    }
+
+    if (countLimit < 0) {
+        setLastError("Invalid parameters");
+        return false;
+    }
+
+    m_renderEngine->setFontCacheLimits(byteLimit, countLimit);
+    return true;
+}
+
+void LibraryContext::purgeFontCache() {
+    if (!m_initialized.load()) {
+        setLastError("Library not initialized");
+        return;
+    }
+
+    m_renderEngine->purgeFontCache();
+}
+
+bool LibraryContext::getMetrics(Text2Image_Metrics& metrics) {
+    if (!m_initialized.load()) {
+        setLastError("Library not initialized");
+        return false;
+    }
+
+    m_renderEngine->getMetrics(metrics);
+    return true;
+}
+
+bool LibraryContext::measureText(const char* const* texts, int count, const Text2Image_FontSpec& font, float maxWidth,
+                                 Text2Image_TextMetrics* metrics) {
+    if (!m_initialized.load()) {
+        setLastError("Library not initialized");
+        return false;
+    }
+
+    try {
+        m_renderEngine->measureText(texts, count, font, maxWidth, metrics);
+        return true;
+    }
+    catch (const std::exception& e) {
+        setLastError("Exception during text measurement: " + std::string(e.what()));
+        return false;
+    }
+    catch (...) {
+        setLastError("Unknown exception during text measurement");
+        return false;
+    }
+}
+
 void LibraryContext::setLastError(const std::string& error) {
     std::lock_guard<std::mutex> lock(m_errorMutex);
     m_lastError = error;
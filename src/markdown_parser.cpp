@@ -0,0 +1,964 @@
+/*
+ * Text2Image Markdown Parser Implementation
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the implementation of the MarkdownParser class.
+ */
+
+#include "markdown_parser.h"
+
+#include <libxml/HTMLtree.h>
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+namespace text2image {
+
+namespace {
+
+// Emphasis and links nested deeper than this stay literal text
+const int kMaxInlineDepth = 32;
+
+const xmlChar* toXml(const char* text) {
+    return reinterpret_cast<const xmlChar*>(text);
+}
+
+bool isBlank(const std::string& line) {
+    return std::all_of(line.begin(), line.end(), [](unsigned char c) { return std::isspace(c); });
+}
+
+// Leading indentation in columns, with tabs advancing to the next multiple of 4
+int countIndent(const std::string& line) {
+    int columns = 0;
+    for (char c : line) {
+        if (c == ' ') ++columns;
+        else if (c == '\t') columns += 4 - (columns % 4);
+        else break;
+    }
+    return columns;
+}
+
+// Remove up to the given number of indentation columns
+std::string stripIndent(const std::string& line, int columns) {
+    size_t pos = 0;
+    int removed = 0;
+    while (pos < line.size() && removed < columns) {
+        if (line[pos] == ' ') ++removed;
+        else if (line[pos] == '\t') removed += 4 - (removed % 4);
+        else break;
+        ++pos;
+    }
+    return line.substr(pos);
+}
+
+std::string trim(const std::string& value) {
+    size_t start = value.find_first_not_of(" \t");
+    if (start == std::string::npos) {
+        return std::string();
+    }
+    size_t end = value.find_last_not_of(" \t");
+    return value.substr(start, end - start + 1);
+}
+
+size_t countRun(const char* text, size_t length, size_t pos, char c) {
+    size_t end = pos;
+    while (end < length && text[end] == c) {
+        ++end;
+    }
+    return end - pos;
+}
+
+bool isThematicBreak(const std::string& line) {
+    char marker = 0;
+    int count = 0;
+    for (char c : line) {
+        if (c == ' ' || c == '\t') continue;
+        if (c != '*' && c != '-' && c != '_') return false;
+        if (marker && c != marker) return false;
+        marker = c;
+        ++count;
+    }
+    return count >= 3;
+}
+
+// Setext underline: returns the heading level or 0
+int setextLevel(const std::string& line) {
+    std::string value = trim(line);
+    if (value.empty()) {
+        return 0;
+    }
+    if (value.find_first_not_of('=') == std::string::npos) return 1;
+    if (value.find_first_not_of('-') == std::string::npos) return 2;
+    return 0;
+}
+
+// ATX heading: returns the level (1-6) or 0, and the heading text
+int atxHeading(const std::string& line, std::string& text) {
+    size_t hashes = line.find_first_not_of('#');
+    if (hashes == std::string::npos) {
+        hashes = line.size();
+    }
+    if (hashes == 0 || hashes > 6 || (hashes < line.size() && line[hashes] != ' ' && line[hashes] != '\t')) {
+        return 0;
+    }
+
+    text = trim(line.substr(hashes));
+
+    // Strip an optional closing sequence of '#'
+    size_t closing = text.find_last_not_of('#');
+    if (closing == std::string::npos) {
+        text.clear();
+    }
+    else if (closing + 1 < text.size() && (text[closing] == ' ' || text[closing] == '\t')) {
+        text = trim(text.substr(0, closing));
+    }
+
+    return static_cast<int>(hashes);
+}
+
+// Split a table row on unescaped pipes outside code spans
+std::vector<std::string> splitTableRow(const std::string& line) {
+    std::string row = trim(line);
+    if (!row.empty() && row.front() == '|') {
+        row.erase(0, 1);
+    }
+    if (!row.empty() && row.back() == '|' && (row.size() < 2 || row[row.size() - 2] != '\\')) {
+        row.pop_back();
+    }
+
+    std::vector<std::string> cells;
+    std::string cell;
+    bool inCode = false;
+    for (size_t i = 0; i < row.size(); ++i) {
+        char c = row[i];
+        if (c == '\\' && i + 1 < row.size() && row[i + 1] == '|') {
+            cell.push_back('|');
+            ++i;
+        }
+        else if (c == '`') {
+            inCode = !inCode;
+            cell.push_back(c);
+        }
+        else if (c == '|' && !inCode) {
+            cells.push_back(trim(cell));
+            cell.clear();
+        }
+        else {
+            cell.push_back(c);
+        }
+    }
+    cells.push_back(trim(cell));
+    return cells;
+}
+
+// Parse a delimiter row such as "| :--- | :---: | ---: |"
+bool parseDelimiterRow(const std::string& line, std::vector<std::string>& align) {
+    if (line.find('-') == std::string::npos) {
+        return false;
+    }
+
+    std::vector<std::string> cells = splitTableRow(line);
+    align.clear();
+    for (const std::string& cell : cells) {
+        if (cell.empty()) {
+            return false;
+        }
+
+        bool left = cell.front() == ':';
+        bool right = cell.back() == ':';
+        size_t start = left ? 1 : 0;
+        size_t end = cell.size() - (right ? 1 : 0);
+        if (end <= start || cell.find_first_not_of('-', start) < end) {
+            return false;
+        }
+
+        align.push_back(left && right ? "center" : right ? "right" : left ? "left" : "");
+    }
+    return true;
+}
+
+} // namespace
+
+// Closers for the delimiters of one inline run, shared by the nested ranges
+// appendInline recurses into. Searches stop at the end of the range they are
+// asked about. One that fails is remembered by where it started, so every
+// later opener of the same kind in that range fails at once. Brackets and
+// parentheses are paired once for the whole run, with a stack, on first use.
+class InlineDelimiters {
+public:
+    InlineDelimiters(const char* text, size_t length)
+        : m_text(text)
+        , m_length(length)
+        , m_paired(false) {
+    }
+
+    const char* text() const { return m_text; }
+
+    // Start of the next run of exactly count backticks in [from, end)
+    size_t findCodeSpanClose(size_t from, size_t end, size_t count) {
+        if (failedBefore('`', count, from, end)) {
+            return std::string::npos;
+        }
+        for (size_t j = from; j < end; ) {
+            j = static_cast<size_t>(std::find(m_text + j, m_text + end, '`') - m_text);
+            if (j >= end) {
+                break;
+            }
+            size_t run = countRun(m_text, end, j, '`');
+            if (run == count) {
+                return j;
+            }
+            j += run;
+        }
+        m_failed[std::make_tuple('`', count, end)] = from;
+        return std::string::npos;
+    }
+
+    // Find the closing emphasis delimiter run, skipping escapes and code spans
+    size_t findEmphasisClose(size_t from, size_t end, char c, size_t count) {
+        if (failedBefore(c, count, from, end)) {
+            return std::string::npos;
+        }
+        for (size_t j = from; j + count <= end; ++j) {
+            if (m_text[j] == '\\') {
+                ++j;
+                continue;
+            }
+
+            if (m_text[j] == '`') {
+                size_t run = countRun(m_text, end, j, '`');
+                size_t close = findCodeSpanClose(j + run, end, run);
+                j = (close != std::string::npos ? close + run : j + run) - 1;
+                continue;
+            }
+
+            if (m_text[j] != c) {
+                continue;
+            }
+
+            size_t run = countRun(m_text, end, j, c);
+            bool leftFlanked = j > from && !std::isspace(static_cast<unsigned char>(m_text[j - 1]));
+            bool intraword = c == '_' && j + run < end && std::isalnum(static_cast<unsigned char>(m_text[j + run]));
+            if (run >= count && leftFlanked && !intraword) {
+                return j;
+            }
+            j += run - 1;
+        }
+        m_failed[std::make_tuple(c, count, end)] = from;
+        return std::string::npos;
+    }
+
+    // Match "[label](destination)" starting at the '[' and ending before
+    // limit. Returns false if not a link.
+    bool matchLink(size_t open, size_t limit, size_t& labelEnd, std::string& destination, size_t& end) {
+        pair();
+        size_t close = m_closers[open];
+        if (close == std::string::npos || close + 1 >= limit || m_text[close + 1] != '(') {
+            return false;
+        }
+        size_t paren = m_closers[close + 1];
+        if (paren == std::string::npos || paren >= limit) {
+            return false;
+        }
+
+        // Drop an optional title after the destination
+        std::string inside = trim(std::string(m_text + close + 2, paren - close - 2));
+        size_t space = inside.find_first_of(" \t");
+        destination = inside.substr(0, space);
+        if (destination.size() >= 2 && destination.front() == '<' && destination.back() == '>') {
+            destination = destination.substr(1, destination.size() - 2);
+        }
+
+        labelEnd = close;
+        end = paren + 1;
+        return true;
+    }
+
+private:
+    bool failedBefore(char c, size_t count, size_t from, size_t end) const {
+        auto it = m_failed.find(std::make_tuple(c, count, end));
+        return it != m_failed.end() && it->second <= from;
+    }
+
+    // Record the partner of every '[' and '(' in one pass; brackets honour
+    // escapes, parentheses do not
+    void pair() {
+        if (m_paired) {
+            return;
+        }
+        m_paired = true;
+        m_closers.assign(m_length, std::string::npos);
+        std::vector<size_t> brackets;
+        std::vector<size_t> parens;
+        for (size_t j = 0; j < m_length; ++j) {
+            char c = m_text[j];
+            if (c == '(') {
+                parens.push_back(j);
+            }
+            else if (c == ')' && !parens.empty()) {
+                m_closers[parens.back()] = j;
+                parens.pop_back();
+            }
+            else if (c == '\\') {
+                if (j + 1 < m_length && m_text[j + 1] == '(') {
+                    parens.push_back(j + 1);
+                }
+                else if (j + 1 < m_length && m_text[j + 1] == ')' && !parens.empty()) {
+                    m_closers[parens.back()] = j + 1;
+                    parens.pop_back();
+                }
+                ++j;
+            }
+            else if (c == '[') {
+                brackets.push_back(j);
+            }
+            else if (c == ']' && !brackets.empty()) {
+                m_closers[brackets.back()] = j;
+                brackets.pop_back();
+            }
+        }
+    }
+
+    const char* m_text;
+    size_t m_length;
+    std::map<std::tuple<char, size_t, size_t>, size_t> m_failed;  // Earliest failed start, per range end
+    std::vector<size_t> m_closers;                                // Partner of each '[' and '(', or npos
+    bool m_paired;
+};
+
+MarkdownParser::MarkdownParser()
+    : m_doc(nullptr)
+    , m_body(nullptr)
+    , m_blockquote(nullptr)
+    , m_inCode(false)
+    , m_codeFenced(false)
+    , m_fenceChar(0)
+    , m_fenceLength(0)
+    , m_fenceIndent(0)
+    , m_codeBlankLines(0)
+    , m_table(nullptr)
+    , m_lastLineBlank(false) {
+    m_doc = htmlNewDocNoDtD(nullptr, nullptr);
+    if (m_doc) {
+        xmlNodePtr html = xmlNewDocNode(m_doc, nullptr, toXml("html"), nullptr);
+        xmlDocSetRootElement(m_doc, html);
+        m_body = newElement(html, "body");
+    }
+}
+
+MarkdownParser::~MarkdownParser() {
+    if (m_doc) {
+        xmlFreeDoc(m_doc);
+        m_doc = nullptr;
+    }
+}
+
+xmlDocPtr MarkdownParser::parse(const std::string& markdown) {
+    MarkdownParser parser;
+    parser.feed(markdown.data(), markdown.size());
+    return parser.finish();
+}
+
+void MarkdownParser::feed(const char* data, size_t length) {
+    if (!m_doc) {
+        return;
+    }
+
+    m_pending.append(data, length);
+
+    size_t start = 0;
+    size_t newline;
+    while ((newline = m_pending.find('\n', start)) != std::string::npos) {
+        size_t end = newline;
+        if (end > start && m_pending[end - 1] == '\r') {
+            --end;
+        }
+        processLine(m_pending.substr(start, end - start));
+        start = newline + 1;
+    }
+    m_pending.erase(0, start);
+}
+
+xmlDocPtr MarkdownParser::finish() {
+    if (!m_doc) {
+        return nullptr;
+    }
+
+    if (!m_pending.empty()) {
+        if (m_pending.back() == '\r') {
+            m_pending.pop_back();
+        }
+        processLine(m_pending);
+        m_pending.clear();
+    }
+    closeAll();
+
+    xmlDocPtr doc = m_doc;
+    m_doc = nullptr;
+    m_body = nullptr;
+    return doc;
+}
+
+void MarkdownParser::processLine(const std::string& line) {
+    // Code blocks outside a quote swallow '>' lines verbatim
+    if (m_inCode && !m_blockquote) {
+        processBlockLine(line);
+        return;
+    }
+
+    int indent = countIndent(line);
+    std::string content = stripIndent(line, indent);
+    bool quoted = indent < 4 && !content.empty() && content[0] == '>';
+
+    if (quoted) {
+        content.erase(0, 1);
+        if (!content.empty() && content[0] == ' ') {
+            content.erase(0, 1);
+        }
+
+        if (!m_blockquote) {
+            closeAll();
+            m_blockquote = newElement(m_body, "blockquote");
+        }
+        processBlockLine(content);
+        return;
+    }
+
+    if (m_blockquote) {
+        // Lazy continuation keeps an open paragraph inside the quote; a
+        // thematic break cannot continue it
+        if (!m_paragraph.empty() && !isBlank(line) && !m_inCode && !(indent < 4 && isThematicBreak(content))) {
+            m_paragraph.push_back(trim(line));
+            return;
+        }
+        closeAll();
+    }
+
+    processBlockLine(line);
+}
+
+void MarkdownParser::processBlockLine(const std::string& line) {
+    // Fenced code takes every line until the closing fence
+    if (m_inCode && m_codeFenced) {
+        std::string value = trim(line);
+        if (countIndent(line) < 4 && value.size() >= m_fenceLength &&
+            value.find_first_not_of(m_fenceChar) == std::string::npos) {
+            closeCode();
+        }
+        else {
+            m_code += stripIndent(line, m_fenceIndent);
+            m_code += '\n';
+        }
+        return;
+    }
+
+    if (isBlank(line)) {
+        closeParagraph();
+        closeTable();
+        if (m_inCode) {
+            ++m_codeBlankLines;
+        }
+        m_lastLineBlank = true;
+        return;
+    }
+
+    const bool lastLineBlank = m_lastLineBlank;
+    m_lastLineBlank = false;
+
+    const int indent = countIndent(line);
+    const int baseIndent = m_lists.empty() ? 0 : m_lists.back().contentIndent;
+    const std::string rest = stripIndent(line, indent);
+
+    // Indented code continues while lines stay indented
+    if (m_inCode) {
+        if (indent >= baseIndent + 4) {
+            m_code.append(m_codeBlankLines, '\n');
+            m_codeBlankLines = 0;
+            m_code += stripIndent(line, baseIndent + 4);
+            m_code += '\n';
+            return;
+        }
+        closeCode();
+    }
+
+    if (m_table) {
+        if (rest.find('|') != std::string::npos) {
+            addTableRow(rest);
+            return;
+        }
+        closeTable();
+    }
+
+    // Indented code cannot interrupt a paragraph
+    if (indent >= baseIndent + 4 && m_paragraph.empty()) {
+        m_inCode = true;
+        m_codeFenced = false;
+        m_codeLanguage.clear();
+        m_code = stripIndent(line, baseIndent + 4);
+        m_code += '\n';
+        m_codeBlankLines = 0;
+        return;
+    }
+
+    // Lines indented less than the open list item's content leave the list
+    auto closeOutdentedLists = [this](int columns) {
+        while (!m_lists.empty() && columns < m_lists.back().contentIndent) {
+            m_lists.pop_back();
+        }
+    };
+
+    // Fenced code block
+    if (!rest.empty() && (rest[0] == '`' || rest[0] == '~')) {
+        size_t fence = countRun(rest.data(), rest.size(), 0, rest[0]);
+        std::string info = trim(rest.substr(fence));
+        if (fence >= 3 && (rest[0] == '~' || info.find('`') == std::string::npos)) {
+            closeParagraph();
+            closeOutdentedLists(indent);
+            m_inCode = true;
+            m_codeFenced = true;
+            m_fenceChar = rest[0];
+            m_fenceLength = fence;
+            m_fenceIndent = indent;
+            m_codeLanguage = info.substr(0, info.find_first_of(" \t{"));
+            m_code.clear();
+            return;
+        }
+    }
+
+    // Setext heading underline turns the open paragraph into a heading. An
+    // underline left of an open list item is not a lazy continuation: "---"
+    // then ends the list as a thematic break and "===" continues the text.
+    if (!m_paragraph.empty() && indent < baseIndent + 4 && (m_lists.empty() || indent >= baseIndent)) {
+        int level = setextLevel(rest);
+        if (level > 0) {
+            std::string text;
+            for (size_t i = 0; i < m_paragraph.size(); ++i) {
+                if (i > 0) text += '\n';
+                text += m_paragraph[i];
+            }
+            m_paragraph.clear();
+
+            xmlNodePtr heading = newElement(currentParent(), level == 1 ? "h1" : "h2");
+            appendInline(heading, text.data(), text.size());
+            return;
+        }
+    }
+
+    // ATX heading
+    std::string headingText;
+    int headingLevel = atxHeading(rest, headingText);
+    if (headingLevel > 0) {
+        closeParagraph();
+        closeOutdentedLists(indent);
+
+        const char* names[] = {"h1", "h2", "h3", "h4", "h5", "h6"};
+        xmlNodePtr heading = newElement(currentParent(), names[headingLevel - 1]);
+        appendInline(heading, headingText.data(), headingText.size());
+        return;
+    }
+
+    // Thematic break is checked after setext so "---" under text stays a heading
+    if (isThematicBreak(rest)) {
+        closeParagraph();
+        closeOutdentedLists(indent);
+        newElement(currentParent(), "hr");
+        return;
+    }
+
+    // A single paragraph line followed by a delimiter row starts a table
+    if (m_paragraph.size() == 1 && startTable(rest)) {
+        return;
+    }
+
+    if (startListItem(line, indent)) {
+        return;
+    }
+
+    if (!m_lists.empty() && lastLineBlank) {
+        // After a blank line only indented content stays in the item
+        closeParagraph();
+        closeOutdentedLists(indent);
+    }
+
+    m_paragraph.push_back(rest);
+}
+
+bool MarkdownParser::startListItem(const std::string& line, int indent) {
+    size_t pos = line.find_first_not_of(" \t");
+    if (pos == std::string::npos) {
+        return false;
+    }
+
+    bool ordered = false;
+    int start = 1;
+    size_t markerEnd = pos;
+
+    if (line[pos] == '-' || line[pos] == '*' || line[pos] == '+') {
+        markerEnd = pos + 1;
+    }
+    else if (std::isdigit(static_cast<unsigned char>(line[pos]))) {
+        size_t digits = pos;
+        while (digits < line.size() && digits - pos < 9 && std::isdigit(static_cast<unsigned char>(line[digits]))) {
+            ++digits;
+        }
+        if (digits >= line.size() || (line[digits] != '.' && line[digits] != ')')) {
+            return false;
+        }
+        ordered = true;
+        start = std::atoi(line.substr(pos, digits - pos).c_str());
+        markerEnd = digits + 1;
+    }
+    else {
+        return false;
+    }
+
+    if (markerEnd < line.size() && line[markerEnd] != ' ' && line[markerEnd] != '\t') {
+        return false;
+    }
+
+    std::string text = markerEnd < line.size() ? line.substr(markerEnd) : std::string();
+    int spaces = countIndent(text);
+    text = stripIndent(text, spaces);
+
+    // Only a bullet or "1." with content may interrupt a paragraph
+    if (!m_paragraph.empty() && m_lists.empty() && (text.empty() || (ordered && start != 1))) {
+        return false;
+    }
+
+    int markerWidth = static_cast<int>(markerEnd - pos);
+    int contentIndent = indent + markerWidth + ((spaces >= 1 && spaces <= 4 && !text.empty()) ? spaces : 1);
+
+    closeParagraph();
+
+    xmlNodePtr parent = nullptr;
+    if (!m_lists.empty() && indent >= m_lists.back().contentIndent) {
+        // Nested list inside the current item
+        parent = m_lists.back().item;
+    }
+    else {
+        while (!m_lists.empty() && indent < m_lists.back().markerIndent) {
+            m_lists.pop_back();
+        }
+        if (!m_lists.empty() && m_lists.back().ordered != ordered) {
+            m_lists.pop_back();
+        }
+        if (m_lists.empty()) {
+            parent = container();
+        }
+        else if (indent >= m_lists.back().contentIndent) {
+            parent = m_lists.back().item;
+        }
+    }
+
+    if (parent) {
+        ListLevel level;
+        level.list = newElement(parent, ordered ? "ol" : "ul");
+        level.ordered = ordered;
+        if (ordered && start != 1) {
+            xmlSetProp(level.list, toXml("start"), toXml(std::to_string(start).c_str()));
+        }
+        m_lists.push_back(level);
+    }
+
+    ListLevel& level = m_lists.back();
+    level.item = newElement(level.list, "li");
+    level.markerIndent = indent;
+    level.contentIndent = contentIndent;
+
+    if (!text.empty()) {
+        m_paragraph.push_back(text);
+    }
+    return true;
+}
+
+bool MarkdownParser::startTable(const std::string& line) {
+    if (m_paragraph[0].find('|') == std::string::npos) {
+        return false;
+    }
+
+    std::vector<std::string> align;
+    if (!parseDelimiterRow(line, align)) {
+        return false;
+    }
+
+    std::vector<std::string> header = splitTableRow(m_paragraph[0]);
+    if (header.size() != align.size()) {
+        return false;
+    }
+    m_paragraph.clear();
+
+    m_table = newElement(currentParent(), "table");
+    m_tableAlign = align;
+
+    xmlNodePtr row = newElement(m_table, "tr");
+    for (size_t i = 0; i < header.size(); ++i) {
+        xmlNodePtr cell = newElement(row, "th");
+        if (!m_tableAlign[i].empty()) {
+            xmlSetProp(cell, toXml("style"), toXml(("text-align: " + m_tableAlign[i]).c_str()));
+        }
+        appendInline(cell, header[i].data(), header[i].size());
+    }
+    return true;
+}
+
+void MarkdownParser::addTableRow(const std::string& line) {
+    std::vector<std::string> cells = splitTableRow(line);
+
+    xmlNodePtr row = newElement(m_table, "tr");
+    for (size_t i = 0; i < m_tableAlign.size(); ++i) {
+        xmlNodePtr cell = newElement(row, "td");
+        if (!m_tableAlign[i].empty()) {
+            xmlSetProp(cell, toXml("style"), toXml(("text-align: " + m_tableAlign[i]).c_str()));
+        }
+        if (i < cells.size()) {
+            appendInline(cell, cells[i].data(), cells[i].size());
+        }
+    }
+}
+
+void MarkdownParser::closeParagraph() {
+    if (m_paragraph.empty()) {
+        return;
+    }
+
+    std::string text;
+    for (size_t i = 0; i < m_paragraph.size(); ++i) {
+        if (i > 0) text += '\n';
+        text += m_paragraph[i];
+    }
+    m_paragraph.clear();
+
+    // Tight list items hold their first paragraph inline
+    xmlNodePtr parent = currentParent();
+    xmlNodePtr target = (!m_lists.empty() && !parent->children) ? parent : newElement(parent, "p");
+
+    size_t end = text.find_last_not_of(" \t");
+    appendInline(target, text.data(), end == std::string::npos ? 0 : end + 1);
+}
+
+void MarkdownParser::closeCode() {
+    if (!m_inCode) {
+        return;
+    }
+
+    xmlNodePtr pre = newElement(currentParent(), "pre");
+    xmlNodePtr code = newElement(pre, "code");
+    if (!m_codeLanguage.empty()) {
+        xmlSetProp(code, toXml("class"), toXml(("language-" + m_codeLanguage).c_str()));
+    }
+
+    // The final newline belongs to the block, not the content
+    size_t length = m_code.size();
+    if (length > 0 && m_code[length - 1] == '\n') {
+        --length;
+    }
+    appendText(code, m_code.data(), length);
+
+    m_inCode = false;
+    m_codeFenced = false;
+    m_code.clear();
+    m_codeLanguage.clear();
+    m_codeBlankLines = 0;
+}
+
+void MarkdownParser::closeTable() {
+    m_table = nullptr;
+    m_tableAlign.clear();
+}
+
+void MarkdownParser::closeLists() {
+    closeParagraph();
+    m_lists.clear();
+}
+
+void MarkdownParser::closeBlockquote() {
+    m_blockquote = nullptr;
+}
+
+void MarkdownParser::closeAll() {
+    closeParagraph();
+    closeCode();
+    closeTable();
+    closeLists();
+    closeBlockquote();
+    m_lastLineBlank = false;
+}
+
+xmlNodePtr MarkdownParser::container() const {
+    return m_blockquote ? m_blockquote : m_body;
+}
+
+xmlNodePtr MarkdownParser::currentParent() const {
+    return m_lists.empty() ? container() : m_lists.back().item;
+}
+
+xmlNodePtr MarkdownParser::newElement(xmlNodePtr parent, const char* name) {
+    xmlNodePtr node = xmlNewDocNode(m_doc, nullptr, toXml(name), nullptr);
+    return xmlAddChild(parent, node);
+}
+
+void MarkdownParser::appendText(xmlNodePtr parent, const char* text, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    // xmlAddChild merges adjacent text nodes
+    xmlAddChild(parent, xmlNewDocTextLen(m_doc, toXml(text), static_cast<int>(length)));
+}
+
+void MarkdownParser::appendInline(xmlNodePtr parent, const char* text, size_t length) {
+    InlineDelimiters delimiters(text, length);
+    appendInline(parent, delimiters, 0, length, 0);
+}
+
+void MarkdownParser::appendInline(xmlNodePtr parent, InlineDelimiters& delimiters, size_t begin, size_t end, int depth) {
+    const char* text = delimiters.text();
+    const bool nest = depth < kMaxInlineDepth;
+    std::string buffer;
+    auto flush = [&]() {
+        appendText(parent, buffer.data(), buffer.size());
+        buffer.clear();
+    };
+    auto hardBreak = [&]() {
+        size_t last = buffer.find_last_not_of(' ');
+        buffer.resize(last == std::string::npos ? 0 : last + 1);
+        flush();
+        newElement(parent, "br");
+    };
+
+    size_t i = begin;
+    while (i < end) {
+        char c = text[i];
+
+        // Backslash escapes and backslash hard breaks
+        if (c == '\\' && i + 1 < end) {
+            char next = text[i + 1];
+            if (next == '\n') {
+                hardBreak();
+                i += 2;
+                continue;
+            }
+            if (std::ispunct(static_cast<unsigned char>(next))) {
+                buffer.push_back(next);
+                i += 2;
+                continue;
+            }
+        }
+
+        // Soft break, or hard break after two trailing spaces
+        if (c == '\n') {
+            if (buffer.size() >= 2 && buffer.compare(buffer.size() - 2, 2, "  ") == 0) {
+                hardBreak();
+            }
+            else {
+                size_t last = buffer.find_last_not_of(' ');
+                buffer.resize(last == std::string::npos ? 0 : last + 1);
+                buffer.push_back(' ');
+            }
+            ++i;
+            while (i < end && text[i] == ' ') ++i;
+            continue;
+        }
+
+        // Code span
+        if (c == '`') {
+            size_t run = countRun(text, end, i, '`');
+            size_t close = delimiters.findCodeSpanClose(i + run, end, run);
+            if (close != std::string::npos) {
+                std::string code(text + i + run, close - i - run);
+                std::replace(code.begin(), code.end(), '\n', ' ');
+                if (code.size() >= 2 && code.front() == ' ' && code.back() == ' ' &&
+                    code.find_first_not_of(' ') != std::string::npos) {
+                    code = code.substr(1, code.size() - 2);
+                }
+
+                flush();
+                xmlNodePtr node = newElement(parent, "code");
+                appendText(node, code.data(), code.size());
+                i = close + run;
+            }
+            else {
+                buffer.append(run, '`');
+                i += run;
+            }
+            continue;
+        }
+
+        // Emphasis, strong emphasis and strikethrough; past the nesting limit they stay literal
+        if (c == '*' || c == '_' || c == '~') {
+            size_t run = countRun(text, end, i, c);
+            bool opens = nest && i + run < end && !std::isspace(static_cast<unsigned char>(text[i + run]));
+            if (c == '_' && i > begin && std::isalnum(static_cast<unsigned char>(text[i - 1]))) {
+                opens = false;
+            }
+            if (c == '~' && run != 2) {
+                opens = false;
+            }
+
+            if (opens) {
+                if (c != '~' && run >= 3) {
+                    size_t close = delimiters.findEmphasisClose(i + 3, end, c, 3);
+                    if (close != std::string::npos) {
+                        flush();
+                        xmlNodePtr strong = newElement(parent, "strong");
+                        xmlNodePtr em = newElement(strong, "em");
+                        appendInline(em, delimiters, i + 3, close, depth + 1);
+                        i = close + 3;
+                        continue;
+                    }
+                }
+
+                size_t count = (c == '~' || run >= 2) ? 2 : 1;
+                size_t close = delimiters.findEmphasisClose(i + count, end, c, count);
+                if (close != std::string::npos) {
+                    flush();
+                    const char* name = (c == '~') ? "del" : (count == 2 ? "strong" : "em");
+                    xmlNodePtr node = newElement(parent, name);
+                    appendInline(node, delimiters, i + count, close, depth + 1);
+                    i = close + count;
+                    continue;
+                }
+            }
+
+            buffer.append(run, c);
+            i += run;
+            continue;
+        }
+
+        // Links and images, also literal past the nesting limit
+        if (nest && (c == '[' || (c == '!' && i + 1 < end && text[i + 1] == '['))) {
+            bool image = c == '!';
+            size_t open = image ? i + 1 : i;
+            size_t labelEnd = 0;
+            size_t linkEnd = 0;
+            std::string destination;
+
+            if (delimiters.matchLink(open, end, labelEnd, destination, linkEnd)) {
+                flush();
+                if (image) {
+                    xmlNodePtr node = newElement(parent, "img");
+                    xmlSetProp(node, toXml("src"), toXml(destination.c_str()));
+                    std::string alt(text + open + 1, labelEnd - open - 1);
+                    xmlSetProp(node, toXml("alt"), toXml(alt.c_str()));
+                }
+                else {
+                    xmlNodePtr node = newElement(parent, "a");
+                    xmlSetProp(node, toXml("href"), toXml(destination.c_str()));
+                    appendInline(node, delimiters, open + 1, labelEnd, depth + 1);
+                }
+                i = linkEnd;
+                continue;
+            }
+        }
+
+        buffer.push_back(c);
+        ++i;
+    }
+
+    flush();
+}
+
+} // namespace text2image
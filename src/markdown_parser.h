@@ -0,0 +1,101 @@
+/*
+ * Text2Image Markdown Parser
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains a streaming Markdown parser that builds the same
+ * document tree the HTML path produces, without an HTML text round trip.
+ */
+
+#ifndef TEXT2IMAGE_MARKDOWN_PARSER_H
+#define TEXT2IMAGE_MARKDOWN_PARSER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <libxml/tree.h>
+
+namespace text2image {
+
+class InlineDelimiters;
+
+// Line-oriented parser for a CommonMark subset: ATX/setext headings,
+// paragraphs, emphasis, inline code, links, images, lists, block quotes,
+// fenced/indented code blocks, thematic breaks and GFM tables.
+class MarkdownParser {
+public:
+    MarkdownParser();
+    ~MarkdownParser();
+
+    // Feed a chunk of input. Lines may span chunk boundaries.
+    void feed(const char* data, size_t length);
+
+    // Flush pending blocks and return the document. The caller owns it.
+    xmlDocPtr finish();
+
+    // Convenience wrapper for a complete input
+    static xmlDocPtr parse(const std::string& markdown);
+
+private:
+    struct ListLevel {
+        xmlNodePtr list;
+        xmlNodePtr item;
+        int markerIndent;
+        int contentIndent;
+        bool ordered;
+    };
+
+    // Block structure
+    void processLine(const std::string& line);
+    void processBlockLine(const std::string& line);
+    bool startListItem(const std::string& line, int indent);
+    bool startTable(const std::string& line);
+    void addTableRow(const std::string& line);
+
+    void closeParagraph();
+    void closeCode();
+    void closeTable();
+    void closeLists();
+    void closeBlockquote();
+    void closeAll();
+
+    xmlNodePtr container() const;
+    xmlNodePtr currentParent() const;
+
+    // Tree construction
+    xmlNodePtr newElement(xmlNodePtr parent, const char* name);
+    void appendText(xmlNodePtr parent, const char* text, size_t length);
+    void appendInline(xmlNodePtr parent, const char* text, size_t length);
+    // Inline content of text[begin, end), depth levels inside emphasis and links
+    void appendInline(xmlNodePtr parent, InlineDelimiters& delimiters, size_t begin, size_t end, int depth);
+
+    xmlDocPtr m_doc;
+    xmlNodePtr m_body;
+    xmlNodePtr m_blockquote;
+    std::string m_pending;
+
+    // Open paragraph lines
+    std::vector<std::string> m_paragraph;
+
+    // Open code block
+    bool m_inCode;
+    bool m_codeFenced;
+    char m_fenceChar;
+    size_t m_fenceLength;
+    int m_fenceIndent;
+    std::string m_codeLanguage;
+    std::string m_code;
+    size_t m_codeBlankLines;
+
+    // Open table
+    xmlNodePtr m_table;
+    std::vector<std::string> m_tableAlign;
+
+    // Open lists, outermost first
+    std::vector<ListLevel> m_lists;
+    bool m_lastLineBlank;
+};
+
+} // namespace text2image
+
+#endif // TEXT2IMAGE_MARKDOWN_PARSER_H
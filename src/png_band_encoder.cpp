@@ -0,0 +1,321 @@
+/*
+ * Text2Image PNG Band Encoder Implementation
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the implementation of the PngBandEncoder class.
+ */
+
+#include "png_band_encoder.h"
+#include "text2image_internal.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+namespace text2image {
+
+namespace {
+
+// zlib's default level, the one Skia's PNG encoder uses too
+const int kCompressionLevel = 6;
+
+const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+void putUint32(uint8_t* out, uint32_t value) {
+    out[0] = static_cast<uint8_t>(value >> 24);
+    out[1] = static_cast<uint8_t>(value >> 16);
+    out[2] = static_cast<uint8_t>(value >> 8);
+    out[3] = static_cast<uint8_t>(value);
+}
+
+uint8_t paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = std::abs(p - a);
+    int pb = std::abs(p - b);
+    int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) {
+        return static_cast<uint8_t>(a);
+    }
+    return static_cast<uint8_t>(pb <= pc ? b : c);
+}
+
+// Filter each row with whichever PNG filter leaves the smallest sum of
+// signed residuals. The first row of a band may not refer to the row above,
+// which belongs to another band, so it picks between None and Sub only.
+void filterBand(const std::vector<uint8_t>& rgba, int width, int rows, int channels, std::vector<uint8_t>& filtered) {
+    const size_t stride = static_cast<size_t>(width) * channels;
+    filtered.resize((stride + 1) * rows);
+
+    std::vector<uint8_t> previous(stride, 0);
+    std::vector<uint8_t> current(stride);
+    std::vector<uint8_t> candidate[5];
+    for (std::vector<uint8_t>& row : candidate) {
+        row.resize(stride);
+    }
+
+    for (int y = 0; y < rows; ++y) {
+        const uint8_t* in = rgba.data() + static_cast<size_t>(y) * width * 4;
+        if (channels == 4) {
+            std::memcpy(current.data(), in, stride);
+        }
+        else {
+            for (int x = 0; x < width; ++x) {
+                std::memcpy(&current[static_cast<size_t>(x) * 3], in + static_cast<size_t>(x) * 4, 3);
+            }
+        }
+
+        const int filters = y == 0 ? 2 : 5;
+        for (size_t i = 0; i < stride; ++i) {
+            int x = current[i];
+            int a = i >= static_cast<size_t>(channels) ? current[i - channels] : 0;
+            int b = previous[i];
+            int c = i >= static_cast<size_t>(channels) ? previous[i - channels] : 0;
+            candidate[0][i] = static_cast<uint8_t>(x);
+            candidate[1][i] = static_cast<uint8_t>(x - a);
+            candidate[2][i] = static_cast<uint8_t>(x - b);
+            candidate[3][i] = static_cast<uint8_t>(x - (a + b) / 2);
+            candidate[4][i] = static_cast<uint8_t>(x - paeth(a, b, c));
+        }
+
+        int best = 0;
+        uint64_t bestSum = UINT64_MAX;
+        for (int f = 0; f < filters; ++f) {
+            uint64_t sum = 0;
+            for (uint8_t value : candidate[f]) {
+                sum += static_cast<uint64_t>(std::abs(static_cast<int8_t>(value)));
+            }
+            if (sum < bestSum) {
+                bestSum = sum;
+                best = f;
+            }
+        }
+
+        uint8_t* out = filtered.data() + (stride + 1) * y;
+        out[0] = static_cast<uint8_t>(best);
+        std::memcpy(out + 1, candidate[best].data(), stride);
+        previous.swap(current);
+    }
+}
+
+// Deflate a band as a raw stream that ends on a byte boundary without a
+// final block, so bands can be concatenated into one zlib stream
+bool deflateBand(const std::vector<uint8_t>& filtered, PngBand& band) {
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, kCompressionLevel, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+
+    // Room for the chunk length and type in front and the CRC behind
+    std::vector<uint8_t>& chunk = band.chunk;
+    chunk.resize(8 + deflateBound(&stream, static_cast<uLong>(filtered.size())) + 16);
+    stream.next_in = const_cast<Bytef*>(filtered.data());
+    stream.avail_in = static_cast<uInt>(filtered.size());
+
+    int status;
+    do {
+        if (stream.total_out + 8 + 4 >= chunk.size()) {
+            chunk.resize(chunk.size() * 2);
+        }
+        stream.next_out = chunk.data() + 8 + stream.total_out;
+        stream.avail_out = static_cast<uInt>(chunk.size() - 8 - 4 - stream.total_out);
+        status = deflate(&stream, Z_SYNC_FLUSH);
+    } while (status == Z_OK && (stream.avail_in > 0 || stream.avail_out == 0));
+
+    const size_t size = stream.total_out;
+    deflateEnd(&stream);
+    if (status != Z_OK && status != Z_BUF_ERROR) {
+        return false;
+    }
+
+    chunk.resize(8 + size + 4);
+    putUint32(chunk.data(), static_cast<uint32_t>(size));
+    std::memcpy(chunk.data() + 4, "IDAT", 4);
+    putUint32(chunk.data() + 8 + size, static_cast<uint32_t>(crc32(0L, chunk.data() + 4, static_cast<uInt>(size + 4))));
+
+    band.adler = static_cast<uint32_t>(adler32(adler32(0L, Z_NULL, 0), filtered.data(), static_cast<uInt>(filtered.size())));
+    band.filteredSize = filtered.size();
+    return true;
+}
+
+void forEach(ThreadPool* pool, const std::vector<size_t>& indices, const std::function<void(size_t)>& body) {
+    if (pool && indices.size() > 1) {
+        pool->parallelFor(indices.size(), [&](size_t i) { body(indices[i]); });
+    }
+    else {
+        for (size_t index : indices) {
+            body(index);
+        }
+    }
+}
+
+} // namespace
+
+void PngBandEncoder::appendChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size) {
+    size_t start = out.size();
+    out.resize(start + 12 + size);
+    uint8_t* chunk = out.data() + start;
+    putUint32(chunk, static_cast<uint32_t>(size));
+    std::memcpy(chunk + 4, type, 4);
+    if (size > 0) {
+        std::memcpy(chunk + 8, data, size);
+    }
+    uLong crc = crc32(0L, chunk + 4, static_cast<uInt>(size + 4));
+    putUint32(chunk + 8 + size, static_cast<uint32_t>(crc));
+}
+
+bool PngBandEncoder::unpremultiply(const uint8_t* pixels, size_t rowBytes, int left, int top, int width, int rows,
+                                   std::vector<uint8_t>& rgba) {
+    rgba.resize(static_cast<size_t>(width) * rows * 4);
+    bool opaque = true;
+    uint8_t* out = rgba.data();
+    for (int y = 0; y < rows; ++y) {
+        const uint8_t* in = pixels + static_cast<size_t>(top + y) * rowBytes + static_cast<size_t>(left) * 4;
+        for (int x = 0; x < width; ++x, in += 4, out += 4) {
+            uint8_t alpha = in[3];
+            if (alpha == 0xFF) {
+                std::memcpy(out, in, 4);
+                continue;
+            }
+            opaque = false;
+            if (alpha == 0) {
+                std::memset(out, 0, 4);
+                continue;
+            }
+            for (int c = 0; c < 3; ++c) {
+                out[c] = static_cast<uint8_t>(std::min(255, (in[c] * 255 + alpha / 2) / alpha));
+            }
+            out[3] = alpha;
+        }
+    }
+    return opaque;
+}
+
+bool PngBandEncoder::compress(const std::vector<uint8_t>& rgba, int width, int height, int channels,
+                              std::vector<uint8_t>& stream) {
+    std::vector<uint8_t> filtered;
+    filterBand(rgba, width, height, channels, filtered);
+
+    z_stream z;
+    std::memset(&z, 0, sizeof(z));
+    if (deflateInit(&z, kCompressionLevel) != Z_OK) {
+        return false;
+    }
+    stream.resize(deflateBound(&z, static_cast<uLong>(filtered.size())));
+    z.next_in = filtered.data();
+    z.avail_in = static_cast<uInt>(filtered.size());
+    z.next_out = stream.data();
+    z.avail_out = static_cast<uInt>(stream.size());
+    int status = deflate(&z, Z_FINISH);
+    stream.resize(z.total_out);
+    deflateEnd(&z);
+    return status == Z_STREAM_END;
+}
+
+bool PngBandEncoder::encode(const uint8_t* pixels, size_t rowBytes, int width, int height,
+                            const PngBands* previous, const std::vector<std::pair<int, int>>& dirtyRows,
+                            ThreadPool* pool, std::vector<uint8_t>& output, PngBands& bands) {
+    if (!pixels || width <= 0 || height <= 0) {
+        return false;
+    }
+
+    const size_t count = static_cast<size_t>((height + kBandRows - 1) / kBandRows);
+    bands.width = width;
+    bands.height = height;
+    bands.bands.assign(count, PngBand());
+
+    // Bands line up with the previous image's only when the size matches
+    const bool reusable = previous && previous->width == width && previous->height == height &&
+                          previous->bands.size() == count;
+    std::vector<bool> reuse(count, false);
+    std::vector<size_t> dirty;
+    for (size_t i = 0; i < count; ++i) {
+        PngBand& band = bands.bands[i];
+        band.top = static_cast<int>(i) * kBandRows;
+        band.rows = std::min(kBandRows, height - band.top);
+        if (reusable) {
+            reuse[i] = std::none_of(dirtyRows.begin(), dirtyRows.end(), [&](const std::pair<int, int>& span) {
+                return span.first < band.top + band.rows && band.top < span.second;
+            });
+        }
+        if (!reuse[i]) {
+            dirty.push_back(i);
+        }
+    }
+
+    std::vector<std::vector<uint8_t>> rgba(count);
+    auto read = [&](size_t i) {
+        PngBand& band = bands.bands[i];
+        band.opaque = unpremultiply(pixels, rowBytes, 0, band.top, width, band.rows, rgba[i]);
+    };
+    forEach(pool, dirty, read);
+
+    // Alpha is dropped when no pixel needs it; a change of color type
+    // invalidates every band kept from before
+    bool opaque = true;
+    for (size_t i = 0; i < count; ++i) {
+        opaque = opaque && (reuse[i] ? previous->bands[i].opaque : bands.bands[i].opaque);
+    }
+    bands.channels = opaque ? 3 : 4;
+    if (reusable && previous->channels != bands.channels) {
+        std::vector<size_t> stale;
+        for (size_t i = 0; i < count; ++i) {
+            if (reuse[i]) {
+                reuse[i] = false;
+                stale.push_back(i);
+                dirty.push_back(i);
+            }
+        }
+        forEach(pool, stale, read);
+    }
+
+    std::atomic<bool> failed(false);
+    forEach(pool, dirty, [&](size_t i) {
+        std::vector<uint8_t> filtered;
+        filterBand(rgba[i], width, bands.bands[i].rows, bands.channels, filtered);
+        std::vector<uint8_t>().swap(rgba[i]);
+        if (!deflateBand(filtered, bands.bands[i])) {
+            failed = true;
+        }
+    });
+    if (failed) {
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (reuse[i]) {
+            bands.bands[i] = previous->bands[i];
+        }
+    }
+
+    // Signature and header
+    output.assign(kSignature, kSignature + sizeof(kSignature));
+    uint8_t header[13];
+    putUint32(header, static_cast<uint32_t>(width));
+    putUint32(header + 4, static_cast<uint32_t>(height));
+    header[8] = 8;                               // Bit depth
+    header[9] = opaque ? 2 : 6;                  // Truecolor, with alpha unless opaque
+    header[10] = 0;                              // Deflate
+    header[11] = 0;                              // Adaptive filtering
+    header[12] = 0;                              // No interlace
+    appendChunk(output, "IHDR", header, sizeof(header));
+
+    // One zlib stream across the IDAT chunks: header, bands, then an empty
+    // final block and the checksum of everything the bands inflate to
+    const uint8_t streamHeader[2] = {0x78, 0x9C};
+    appendChunk(output, "IDAT", streamHeader, sizeof(streamHeader));
+    uLong adler = adler32(0L, Z_NULL, 0);
+    for (const PngBand& band : bands.bands) {
+        output.insert(output.end(), band.chunk.begin(), band.chunk.end());
+        adler = adler32_combine(adler, band.adler, static_cast<z_off_t>(band.filteredSize));
+    }
+    uint8_t trailer[6] = {0x03, 0x00};
+    putUint32(trailer + 2, static_cast<uint32_t>(adler));
+    appendChunk(output, "IDAT", trailer, sizeof(trailer));
+    appendChunk(output, "IEND", nullptr, 0);
+    return true;
+}
+
+} // namespace text2image
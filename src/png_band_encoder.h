@@ -0,0 +1,70 @@
+/*
+ * Text2Image PNG Band Encoder
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains a PNG encoder that deflates bands of rows independently,
+ * so a later encode of a mostly unchanged image can copy the bands it shares
+ * with the previous one instead of compressing them again.
+ */
+
+#ifndef TEXT2IMAGE_PNG_BAND_ENCODER_H
+#define TEXT2IMAGE_PNG_BAND_ENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace text2image {
+
+class ThreadPool;
+
+// One band of rows, wrapped as a complete IDAT chunk
+struct PngBand {
+    int top;
+    int rows;
+    bool opaque;                  // Every pixel has full alpha
+    uint32_t adler;               // Adler-32 of the filtered rows
+    size_t filteredSize;          // Bytes of filtered rows the chunk inflates to
+    std::vector<uint8_t> chunk;
+};
+
+// Bands of one encoded image
+struct PngBands {
+    int width;
+    int height;
+    int channels;                 // 3 for RGB, 4 for RGBA
+    std::vector<PngBand> bands;
+};
+
+class PngBandEncoder {
+public:
+    // Rows per band; smaller bands reuse more and compress slightly worse
+    static constexpr int kBandRows = 16;
+
+    // Encode premultiplied RGBA pixels as PNG. Bands of previous that lie
+    // outside every dirty row span [top, bottom) are copied, provided the
+    // size and color type still match. The bands of this image are returned
+    // in bands for the next encode. Dirty bands are compressed on pool when
+    // one is given.
+    static bool encode(const uint8_t* pixels, size_t rowBytes, int width, int height,
+                       const PngBands* previous, const std::vector<std::pair<int, int>>& dirtyRows,
+                       ThreadPool* pool, std::vector<uint8_t>& output, PngBands& bands);
+
+    // Append a chunk with its length and CRC
+    static void appendChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size);
+
+    // Unpremultiply a width x rows area at (left, top) into tightly packed
+    // RGBA; returns whether every pixel in it is opaque
+    static bool unpremultiply(const uint8_t* pixels, size_t rowBytes, int left, int top, int width, int rows,
+                              std::vector<uint8_t>& rgba);
+
+    // Filter and deflate tightly packed RGBA into one zlib stream, as PNG
+    // image data with 3 or 4 channels, for callers writing their own chunks
+    static bool compress(const std::vector<uint8_t>& rgba, int width, int height, int channels,
+                         std::vector<uint8_t>& stream);
+};
+
+} // namespace text2image
+
+#endif // TEXT2IMAGE_PNG_BAND_ENCODER_H
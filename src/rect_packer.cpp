@@ -0,0 +1,98 @@
+/*
+ * Text2Image Rect Packer Implementation
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the implementation of the RectPacker class.
+ */
+
+#include "rect_packer.h"
+
+#include <algorithm>
+#include <climits>
+
+namespace text2image {
+
+RectPacker::RectPacker(int width)
+    : m_width(width),
+      m_height(0) {
+    m_skyline.push_back(Segment{0, 0, width});
+}
+
+bool RectPacker::pack(int width, int height, int& x, int& y) {
+    if (width <= 0 || height <= 0 || width > m_width) {
+        return false;
+    }
+
+    // Try the rect's left edge at the start of every segment; its top is the
+    // highest skyline it spans. Ties go to the spot wasting least space below.
+    size_t best = m_skyline.size();
+    int bestY = INT_MAX;
+    long long bestWaste = LLONG_MAX;
+    for (size_t i = 0; i < m_skyline.size(); ++i) {
+        const int left = m_skyline[i].x;
+        if (left + width > m_width) {
+            break;
+        }
+
+        int top = 0;
+        int covered = 0;
+        for (size_t j = i; j < m_skyline.size() && covered < width; ++j) {
+            top = std::max(top, m_skyline[j].y);
+            covered = m_skyline[j].x + m_skyline[j].width - left;
+        }
+
+        long long waste = 0;
+        covered = 0;
+        for (size_t j = i; j < m_skyline.size() && covered < width; ++j) {
+            int span = std::min(m_skyline[j].x + m_skyline[j].width, left + width) - m_skyline[j].x;
+            waste += static_cast<long long>(top - m_skyline[j].y) * span;
+            covered = m_skyline[j].x + m_skyline[j].width - left;
+        }
+
+        if (top < bestY || (top == bestY && waste < bestWaste)) {
+            best = i;
+            bestY = top;
+            bestWaste = waste;
+        }
+    }
+    if (best == m_skyline.size()) {
+        return false;
+    }
+
+    x = m_skyline[best].x;
+    y = bestY;
+
+    // Raise the skyline under the rect and trim what it now overlaps
+    const int right = x + width;
+    std::vector<Segment> skyline;
+    skyline.reserve(m_skyline.size() + 2);
+    for (const Segment& segment : m_skyline) {
+        if (segment.x < x) {
+            skyline.push_back(Segment{segment.x, segment.y, std::min(segment.width, x - segment.x)});
+        }
+    }
+    skyline.push_back(Segment{x, y + height, width});
+    for (const Segment& segment : m_skyline) {
+        const int end = segment.x + segment.width;
+        if (end > right) {
+            const int start = std::max(segment.x, right);
+            skyline.push_back(Segment{start, segment.y, end - start});
+        }
+    }
+
+    // Neighbours at the same height become one segment
+    m_skyline.clear();
+    for (const Segment& segment : skyline) {
+        if (!m_skyline.empty() && m_skyline.back().y == segment.y) {
+            m_skyline.back().width += segment.width;
+        }
+        else {
+            m_skyline.push_back(segment);
+        }
+    }
+
+    m_height = std::max(m_height, y + height);
+    return true;
+}
+
+} // namespace text2image
@@ -0,0 +1,42 @@
+/*
+ * Text2Image Rect Packer
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the skyline packer that places atlas items in one
+ * surface.
+ */
+
+#ifndef TEXT2IMAGE_RECT_PACKER_H
+#define TEXT2IMAGE_RECT_PACKER_H
+
+#include <vector>
+
+namespace text2image {
+
+// Bottom-left skyline packer: each rect goes where its top edge ends up
+// lowest, over a strip of fixed width that grows downwards
+class RectPacker {
+public:
+    explicit RectPacker(int width);
+
+    // Place a width x height rect; fails only when it is wider than the strip
+    bool pack(int width, int height, int& x, int& y);
+
+    // Height used so far
+    int getHeight() const { return m_height; }
+
+private:
+    struct Segment {
+        int x;
+        int y;                // Top of the free space above this stretch
+        int width;
+    };
+
+    std::vector<Segment> m_skyline;
+    int m_width;
+    int m_height;
+};
+
+} // namespace text2image
+
+#endif // TEXT2IMAGE_RECT_PACKER_H
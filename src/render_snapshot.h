@@ -0,0 +1,41 @@
+/*
+ * Text2Image Render Snapshot
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains what an incremental render keeps once it finishes, so a
+ * later task can re-render only the areas whose content changed.
+ */
+
+#ifndef TEXT2IMAGE_RENDER_SNAPSHOT_H
+#define TEXT2IMAGE_RENDER_SNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <SkRect.h>
+
+#include "text2image.h"
+#include "display_list.h"
+#include "png_band_encoder.h"
+
+namespace text2image {
+
+struct RenderSnapshot {
+    int width;                    // In device pixels
+    int height;
+    SkScalar scale;               // Device pixels per CSS pixel
+    Text2Image_BackgroundType backgroundType;
+    uint32_t backgroundColor;
+    std::string backgroundImage;  // Copied; the options only point at caller memory
+    float backgroundBlur;
+    int borderRadius;
+    DisplayList content;          // Culled, as played back, in CSS pixels
+    SkRect cover;
+    std::vector<uint8_t> pixels;  // Premultiplied RGBA before border radius, width * 4 bytes per row
+    PngBands png;                 // No bands unless the output was PNG
+};
+
+} // namespace text2image
+
+#endif // TEXT2IMAGE_RENDER_SNAPSHOT_H
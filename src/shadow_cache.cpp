@@ -0,0 +1,199 @@
+/*
+ * Text2Image Shadow Cache Implementation
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the implementation of the ShadowCache class.
+ */
+
+#include "shadow_cache.h"
+
+#include <SkBlurTypes.h>
+#include <SkMaskFilter.h>
+#include <SkPaint.h>
+#include <SkRRect.h>
+#include <SkSurface.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace text2image {
+
+namespace {
+
+// CSS blur radius to Gaussian sigma
+SkScalar blurSigma(SkScalar blur) {
+    return blur / 2;
+}
+
+// Distance past the shape edge at which a Gaussian of this sigma is negligible
+int blurMargin(SkScalar sigma) {
+    return static_cast<int>(std::ceil(3 * sigma));
+}
+
+SkRect outset(const SkRect& rect, SkScalar amount) {
+    return SkRect::MakeLTRB(rect.fLeft - amount, rect.fTop - amount, rect.fRight + amount, rect.fBottom + amount);
+}
+
+} // namespace
+
+ShadowCache::ShadowCache(size_t maxEntries)
+    : m_maxEntries(maxEntries),
+      m_hits(0),
+      m_misses(0) {
+}
+
+ShadowCache::~ShadowCache() {
+}
+
+size_t ShadowCache::KeyHash::operator()(const Key& key) const {
+    uint64_t hash = 14695981039346656037ULL;
+    const uint32_t values[4] = {
+        static_cast<uint32_t>(key.radius), static_cast<uint32_t>(key.blur),
+        static_cast<uint32_t>(key.spread), key.color
+    };
+    for (uint32_t value : values) {
+        hash = (hash ^ value) * 1099511628211ULL;
+    }
+    return static_cast<size_t>(hash);
+}
+
+SkRect ShadowCache::shadowBounds(const SkRect& box, const BoxShadowSpec& shadow) {
+    SkScalar extent = shadow.spread + blurMargin(blurSigma(std::max(shadow.blur, 0.0f)));
+    return outset(box, extent).makeOffset(shadow.offsetX, shadow.offsetY);
+}
+
+void ShadowCache::drawShadow(SkCanvas* canvas, const SkRect& box, const BoxShadowSpec& shadow) {
+    if (SkColorGetA(shadow.color) == 0) {
+        return;
+    }
+
+    SkRect shape = outset(box, shadow.spread).makeOffset(shadow.offsetX, shadow.offsetY);
+    if (shape.isEmpty()) {
+        return;
+    }
+
+    Key key;
+    key.radius = shadow.radius > 0 ? std::max(0, static_cast<int>(std::lround(shadow.radius + shadow.spread))) : 0;
+    key.blur = std::max(0, static_cast<int>(std::lround(shadow.blur)));
+    key.spread = static_cast<int>(std::lround(shadow.spread));
+    key.color = shadow.color;
+
+    // Outer shadows never show through the box that casts them
+    canvas->save();
+    if (shadow.radius > 0) {
+        canvas->clipRRect(SkRRect::MakeRectXY(box, shadow.radius, shadow.radius), SkClipOp::kDifference, true);
+    }
+    else {
+        canvas->clipRect(box, SkClipOp::kDifference);
+    }
+
+    const int margin = blurMargin(blurSigma(static_cast<SkScalar>(key.blur)));
+    const SkScalar minimumSide = static_cast<SkScalar>(2 * (key.radius + margin) + 1);
+    if (key.blur == 0 || shape.width() < minimumSide || shape.height() < minimumSide) {
+        // Sharp shadows need no mask, and boxes smaller than the patch are cheap to blur
+        drawDirect(canvas, shape, static_cast<SkScalar>(key.radius), shadow);
+        canvas->restore();
+        return;
+    }
+
+    NinePatch patch;
+    bool found = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lruPosition);
+            patch = it->second.patch;
+            found = true;
+        }
+    }
+
+    if (found) {
+        ++m_hits;
+    }
+    else {
+        ++m_misses;
+
+        // Blur outside the lock so concurrent renders only serialize on lookups
+        patch = makeNinePatch(key);
+        if (!patch.image) {
+            drawDirect(canvas, shape, static_cast<SkScalar>(key.radius), shadow);
+            canvas->restore();
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            // A concurrent render got here first; either mask will do
+            it->second.patch = patch;
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lruPosition);
+        }
+        else {
+            m_lru.push_front(key);
+            m_entries.emplace(key, CacheEntry{patch, m_lru.begin()});
+            while (m_entries.size() > m_maxEntries && !m_lru.empty()) {
+                m_entries.erase(m_lru.back());
+                m_lru.pop_back();
+            }
+        }
+    }
+
+    // Corners and edges keep their size; the one-pixel center row and column stretch
+    SkIRect center = SkIRect::MakeXYWH(patch.inset, patch.inset, 1, 1);
+    canvas->drawImageNine(patch.image.get(), center, outset(shape, static_cast<SkScalar>(patch.margin)), SkFilterMode::kLinear);
+    canvas->restore();
+}
+
+void ShadowCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_lru.clear();
+}
+
+ShadowCache::NinePatch ShadowCache::makeNinePatch(const Key& key) {
+    NinePatch patch;
+    const SkScalar sigma = blurSigma(static_cast<SkScalar>(key.blur));
+    patch.margin = blurMargin(sigma);
+
+    // The center row and column sit a full blur margin away from the corner
+    // arcs, so they look like the edge of an arbitrarily long box
+    const int shapeSide = 2 * (key.radius + patch.margin) + 1;
+    const int imageSide = shapeSide + 2 * patch.margin;
+    patch.inset = patch.margin + key.radius + patch.margin;
+
+    sk_sp<SkSurface> surface = SkSurface::MakeRaster(SkImageInfo::MakeN32Premul(imageSide, imageSide));
+    if (!surface) {
+        return patch;
+    }
+
+    SkCanvas* canvas = surface->getCanvas();
+    canvas->clear(SK_ColorTRANSPARENT);
+
+    SkPaint paint;
+    paint.setAntiAlias(true);
+    paint.setColor(key.color);
+    paint.setMaskFilter(SkMaskFilter::MakeBlur(kNormal_SkBlurStyle, sigma));
+    SkRect shape = SkRect::MakeXYWH(patch.margin, patch.margin, shapeSide, shapeSide);
+    canvas->drawRRect(SkRRect::MakeRectXY(shape, key.radius, key.radius), paint);
+
+    patch.image = surface->makeImageSnapshot();
+    return patch;
+}
+
+void ShadowCache::drawDirect(SkCanvas* canvas, const SkRect& shape, SkScalar radius, const BoxShadowSpec& shadow) {
+    SkPaint paint;
+    paint.setAntiAlias(true);
+    paint.setColor(shadow.color);
+    if (shadow.blur > 0) {
+        paint.setMaskFilter(SkMaskFilter::MakeBlur(kNormal_SkBlurStyle, blurSigma(shadow.blur)));
+    }
+    if (radius > 0) {
+        canvas->drawRRect(SkRRect::MakeRectXY(shape, radius, radius), paint);
+    }
+    else {
+        canvas->drawRect(shape, paint);
+    }
+}
+
+} // namespace text2image
@@ -0,0 +1,95 @@
+/*
+ * Text2Image Shadow Cache
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the cache of pre-blurred nine-patch masks used to draw
+ * CSS box shadows without blurring a full-size layer on every render.
+ */
+
+#ifndef TEXT2IMAGE_SHADOW_CACHE_H
+#define TEXT2IMAGE_SHADOW_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include <SkCanvas.h>
+#include <SkImage.h>
+#include <SkRect.h>
+
+namespace text2image {
+
+// Outer box shadow of one box, in CSS pixels
+struct BoxShadowSpec {
+    SkScalar offsetX;
+    SkScalar offsetY;
+    SkScalar blur;            // CSS blur radius; the Gaussian sigma is half of it
+    SkScalar spread;
+    SkScalar radius;          // Border radius of the casting box
+    SkColor color;
+};
+
+class ShadowCache {
+public:
+    explicit ShadowCache(size_t maxEntries = 128);
+    ~ShadowCache();
+
+    // Draw the shadow cast by box. The shadow is clipped out of the box itself,
+    // as CSS outer shadows are.
+    void drawShadow(SkCanvas* canvas, const SkRect& box, const BoxShadowSpec& shadow);
+
+    // Area the shadow of box may touch
+    static SkRect shadowBounds(const SkRect& box, const BoxShadowSpec& shadow);
+
+    // Cache statistics
+    size_t getHits() const { return m_hits; }
+    size_t getMisses() const { return m_misses; }
+
+    void clear();
+
+private:
+    // Shapes are rasterized at whole-pixel sizes, so keys are quantized the same way
+    struct Key {
+        int radius;           // Corner radius after spread
+        int blur;
+        int spread;
+        SkColor color;
+
+        bool operator==(const Key& other) const {
+            return radius == other.radius && blur == other.blur && spread == other.spread && color == other.color;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    // Blurred rounded square whose edges are flat at the center row and column
+    struct NinePatch {
+        sk_sp<SkImage> image;
+        int inset;            // Width of the fixed border slices
+        int margin;           // Blur extent outside the shape
+    };
+
+    struct CacheEntry {
+        NinePatch patch;
+        std::list<Key>::iterator lruPosition;
+    };
+
+    static NinePatch makeNinePatch(const Key& key);
+    static void drawDirect(SkCanvas* canvas, const SkRect& shape, SkScalar radius, const BoxShadowSpec& shadow);
+
+    std::unordered_map<Key, CacheEntry, KeyHash> m_entries;
+    std::list<Key> m_lru;  // Most recently used first
+    size_t m_maxEntries;
+    std::atomic<size_t> m_hits;
+    std::atomic<size_t> m_misses;
+    std::mutex m_mutex;
+};
+
+} // namespace text2image
+
+#endif // TEXT2IMAGE_SHADOW_CACHE_H
@@ -6,29 +6,89 @@
  */
 
 #include "text2image_internal.h"
+#include "css_parser.h"
+#include "markdown_parser.h"
+#include "syntax_highlighter.h"
+#include "style_resolver.h"
+#include "layout_engine.h"
+#include "compiled_document.h"
+#include "png_band_encoder.h"
+#include "render_snapshot.h"
+#include "rect_packer.h"
+#include "animation_encoder.h"
+#include "image_downsampler.h"
+#include "text_normalizer.h"
 
 #include <SkCanvas.h>
 #include <SkDocument.h>
 #include <SkPaint.h>
+#include <SkMatrix.h>
 #include <SkPath.h>
+#include <SkRRect.h>
+#include <SkRegion.h>
 #include <SkStream.h>
 #include <SkSurface.h>
 #include <SkTypeface.h>
 #include <SkFont.h>
+#include <SkFontMetrics.h>
+#include <SkGraphics.h>
 #include <SkTextBlob.h>
 #include <SkImage.h>
+#include <SkPixmap.h>
+#include <SkPngEncoder.h>
+#include <SkWebpEncoder.h>
 #include <SkCodec.h>
 #include <SkData.h>
 
 #include <libxml/HTMLparser.h>
 #include <libxml/css.h>
 
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <sstream>
-#include <regex>
 
 namespace text2image {
 
+// Style resolved once per stylesheet for the plain-text fast path
+struct PlainTextStyle {
+    SkFont fonts[4];          // Indexed by PlainTextRun::fontIndex
+    SkScalar spaceWidths[4];  // Width of U+0020 in each font
+    std::shared_ptr<FontFallbackMap> fallbacks[4];  // For characters each font lacks
+    SkColor color;
+    SkScalar lineHeight;
+    SkScalar baseline;        // Baseline offset from the top of a line box
+    SkScalar inset;           // Margin plus padding of html and body
+    bool modeled;             // Every rule applied; AUTO input needs the HTML path otherwise
+};
+
+// Parsed document and stylesheet of one render. Each render owns its own,
+// so renders running on different threads share no parser state.
+struct RenderDocument {
+    xmlDocPtr doc;
+    std::unique_ptr<StyleResolver> styles;
+
+    RenderDocument() : doc(nullptr) {}
+    ~RenderDocument() {
+        if (doc) {
+            xmlFreeDoc(doc);
+        }
+    }
+
+    RenderDocument(const RenderDocument&) = delete;
+    RenderDocument& operator=(const RenderDocument&) = delete;
+};
+
+// Styled text run produced by the plain-text scanner
+struct PlainTextRun {
+    std::string text;
+    int fontIndex;            // Bit 0: bold, bit 1: italic
+    bool lineBreak;           // Forced line break after this run
+};
+
 // SkiaRenderEngine implementation details
 class SkiaRenderEngine::Impl {
 public:
@@ -38,45 +98,284 @@ public:
     bool initialize();
     void shutdown();
     bool render(std::shared_ptr<Task> task);
+    bool compile(std::shared_ptr<Task> task, const std::string& outputPath);
+
+    // Image fetching, font cache budget and statistics
+    void setResourceResolver(ResourceResolver resolver);
+    bool setLocalImageDirectory(const std::string& directory);
+    void setFontCacheLimits(size_t byteLimit, int countLimit);
+    void purgeFontCache();
+    void getMetrics(Text2Image_Metrics& metrics);
+
+    // Text measurement, sharing the layout engine's fonts and line breaking
+    void measureText(const char* const* texts, int count, const Text2Image_FontSpec& font, float maxWidth,
+                     Text2Image_TextMetrics* metrics);
 
 private:
+    // Compiled documents
+    bool renderCompiled(std::shared_ptr<Task> task);
+
+    // Atlas tasks: many small documents in one surface
+    bool renderAtlas(std::shared_ptr<Task> task);
+    bool drawAtlasItem(SkCanvas* canvas, const AtlasItem& item, const Text2Image_RenderOptions& options);
+    
+    // Incremental rendering: redraw what changed since the base task
+    bool renderIncremental(std::shared_ptr<Task> task, int width, int height, SkScalar scale, DisplayList& content,
+                           const SkRect& cover);
+
+    // Animation tasks: each frame stores only the area that changed
+    bool renderAnimation(std::shared_ptr<Task> task);
+    bool parseFrame(const std::string& html, const std::string& css, const Text2Image_RenderOptions& options,
+                    RenderDocument& document);
+
+    // Thumbnail tasks: the finished surface and smaller copies of it, one page each
+    bool encodeThumbnails(std::shared_ptr<Task> task, const sk_sp<SkSurface>& surface, SkEncodedImageFormat format, bool draft);
+
+    // Plain-text fast path
+    bool scanPlainText(const std::string& input, bool strict, std::vector<PlainTextRun>& runs);
+    std::shared_ptr<const PlainTextStyle> getPlainTextStyle(const std::string& css);
+    void renderPlainText(SkCanvas* canvas, int width, int height, const PlainTextStyle& style, const std::vector<PlainTextRun>& runs);
+
     // HTML parsing and rendering
-    bool parseHtml(const std::string& html, const std::string& css);
-    bool renderHtmlToCanvas(SkCanvas* canvas, int width, int height, const Text2Image_RenderOptions& options);
+    bool parseHtml(const std::string& html, const std::string& css, RenderDocument& document);
+    bool parseMarkdown(const std::string& markdown, const std::string& css, RenderDocument& document);
+    bool parsePlainText(const std::vector<PlainTextRun>& runs, const std::string& css, RenderDocument& document);
+    bool recordHtml(const RenderDocument& document, int width, int height, DisplayList& list, SkScalar imageScale = 1);
+
+    // Pagination
+    bool renderPages(const RenderDocument& document, int width, int height, SkScalar scale,
+                     const Text2Image_RenderOptions& options, std::vector<std::vector<uint8_t>>& pages);
     
-    // Background handling
-    bool drawBackground(SkCanvas* canvas, int width, int height, const Text2Image_RenderOptions& options);
+    // Background handling; nothing is drawn inside cover, which content hides
+    bool drawBackground(SkCanvas* canvas, int width, int height, const Text2Image_RenderOptions& options,
+                        const SkRect& cover = SkRect::MakeEmpty());
+
+    // Debug output: write counts instead of content
+    void drawOverdraw(SkCanvas* canvas, int width, int height, const DisplayListView& content, const SkRect& cover);
     
-    // Image format conversion
-    bool encodeImage(SkCanvas* canvas, SkEncodedImageFormat format, int quality, std::vector<uint8_t>& output);
+    // Output rounding and image format conversion
+    sk_sp<SkSurface> applyBorderRadius(sk_sp<SkSurface> surface, const SkImageInfo& info, int borderRadius);
+    // Drafts use the fastest encoder settings instead of the smallest output
+    bool encodeImage(SkCanvas* canvas, SkEncodedImageFormat format, int quality, std::vector<uint8_t>& output,
+                     bool draft = false);
+    bool encodeImage(const sk_sp<SkImage>& image, SkEncodedImageFormat format, int quality, std::vector<uint8_t>& output,
+                     bool draft = false);
     
     // CSS parsing
-    bool parseCss(const std::string& css);
+    bool parseCss(const std::string& css, RenderDocument& document);
     
     // Font loading
     sk_sp<SkTypeface> loadFont(const std::string& fontFamily, int weight, bool italic);
     
-    // HTML element rendering
-    void renderElement(SkCanvas* canvas, xmlNode* node, int x, int y, int width);
-    
-    // Code highlighting
-    std::string highlightCode(const std::string& code, const std::string& language);
-    
     // Image loading
     sk_sp<SkImage> loadImage(const std::string& path);
     
     // Members
-    xmlDocPtr m_htmlDoc;
-    std::unordered_map<std::string, std::string> m_cssRules;
     std::vector<sk_sp<SkTypeface>> m_loadedFonts;
+
+    // Plain-text styles keyed by stylesheet text
+    std::unordered_map<std::string, std::shared_ptr<const PlainTextStyle>> m_plainTextStyles;
+    std::mutex m_plainTextStylesMutex;
+
+    // Token spans for code blocks, shared across renders
+    SyntaxHighlighter m_highlighter;
+
+    // Box layout and painting for parsed documents
+    LayoutEngine m_layoutEngine;
+
+    // Interns the styles text is measured in; it has no rules, so it is never replaced
+    StyleResolver m_measureStyles;
+
+    // Font cache purges requested through the API
+    std::atomic<uint64_t> m_fontCachePurges;
+};
+
+namespace {
+
+// Upper bound on cached plain-text styles before the cache is reset
+const size_t kMaxPlainTextStyles = 64;
+
+// Upper bound on pages produced by one paginated render
+const size_t kMaxPages = 256;
+
+// Strings measured per pool task; smaller batches stay on the calling thread
+const size_t kMeasureBatchSize = 256;
+
+// Upper bound on tasks one measurement batch is split into
+const size_t kMaxMeasureTasks = 16;
+
+// Transparent gap between atlas items, so sampling one never picks up its neighbour
+const int kAtlasPadding = 1;
+
+// Place every item in one sheet. The sheet is about square, and never
+// narrower than the widest item.
+bool packAtlas(const std::vector<AtlasItem>& items, std::vector<Text2Image_AtlasRect>& rects, int& width, int& height) {
+    int widest = 0;
+    double area = 0;
+    for (const AtlasItem& item : items) {
+        widest = std::max(widest, item.width + kAtlasPadding);
+        area += static_cast<double>(item.width + kAtlasPadding) * (item.height + kAtlasPadding);
+    }
+    const int side = std::min(kMaxAtlasSide + kAtlasPadding,
+                              std::max(widest, static_cast<int>(std::ceil(std::sqrt(area * 1.1)))));
+    
+    // Tall items first leaves the flattest skyline
+    std::vector<size_t> order(items.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return items[a].height != items[b].height ? items[a].height > items[b].height : items[a].width > items[b].width;
+    });
+    
+    RectPacker packer(side);
+    rects.assign(items.size(), Text2Image_AtlasRect());
+    width = 0;
+    for (size_t index : order) {
+        Text2Image_AtlasRect& rect = rects[index];
+        rect.width = items[index].width;
+        rect.height = items[index].height;
+        if (!packer.pack(rect.width + kAtlasPadding, rect.height + kAtlasPadding, rect.x, rect.y)) {
+            return false;
+        }
+        width = std::max(width, rect.x + rect.width);
+    }
+    height = packer.getHeight() - kAtlasPadding;
+    return height <= kMaxAtlasSide;
+}
+
+// Draft renders lay out at full size and rasterize at this fraction of it
+const SkScalar kDraftScale = 0.5f;
+
+// Largest device pixel ratio honored; larger ratios are clamped to it
+const SkScalar kMaxDevicePixelRatio = 4;
+
+// Device pixels per CSS pixel the options ask for
+SkScalar devicePixelRatio(const Text2Image_RenderOptions& options) {
+    if (!(options.devicePixelRatio > 0)) {
+        return 1;
+    }
+    return std::min(static_cast<SkScalar>(options.devicePixelRatio), kMaxDevicePixelRatio);
+}
+
+// Surface side covering size CSS pixels drawn at scale
+int scaledSize(int size, SkScalar scale) {
+    return std::max(1, static_cast<int>(std::ceil(size * scale)));
+}
+
+// Border radius in surface pixels
+int scaledRadius(int radius, SkScalar scale) {
+    return static_cast<int>(std::lround(radius * scale));
+}
+
+// Overdraw maps add this much alpha per write, so up to 15 writes are told apart
+const uint8_t kOverdrawStep = 0x10;
+
+// Overdraw map colors by write count; the last entry covers every count past it
+const uint8_t kOverdrawColors[][3] = {
+    {0xFF, 0xFF, 0xFF},  // Never written
+    {0x6F, 0x8F, 0xFF},  // Once
+    {0x6F, 0xDF, 0x6F},  // Twice
+    {0xFF, 0x8F, 0xCF},  // Three times
+    {0xFF, 0x4F, 0x4F}   // Four or more
+};
+
+SkEncodedImageFormat toEncodedImageFormat(Text2Image_Format format) {
+    switch (format) {
+        case TEXT2IMAGE_FORMAT_PNG:
+            return SkEncodedImageFormat::kPNG;
+        case TEXT2IMAGE_FORMAT_JPG:
+            return SkEncodedImageFormat::kJPEG;
+        case TEXT2IMAGE_FORMAT_WEBP:
+            return SkEncodedImageFormat::kWEBP;
+        case TEXT2IMAGE_FORMAT_BMP:
+            return SkEncodedImageFormat::kBMP;
+        case TEXT2IMAGE_FORMAT_TIF:
+            return SkEncodedImageFormat::kTIFF;
+        default:
+            return SkEncodedImageFormat::kPNG;
+    }
+}
+
+// Output size for the resolution options
+void canvasSize(const Text2Image_RenderOptions& options, int& width, int& height) {
+    if (options.resolution == TEXT2IMAGE_RESOLUTION_AUTO) {
+        // Auto-detect size based on content
+        // For now, use custom dimensions or default to 800x600
+        width = options.customWidth > 0 ? options.customWidth : 800;
+        height = options.customHeight > 0 ? options.customHeight : 600;
+        return;
+    }
+    
+    // Use predefined resolution
+    switch (options.resolution) {
+        case TEXT2IMAGE_RESOLUTION_720P:
+            width = 1280;
+            height = 720;
+            break;
+        case TEXT2IMAGE_RESOLUTION_1080P:
+            width = 1920;
+            height = 1080;
+            break;
+        case TEXT2IMAGE_RESOLUTION_2K:
+            width = 2560;
+            height = 1440;
+            break;
+        case TEXT2IMAGE_RESOLUTION_4K:
+            width = 3840;
+            height = 2160;
+            break;
+        case TEXT2IMAGE_RESOLUTION_8K:
+            width = 7680;
+            height = 4320;
+            break;
+        default:
+            width = 800;
+            height = 600;
+            break;
+    }
+}
+
+// Tags understood by the plain-text scanner
+enum class PlainTextTag {
+    UNSUPPORTED,
+    BREAK,
+    BOLD,
+    ITALIC
+};
+
+PlainTextTag classifyPlainTextTag(const std::string& name) {
+    if (name == "br") return PlainTextTag::BREAK;
+    if (name == "b" || name == "strong") return PlainTextTag::BOLD;
+    if (name == "i" || name == "em") return PlainTextTag::ITALIC;
+    return PlainTextTag::UNSUPPORTED;
+}
+
+// CJK ideographs, kana, hangul and fullwidth forms break between any two characters
+bool isCjkCodepoint(uint32_t c) {
+    return (c >= 0x2E80 && c <= 0x9FFF) ||
+           (c >= 0xAC00 && c <= 0xD7AF) ||
+           (c >= 0xF900 && c <= 0xFAFF) ||
+           (c >= 0xFF00 && c <= 0xFFEF) ||
+           (c >= 0x20000 && c <= 0x2FFFF);
+}
+
+// A positioned piece of a plain-text line
+struct PlainTextSegment {
+    const char* text;
+    size_t length;
+    int fontIndex;
+    SkScalar x;
+    int line;
 };
 
+} // namespace
+
 SkiaRenderEngine::SkiaRenderEngine()
     : m_impl(new Impl()) {
 }
 
 SkiaRenderEngine::~SkiaRenderEngine() {
-    delete m_impl;
 }
 
 bool SkiaRenderEngine::initialize() {
@@ -91,10 +390,41 @@ bool SkiaRenderEngine::render(std::shared_ptr<Task> task) {
     return m_impl->render(task);
 }
 
+bool SkiaRenderEngine::compile(std::shared_ptr<Task> task, const std::string& outputPath) {
+    return m_impl->compile(task, outputPath);
+}
+
+void SkiaRenderEngine::setResourceResolver(std::function<bool(const std::string&, std::vector<uint8_t>&)> resolver) {
+    m_impl->setResourceResolver(std::move(resolver));
+}
+
+bool SkiaRenderEngine::setLocalImageDirectory(const std::string& directory) {
+    return m_impl->setLocalImageDirectory(directory);
+}
+
+void SkiaRenderEngine::setFontCacheLimits(size_t byteLimit, int countLimit) {
+    m_impl->setFontCacheLimits(byteLimit, countLimit);
+}
+
+void SkiaRenderEngine::purgeFontCache() {
+    m_impl->purgeFontCache();
+}
+
+void SkiaRenderEngine::getMetrics(Text2Image_Metrics& metrics) {
+    m_impl->getMetrics(metrics);
+}
+
+void SkiaRenderEngine::measureText(const char* const* texts, int count, const Text2Image_FontSpec& font, float maxWidth,
+                                   Text2Image_TextMetrics* metrics) {
+    m_impl->measureText(texts, count, font, maxWidth, metrics);
+}
+
 // Impl class implementation
 
 SkiaRenderEngine::Impl::Impl()
-    : m_htmlDoc(nullptr) {
+    : m_layoutEngine(m_highlighter),
+      m_measureStyles(std::string()),
+      m_fontCachePurges(0) {
 }
 
 SkiaRenderEngine::Impl::~Impl() {
@@ -106,6 +436,13 @@ bool SkiaRenderEngine::Impl::initialize() {
         // Initialize libxml2
         xmlInitParser();
         
+        // Large documents lay out independent blocks on the shared pool
+        m_layoutEngine.setThreadPool(&LibraryContext::getInstance().getThreadPool());
+        
+        // Map the font coverage index, scanning the installed fonts only when it is missing or stale;
+        // without it text still renders, in each style's own font
+        m_layoutEngine.getFontFallback().initialize(FontCoverageIndex::defaultPath());
+        
         // Load default fonts
         // In a real implementation, we would load system fonts here
         sk_sp<SkTypeface> defaultFont = SkTypeface::MakeDefault();
@@ -126,15 +463,6 @@ bool SkiaRenderEngine::Impl::initialize() {
 }
 
 void SkiaRenderEngine::Impl::shutdown() {
-    // Clean up HTML document if it exists
-    if (m_htmlDoc) {
-        xmlFreeDoc(m_htmlDoc);
-        m_htmlDoc = nullptr;
-    }
-    
-    // Clear CSS rules
-    m_cssRules.clear();
-    
     // Clear loaded fonts
     m_loadedFonts.clear();
     
@@ -142,128 +470,229 @@ void SkiaRenderEngine::Impl::shutdown() {
     xmlCleanupParser();
 }
 
+void SkiaRenderEngine::Impl::setResourceResolver(ResourceResolver resolver) {
+    m_layoutEngine.getImageCache().setResolver(std::move(resolver));
+}
+
+bool SkiaRenderEngine::Impl::setLocalImageDirectory(const std::string& directory) {
+    return m_layoutEngine.getImageCache().setLocalDirectory(directory);
+}
+
+void SkiaRenderEngine::Impl::setFontCacheLimits(size_t byteLimit, int countLimit) {
+    // Lowering a limit purges down to it right away
+    if (byteLimit > 0) {
+        SkGraphics::SetFontCacheLimit(byteLimit);
+    }
+    if (countLimit > 0) {
+        SkGraphics::SetFontCacheCountLimit(countLimit);
+    }
+}
+
+void SkiaRenderEngine::Impl::purgeFontCache() {
+    SkGraphics::PurgeFontCache();
+    m_fontCachePurges.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SkiaRenderEngine::Impl::getMetrics(Text2Image_Metrics& metrics) {
+    // Skia counts no strike lookups; its cache is described by what it holds
+    metrics.fontCacheBytesUsed = SkGraphics::GetFontCacheUsed();
+    metrics.fontCacheByteLimit = SkGraphics::GetFontCacheLimit();
+    metrics.fontCacheCountUsed = SkGraphics::GetFontCacheCountUsed();
+    metrics.fontCacheCountLimit = SkGraphics::GetFontCacheCountLimit();
+    metrics.fontCachePurges = m_fontCachePurges.load(std::memory_order_relaxed);
+
+    FontCacheStats stats = m_layoutEngine.getFontCacheStats();
+    metrics.typefaceHits = stats.typefaceHits;
+    metrics.typefaceMisses = stats.typefaceMisses;
+    metrics.typefaceEvictions = stats.typefaceEvictions;
+    metrics.glyphTableHits = stats.glyphTableHits;
+    metrics.glyphTableMisses = stats.glyphTableMisses;
+    metrics.glyphTableEvictions = stats.glyphTableEvictions;
+    metrics.fallbackPagesBuilt = stats.fallbackPagesBuilt;
+    metrics.fallbackTypefacesOpened = stats.fallbackTypefacesOpened;
+}
+
+void SkiaRenderEngine::Impl::measureText(const char* const* texts, int count, const Text2Image_FontSpec& font, float maxWidth,
+                                         Text2Image_TextMetrics* metrics) {
+    ComputedStyle style;
+    style.fontFamily = font.fontFamily ? font.fontFamily : "";
+    style.fontSize = font.fontSize;
+    style.fontWeight = font.fontWeight > 0 ? std::max(100, std::min(900, font.fontWeight)) : 400;
+    style.italic = font.italic;
+    style.lineHeightScale = font.lineHeight > 0 ? font.lineHeight : 1.2f;
+    style.lineHeight = style.fontSize * style.lineHeightScale;
+    std::shared_ptr<const ComputedStyle> interned = m_measureStyles.intern(style);
+
+    // Large batches are cut into contiguous runs, each measured with its own layout context
+    const size_t total = static_cast<size_t>(count);
+    const size_t tasks = std::max<size_t>(1, std::min(kMaxMeasureTasks, total / kMeasureBatchSize));
+    auto measureRun = [&](size_t task) {
+        const size_t begin = total * task / tasks;
+        const size_t end = total * (task + 1) / tasks;
+        std::vector<TextMeasurement> results(end - begin);
+        m_layoutEngine.measureText(m_measureStyles, interned, texts + begin, end - begin, maxWidth, results.data());
+
+        for (size_t i = 0; i < results.size(); ++i) {
+            const TextMeasurement& result = results[i];
+            Text2Image_TextMetrics& out = metrics[begin + i];
+            out.width = result.width;
+            out.height = result.height;
+            out.lineCount = static_cast<int>(result.lineEnds.size());
+            if (out.lineEnds) {
+                const size_t copied = std::min(result.lineEnds.size(), static_cast<size_t>(std::max(0, out.lineEndCapacity)));
+                std::copy(result.lineEnds.begin(), result.lineEnds.begin() + copied, out.lineEnds);
+            }
+        }
+    };
+    if (tasks > 1) {
+        LibraryContext::getInstance().getThreadPool().parallelFor(tasks, measureRun);
+    }
+    else {
+        measureRun(0);
+    }
+}
+
 bool SkiaRenderEngine::Impl::render(std::shared_ptr<Task> task) {
+    // Compiled documents carry their layout; only painting and encoding remain
+    if (task->getCompiled()) {
+        return renderCompiled(task);
+    }
+    if (!task->getAtlasItems().empty()) {
+        return renderAtlas(task);
+    }
+    if (!task->getFrames().empty()) {
+        return renderAnimation(task);
+    }
+    
     try {
         const std::string& html = task->getHtml();
         const std::string& css = task->getCss();
         const Text2Image_RenderOptions& options = task->getOptions();
         
-        // Parse HTML and CSS
-        if (!parseHtml(html, css)) {
+        // Plain text and minimal markup skip libxml2 entirely
+        RenderDocument document;
+        std::vector<PlainTextRun> plainTextRuns;
+        bool plainText = false;
+        if (options.inputFormat == TEXT2IMAGE_INPUT_PLAIN_TEXT) {
+            plainText = scanPlainText(html, false, plainTextRuns);
+        }
+        else if (options.inputFormat == TEXT2IMAGE_INPUT_AUTO) {
+            plainText = scanPlainText(html, true, plainTextRuns);
+        }
+
+        // Pagination, incremental renders and overdraw maps need a box tree, so scanned text becomes a
+        // minimal document
+        const bool incremental = options.incremental && !options.paginate && !options.debugOverdraw;
+        const bool recordText = options.paginate || incremental || options.debugOverdraw;
+        
+        // Drawn directly, AUTO input stays on the fast path only if no rule would be ignored
+        if (plainText && options.inputFormat == TEXT2IMAGE_INPUT_AUTO && !recordText &&
+            !getPlainTextStyle(css)->modeled) {
+            plainText = false;
+        }
+        
+        if (plainText && recordText) {
+            if (!parsePlainText(plainTextRuns, css, document)) {
+                task->setErrorMessage("Failed to build plain-text document");
+                return false;
+            }
+        }
+        // Parse the document and CSS
+        else if (options.inputFormat == TEXT2IMAGE_INPUT_MARKDOWN) {
+            if (!parseMarkdown(html, css, document)) {
+                task->setErrorMessage("Failed to parse Markdown/CSS");
+                return false;
+            }
+        }
+        else if (!plainText && !parseHtml(html, css, document)) {
             task->setErrorMessage("Failed to parse HTML/CSS");
             return false;
         }
         
-        // Determine canvas size
+        // Determine canvas size, in CSS pixels
         int width, height;
-        if (options.resolution == TEXT2IMAGE_RESOLUTION_AUTO) {
-            // Auto-detect size based on content
-            // For now, use custom dimensions or default to 800x600
-            width = options.customWidth > 0 ? options.customWidth : 800;
-            height = options.customHeight > 0 ? options.customHeight : 600;
+        canvasSize(options, width, height);
+        
+        // Layout stays in CSS pixels; the surface has ratio device pixels for each.
+        // Overdraw maps count CSS pixels.
+        const SkScalar ratio = options.debugOverdraw ? 1 : devicePixelRatio(options);
+        
+        // Paginated output: one layout, one buffer per page
+        if (options.paginate) {
+            std::vector<std::vector<uint8_t>> pages;
+            if (!renderPages(document, width, height, ratio, options, pages)) {
+                task->setErrorMessage("Failed to render pages");
+                return false;
+            }
+            task->setPages(std::move(pages));
+            return true;
         }
-        else {
-            // Use predefined resolution
-            switch (options.resolution) {
-                case TEXT2IMAGE_RESOLUTION_720P:
-                    width = 1280;
-                    height = 720;
-                    break;
-                case TEXT2IMAGE_RESOLUTION_1080P:
-                    width = 1920;
-                    height = 1080;
-                    break;
-                case TEXT2IMAGE_RESOLUTION_2K:
-                    width = 2560;
-                    height = 1440;
-                    break;
-                case TEXT2IMAGE_RESOLUTION_4K:
-                    width = 3840;
-                    height = 2160;
-                    break;
-                case TEXT2IMAGE_RESOLUTION_8K:
-                    width = 7680;
-                    height = 4320;
-                    break;
-                default:
-                    width = 800;
-                    height = 600;
-                    break;
+
+        // Documents are recorded first so the background can skip what they hide
+        DisplayList content;
+        SkRect cover = SkRect::MakeEmpty();
+        if (!plainText || recordText) {
+            if (!recordHtml(document, width, height, content, ratio)) {
+                task->setErrorMessage("Failed to render HTML");
+                return false;
             }
+            cover = content.cullOccluded().cover;
+        }
+        
+        if (incremental) {
+            return renderIncremental(task, width, height, ratio, content, cover);
         }
         
+        // Drafts keep the full-size layout, so lines break where the full render breaks them
+        const bool draft = options.renderQuality == TEXT2IMAGE_RENDER_QUALITY_DRAFT && !options.debugOverdraw;
+        const SkScalar scale = draft ? ratio * kDraftScale : ratio;
+        
         // Create Skia surface
-        SkImageInfo info = SkImageInfo::Make(width, height, kRGBA_8888_SkColorType, kPremul_SkAlphaType);
+        SkImageInfo info = SkImageInfo::Make(scaledSize(width, scale), scaledSize(height, scale),
+                                             kRGBA_8888_SkColorType, kPremul_SkAlphaType);
         sk_sp<SkSurface> surface = SkSurface::MakeRaster(info);
         if (!surface) {
             task->setErrorMessage("Failed to create Skia surface");
             return false;
         }
         
+        // Glyphs and paths rasterize at the surface resolution, not stretched from CSS pixels
         SkCanvas* canvas = surface->getCanvas();
-        
-        // Draw background
-        if (!drawBackground(canvas, width, height, options)) {
-            task->setErrorMessage("Failed to draw background");
-            return false;
+        if (scale != 1) {
+            canvas->scale(scale, scale);
         }
         
-        // Render HTML to canvas
-        if (!renderHtmlToCanvas(canvas, width, height, options)) {
-            task->setErrorMessage("Failed to render HTML");
-            return false;
+        if (options.debugOverdraw) {
+            drawOverdraw(canvas, width, height, content.view(), cover);
         }
-        
-        // Apply border radius if needed
-        if (options.borderRadius > 0) {
-            // Create a new surface with rounded corners
-            SkPath path;
-            path.addRoundRect(SkRect::MakeWH(width, height), options.borderRadius, options.borderRadius);
-            
-            sk_sp<SkSurface> roundedSurface = SkSurface::MakeRaster(info);
-            SkCanvas* roundedCanvas = roundedSurface->getCanvas();
-            
-            // Clear the canvas
-            roundedCanvas->clear(SK_ColorTRANSPARENT);
-            
-            // Clip to rounded rectangle
-            roundedCanvas->clipPath(path, true);
-            
-            // Draw the original surface
-            sk_sp<SkImage> image = surface->makeImageSnapshot();
-            roundedCanvas->drawImage(image, 0, 0);
+        else {
+            // Draw background
+            if (!drawBackground(canvas, width, height, options, cover)) {
+                task->setErrorMessage("Failed to draw background");
+                return false;
+            }
             
-            // Replace the original surface with the rounded one
-            surface = roundedSurface;
+            // Render content to canvas
+            if (plainText) {
+                renderPlainText(canvas, width, height, *getPlainTextStyle(css), plainTextRuns);
+            }
+            else {
+                m_layoutEngine.playback(canvas, content, draft);
+            }
         }
         
+        // Apply border radius if needed
+        surface = applyBorderRadius(surface, info, scaledRadius(options.borderRadius, scale));
+        
         // Encode the image
-        SkEncodedImageFormat format;
-        switch (options.format) {
-            case TEXT2IMAGE_FORMAT_PNG:
-                format = SkEncodedImageFormat::kPNG;
-                break;
-            case TEXT2IMAGE_FORMAT_JPG:
-            case TEXT2IMAGE_FORMAT_JPEG:
-                format = SkEncodedImageFormat::kJPEG;
-                break;
-            case TEXT2IMAGE_FORMAT_WEBP:
-                format = SkEncodedImageFormat::kWEBP;
-                break;
-            case TEXT2IMAGE_FORMAT_BMP:
-                format = SkEncodedImageFormat::kBMP;
-                break;
-            case TEXT2IMAGE_FORMAT_TIF:
-            case TEXT2IMAGE_FORMAT_TIFF:
-                format = SkEncodedImageFormat::kTIFF;
-                break;
-            default:
-                format = SkEncodedImageFormat::kPNG;
-                break;
+        SkEncodedImageFormat format = toEncodedImageFormat(options.format);
+        
+        if (!task->getThumbnails().empty()) {
+            return encodeThumbnails(task, surface, format, draft);
         }
         
         std::vector<uint8_t> output;
-        if (!encodeImage(surface->getCanvas(), format, options.quality, output)) {
+        if (!encodeImage(surface->getCanvas(), format, options.quality, output, draft)) {
             task->setErrorMessage("Failed to encode image");
             return false;
         }
@@ -283,206 +712,1340 @@ bool SkiaRenderEngine::Impl::render(std::shared_ptr<Task> task) {
     }
 }
 
-bool SkiaRenderEngine::Impl::parseHtml(const std::string& html, const std::string& css) {
-    // Clean up previous document if it exists
-    if (m_htmlDoc) {
-        xmlFreeDoc(m_htmlDoc);
-        m_htmlDoc = nullptr;
-    }
+bool SkiaRenderEngine::Impl::compile(std::shared_ptr<Task> task, const std::string& outputPath) {
+    const std::string& html = task->getHtml();
+    const std::string& css = task->getCss();
+    const Text2Image_RenderOptions& options = task->getOptions();
     
-    // Parse CSS first
-    if (!parseCss(css)) {
-        return false;
+    // Plain text goes through the document path too, so every input compiles to a display list
+    RenderDocument document;
+    std::vector<PlainTextRun> plainTextRuns;
+    bool plainText = false;
+    if (options.inputFormat == TEXT2IMAGE_INPUT_PLAIN_TEXT) {
+        plainText = scanPlainText(html, false, plainTextRuns);
+    }
+    else if (options.inputFormat == TEXT2IMAGE_INPUT_AUTO) {
+        plainText = scanPlainText(html, true, plainTextRuns);
     }
     
-    // Parse HTML
-    htmlDocPtr doc = htmlReadMemory(html.c_str(), static_cast<int>(html.length()), nullptr, nullptr, HTML_PARSE_RECOVER | HTML_PARSE_NOERROR | HTML_PARSE_NOWARNING);
-    if (!doc) {
+    if (plainText) {
+        if (!parsePlainText(plainTextRuns, css, document)) {
+            task->setErrorMessage("Failed to build plain-text document");
+            return false;
+        }
+    }
+    else if (options.inputFormat == TEXT2IMAGE_INPUT_MARKDOWN) {
+        if (!parseMarkdown(html, css, document)) {
+            task->setErrorMessage("Failed to parse Markdown/CSS");
+            return false;
+        }
+    }
+    else if (!parseHtml(html, css, document)) {
+        task->setErrorMessage("Failed to parse HTML/CSS");
         return false;
     }
     
-    m_htmlDoc = doc;
-    return true;
-}
-
-bool SkiaRenderEngine::Impl::renderHtmlToCanvas(SkCanvas* canvas, int width, int height, const Text2Image_RenderOptions& options) {
-    if (!m_htmlDoc) {
+    int width, height;
+    canvasSize(options, width, height);
+    
+    // Images are stored at the ratio the document is compiled for
+    DisplayList content;
+    if (!recordHtml(document, width, height, content, devicePixelRatio(options))) {
+        task->setErrorMessage("Failed to lay out document");
         return false;
     }
+    SkRect cover = content.cullOccluded().cover;
     
-    // Get the root element
-    xmlNode* root = xmlDocGetRootElement(m_htmlDoc);
-    if (!root) {
+    std::string error;
+    if (!CompiledDocument::write(outputPath, content, width, height, cover, error)) {
+        task->setErrorMessage(error);
         return false;
     }
-    
-    // Render the root element
-    renderElement(canvas, root, 0, 0, width);
-    
     return true;
 }
 
-bool SkiaRenderEngine::Impl::drawBackground(SkCanvas* canvas, int width, int height, const Text2Image_RenderOptions& options) {
+bool SkiaRenderEngine::Impl::renderCompiled(std::shared_ptr<Task> task) {
     try {
-        if (options.backgroundType == TEXT2IMAGE_BACKGROUND_SOLID) {
-            // Draw solid background color
-            SkPaint paint;
-            paint.setColor(options.backgroundColor);
-            canvas->drawRect(SkRect::MakeWH(width, height), paint);
+        const CompiledDocument& document = *task->getCompiled();
+        const Text2Image_RenderOptions& options = task->getOptions();
+        const int width = document.getWidth();
+        const int height = document.getHeight();
+        const bool draft = options.renderQuality == TEXT2IMAGE_RENDER_QUALITY_DRAFT && !options.debugOverdraw;
+        const SkScalar ratio = options.debugOverdraw ? 1 : devicePixelRatio(options);
+        const SkScalar scale = draft ? ratio * kDraftScale : ratio;
+        
+        SkImageInfo info = SkImageInfo::Make(scaledSize(width, scale), scaledSize(height, scale),
+                                             kRGBA_8888_SkColorType, kPremul_SkAlphaType);
+        sk_sp<SkSurface> surface = SkSurface::MakeRaster(info);
+        if (!surface) {
+            task->setErrorMessage("Failed to create Skia surface");
+            return false;
         }
-        else if (options.backgroundType == TEXT2IMAGE_BACKGROUND_IMAGE && options.backgroundImage) {
-            // Load and draw background image
-            sk_sp<SkImage> image = loadImage(options.backgroundImage);
-            if (!image) {
+        
+        SkCanvas* canvas = surface->getCanvas();
+        if (scale != 1) {
+            canvas->scale(scale, scale);
+        }
+        if (options.debugOverdraw) {
+            drawOverdraw(canvas, width, height, document.view(), document.getCover());
+        }
+        else {
+            if (!drawBackground(canvas, width, height, options, document.getCover())) {
+                task->setErrorMessage("Failed to draw background");
                 return false;
             }
-            
-            // Draw the image scaled to fit the canvas
-            SkPaint paint;
-            
-            // Apply blur if needed
-            if (options.backgroundBlur > 0) {
-                // In a real implementation, we would apply a blur filter here
-                // For now, we'll just draw the image as is
-            }
-            
-            // Calculate the scaling factor to fit the image to the canvas
-            SkScalar scaleX = static_cast<SkScalar>(width) / image->width();
-            SkScalar scaleY = static_cast<SkScalar>(height) / image->height();
-            SkScalar scale = std::max(scaleX, scaleY);
-            
-            // Calculate the position to center the image
-            SkScalar x = (width - image->width() * scale) / 2;
-            SkScalar y = (height - image->height() * scale) / 2;
-            
-            // Draw the image
-            canvas->save();
-            canvas->translate(x, y);
-            canvas->scale(scale, scale);
-            canvas->drawImage(image, 0, 0, &paint);
-            canvas->restore();
+            m_layoutEngine.playback(canvas, document.view(), draft);
+        }
+        
+        surface = applyBorderRadius(surface, info, scaledRadius(options.borderRadius, scale));
+        
+        std::vector<uint8_t> output;
+        if (!encodeImage(surface->getCanvas(), toEncodedImageFormat(options.format), options.quality, output, draft)) {
+            task->setErrorMessage("Failed to encode image");
+            return false;
         }
         
+        task->setResult(output);
         return true;
     }
     catch (const std::exception& e) {
-        // Handle exception
+        task->setErrorMessage("Exception during rendering: " + std::string(e.what()));
         return false;
     }
     catch (...) {
-        // Handle unknown exception
+        task->setErrorMessage("Unknown exception during rendering");
         return false;
     }
 }
 
-bool SkiaRenderEngine::Impl::encodeImage(SkCanvas* canvas, SkEncodedImageFormat format, int quality, std::vector<uint8_t>& output) {
-    try {
-        // Create an image snapshot of the canvas
-        sk_sp<SkImage> image = canvas->makeImageSnapshot();
-        if (!image) {
-            return false;
+bool SkiaRenderEngine::Impl::encodeThumbnails(std::shared_ptr<Task> task, const sk_sp<SkSurface>& surface,
+                                              SkEncodedImageFormat format, bool draft) {
+    const Text2Image_RenderOptions& options = task->getOptions();
+    const std::vector<Text2Image_Thumbnail>& thumbnails = task->getThumbnails();
+    
+    SkPixmap pixmap;
+    if (!surface->peekPixels(&pixmap)) {
+        task->setErrorMessage("Failed to read rendered pixels");
+        return false;
+    }
+    const int width = pixmap.width();
+    const int height = pixmap.height();
+    
+    // Halvings are computed once, before the parallel part, and shared by every thumbnail
+    ImageDownsampler downsampler(static_cast<const uint8_t*>(pixmap.addr()), pixmap.rowBytes(), width, height);
+    std::vector<SkISize> sizes;
+    for (const Text2Image_Thumbnail& thumbnail : thumbnails) {
+        double factor = thumbnail.scale > 0 ? thumbnail.scale : 1.0;
+        if (thumbnail.maxSide > 0) {
+            factor = std::min(factor, static_cast<double>(thumbnail.maxSide) / std::max(width, height));
         }
-        
-        // Encode the image
-        SkDynamicMemoryWStream stream;
-        if (!image->encodeToStream(&stream, format, quality)) {
-            return false;
+        SkISize size = SkISize::Make(std::min(width, std::max(1, static_cast<int>(std::lround(width * factor)))),
+                                     std::min(height, std::max(1, static_cast<int>(std::lround(height * factor)))));
+        downsampler.prepare(size.width(), size.height());
+        sizes.push_back(size);
+    }
+    
+    // Page 0 is the full image; each page is resampled and encoded on its own thread
+    sk_sp<SkImage> full = surface->makeImageSnapshot();
+    std::vector<std::vector<uint8_t>> pages(sizes.size() + 1);
+    std::atomic<bool> failed(false);
+    LibraryContext::getInstance().getThreadPool().parallelFor(pages.size(), [&](size_t i) {
+        if (i == 0) {
+            if (!encodeImage(full, format, options.quality, pages[0], draft)) {
+                failed = true;
+            }
+            return;
         }
         
-        // Get the encoded data
-        sk_sp<SkData> data = stream.detachAsData();
-        if (!data) {
-            return false;
+        PixelLevel level;
+        if (!downsampler.downsample(sizes[i - 1].width(), sizes[i - 1].height(), level)) {
+            failed = true;
+            return;
+        }
+        SkImageInfo info = SkImageInfo::Make(level.width, level.height, kRGBA_8888_SkColorType, kPremul_SkAlphaType);
+        sk_sp<SkImage> image = SkImage::MakeRasterData(info, SkData::MakeWithoutCopy(level.pixels.data(), level.pixels.size()),
+                                                       static_cast<size_t>(level.width) * 4);
+        if (!image || !encodeImage(image, format, options.quality, pages[i], draft)) {
+            failed = true;
+        }
+    });
+    if (failed) {
+        task->setErrorMessage("Failed to encode image");
+        return false;
+    }
+    
+    task->setPages(std::move(pages));
+    return true;
+}
+
+bool SkiaRenderEngine::Impl::renderAtlas(std::shared_ptr<Task> task) {
+    try {
+        const std::vector<AtlasItem>& items = task->getAtlasItems();
+        const Text2Image_RenderOptions& options = task->getOptions();
+        
+        std::vector<Text2Image_AtlasRect> rects;
+        int width, height;
+        if (!packAtlas(items, rects, width, height)) {
+            task->setErrorMessage("Atlas items do not fit in one sheet");
+            return false;
+        }
+        
+        SkImageInfo info = SkImageInfo::Make(width, height, kRGBA_8888_SkColorType, kPremul_SkAlphaType);
+        sk_sp<SkSurface> surface = SkSurface::MakeRaster(info);
+        if (!surface) {
+            task->setErrorMessage("Failed to create Skia surface");
+            return false;
+        }
+        
+        SkCanvas* canvas = surface->getCanvas();
+        canvas->clear(SK_ColorTRANSPARENT);
+        
+        // Items draw into one canvas, so they are drawn one after another
+        for (size_t i = 0; i < items.size(); ++i) {
+            const Text2Image_AtlasRect& rect = rects[i];
+            SkAutoCanvasRestore restore(canvas, true);
+            canvas->translate(rect.x, rect.y);
+            
+            // Each item is rounded on its own, in place of applyBorderRadius on the sheet
+            SkRect cell = SkRect::MakeWH(rect.width, rect.height);
+            if (options.borderRadius > 0) {
+                canvas->clipRRect(SkRRect::MakeRectXY(cell, options.borderRadius, options.borderRadius), true);
+            }
+            else {
+                canvas->clipRect(cell);
+            }
+            
+            if (!drawAtlasItem(canvas, items[i], options)) {
+                task->setErrorMessage("Failed to render atlas item " + std::to_string(i));
+                return false;
+            }
+        }
+        
+        SkEncodedImageFormat format = toEncodedImageFormat(options.format);
+        if (task->getAtlasOutput() == TEXT2IMAGE_ATLAS_CROPS) {
+            // Crops share the sheet's pixels and are encoded in parallel
+            sk_sp<SkImage> sheet = surface->makeImageSnapshot();
+            std::vector<std::vector<uint8_t>> crops(items.size());
+            std::atomic<bool> failed(false);
+            LibraryContext::getInstance().getThreadPool().parallelFor(items.size(), [&](size_t i) {
+                const Text2Image_AtlasRect& rect = rects[i];
+                sk_sp<SkImage> crop = sheet ? sheet->makeSubset(SkIRect::MakeXYWH(rect.x, rect.y, rect.width, rect.height)) : nullptr;
+                if (!crop || !encodeImage(crop, format, options.quality, crops[i])) {
+                    failed = true;
+                }
+            });
+            if (failed) {
+                task->setErrorMessage("Failed to encode image");
+                return false;
+            }
+            task->setPages(std::move(crops));
+        }
+        else {
+            std::vector<uint8_t> output;
+            if (!encodeImage(surface->getCanvas(), format, options.quality, output)) {
+                task->setErrorMessage("Failed to encode image");
+                return false;
+            }
+            task->setResult(output);
         }
         
-        // Copy the data to the output vector
-        output.resize(data->size());
-        std::memcpy(output.data(), data->data(), data->size());
-        
+        task->setAtlasRects(std::move(rects));
         return true;
     }
     catch (const std::exception& e) {
-        // Handle exception
+        task->setErrorMessage("Exception during rendering: " + std::string(e.what()));
         return false;
     }
     catch (...) {
-        // Handle unknown exception
+        task->setErrorMessage("Unknown exception during rendering");
         return false;
     }
 }
 
-bool SkiaRenderEngine::Impl::parseCss(const std::string& css) {
-    // Clear previous CSS rules
-    m_cssRules.clear();
+bool SkiaRenderEngine::Impl::drawAtlasItem(SkCanvas* canvas, const AtlasItem& item, const Text2Image_RenderOptions& options) {
+    std::vector<PlainTextRun> plainTextRuns;
+    bool plainText = false;
+    if (options.inputFormat == TEXT2IMAGE_INPUT_PLAIN_TEXT) {
+        plainText = scanPlainText(item.html, false, plainTextRuns);
+    }
+    else if (options.inputFormat == TEXT2IMAGE_INPUT_AUTO) {
+        plainText = scanPlainText(item.html, true, plainTextRuns) && getPlainTextStyle(item.css)->modeled;
+    }
     
-    // Simple CSS parser (this is a very basic implementation)
-    // In a real implementation, we would use a proper CSS parser
-    std::regex ruleRegex("([^{]+)\\s*\\{\\s*([^}]+)\\s*\\}");
-    std::smatch match;
+    // Badges and tags are mostly plain text, which needs no document at all
+    if (plainText) {
+        if (!drawBackground(canvas, item.width, item.height, options)) {
+            return false;
+        }
+        renderPlainText(canvas, item.width, item.height, *getPlainTextStyle(item.css), plainTextRuns);
+        return true;
+    }
     
-    std::string::const_iterator searchStart(css.cbegin());
-    while (std::regex_search(searchStart, css.cend(), match, ruleRegex)) {
-        std::string selector = match[1].str();
-        std::string properties = match[2].str();
+    RenderDocument document;
+    if (options.inputFormat == TEXT2IMAGE_INPUT_MARKDOWN) {
+        if (!parseMarkdown(item.html, item.css, document)) {
+            return false;
+        }
+    }
+    else if (!parseHtml(item.html, item.css, document)) {
+        return false;
+    }
+    
+    DisplayList content;
+    if (!recordHtml(document, item.width, item.height, content)) {
+        return false;
+    }
+    SkRect cover = content.cullOccluded().cover;
+    if (!drawBackground(canvas, item.width, item.height, options, cover)) {
+        return false;
+    }
+    m_layoutEngine.playback(canvas, content);
+    return true;
+}
+
+bool SkiaRenderEngine::Impl::renderIncremental(std::shared_ptr<Task> task, int width, int height, SkScalar scale,
+                                               DisplayList& content, const SkRect& cover) {
+    const Text2Image_RenderOptions& options = task->getOptions();
+    
+    // Damage and pixels are in device pixels; content and cover stay in CSS pixels
+    const int deviceWidth = scaledSize(width, scale);
+    const int deviceHeight = scaledSize(height, scale);
+    
+    auto snapshot = std::make_shared<RenderSnapshot>();
+    snapshot->width = deviceWidth;
+    snapshot->height = deviceHeight;
+    snapshot->scale = scale;
+    snapshot->backgroundType = options.backgroundType;
+    snapshot->backgroundColor = options.backgroundColor;
+    snapshot->backgroundImage = options.backgroundImage ? options.backgroundImage : "";
+    snapshot->backgroundBlur = options.backgroundBlur;
+    snapshot->borderRadius = options.borderRadius;
+    snapshot->cover = cover;
+    
+    // Old pixels carry over only when everything outside the document matches
+    std::shared_ptr<const RenderSnapshot> base = task->takeBaseSnapshot();
+    if (base && (base->width != deviceWidth || base->height != deviceHeight || base->scale != scale ||
+                 base->backgroundType != snapshot->backgroundType ||
+                 base->backgroundColor != snapshot->backgroundColor ||
+                 base->backgroundImage != snapshot->backgroundImage ||
+                 base->backgroundBlur != snapshot->backgroundBlur)) {
+        base.reset();
+    }
+    
+    const SkIRect bounds = SkIRect::MakeWH(deviceWidth, deviceHeight);
+    const SkMatrix toDevice = SkMatrix::Scale(scale, scale);
+    SkRegion damage;
+    if (base) {
+        for (const SkRect& rect : DisplayList::damage(base->content.view(), content.view())) {
+            // A pixel of slack keeps anti-aliased edges inside
+            SkIRect area = toDevice.mapRect(rect).roundOut();
+            area.outset(1, 1);
+            if (area.intersect(bounds)) {
+                damage.op(area, SkRegion::kUnion_Op);
+            }
+        }
         
-        // Store the rule
-        m_cssRules[selector] = properties;
+        // Past half the canvas, copying the old pixels saves little
+        int64_t damaged = 0;
+        for (SkRegion::Iterator it(damage); !it.done(); it.next()) {
+            damaged += static_cast<int64_t>(it.rect().width()) * it.rect().height();
+        }
+        if (damaged * 2 > static_cast<int64_t>(deviceWidth) * deviceHeight) {
+            base.reset();
+        }
+    }
+    if (!base) {
+        damage.setRect(bounds);
+    }
+    
+    SkImageInfo info = SkImageInfo::Make(deviceWidth, deviceHeight, kRGBA_8888_SkColorType, kPremul_SkAlphaType);
+    sk_sp<SkSurface> surface = SkSurface::MakeRaster(info);
+    if (!surface) {
+        task->setErrorMessage("Failed to create Skia surface");
+        return false;
+    }
+    
+    SkCanvas* canvas = surface->getCanvas();
+    if (base) {
+        canvas->writePixels(info, base->pixels.data(), static_cast<size_t>(deviceWidth) * 4, 0, 0);
+    }
+    
+    // Everything is drawn, but only damaged pixels change. The region clip is in device pixels.
+    if (!damage.isEmpty()) {
+        SkAutoCanvasRestore restore(canvas, true);
+        canvas->clipRegion(damage);
+        canvas->scale(scale, scale);
+        canvas->clear(SK_ColorTRANSPARENT);
+        if (!drawBackground(canvas, width, height, options, cover)) {
+            task->setErrorMessage("Failed to draw background");
+            return false;
+        }
+        m_layoutEngine.playback(canvas, content);
+    }
+    
+    // The next render starts from the pixels before rounding
+    snapshot->pixels.resize(static_cast<size_t>(deviceWidth) * deviceHeight * 4);
+    if (!surface->readPixels(info, snapshot->pixels.data(), static_cast<size_t>(deviceWidth) * 4, 0, 0)) {
+        task->setErrorMessage("Failed to read rendered pixels");
+        return false;
+    }
+    
+    surface = applyBorderRadius(surface, info, scaledRadius(options.borderRadius, scale));
+    
+    std::vector<uint8_t> output;
+    if (options.format == TEXT2IMAGE_FORMAT_PNG) {
+        // Rows outside the damage keep their compressed bands from the base
+        std::vector<std::pair<int, int>> dirtyRows;
+        for (SkRegion::Iterator it(damage); !it.done(); it.next()) {
+            dirtyRows.emplace_back(it.rect().fTop, it.rect().fBottom);
+        }
+        const PngBands* previous = base && base->borderRadius == options.borderRadius ? &base->png : nullptr;
         
-        // Move to the next match
-        searchStart = match.suffix().first;
+        SkPixmap pixmap;
+        if (!surface->peekPixels(&pixmap) ||
+            !PngBandEncoder::encode(static_cast<const uint8_t*>(pixmap.addr()), pixmap.rowBytes(), deviceWidth, deviceHeight,
+                                    previous, dirtyRows, &LibraryContext::getInstance().getThreadPool(),
+                                    output, snapshot->png)) {
+            task->setErrorMessage("Failed to encode image");
+            return false;
+        }
+    }
+    else if (!encodeImage(surface->getCanvas(), toEncodedImageFormat(options.format), options.quality, output)) {
+        task->setErrorMessage("Failed to encode image");
+        return false;
     }
     
+    snapshot->content = std::move(content);
+    task->setResult(output);
+    task->setSnapshot(std::move(snapshot));
     return true;
 }
 
-sk_sp<SkTypeface> SkiaRenderEngine::Impl::loadFont(const std::string& fontFamily, int weight, bool italic) {
-    // In a real implementation, we would load the specified font
-    // For now, just return the default font
-    return SkTypeface::MakeDefault();
+bool SkiaRenderEngine::Impl::renderAnimation(std::shared_ptr<Task> task) {
+    try {
+        const std::vector<AnimationFrameSource>& sources = task->getFrames();
+        const Text2Image_RenderOptions& options = task->getOptions();
+        const bool webp = options.format == TEXT2IMAGE_FORMAT_WEBP;
+        
+        int width, height;
+        canvasSize(options, width, height);
+        
+        // One surface carries over between frames, as the viewer's canvas does
+        SkImageInfo info = SkImageInfo::Make(width, height, kRGBA_8888_SkColorType, kPremul_SkAlphaType);
+        sk_sp<SkSurface> surface = SkSurface::MakeRaster(info);
+        SkPixmap pixmap;
+        if (!surface || !surface->peekPixels(&pixmap)) {
+            task->setErrorMessage("Failed to create Skia surface");
+            return false;
+        }
+        SkCanvas* canvas = surface->getCanvas();
+        
+        const SkIRect bounds = SkIRect::MakeWH(width, height);
+        DisplayList previous;
+        std::vector<AnimationFrame> frames;
+        for (size_t i = 0; i < sources.size(); ++i) {
+            RenderDocument document;
+            if (!parseFrame(sources[i].html, task->getCss(), options, document)) {
+                task->setErrorMessage("Failed to parse animation frame " + std::to_string(i));
+                return false;
+            }
+            DisplayList content;
+            if (!recordHtml(document, width, height, content)) {
+                task->setErrorMessage("Failed to render animation frame " + std::to_string(i));
+                return false;
+            }
+            SkRect cover = content.cullOccluded().cover;
+            
+            // Later frames cover the bounds of what changed, with a pixel of
+            // slack for anti-aliased edges
+            SkIRect area = bounds;
+            if (i > 0) {
+                SkRect changed = SkRect::MakeEmpty();
+                for (const SkRect& rect : DisplayList::damage(previous.view(), content.view())) {
+                    changed.join(rect);
+                }
+                area = changed.roundOut();
+                area.outset(1, 1);
+                if (!area.intersect(bounds)) {
+                    // Nothing changed: the previous frame just shows longer
+                    frames.back().duration += sources[i].duration;
+                    previous = std::move(content);
+                    continue;
+                }
+                // WebP frame offsets are stored halved
+                if (webp) {
+                    area.fLeft &= ~1;
+                    area.fTop &= ~1;
+                }
+            }
+            
+            {
+                SkAutoCanvasRestore restore(canvas, true);
+                canvas->clipRect(SkRect::Make(area));
+                canvas->clear(SK_ColorTRANSPARENT);
+                if (options.borderRadius > 0) {
+                    SkRect frame = SkRect::MakeWH(width, height);
+                    canvas->clipRRect(SkRRect::MakeRectXY(frame, options.borderRadius, options.borderRadius), true);
+                }
+                if (!drawBackground(canvas, width, height, options, cover)) {
+                    task->setErrorMessage("Failed to draw background");
+                    return false;
+                }
+                m_layoutEngine.playback(canvas, content);
+            }
+            
+            AnimationFrame frame;
+            frame.x = area.fLeft;
+            frame.y = area.fTop;
+            frame.width = area.width();
+            frame.height = area.height();
+            frame.duration = sources[i].duration;
+            frame.opaque = PngBandEncoder::unpremultiply(static_cast<const uint8_t*>(pixmap.addr()), pixmap.rowBytes(),
+                                                         frame.x, frame.y, frame.width, frame.height, frame.rgba);
+            frames.push_back(std::move(frame));
+            previous = std::move(content);
+        }
+        
+        std::vector<uint8_t> output;
+        ThreadPool* pool = &LibraryContext::getInstance().getThreadPool();
+        bool encoded = webp ? AnimationEncoder::encodeWebp(width, height, frames, options.quality, pool, output)
+                            : AnimationEncoder::encodeApng(width, height, frames, pool, output);
+        if (!encoded) {
+            task->setErrorMessage("Failed to encode animation");
+            return false;
+        }
+        
+        task->setResult(output);
+        return true;
+    }
+    catch (const std::exception& e) {
+        task->setErrorMessage("Exception during rendering: " + std::string(e.what()));
+        return false;
+    }
+    catch (...) {
+        task->setErrorMessage("Unknown exception during rendering");
+        return false;
+    }
+}
+
+bool SkiaRenderEngine::Impl::parseFrame(const std::string& html, const std::string& css, const Text2Image_RenderOptions& options,
+                                        RenderDocument& document) {
+    // Frames are diffed as box trees, so scanned text becomes a minimal document
+    std::vector<PlainTextRun> plainTextRuns;
+    bool plainText = false;
+    if (options.inputFormat == TEXT2IMAGE_INPUT_PLAIN_TEXT) {
+        plainText = scanPlainText(html, false, plainTextRuns);
+    }
+    else if (options.inputFormat == TEXT2IMAGE_INPUT_AUTO) {
+        plainText = scanPlainText(html, true, plainTextRuns);
+    }
+    
+    if (plainText) {
+        return parsePlainText(plainTextRuns, css, document);
+    }
+    if (options.inputFormat == TEXT2IMAGE_INPUT_MARKDOWN) {
+        return parseMarkdown(html, css, document);
+    }
+    return parseHtml(html, css, document);
+}
+
+bool SkiaRenderEngine::Impl::scanPlainText(const std::string& input, bool strict, std::vector<PlainTextRun>& runs) {
+    // Explicit plain text without markup keeps its newlines as hard breaks; otherwise they
+    // collapse like HTML whitespace
+    bool hasMarkup = false;
+    for (size_t i = input.find('<'); i != std::string::npos && !hasMarkup; i = input.find('<', i + 1)) {
+        hasMarkup = i + 1 < input.size() && (input[i + 1] == '/' || std::isalpha(static_cast<unsigned char>(input[i + 1])));
+    }
+
+    int boldDepth = 0;
+    int italicDepth = 0;
+    std::string text;
+    bool lastWasSpace = false;
+
+    auto currentFont = [&]() {
+        return (boldDepth > 0 ? 1 : 0) | (italicDepth > 0 ? 2 : 0);
+    };
+    auto flush = [&](bool lineBreak) {
+        if (!text.empty() || lineBreak) {
+            runs.push_back({text, currentFont(), lineBreak});
+            text.clear();
+        }
+        if (lineBreak) {
+            lastWasSpace = false;
+        }
+    };
+
+    size_t pos = 0;
+    while (pos < input.size()) {
+        // Bytes no rule below applies to are copied in bulk
+        size_t plain = plainTextPrefix(input.data() + pos, input.size() - pos);
+        if (plain > 0) {
+            text.append(input, pos, plain);
+            lastWasSpace = false;
+            pos += plain;
+            continue;
+        }
+
+        char c = input[pos];
+
+        // Comments, doctypes and processing instructions are not text to HTML
+        if (strict && c == '<' && pos + 1 < input.size() && (input[pos + 1] == '!' || input[pos + 1] == '?')) {
+            return false;
+        }
+
+        if (c == '<' && pos + 1 < input.size() &&
+            (input[pos + 1] == '/' || std::isalpha(static_cast<unsigned char>(input[pos + 1])))) {
+            size_t close = input.find('>', pos);
+            if (close == std::string::npos) {
+                if (strict) return false;
+                text.push_back(c);
+                ++pos;
+                continue;
+            }
+
+            bool closing = input[pos + 1] == '/';
+            size_t nameStart = pos + (closing ? 2 : 1);
+            size_t nameEnd = nameStart;
+            while (nameEnd < close && std::isalnum(static_cast<unsigned char>(input[nameEnd]))) {
+                ++nameEnd;
+            }
+
+            std::string name = input.substr(nameStart, nameEnd - nameStart);
+            std::transform(name.begin(), name.end(), name.begin(),
+                           [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+
+            // Attributes (style, class, id) change how HTML renders the tag
+            if (strict) {
+                size_t rest = input.find_first_not_of(" \t\n\r\f/", nameEnd);
+                if (rest < close) {
+                    return false;
+                }
+            }
+
+            PlainTextTag tag = classifyPlainTextTag(name);
+            if (tag == PlainTextTag::UNSUPPORTED) {
+                // Anything richer than the supported tags needs the HTML path
+                if (strict) return false;
+                text.append(input, pos, close - pos + 1);
+                lastWasSpace = false;
+                pos = close + 1;
+                continue;
+            }
+
+            if (tag == PlainTextTag::BREAK) {
+                flush(true);
+            }
+            else {
+                int& depth = (tag == PlainTextTag::BOLD) ? boldDepth : italicDepth;
+                int newDepth = closing ? std::max(depth - 1, 0) : depth + 1;
+                if ((depth > 0) != (newDepth > 0)) {
+                    // Text collected so far belongs to the previous font
+                    flush(false);
+                }
+                depth = newDepth;
+            }
+
+            pos = close + 1;
+            continue;
+        }
+
+        if (c == '&') {
+            size_t consumed = decodeCharacterReference(input.data() + pos, input.size() - pos, text);
+            if (consumed == 0) {
+                if (strict && hasMarkup) return false;
+                text.push_back(c);
+                consumed = 1;
+            }
+            lastWasSpace = false;
+            pos += consumed;
+            continue;
+        }
+
+        if (c == '\n' && !strict && !hasMarkup) {
+            flush(true);
+            ++pos;
+            continue;
+        }
+
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f') {
+            if (!lastWasSpace) {
+                text.push_back(' ');
+                lastWasSpace = true;
+            }
+            ++pos;
+            continue;
+        }
+
+        text.push_back(c);
+        lastWasSpace = false;
+        ++pos;
+    }
+
+    flush(false);
+    return true;
 }
 
-void SkiaRenderEngine::Impl::renderElement(SkCanvas* canvas, xmlNode* node, int x, int y, int width) {
-    if (!node || node->type != XML_ELEMENT_NODE) {
+std::shared_ptr<const PlainTextStyle> SkiaRenderEngine::Impl::getPlainTextStyle(const std::string& css) {
+    {
+        std::lock_guard<std::mutex> lock(m_plainTextStylesMutex);
+        auto it = m_plainTextStyles.find(css);
+        if (it != m_plainTextStyles.end()) {
+            return it->second;
+        }
+    }
+
+    // Defaults match the user agent stylesheet for body text
+    std::string family;
+    float fontSize = 16.0f;
+    int weight = 400;
+    bool italic = false;
+    uint32_t color = SK_ColorBLACK;
+    float lineHeightFactor = 1.2f;
+    float lineHeightPx = 0.0f;
+    float inset = 0.0f;
+    bool modeled = true;
+
+    // Only rules for the root and body can affect bare text. :root outranks
+    // html, so its declarations apply after them.
+    std::vector<CssRule> rules;
+    parseCssRules(css, rules);
+    CssDeclarations rootRules;
+    CssDeclarations rootClassRules;
+    CssDeclarations bodyRules;
+    for (const CssRule& rule : rules) {
+        CssDeclarations declarations = parseCssDeclarations(rule.declarations);
+        for (const std::string& selector : splitCssSelectorList(rule.selector)) {
+            CssDeclarations* target = selector == "html" ? &rootRules
+                                    : selector == ":root" ? &rootClassRules
+                                    : selector == "body" ? &bodyRules
+                                    : nullptr;
+            if (!target) {
+                // A rule for <b>, <i> or anything else needs the style resolver
+                modeled = false;
+                continue;
+            }
+            target->insert(target->end(), declarations.begin(), declarations.end());
+        }
+    }
+    rootRules.insert(rootRules.end(), rootClassRules.begin(), rootClassRules.end());
+
+    // html, then body: inherited values and em lengths carry from one to the
+    // other, and their margins and paddings add up
+    auto applyElement = [&](const CssDeclarations& declarations, float defaultMargin) {
+        // Font size first, since em lengths depend on it
+        const float parentSize = fontSize;
+        for (const auto& declaration : declarations) {
+            if (declaration.first == "font-size" && !parseCssLength(declaration.second, parentSize, fontSize)) {
+                modeled = false;
+            }
+        }
+
+        const int parentWeight = weight;
+        float margin = defaultMargin;
+        float padding = 0.0f;
+        for (const auto& declaration : declarations) {
+            const std::string& name = declaration.first;
+            const std::string& value = declaration.second;
+            if (name == "font-size") {
+                continue;
+            }
+            else if (name == "font-family") {
+                std::vector<std::string> families = parseCssFontFamilies(value);
+                if (!families.empty()) {
+                    family = families.front();
+                }
+            }
+            else if (name == "font-weight") {
+                weight = parseCssFontWeight(value, parentWeight);
+            }
+            else if (name == "font-style" && (value == "normal" || value == "italic" || value == "oblique")) {
+                italic = value != "normal";
+            }
+            else if (name == "color") {
+                if (!parseCssColor(value, color)) {
+                    modeled = false;
+                }
+            }
+            else if (name == "line-height") {
+                char* end = nullptr;
+                float factor = std::strtof(value.c_str(), &end);
+                if (value == "normal") {
+                    lineHeightFactor = 1.2f;
+                    lineHeightPx = 0.0f;
+                }
+                else if (end != value.c_str() && *end == '\0') {
+                    lineHeightFactor = factor;
+                    lineHeightPx = 0.0f;
+                }
+                else if (!parseCssLength(value, fontSize, lineHeightPx)) {
+                    modeled = false;
+                }
+            }
+            // One inset serves every side, so only single-value shorthands are modeled
+            else if ((name == "margin" || name == "padding") && value.find_first_of(" \t") == std::string::npos) {
+                if (!parseCssLength(value, fontSize, name == "margin" ? margin : padding)) {
+                    modeled = false;
+                }
+            }
+            else {
+                // text-align, background, letter-spacing, margin-left and the like
+                modeled = false;
+            }
+        }
+        inset += margin + padding;
+    };
+    applyElement(rootRules, 0.0f);
+    applyElement(bodyRules, 8.0f);
+
+    auto style = std::make_shared<PlainTextStyle>();
+    for (int i = 0; i < 4; ++i) {
+        int fontWeight = (i & 1) ? std::max(weight, 700) : weight;
+        bool fontItalic = italic || (i & 2);
+
+        SkFont& font = style->fonts[i];
+        font.setTypeface(loadFont(family, fontWeight, fontItalic));
+        font.setSize(fontSize);
+        font.setEdging(SkFont::Edging::kAntiAlias);
+        style->spaceWidths[i] = font.measureText(" ", 1, SkTextEncoding::kUTF8);
+        style->fallbacks[i] = m_layoutEngine.getFontFallback().getMap(font);
+    }
+
+    SkFontMetrics metrics;
+    style->fonts[0].getMetrics(&metrics);
+    SkScalar contentHeight = metrics.fDescent - metrics.fAscent;
+
+    style->color = color;
+    style->lineHeight = lineHeightPx > 0.0f ? lineHeightPx : fontSize * lineHeightFactor;
+    style->baseline = (style->lineHeight - contentHeight) / 2 - metrics.fAscent;
+    style->inset = inset;
+    style->modeled = modeled;
+
+    std::lock_guard<std::mutex> lock(m_plainTextStylesMutex);
+    if (m_plainTextStyles.size() >= kMaxPlainTextStyles) {
+        m_plainTextStyles.clear();
+    }
+    m_plainTextStyles[css] = style;
+    return style;
+}
+
+void SkiaRenderEngine::Impl::renderPlainText(SkCanvas* canvas, int width, int height, const PlainTextStyle& style, const std::vector<PlainTextRun>& runs) {
+    const SkScalar maxWidth = std::max<SkScalar>(width - 2 * style.inset, 1);
+    const int maxLines = static_cast<int>((height - style.inset) / style.lineHeight) + 1;
+
+    std::vector<PlainTextSegment> segments;
+    SkScalar x = 0;
+    int line = 0;
+    bool pendingSpace = false;
+
+    // Place one unbreakable piece, extending the previous segment when contiguous
+    auto place = [&](const char* text, size_t length, int fontIndex, SkScalar advance, bool contiguous) {
+        if (x > 0 && x + advance > maxWidth) {
+            ++line;
+            x = 0;
+            contiguous = false;
+        }
+        else if (pendingSpace && x > 0) {
+            x += style.spaceWidths[fontIndex];
+        }
+        pendingSpace = false;
+
+        if (contiguous && !segments.empty()) {
+            PlainTextSegment& last = segments.back();
+            if (last.line == line && last.fontIndex == fontIndex && last.text + last.length <= text) {
+                last.length = static_cast<size_t>(text + length - last.text);
+                x += advance;
+                return;
+            }
+        }
+
+        segments.push_back({text, length, fontIndex, x, line});
+        x += advance;
+    };
+
+    for (const PlainTextRun& run : runs) {
+        const SkFont& font = style.fonts[run.fontIndex];
+        FontFallbackMap& fallback = *style.fallbacks[run.fontIndex];
+        const char* p = run.text.data();
+        const char* end = p + run.text.size();
+        bool contiguous = false;
+
+        while (p < end && line < maxLines) {
+            if (*p == ' ') {
+                pendingSpace = true;
+                ++p;
+                continue;
+            }
+
+            // Collect a word, or a single CJK character which is its own break opportunity
+            const char* wordStart = p;
+            const char* cursor = p;
+            uint32_t codepoint = nextCodepoint(cursor, end);
+            if (!isCjkCodepoint(codepoint)) {
+                while (cursor < end && *cursor != ' ') {
+                    const char* next = cursor;
+                    if (isCjkCodepoint(nextCodepoint(next, end))) {
+                        break;
+                    }
+                    cursor = next;
+                }
+            }
+            p = cursor;
+
+            size_t length = static_cast<size_t>(p - wordStart);
+            SkScalar advance = fallback.measure(font, wordStart, length);
+            if (advance <= maxWidth) {
+                place(wordStart, length, run.fontIndex, advance, contiguous);
+                contiguous = true;
+                continue;
+            }
+
+            // Words wider than the line are broken between characters
+            const char* pieceStart = wordStart;
+            const char* q = wordStart;
+            SkScalar pieceWidth = 0;
+            while (q < p) {
+                const char* charStart = q;
+                nextCodepoint(q, p);
+                SkScalar charWidth = fallback.measure(font, charStart, static_cast<size_t>(q - charStart));
+                if (pieceWidth > 0 && pieceWidth + charWidth > maxWidth) {
+                    place(pieceStart, static_cast<size_t>(charStart - pieceStart), run.fontIndex, pieceWidth, false);
+                    pieceStart = charStart;
+                    pieceWidth = 0;
+                }
+                pieceWidth += charWidth;
+            }
+            place(pieceStart, static_cast<size_t>(p - pieceStart), run.fontIndex, pieceWidth, false);
+            contiguous = false;
+        }
+
+        if (run.lineBreak) {
+            ++line;
+            x = 0;
+            pendingSpace = false;
+        }
+    }
+
+    if (segments.empty()) {
         return;
     }
+
+    // All visible text goes into one blob: one run per segment and typeface
+    SkTextBlobBuilder builder;
+    std::vector<FontRun> fontRuns;
+    for (const PlainTextSegment& segment : segments) {
+        if (segment.line >= maxLines) {
+            break;
+        }
+
+        style.fallbacks[segment.fontIndex]->split(style.fonts[segment.fontIndex], segment.text, segment.length, fontRuns);
+        SkScalar runX = style.inset + segment.x;
+        SkScalar runY = style.inset + segment.line * style.lineHeight + style.baseline;
+        for (const FontRun& fontRun : fontRuns) {
+            const char* text = segment.text + fontRun.start;
+            int glyphCount = fontRun.font.textToGlyphs(text, fontRun.length, SkTextEncoding::kUTF8, nullptr, 0);
+            if (glyphCount > 0) {
+                const SkTextBlobBuilder::RunBuffer& buffer = builder.allocRun(fontRun.font, glyphCount, runX, runY);
+                fontRun.font.textToGlyphs(text, fontRun.length, SkTextEncoding::kUTF8, buffer.glyphs, glyphCount);
+            }
+            runX += fontRun.font.measureText(text, fontRun.length, SkTextEncoding::kUTF8);
+        }
+    }
+
+    sk_sp<SkTextBlob> blob = builder.make();
+    if (blob) {
+        SkPaint paint;
+        paint.setAntiAlias(true);
+        paint.setColor(style.color);
+        canvas->drawTextBlob(blob, 0, 0, paint);
+    }
+}
+
+bool SkiaRenderEngine::Impl::parseHtml(const std::string& html, const std::string& css, RenderDocument& document) {
+    // Clean up previous document if it exists
+    if (document.doc) {
+        xmlFreeDoc(document.doc);
+        document.doc = nullptr;
+    }
+    
+    // Parse CSS first
+    if (!parseCss(css, document)) {
+        return false;
+    }
+    
+    // Parse HTML
+    htmlDocPtr doc = htmlReadMemory(html.c_str(), static_cast<int>(html.length()), nullptr, nullptr, HTML_PARSE_RECOVER | HTML_PARSE_NOERROR | HTML_PARSE_NOWARNING);
+    if (!doc) {
+        return false;
+    }
+    
+    document.doc = doc;
+    return true;
+}
+
+bool SkiaRenderEngine::Impl::parseMarkdown(const std::string& markdown, const std::string& css, RenderDocument& document) {
+    // Clean up previous document if it exists
+    if (document.doc) {
+        xmlFreeDoc(document.doc);
+        document.doc = nullptr;
+    }
+    
+    // Parse CSS first
+    if (!parseCss(css, document)) {
+        return false;
+    }
+    
+    // Build the document tree directly from Markdown
+    xmlDocPtr doc = MarkdownParser::parse(markdown);
+    if (!doc) {
+        return false;
+    }
+    
+    document.doc = doc;
+    return true;
+}
+
+bool SkiaRenderEngine::Impl::parsePlainText(const std::vector<PlainTextRun>& runs, const std::string& css, RenderDocument& document) {
+    // Clean up previous document if it exists
+    if (document.doc) {
+        xmlFreeDoc(document.doc);
+        document.doc = nullptr;
+    }
+    
+    // Parse CSS first
+    if (!parseCss(css, document)) {
+        return false;
+    }
+    
+    // Runs map onto <b>, <i> and <br> under <body>
+    xmlDocPtr doc = xmlNewDoc(BAD_CAST "1.0");
+    xmlNodePtr html = xmlNewNode(nullptr, BAD_CAST "html");
+    xmlDocSetRootElement(doc, html);
+    xmlNodePtr body = xmlNewChild(html, nullptr, BAD_CAST "body", nullptr);
+    for (const PlainTextRun& run : runs) {
+        if (!run.text.empty()) {
+            xmlNodePtr parent = body;
+            if (run.fontIndex & 1) {
+                parent = xmlNewChild(parent, nullptr, BAD_CAST "b", nullptr);
+            }
+            if (run.fontIndex & 2) {
+                parent = xmlNewChild(parent, nullptr, BAD_CAST "i", nullptr);
+            }
+            xmlAddChild(parent, xmlNewTextLen(BAD_CAST run.text.data(), static_cast<int>(run.text.size())));
+        }
+        if (run.lineBreak) {
+            xmlNewChild(body, nullptr, BAD_CAST "br", nullptr);
+        }
+    }
+    
+    document.doc = doc;
+    return true;
+}
+
+bool SkiaRenderEngine::Impl::recordHtml(const RenderDocument& document, int width, int height, DisplayList& list,
+                                        SkScalar imageScale) {
+    if (!document.doc || !document.styles) {
+        return false;
+    }
+    
+    // Get the root element
+    xmlNode* root = xmlDocGetRootElement(document.doc);
+    if (!root) {
+        return false;
+    }
+    
+    // Layout stops at the bottom of the canvas, so render cost follows the visible area
+    std::unique_ptr<LayoutBox> layout = m_layoutEngine.layout(document.doc, *document.styles, width, height, imageScale);
+    if (!layout) {
+        return false;
+    }
+    
+    m_layoutEngine.record(*layout, SkRect::MakeWH(width, height), list);
+    
+    return true;
+}
+
+bool SkiaRenderEngine::Impl::renderPages(const RenderDocument& document, int width, int height, SkScalar scale,
+                                         const Text2Image_RenderOptions& options, std::vector<std::vector<uint8_t>>& pages) {
+    if (!document.doc || !document.styles) {
+        return false;
+    }
+    
+    // The whole document is laid out once; pages differ only in the band they paint
+    std::unique_ptr<LayoutBox> layout = m_layoutEngine.layout(document.doc, *document.styles, width, SK_ScalarInfinity, scale);
+    if (!layout) {
+        return false;
+    }
+    std::vector<SkScalar> pageTops = LayoutEngine::findPageBreaks(*layout, height, kMaxPages);
+    
+    // Every page shares one background raster
+    SkImageInfo info = SkImageInfo::Make(scaledSize(width, scale), scaledSize(height, scale),
+                                         kRGBA_8888_SkColorType, kPremul_SkAlphaType);
+    sk_sp<SkSurface> backgroundSurface = SkSurface::MakeRaster(info);
+    if (!backgroundSurface) {
+        return false;
+    }
+    backgroundSurface->getCanvas()->scale(scale, scale);
+    if (!drawBackground(backgroundSurface->getCanvas(), width, height, options)) {
+        return false;
+    }
+    sk_sp<SkImage> background = backgroundSurface->makeImageSnapshot();
+    
+    // Pages are painted and encoded independently on the thread pool
+    SkEncodedImageFormat format = toEncodedImageFormat(options.format);
+    const LayoutBox& root = *layout;
+    pages.assign(pageTops.size(), std::vector<uint8_t>());
+    std::atomic<bool> failed(false);
+    
+    LibraryContext::getInstance().getThreadPool().parallelFor(pageTops.size(), [&](size_t index) {
+        SkScalar top = pageTops[index];
+        SkScalar bottom = index + 1 < pageTops.size() ? pageTops[index + 1] : top + height;
+        
+        sk_sp<SkSurface> surface = SkSurface::MakeRaster(info);
+        if (!surface) {
+            failed = true;
+            return;
+        }
+        
+        DisplayList content;
+        m_layoutEngine.record(root, SkRect::MakeLTRB(0, top, width, bottom), content);
+        SkRect cover = SkMatrix::Scale(scale, scale).mapRect(content.cullOccluded().cover.makeOffset(0, -top));
+        
+        SkCanvas* canvas = surface->getCanvas();
+        canvas->save();
+        if (!cover.isEmpty()) {
+            canvas->clipRect(cover, SkClipOp::kDifference);
+        }
+        canvas->drawImage(background, 0, 0);
+        canvas->restore();
+        
+        // Content past the break belongs to the next page
+        canvas->save();
+        canvas->scale(scale, scale);
+        canvas->clipRect(SkRect::MakeWH(width, bottom - top));
+        canvas->translate(0, -top);
+        m_layoutEngine.playback(canvas, content);
+        canvas->restore();
+        
+        surface = applyBorderRadius(surface, info, scaledRadius(options.borderRadius, scale));
+        if (!encodeImage(surface->getCanvas(), format, options.quality, pages[index])) {
+            failed = true;
+        }
+    });
+    
+    return !failed;
+}
+
+bool SkiaRenderEngine::Impl::drawBackground(SkCanvas* canvas, int width, int height, const Text2Image_RenderOptions& options,
+                                            const SkRect& cover) {
+    // Opaque content over the whole canvas leaves nothing of the background to see
+    if (cover.contains(SkRect::MakeWH(width, height))) {
+        return true;
+    }
     
-    std::string nodeName(reinterpret_cast<const char*>(node->name));
+    SkAutoCanvasRestore restore(canvas, true);
+    if (!cover.isEmpty()) {
+        canvas->clipRect(cover, SkClipOp::kDifference);
+    }
     
-    // Handle text nodes
-    if (nodeName == "text" || nodeName == "#text") {
-        xmlChar* content = xmlNodeGetContent(node);
-        if (content) {
-            std::string text(reinterpret_cast<const char*>(content));
+    try {
+        if (options.backgroundType == TEXT2IMAGE_BACKGROUND_SOLID) {
+            // Draw solid background color
+            SkPaint paint;
+            paint.setColor(options.backgroundColor);
+            canvas->drawRect(SkRect::MakeWH(width, height), paint);
+        }
+        else if (options.backgroundType == TEXT2IMAGE_BACKGROUND_IMAGE && options.backgroundImage) {
+            // Load and draw background image
+            sk_sp<SkImage> image = loadImage(options.backgroundImage);
+            if (!image) {
+                return false;
+            }
             
-            // Create paint for text
+            // Draw the image scaled to fit the canvas
             SkPaint paint;
-            paint.setColor(SK_ColorBLACK);
             
-            // Create font
-            SkFont font;
-            font.setSize(16);
+            // Apply blur if needed
+            if (options.backgroundBlur > 0) {
+                // In a real implementation, we would apply a blur filter here
+                // For now, we'll just draw the image as is
+            }
+            
+            // Calculate the scaling factor to fit the image to the canvas
+            SkScalar scaleX = static_cast<SkScalar>(width) / image->width();
+            SkScalar scaleY = static_cast<SkScalar>(height) / image->height();
+            SkScalar scale = std::max(scaleX, scaleY);
             
-            // Draw text
-            canvas->drawSimpleText(text.c_str(), text.length(), SkTextEncoding::kUTF8, x, y + 16, font, paint);
+            // Calculate the position to center the image
+            SkScalar x = (width - image->width() * scale) / 2;
+            SkScalar y = (height - image->height() * scale) / 2;
             
-            xmlFree(content);
+            // Draw the image
+            canvas->save();
+            canvas->translate(x, y);
+            canvas->scale(scale, scale);
+            canvas->drawImage(image, 0, 0, &paint);
+            canvas->restore();
+        }
+        
+        return true;
+    }
+    catch (const std::exception& e) {
+        // Handle exception
+        return false;
+    }
+    catch (...) {
+        // Handle unknown exception
+        return false;
+    }
+}
+
+void SkiaRenderEngine::Impl::drawOverdraw(SkCanvas* canvas, int width, int height, const DisplayListView& content, const SkRect& cover) {
+    sk_sp<SkSurface> counts = SkSurface::MakeRaster(SkImageInfo::MakeA8(width, height));
+    if (!counts) {
+        return;
+    }
+    
+    // Every write adds one step of alpha to the pixels it touches
+    SkCanvas* countCanvas = counts->getCanvas();
+    countCanvas->clear(SK_ColorTRANSPARENT);
+    SkPaint paint;
+    paint.setColor(SkColorSetARGB(kOverdrawStep, 0, 0, 0));
+    paint.setBlendMode(SkBlendMode::kPlus);
+    
+    const SkRect canvasRect = SkRect::MakeWH(width, height);
+    if (!cover.contains(canvasRect)) {
+        countCanvas->save();
+        if (!cover.isEmpty()) {
+            countCanvas->clipRect(cover, SkClipOp::kDifference);
+        }
+        countCanvas->drawRect(canvasRect, paint);
+        countCanvas->restore();
+    }
+    DisplayList::drawCoverage(content, countCanvas, paint);
+    
+    SkPixmap pixmap;
+    if (!counts->peekPixels(&pixmap)) {
+        return;
+    }
+    
+    const size_t lastColor = sizeof(kOverdrawColors) / sizeof(kOverdrawColors[0]) - 1;
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = pixmap.addr8(0, y);
+        uint8_t* out = &pixels[static_cast<size_t>(y) * width * 4];
+        for (int x = 0; x < width; ++x) {
+            size_t writes = std::min<size_t>((row[x] + kOverdrawStep / 2) / kOverdrawStep, lastColor);
+            out[0] = kOverdrawColors[writes][0];
+            out[1] = kOverdrawColors[writes][1];
+            out[2] = kOverdrawColors[writes][2];
+            out[3] = 0xFF;
+            out += 4;
         }
     }
     
-    // Handle other elements
-    // This is a very simplified implementation
-    // In a real implementation, we would handle different HTML elements properly
+    SkImageInfo info = SkImageInfo::Make(width, height, kRGBA_8888_SkColorType, kOpaque_SkAlphaType);
+    canvas->writePixels(info, pixels.data(), static_cast<size_t>(width) * 4, 0, 0);
+}
+
+sk_sp<SkSurface> SkiaRenderEngine::Impl::applyBorderRadius(sk_sp<SkSurface> surface, const SkImageInfo& info, int borderRadius) {
+    if (borderRadius <= 0) {
+        return surface;
+    }
+    
+    // Create a new surface with rounded corners
+    SkPath path;
+    path.addRoundRect(SkRect::MakeWH(info.width(), info.height()), borderRadius, borderRadius);
     
-    // Render child nodes
-    for (xmlNode* child = node->children; child; child = child->next) {
-        renderElement(canvas, child, x, y + 20, width);
+    sk_sp<SkSurface> roundedSurface = SkSurface::MakeRaster(info);
+    if (!roundedSurface) {
+        return surface;
     }
+    SkCanvas* roundedCanvas = roundedSurface->getCanvas();
+    
+    // Clear the canvas
+    roundedCanvas->clear(SK_ColorTRANSPARENT);
+    
+    // Clip to rounded rectangle
+    roundedCanvas->clipPath(path, true);
+    
+    // Draw the original surface
+    sk_sp<SkImage> image = surface->makeImageSnapshot();
+    roundedCanvas->drawImage(image, 0, 0);
+    
+    return roundedSurface;
 }
 
-std::string SkiaRenderEngine::Impl::highlightCode(const std::string& code, const std::string& language) {
-    // In a real implementation, we would implement code highlighting
-    // For now, just return the code as is
-    return code;
+bool SkiaRenderEngine::Impl::encodeImage(SkCanvas* canvas, SkEncodedImageFormat format, int quality, std::vector<uint8_t>& output,
+                                         bool draft) {
+    // Create an image snapshot of the canvas
+    return encodeImage(canvas->makeImageSnapshot(), format, quality, output, draft);
+}
+
+bool SkiaRenderEngine::Impl::encodeImage(const sk_sp<SkImage>& image, SkEncodedImageFormat format, int quality, std::vector<uint8_t>& output,
+                                         bool draft) {
+    try {
+        if (!image) {
+            return false;
+        }
+        
+        // Encode the image
+        SkDynamicMemoryWStream stream;
+        SkPixmap pixmap;
+        if (draft && format == SkEncodedImageFormat::kPNG && image->peekPixels(&pixmap)) {
+            // Unfiltered rows and the lightest deflate level
+            SkPngEncoder::Options png;
+            png.fFilterFlags = SkPngEncoder::FilterFlag::kNone;
+            png.fZLibLevel = 1;
+            if (!SkPngEncoder::Encode(&stream, pixmap, png)) {
+                return false;
+            }
+        }
+        else if (draft && format == SkEncodedImageFormat::kWEBP && image->peekPixels(&pixmap)) {
+            // Lossless WebP searches much harder than lossy
+            SkWebpEncoder::Options webp;
+            webp.fCompression = SkWebpEncoder::Compression::kLossy;
+            webp.fQuality = static_cast<float>(std::min(quality, 90));
+            if (!SkWebpEncoder::Encode(&stream, pixmap, webp)) {
+                return false;
+            }
+        }
+        else if (!image->encodeToStream(&stream, format, quality)) {
+            return false;
+        }
+        
+        // Get the encoded data
+        sk_sp<SkData> data = stream.detachAsData();
+        if (!data) {
+            return false;
+        }
+        
+        // Copy the data to the output vector
+        output.resize(data->size());
+        std::memcpy(output.data(), data->data(), data->size());
+        
+        return true;
+    }
+    catch (const std::exception& e) {
+        // Handle exception
+        return false;
+    }
+    catch (...) {
+        // Handle unknown exception
+        return false;
+    }
+}
+
+bool SkiaRenderEngine::Impl::parseCss(const std::string& css, RenderDocument& document) {
+    // Rules are parsed once per document and matched during layout
+    document.styles.reset(new StyleResolver(css));
+    return true;
+}
+
+sk_sp<SkTypeface> SkiaRenderEngine::Impl::loadFont(const std::string& fontFamily, int weight, bool italic) {
+    SkFontStyle style(weight, SkFontStyle::kNormal_Width,
+                      italic ? SkFontStyle::kItalic_Slant : SkFontStyle::kUpright_Slant);
+    sk_sp<SkTypeface> typeface = SkTypeface::MakeFromName(fontFamily.empty() ? nullptr : fontFamily.c_str(), style);
+    return typeface ? typeface : SkTypeface::MakeDefault();
 }
 
 sk_sp<SkImage> SkiaRenderEngine::Impl::loadImage(const std::string& path) {
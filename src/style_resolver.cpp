@@ -0,0 +1,1049 @@
+/*
+ * Text2Image Style Resolver Implementation
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the implementation of the StyleResolver class.
+ */
+
+#include "style_resolver.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+namespace text2image {
+
+namespace {
+
+// Largest tab-size honoured; tabs are expanded to this many spaces at most
+const int kMaxTabSize = 64;
+
+const char* const kHiddenTags[] = {
+    "head", "link", "meta", "noscript", "script", "style", "template", "title"
+};
+
+const char* const kBlockTags[] = {
+    "address", "article", "aside", "blockquote", "body", "caption", "center", "dd", "details",
+    "dialog", "div", "dl", "dt", "fieldset", "figcaption", "figure", "footer", "form", "h1", "h2",
+    "h3", "h4", "h5", "h6", "header", "hr", "html", "main", "nav", "ol", "p", "pre", "section",
+    "summary", "tbody", "tfoot", "thead", "ul"
+};
+
+bool inList(const std::string& tag, const char* const* list, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (tag == list[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string lowerCase(const std::string& value) {
+    std::string result(value);
+    std::transform(result.begin(), result.end(), result.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return result;
+}
+
+// Split on whitespace outside parentheses, so "rgba(0, 0, 0, 0.1)" stays one word
+std::vector<std::string> splitWords(const std::string& value) {
+    std::vector<std::string> words;
+    std::string word;
+    int depth = 0;
+    for (char c : value) {
+        if (c == '(') ++depth;
+        else if (c == ')' && depth > 0) --depth;
+        if (depth == 0 && std::isspace(static_cast<unsigned char>(c))) {
+            if (!word.empty()) {
+                words.push_back(word);
+                word.clear();
+            }
+        }
+        else {
+            word.push_back(c);
+        }
+    }
+    if (!word.empty()) {
+        words.push_back(word);
+    }
+    return words;
+}
+
+std::string getAttribute(xmlNode* element, const char* name) {
+    xmlChar* value = xmlGetProp(element, reinterpret_cast<const xmlChar*>(name));
+    if (!value) {
+        return std::string();
+    }
+    std::string result(reinterpret_cast<const char*>(value));
+    xmlFree(value);
+    return result;
+}
+
+bool isMonospaceFamily(const std::string& family) {
+    return family == "monospace";
+}
+
+bool parseBorderWidth(const std::string& value, float fontSize, float& width) {
+    if (value == "thin") { width = 1.0f; return true; }
+    if (value == "medium") { width = 3.0f; return true; }
+    if (value == "thick") { width = 5.0f; return true; }
+    return parseCssLength(value, fontSize, width);
+}
+
+// Expand a 1-4 value box shorthand (margin, padding, border-width)
+bool parseBoxShorthand(const std::string& value, float fontSize, float out[4], bool borderWidths) {
+    std::vector<std::string> parts = splitWords(value);
+    if (parts.empty() || parts.size() > 4) {
+        return false;
+    }
+
+    float values[4];
+    for (size_t i = 0; i < parts.size(); ++i) {
+        if (parts[i] == "auto") {
+            values[i] = 0.0f;
+        }
+        else if (!(borderWidths ? parseBorderWidth(parts[i], fontSize, values[i])
+                                : parseCssLength(parts[i], fontSize, values[i]))) {
+            return false;
+        }
+    }
+
+    // top, right = top, bottom = top, left = right
+    out[SIDE_TOP] = values[0];
+    out[SIDE_RIGHT] = parts.size() > 1 ? values[1] : values[0];
+    out[SIDE_BOTTOM] = parts.size() > 2 ? values[2] : values[0];
+    out[SIDE_LEFT] = parts.size() > 3 ? values[3] : out[SIDE_RIGHT];
+    return true;
+}
+
+// Parse "1px solid #ccc" style border values
+void parseBorder(const std::string& value, float fontSize, float& width, uint32_t& color, bool& hasColor) {
+    width = 3.0f;
+    hasColor = false;
+    for (const std::string& part : splitWords(value)) {
+        std::string lower = lowerCase(part);
+        float length;
+        if (lower == "none" || lower == "hidden") {
+            width = 0.0f;
+            return;
+        }
+        if (parseBorderWidth(lower, fontSize, length)) {
+            width = length;
+        }
+        else if (parseCssColor(part, color)) {
+            hasColor = true;
+        }
+    }
+}
+
+// Parse the first shadow of a box-shadow list. Inset shadows are not drawn.
+void parseBoxShadow(const std::string& value, float fontSize, ComputedStyle& style) {
+    style.shadowColor = 0;
+
+    int depth = 0;
+    size_t end = 0;
+    for (; end < value.size(); ++end) {
+        if (value[end] == '(') ++depth;
+        else if (value[end] == ')' && depth > 0) --depth;
+        else if (value[end] == ',' && depth == 0) break;
+    }
+
+    float lengths[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    int lengthCount = 0;
+    uint32_t color = style.color;
+    for (const std::string& part : splitWords(value.substr(0, end))) {
+        std::string lower = lowerCase(part);
+        float length;
+        if (lower == "none" || lower == "inset") {
+            return;
+        }
+        if (lengthCount < 4 && parseCssLength(lower, fontSize, length)) {
+            lengths[lengthCount++] = length;
+        }
+        else if (!parseCssColor(part, color)) {
+            return;
+        }
+    }
+    if (lengthCount < 2) {
+        return;
+    }
+
+    style.shadowOffsetX = lengths[0];
+    style.shadowOffsetY = lengths[1];
+    style.shadowBlur = std::max(lengths[2], 0.0f);
+    style.shadowSpread = lengths[3];
+    style.shadowColor = color;
+}
+
+int sideIndex(const std::string& side) {
+    if (side == "top") return SIDE_TOP;
+    if (side == "right") return SIDE_RIGHT;
+    if (side == "bottom") return SIDE_BOTTOM;
+    if (side == "left") return SIDE_LEFT;
+    return -1;
+}
+
+bool parseFontSize(const std::string& value, float parentSize, float& size) {
+    static const struct { const char* name; float size; } kKeywords[] = {
+        {"xx-small", 9.0f}, {"x-small", 10.0f}, {"small", 13.0f}, {"medium", 16.0f},
+        {"large", 18.0f}, {"x-large", 24.0f}, {"xx-large", 32.0f}
+    };
+    for (const auto& keyword : kKeywords) {
+        if (value == keyword.name) {
+            size = keyword.size;
+            return true;
+        }
+    }
+    if (value == "smaller") {
+        size = parentSize / 1.2f;
+        return true;
+    }
+    if (value == "larger") {
+        size = parentSize * 1.2f;
+        return true;
+    }
+    return parseCssLength(value, parentSize, size);
+}
+
+void applyLineHeight(const std::string& value, ComputedStyle& style) {
+    if (value == "normal") {
+        style.lineHeightScale = 1.2f;
+        return;
+    }
+
+    char* end = nullptr;
+    float number = std::strtof(value.c_str(), &end);
+    if (end != value.c_str() && *end == '\0') {
+        style.lineHeightScale = number;
+        return;
+    }
+
+    float px;
+    if (parseCssLength(value, style.fontSize, px)) {
+        style.lineHeight = px;
+        style.lineHeightScale = 0.0f;
+    }
+}
+
+// The font shorthand: [style] [weight] size[/line-height] family
+void applyFontShorthand(const std::string& value, ComputedStyle& style, const ComputedStyle& parent) {
+    std::vector<std::string> parts = splitWords(value);
+    for (size_t i = 0; i < parts.size(); ++i) {
+        std::string part = lowerCase(parts[i]);
+        std::string sizePart = part.substr(0, part.find('/'));
+        float size;
+        if (parseFontSize(sizePart, parent.fontSize, size)) {
+            style.fontSize = size;
+            if (part.find('/') != std::string::npos) {
+                applyLineHeight(part.substr(part.find('/') + 1), style);
+            }
+
+            std::string families;
+            for (size_t j = i + 1; j < parts.size(); ++j) {
+                families += (j > i + 1 ? " " : "") + parts[j];
+            }
+            std::vector<std::string> list = parseCssFontFamilies(families);
+            if (!list.empty()) {
+                style.fontFamily = list.front();
+            }
+            return;
+        }
+
+        if (part == "italic" || part == "oblique") {
+            style.italic = true;
+        }
+        else if (part != "normal") {
+            style.fontWeight = parseCssFontWeight(part, parent.fontWeight);
+        }
+    }
+}
+
+} // namespace
+
+ComputedStyle::ComputedStyle()
+    : display(Display::INLINE),
+      fontSize(16.0f),
+      fontWeight(400),
+      italic(false),
+      color(0xFF000000),
+      lineHeight(19.2f),
+      lineHeightScale(1.2f),
+      textAlign(TextAlign::LEFT),
+      whiteSpace(WhiteSpace::NORMAL),
+      listStyle(ListStyle::DISC),
+      tabSize(8),
+      underline(false),
+      lineThrough(false),
+      backgroundColor(0),
+      borderColor(0xFF000000),
+      borderRadius(0.0f),
+      shadowOffsetX(0.0f),
+      shadowOffsetY(0.0f),
+      shadowBlur(0.0f),
+      shadowSpread(0.0f),
+      shadowColor(0),
+      width(0.0f),
+      widthPercent(0.0f),
+      maxWidth(0.0f),
+      height(0.0f),
+      overflowHidden(false),
+      textFit(TextFit::NONE) {
+    for (int i = 0; i < 4; ++i) {
+        margin[i] = 0.0f;
+        padding[i] = 0.0f;
+        borderWidth[i] = 0.0f;
+    }
+}
+
+const ComputedStyle& ComputedStyle::initial() {
+    static const ComputedStyle style;
+    return style;
+}
+
+bool ComputedStyle::operator==(const ComputedStyle& other) const {
+    for (int i = 0; i < 4; ++i) {
+        if (margin[i] != other.margin[i] || padding[i] != other.padding[i] || borderWidth[i] != other.borderWidth[i]) {
+            return false;
+        }
+    }
+    return display == other.display &&
+           fontSize == other.fontSize &&
+           fontWeight == other.fontWeight &&
+           italic == other.italic &&
+           color == other.color &&
+           lineHeight == other.lineHeight &&
+           lineHeightScale == other.lineHeightScale &&
+           textAlign == other.textAlign &&
+           whiteSpace == other.whiteSpace &&
+           listStyle == other.listStyle &&
+           tabSize == other.tabSize &&
+           underline == other.underline &&
+           lineThrough == other.lineThrough &&
+           backgroundColor == other.backgroundColor &&
+           borderColor == other.borderColor &&
+           borderRadius == other.borderRadius &&
+           shadowOffsetX == other.shadowOffsetX &&
+           shadowOffsetY == other.shadowOffsetY &&
+           shadowBlur == other.shadowBlur &&
+           shadowSpread == other.shadowSpread &&
+           shadowColor == other.shadowColor &&
+           width == other.width &&
+           widthPercent == other.widthPercent &&
+           maxWidth == other.maxWidth &&
+           height == other.height &&
+           overflowHidden == other.overflowHidden &&
+           textFit == other.textFit &&
+           fontFamily == other.fontFamily;
+}
+
+size_t ComputedStyle::hash() const {
+    // FNV-1a over the fields most likely to differ; equality settles the rest
+    uint64_t value = 14695981039346656037ULL;
+    auto mix = [&value](uint32_t bits) {
+        value = (value ^ bits) * 1099511628211ULL;
+    };
+    auto mixFloat = [&mix](float number) {
+        uint32_t bits;
+        std::memcpy(&bits, &number, sizeof(bits));
+        mix(bits);
+    };
+
+    mix(static_cast<uint32_t>(display));
+    mixFloat(fontSize);
+    mix(static_cast<uint32_t>(fontWeight) | (italic ? 0x10000u : 0u));
+    mix(color);
+    mix(backgroundColor);
+    mixFloat(lineHeight);
+    for (int i = 0; i < 4; ++i) {
+        mixFloat(margin[i]);
+        mixFloat(padding[i]);
+    }
+    for (unsigned char c : fontFamily) {
+        mix(c);
+    }
+    return static_cast<size_t>(value);
+}
+
+ComputedStyleStore::ComputedStyleStore(size_t maxEntries)
+    : m_maxEntries(maxEntries) {
+}
+
+std::shared_ptr<const ComputedStyle> ComputedStyleStore::intern(const ComputedStyle& style) {
+    const size_t hash = style.hash();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto range = m_styles.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (*it->second == style) {
+            return it->second;
+        }
+    }
+
+    // Past the bound, start over; records already handed out stay alive
+    if (m_styles.size() >= m_maxEntries) {
+        m_styles.clear();
+    }
+
+    auto interned = std::make_shared<const ComputedStyle>(style);
+    m_styles.emplace(hash, interned);
+    return interned;
+}
+
+size_t ComputedStyleStore::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_styles.size();
+}
+
+void ComputedStyleStore::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_styles.clear();
+}
+
+namespace {
+
+// FNV-1a, seeded with the kind of name so a tag and a class never collide
+uint32_t nameHash(char kind, const std::string& name) {
+    uint32_t hash = (2166136261u ^ static_cast<unsigned char>(kind)) * 16777619u;
+    for (unsigned char c : name) {
+        hash = (hash ^ c) * 16777619u;
+    }
+    return hash;
+}
+
+} // namespace
+
+AncestorFilter::AncestorFilter() {
+    std::memset(m_bits, 0, sizeof(m_bits));
+}
+
+void AncestorFilter::addElement(xmlNode* element) {
+    add(tagHash(lowerCase(reinterpret_cast<const char*>(element->name))));
+    std::string id = getAttribute(element, "id");
+    if (!id.empty()) {
+        add(idHash(id));
+    }
+    for (const std::string& name : splitWords(getAttribute(element, "class"))) {
+        add(classHash(name));
+    }
+}
+
+// Two probes per name, from the low and high bits of the hash
+void AncestorFilter::add(uint32_t hash) {
+    const uint32_t bits = kWords * 64;
+    uint32_t first = hash % bits;
+    uint32_t second = (hash >> 16) % bits;
+    m_bits[first / 64] |= 1ULL << (first % 64);
+    m_bits[second / 64] |= 1ULL << (second % 64);
+}
+
+bool AncestorFilter::mayContain(uint32_t hash) const {
+    const uint32_t bits = kWords * 64;
+    uint32_t first = hash % bits;
+    uint32_t second = (hash >> 16) % bits;
+    return (m_bits[first / 64] & (1ULL << (first % 64))) && (m_bits[second / 64] & (1ULL << (second % 64)));
+}
+
+uint32_t AncestorFilter::tagHash(const std::string& tag) {
+    return nameHash('t', tag);
+}
+
+uint32_t AncestorFilter::idHash(const std::string& id) {
+    return nameHash('#', id);
+}
+
+uint32_t AncestorFilter::classHash(const std::string& name) {
+    return nameHash('.', name);
+}
+
+StyleResolver::StyleResolver(const std::string& css) {
+    std::vector<CssRule> rules;
+    parseCssRules(css, rules);
+
+    for (const CssRule& rule : rules) {
+        CssDeclarations declarations = parseCssDeclarations(rule.declarations);
+        if (declarations.empty()) {
+            continue;
+        }
+
+        // Each selector in a list becomes its own rule with its own specificity
+        for (const std::string& text : splitCssSelectorList(rule.selector)) {
+            Rule parsed;
+            if (!parseSelector(text, parsed.selector)) {
+                continue;
+            }
+            parsed.declarations = declarations;
+            parsed.order = m_rules.size();
+
+            // Every name in a compound left of the subject must appear on some ancestor
+            const std::vector<CompoundSelector>& compounds = parsed.selector.compounds;
+            for (size_t i = 0; i + 1 < compounds.size(); ++i) {
+                if (!compounds[i].tag.empty()) {
+                    parsed.ancestorHashes.push_back(AncestorFilter::tagHash(compounds[i].tag));
+                }
+                if (!compounds[i].id.empty()) {
+                    parsed.ancestorHashes.push_back(AncestorFilter::idHash(compounds[i].id));
+                }
+                for (const std::string& name : compounds[i].classes) {
+                    parsed.ancestorHashes.push_back(AncestorFilter::classHash(name));
+                }
+            }
+            m_rules.push_back(std::move(parsed));
+        }
+    }
+}
+
+StyleResolver::~StyleResolver() {
+}
+
+std::shared_ptr<const ComputedStyle> StyleResolver::inheritFrom(const ComputedStyle& parent) const {
+    ComputedStyle style;
+    inherit(parent, style);
+    return m_store.intern(style);
+}
+
+void StyleResolver::inherit(const ComputedStyle& parent, ComputedStyle& style) {
+    style.fontFamily = parent.fontFamily;
+    style.fontSize = parent.fontSize;
+    style.fontWeight = parent.fontWeight;
+    style.italic = parent.italic;
+    style.color = parent.color;
+    style.lineHeight = parent.lineHeight;
+    style.lineHeightScale = parent.lineHeightScale;
+    style.textAlign = parent.textAlign;
+    style.whiteSpace = parent.whiteSpace;
+    style.listStyle = parent.listStyle;
+    style.tabSize = parent.tabSize;
+    style.underline = parent.underline;
+    style.lineThrough = parent.lineThrough;
+}
+
+std::shared_ptr<const ComputedStyle> StyleResolver::resolve(xmlNode* element, const ComputedStyle& parent,
+                                                            const AncestorFilter* ancestors) const {
+    ComputedStyle style;
+    inherit(parent, style);
+    std::string tag = lowerCase(reinterpret_cast<const char*>(element->name));
+
+    // Matching author rules in cascade order
+    std::vector<const Rule*> matched;
+    for (const Rule& rule : m_rules) {
+        if (ancestors) {
+            bool possible = true;
+            for (uint32_t hash : rule.ancestorHashes) {
+                if (!ancestors->mayContain(hash)) {
+                    possible = false;
+                    break;
+                }
+            }
+            if (!possible) {
+                continue;
+            }
+        }
+        if (matchesFrom(rule.selector, rule.selector.compounds.size() - 1, element)) {
+            matched.push_back(&rule);
+        }
+    }
+    std::stable_sort(matched.begin(), matched.end(), [](const Rule* a, const Rule* b) {
+        return a->selector.specificity < b->selector.specificity;
+    });
+
+    CssDeclarations inlineStyle;
+    std::string styleAttribute = getAttribute(element, "style");
+    if (!styleAttribute.empty()) {
+        inlineStyle = parseCssDeclarations(styleAttribute);
+    }
+
+    // Font size first, since em lengths in the user agent box defaults depend on it
+    applyUserAgentFont(tag, style, parent);
+    for (const Rule* rule : matched) {
+        for (const auto& declaration : rule->declarations) {
+            if (declaration.first == "font-size" || declaration.first == "font") {
+                applyDeclarations(CssDeclarations(1, declaration), style, parent);
+            }
+        }
+    }
+    for (const auto& declaration : inlineStyle) {
+        if (declaration.first == "font-size" || declaration.first == "font") {
+            applyDeclarations(CssDeclarations(1, declaration), style, parent);
+        }
+    }
+
+    applyUserAgentBox(tag, element, style);
+    for (const Rule* rule : matched) {
+        applyDeclarations(rule->declarations, style, parent);
+    }
+    applyDeclarations(inlineStyle, style, parent);
+
+    if (style.lineHeightScale > 0.0f) {
+        style.lineHeight = style.fontSize * style.lineHeightScale;
+    }
+    return m_store.intern(style);
+}
+
+StyleSharingCache::StyleSharingCache(const StyleResolver& resolver)
+    : m_resolver(resolver),
+      m_shared(0) {
+}
+
+std::shared_ptr<const ComputedStyle> StyleSharingCache::resolve(xmlNode* element, const ComputedStyle& parent) {
+    xmlNode* parentNode = element->parent;
+    if (!parentNode || parentNode->type != XML_ELEMENT_NODE) {
+        return m_resolver.resolve(element, parent);
+    }
+    ParentState& state = parentState(parentNode);
+
+    // Ids and inline styles make an element unique
+    const bool shareable = !xmlHasProp(element, reinterpret_cast<const xmlChar*>("id")) &&
+                           !xmlHasProp(element, reinterpret_cast<const xmlChar*>("style"));
+    std::string classes;
+    if (shareable) {
+        classes = getAttribute(element, "class");
+        for (const Candidate& candidate : state.candidates) {
+            if (candidate.style && candidate.parentStyle == &parent &&
+                xmlStrEqual(candidate.tag, element->name) && candidate.classes == classes) {
+                ++m_shared;
+                return candidate.style;
+            }
+        }
+    }
+
+    std::shared_ptr<const ComputedStyle> style = m_resolver.resolve(element, parent, &state.filter);
+    if (shareable) {
+        Candidate& slot = state.candidates[state.next];
+        slot.tag = element->name;
+        slot.classes = classes;
+        slot.parentStyle = &parent;
+        slot.style = style;
+        state.next = (state.next + 1) % kCandidates;
+    }
+    return style;
+}
+
+StyleSharingCache::ParentState& StyleSharingCache::parentState(xmlNode* parent) {
+    auto it = m_parents.find(parent);
+    if (it != m_parents.end()) {
+        return it->second;
+    }
+
+    AncestorFilter filter;
+    xmlNode* grandparent = parent->parent;
+    if (grandparent && grandparent->type == XML_ELEMENT_NODE) {
+        filter = parentState(grandparent).filter;
+    }
+    filter.addElement(parent);
+
+    ParentState& state = m_parents[parent];
+    state.filter = filter;
+    state.next = 0;
+    return state;
+}
+
+bool StyleResolver::parseSelector(const std::string& text, Selector& selector) {
+    selector.compounds.clear();
+    selector.combinators.clear();
+    selector.specificity = 0;
+
+    uint32_t ids = 0;
+    uint32_t classes = 0;
+    uint32_t tags = 0;
+    char pendingCombinator = 0;
+    bool inCompound = false;
+
+    auto readName = [&text](size_t& pos) {
+        size_t start = pos;
+        while (pos < text.size() && (std::isalnum(static_cast<unsigned char>(text[pos])) || text[pos] == '-' || text[pos] == '_')) {
+            ++pos;
+        }
+        return text.substr(start, pos - start);
+    };
+
+    size_t pos = 0;
+    while (pos < text.size()) {
+        char c = text[pos];
+        if (std::isspace(static_cast<unsigned char>(c)) || c == '>') {
+            if (c == '>') {
+                pendingCombinator = '>';
+            }
+            else if (!pendingCombinator) {
+                pendingCombinator = ' ';
+            }
+            inCompound = false;
+            ++pos;
+            continue;
+        }
+
+        // Sibling combinators, attributes and functional pseudo-classes are not supported
+        if (c == '+' || c == '~' || c == '[' || c == '(' || c == ',') {
+            return false;
+        }
+
+        if (!inCompound) {
+            if (!selector.compounds.empty()) {
+                selector.combinators.push_back(pendingCombinator ? pendingCombinator : ' ');
+            }
+            else if (pendingCombinator == '>') {
+                return false;
+            }
+            selector.compounds.push_back(CompoundSelector());
+            selector.compounds.back().root = false;
+            pendingCombinator = 0;
+            inCompound = true;
+        }
+
+        CompoundSelector& compound = selector.compounds.back();
+        if (c == '*') {
+            ++pos;
+        }
+        else if (c == '.') {
+            ++pos;
+            std::string name = readName(pos);
+            if (name.empty()) return false;
+            compound.classes.push_back(name);
+            ++classes;
+        }
+        else if (c == '#') {
+            ++pos;
+            std::string name = readName(pos);
+            if (name.empty()) return false;
+            compound.id = name;
+            ++ids;
+        }
+        else if (c == ':') {
+            ++pos;
+            std::string name = lowerCase(readName(pos));
+            if (name != "root") {
+                return false;
+            }
+            compound.root = true;
+            ++classes;
+        }
+        else {
+            std::string name = lowerCase(readName(pos));
+            if (name.empty()) return false;
+            compound.tag = name;
+            ++tags;
+        }
+    }
+
+    if (selector.compounds.empty() || pendingCombinator == '>') {
+        return false;
+    }
+
+    selector.specificity = (std::min(ids, 255u) << 16) | (std::min(classes, 255u) << 8) | std::min(tags, 255u);
+    return true;
+}
+
+bool StyleResolver::matchesCompound(const CompoundSelector& compound, xmlNode* element) {
+    if (!compound.tag.empty() && lowerCase(reinterpret_cast<const char*>(element->name)) != compound.tag) {
+        return false;
+    }
+    if (compound.root && (!element->parent || element->parent->type == XML_ELEMENT_NODE)) {
+        return false;
+    }
+    if (!compound.id.empty() && getAttribute(element, "id") != compound.id) {
+        return false;
+    }
+    if (!compound.classes.empty()) {
+        std::vector<std::string> classes = splitWords(getAttribute(element, "class"));
+        for (const std::string& name : compound.classes) {
+            if (std::find(classes.begin(), classes.end(), name) == classes.end()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool StyleResolver::matchesFrom(const Selector& selector, size_t index, xmlNode* element) {
+    if (!matchesCompound(selector.compounds[index], element)) {
+        return false;
+    }
+    if (index == 0) {
+        return true;
+    }
+
+    char combinator = selector.combinators[index - 1];
+    for (xmlNode* ancestor = element->parent; ancestor && ancestor->type == XML_ELEMENT_NODE; ancestor = ancestor->parent) {
+        if (matchesFrom(selector, index - 1, ancestor)) {
+            return true;
+        }
+        if (combinator == '>') {
+            break;
+        }
+    }
+    return false;
+}
+
+void StyleResolver::applyUserAgentFont(const std::string& tag, ComputedStyle& style, const ComputedStyle& parent) {
+    static const float kHeadingSizes[] = { 2.0f, 1.5f, 1.17f, 1.0f, 0.83f, 0.67f };
+
+    if (tag.size() == 2 && tag[0] == 'h' && tag[1] >= '1' && tag[1] <= '6') {
+        style.fontSize = parent.fontSize * kHeadingSizes[tag[1] - '1'];
+        style.fontWeight = 700;
+    }
+    else if (tag == "b" || tag == "strong" || tag == "th") {
+        style.fontWeight = std::max(parent.fontWeight, 700);
+    }
+    else if (tag == "i" || tag == "em" || tag == "cite" || tag == "var" || tag == "dfn" || tag == "address") {
+        style.italic = true;
+    }
+    else if (tag == "pre" || tag == "code" || tag == "kbd" || tag == "samp" || tag == "tt") {
+        // Monospace text defaults to 13px against a 16px proportional default
+        if (!isMonospaceFamily(parent.fontFamily)) {
+            style.fontSize = parent.fontSize * 0.8125f;
+        }
+        style.fontFamily = "monospace";
+    }
+    else if (tag == "small" || tag == "sub" || tag == "sup") {
+        style.fontSize = parent.fontSize * 0.83f;
+    }
+    else if (tag == "big") {
+        style.fontSize = parent.fontSize * 1.2f;
+    }
+}
+
+void StyleResolver::applyUserAgentBox(const std::string& tag, xmlNode* element, ComputedStyle& style) {
+    const float em = style.fontSize;
+
+    if (inList(tag, kHiddenTags, sizeof(kHiddenTags) / sizeof(kHiddenTags[0]))) {
+        style.display = Display::NONE;
+        return;
+    }
+    if (inList(tag, kBlockTags, sizeof(kBlockTags) / sizeof(kBlockTags[0]))) {
+        style.display = Display::BLOCK;
+    }
+
+    if (tag == "body") {
+        for (int i = 0; i < 4; ++i) style.margin[i] = 8.0f;
+    }
+    else if (tag.size() == 2 && tag[0] == 'h' && tag[1] >= '1' && tag[1] <= '6') {
+        static const float kHeadingMargins[] = { 0.67f, 0.83f, 1.0f, 1.33f, 1.67f, 2.33f };
+        style.margin[SIDE_TOP] = style.margin[SIDE_BOTTOM] = kHeadingMargins[tag[1] - '1'] * em;
+    }
+    else if (tag == "p" || tag == "dl" || tag == "pre") {
+        style.margin[SIDE_TOP] = style.margin[SIDE_BOTTOM] = em;
+    }
+    else if (tag == "ul" || tag == "ol") {
+        // Nested lists have no vertical margin
+        bool nested = element->parent && element->parent->type == XML_ELEMENT_NODE &&
+                      lowerCase(reinterpret_cast<const char*>(element->parent->name)) == "li";
+        if (!nested) {
+            style.margin[SIDE_TOP] = style.margin[SIDE_BOTTOM] = em;
+        }
+        style.padding[SIDE_LEFT] = 40.0f;
+        style.listStyle = tag == "ol" ? ListStyle::DECIMAL : ListStyle::DISC;
+    }
+    else if (tag == "li") {
+        style.display = Display::LIST_ITEM;
+    }
+    else if (tag == "blockquote" || tag == "figure") {
+        style.margin[SIDE_TOP] = style.margin[SIDE_BOTTOM] = em;
+        style.margin[SIDE_LEFT] = style.margin[SIDE_RIGHT] = 40.0f;
+    }
+    else if (tag == "dd") {
+        style.margin[SIDE_LEFT] = 40.0f;
+    }
+    else if (tag == "hr") {
+        style.margin[SIDE_TOP] = style.margin[SIDE_BOTTOM] = 0.5f * em;
+        for (int i = 0; i < 4; ++i) style.borderWidth[i] = 1.0f;
+        style.borderColor = 0xFF9A9A9A;
+    }
+    else if (tag == "table") {
+        style.display = Display::TABLE;
+    }
+    else if (tag == "tr") {
+        style.display = Display::TABLE_ROW;
+    }
+    else if (tag == "td" || tag == "th") {
+        style.display = Display::TABLE_CELL;
+        for (int i = 0; i < 4; ++i) style.padding[i] = 1.0f;
+        if (tag == "th") {
+            style.textAlign = TextAlign::CENTER;
+        }
+    }
+    else if (tag == "center" || tag == "caption") {
+        style.textAlign = TextAlign::CENTER;
+    }
+    else if (tag == "a") {
+        style.color = 0xFF0000EE;
+        style.underline = true;
+    }
+    else if (tag == "u" || tag == "ins") {
+        style.underline = true;
+    }
+    else if (tag == "s" || tag == "del" || tag == "strike") {
+        style.lineThrough = true;
+    }
+    else if (tag == "mark") {
+        style.backgroundColor = 0xFFFFFF00;
+        style.color = 0xFF000000;
+    }
+
+    if (tag == "pre") {
+        style.whiteSpace = WhiteSpace::PRE;
+    }
+}
+
+void StyleResolver::applyDeclarations(const CssDeclarations& declarations, ComputedStyle& style, const ComputedStyle& parent) {
+    for (const auto& declaration : declarations) {
+        const std::string& name = declaration.first;
+        const std::string& rawValue = declaration.second;
+        std::string value = lowerCase(rawValue);
+        const float em = style.fontSize;
+
+        if (value == "inherit") {
+            if (name == "color") style.color = parent.color;
+            else if (name == "font-size") style.fontSize = parent.fontSize;
+            else if (name == "font-family") style.fontFamily = parent.fontFamily;
+            else if (name == "background-color") style.backgroundColor = parent.backgroundColor;
+            continue;
+        }
+
+        if (name == "color") {
+            parseCssColor(rawValue, style.color);
+        }
+        else if (name == "background-color" || name == "background") {
+            if (!parseCssColor(rawValue, style.backgroundColor)) {
+                for (const std::string& part : splitWords(rawValue)) {
+                    if (parseCssColor(part, style.backgroundColor)) {
+                        break;
+                    }
+                }
+            }
+        }
+        else if (name == "font-size") {
+            parseFontSize(value, parent.fontSize, style.fontSize);
+        }
+        else if (name == "font-family") {
+            std::vector<std::string> families = parseCssFontFamilies(rawValue);
+            if (!families.empty()) {
+                style.fontFamily = families.front();
+            }
+        }
+        else if (name == "font-weight") {
+            style.fontWeight = parseCssFontWeight(value, parent.fontWeight);
+        }
+        else if (name == "font-style") {
+            style.italic = value == "italic" || value == "oblique";
+        }
+        else if (name == "font") {
+            applyFontShorthand(rawValue, style, parent);
+        }
+        else if (name == "line-height") {
+            applyLineHeight(value, style);
+        }
+        else if (name == "text-align") {
+            if (value == "center") style.textAlign = TextAlign::CENTER;
+            else if (value == "right" || value == "end") style.textAlign = TextAlign::RIGHT;
+            else style.textAlign = TextAlign::LEFT;
+        }
+        else if (name == "text-decoration" || name == "text-decoration-line") {
+            style.underline = value.find("underline") != std::string::npos;
+            style.lineThrough = value.find("line-through") != std::string::npos;
+        }
+        else if (name == "white-space") {
+            if (value == "pre" || value == "pre-wrap") style.whiteSpace = WhiteSpace::PRE;
+            else if (value == "nowrap") style.whiteSpace = WhiteSpace::NOWRAP;
+            else style.whiteSpace = WhiteSpace::NORMAL;
+        }
+        else if (name == "display") {
+            if (value == "none") style.display = Display::NONE;
+            else if (value == "inline" || value == "inline-block") style.display = Display::INLINE;
+            else if (value == "list-item") style.display = Display::LIST_ITEM;
+            else if (value == "table") style.display = Display::TABLE;
+            else if (value == "table-row") style.display = Display::TABLE_ROW;
+            else if (value == "table-cell") style.display = Display::TABLE_CELL;
+            else style.display = Display::BLOCK;
+        }
+        else if (name == "list-style-type" || name == "list-style") {
+            if (value.find("none") != std::string::npos) style.listStyle = ListStyle::NONE;
+            else if (value.find("decimal") != std::string::npos) style.listStyle = ListStyle::DECIMAL;
+            else style.listStyle = ListStyle::DISC;
+        }
+        else if (name == "tab-size") {
+            long tabSize = std::strtol(value.c_str(), nullptr, 10);
+            if (tabSize > 0) {
+                style.tabSize = static_cast<int>(std::min<long>(tabSize, kMaxTabSize));
+            }
+        }
+        else if (name == "margin") {
+            parseBoxShorthand(value, em, style.margin, false);
+        }
+        else if (name == "padding") {
+            parseBoxShorthand(value, em, style.padding, false);
+        }
+        else if (name.compare(0, 7, "margin-") == 0 && sideIndex(name.substr(7)) >= 0) {
+            float length;
+            if (value == "auto") style.margin[sideIndex(name.substr(7))] = 0.0f;
+            else if (parseCssLength(value, em, length)) style.margin[sideIndex(name.substr(7))] = length;
+        }
+        else if (name.compare(0, 8, "padding-") == 0 && sideIndex(name.substr(8)) >= 0) {
+            parseCssLength(value, em, style.padding[sideIndex(name.substr(8))]);
+        }
+        else if (name == "border") {
+            float width;
+            bool hasColor;
+            parseBorder(rawValue, em, width, style.borderColor, hasColor);
+            for (int i = 0; i < 4; ++i) style.borderWidth[i] = width;
+            if (!hasColor) style.borderColor = style.color;
+        }
+        else if (name.compare(0, 7, "border-") == 0 && sideIndex(name.substr(7)) >= 0) {
+            float width;
+            bool hasColor;
+            parseBorder(rawValue, em, width, style.borderColor, hasColor);
+            style.borderWidth[sideIndex(name.substr(7))] = width;
+            if (!hasColor) style.borderColor = style.color;
+        }
+        else if (name == "border-width") {
+            parseBoxShorthand(value, em, style.borderWidth, true);
+        }
+        else if (name == "border-color") {
+            parseCssColor(rawValue, style.borderColor);
+        }
+        else if (name == "border-style") {
+            if (value == "none" || value == "hidden") {
+                for (int i = 0; i < 4; ++i) style.borderWidth[i] = 0.0f;
+            }
+        }
+        else if (name == "border-radius") {
+            parseCssLength(value.substr(0, value.find(' ')), em, style.borderRadius);
+        }
+        else if (name == "box-shadow") {
+            parseBoxShadow(rawValue, em, style);
+        }
+        else if (name == "width") {
+            float length;
+            if (value == "auto") {
+                style.width = 0.0f;
+                style.widthPercent = 0.0f;
+            }
+            else if (!value.empty() && value.back() == '%') {
+                style.widthPercent = std::strtof(value.c_str(), nullptr);
+                style.width = 0.0f;
+            }
+            else if (parseCssLength(value, em, length)) {
+                style.width = length;
+            }
+        }
+        else if (name == "height") {
+            float length;
+            if (value == "auto") style.height = 0.0f;
+            else if (parseCssLength(value, em, length)) style.height = length;
+        }
+        else if (name == "max-width") {
+            float length;
+            if (value == "none") style.maxWidth = 0.0f;
+            else if (parseCssLength(value, em, length)) style.maxWidth = length;
+        }
+        else if (name == "overflow") {
+            style.overflowHidden = value == "hidden" || value == "clip";
+        }
+        else if (name == "text-fit") {
+            if (value == "fit") style.textFit = TextFit::FIT;
+            else if (value == "shrink") style.textFit = TextFit::SHRINK;
+            else style.textFit = TextFit::NONE;
+        }
+    }
+}
+
+} // namespace text2image
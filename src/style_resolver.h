@@ -0,0 +1,257 @@
+/*
+ * Text2Image Style Resolver
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the computed style model and the resolver that applies
+ * the user agent defaults and author stylesheet to document elements.
+ */
+
+#ifndef TEXT2IMAGE_STYLE_RESOLVER_H
+#define TEXT2IMAGE_STYLE_RESOLVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <libxml/tree.h>
+
+#include "css_parser.h"
+
+namespace text2image {
+
+enum class Display : uint8_t {
+    BLOCK = 0,
+    INLINE,
+    LIST_ITEM,
+    TABLE,
+    TABLE_ROW,
+    TABLE_CELL,
+    NONE
+};
+
+enum class TextAlign : uint8_t {
+    LEFT = 0,
+    CENTER,
+    RIGHT
+};
+
+enum class WhiteSpace : uint8_t {
+    NORMAL = 0,
+    PRE,
+    NOWRAP
+};
+
+enum class ListStyle : uint8_t {
+    NONE = 0,
+    DISC,
+    DECIMAL
+};
+
+// Non-standard text-fit: scale a block's inline text to the largest size
+// that fits its content box
+enum class TextFit : uint8_t {
+    NONE = 0,
+    FIT,          // Grow or shrink
+    SHRINK        // Only shrink below the specified size
+};
+
+// Box sides, in CSS shorthand order
+enum BoxSide {
+    SIDE_TOP = 0,
+    SIDE_RIGHT,
+    SIDE_BOTTOM,
+    SIDE_LEFT
+};
+
+// Resolved values for one element. Lengths are in CSS pixels, colors ARGB.
+struct ComputedStyle {
+    Display display;
+
+    // Inherited
+    std::string fontFamily;
+    float fontSize;
+    int fontWeight;
+    bool italic;
+    uint32_t color;
+    float lineHeight;         // Used line height in pixels
+    float lineHeightScale;    // Font-size multiple when line-height is a number, else 0
+    TextAlign textAlign;
+    WhiteSpace whiteSpace;
+    ListStyle listStyle;
+    int tabSize;
+    bool underline;           // Text decorations propagate to descendants
+    bool lineThrough;
+
+    // Not inherited
+    uint32_t backgroundColor;
+    float margin[4];
+    float padding[4];
+    float borderWidth[4];
+    uint32_t borderColor;
+    float borderRadius;
+    float shadowOffsetX;      // First outer box-shadow
+    float shadowOffsetY;
+    float shadowBlur;
+    float shadowSpread;
+    uint32_t shadowColor;     // Transparent for none
+    float width;              // 0 means auto
+    float widthPercent;       // Used when width is auto and this is positive
+    float maxWidth;           // 0 means none
+    float height;             // 0 means auto; only images and text-fit blocks use it
+    bool overflowHidden;
+    TextFit textFit;
+
+    ComputedStyle();
+
+    // Style of the initial containing block
+    static const ComputedStyle& initial();
+
+    bool isBlockLevel() const { return display != Display::INLINE && display != Display::NONE; }
+
+    // Field-wise comparison and hash, used for interning
+    bool operator==(const ComputedStyle& other) const;
+    bool operator!=(const ComputedStyle& other) const { return !(*this == other); }
+    size_t hash() const;
+};
+
+// Hash-consed set of computed styles. Equal styles intern to one shared,
+// ref-counted record, so two interned styles are equal exactly when their
+// pointers are. Thread-safe.
+class ComputedStyleStore {
+public:
+    explicit ComputedStyleStore(size_t maxEntries = 4096);
+
+    std::shared_ptr<const ComputedStyle> intern(const ComputedStyle& style);
+
+    size_t size() const;
+    void clear();
+
+private:
+    std::unordered_multimap<size_t, std::shared_ptr<const ComputedStyle>> m_styles;
+    size_t m_maxEntries;
+    mutable std::mutex m_mutex;
+};
+
+// Bloom filter over the tags, ids and classes of an element's ancestors.
+// A selector whose ancestor compounds name something not in the filter
+// cannot match, so it is rejected without walking up the tree.
+class AncestorFilter {
+public:
+    AncestorFilter();
+
+    // Add the tag, id and classes of one ancestor
+    void addElement(xmlNode* element);
+
+    void add(uint32_t hash);
+    bool mayContain(uint32_t hash) const;
+
+    static uint32_t tagHash(const std::string& tag);
+    static uint32_t idHash(const std::string& id);
+    static uint32_t classHash(const std::string& name);
+
+private:
+    static const size_t kWords = 16;  // 1024 bits
+    uint64_t m_bits[kWords];
+};
+
+// Matches author rules against elements and computes their styles
+class StyleResolver {
+public:
+    explicit StyleResolver(const std::string& css);
+    ~StyleResolver();
+
+    // Compute the style of an element given its parent's computed style. When
+    // ancestors is given it must hold every ancestor of element.
+    std::shared_ptr<const ComputedStyle> resolve(xmlNode* element, const ComputedStyle& parent,
+                                                 const AncestorFilter* ancestors = nullptr) const;
+
+    // Style for anonymous text inside an element
+    std::shared_ptr<const ComputedStyle> inheritFrom(const ComputedStyle& parent) const;
+
+    // Intern a style derived from one this resolver handed out
+    std::shared_ptr<const ComputedStyle> intern(const ComputedStyle& style) const { return m_store.intern(style); }
+
+    // Number of distinct styles resolved so far
+    size_t getStyleCount() const { return m_store.size(); }
+
+private:
+    struct CompoundSelector {
+        std::string tag;      // Empty for any element
+        std::string id;
+        std::vector<std::string> classes;
+        bool root;            // :root
+    };
+
+    struct Selector {
+        std::vector<CompoundSelector> compounds;  // Leftmost first
+        std::vector<char> combinators;            // ' ' or '>' between compounds
+        uint32_t specificity;
+    };
+
+    struct Rule {
+        Selector selector;
+        CssDeclarations declarations;
+        size_t order;
+        std::vector<uint32_t> ancestorHashes;     // Names an ancestor must carry
+    };
+
+    static void inherit(const ComputedStyle& parent, ComputedStyle& style);
+    static bool parseSelector(const std::string& text, Selector& selector);
+    static bool matchesCompound(const CompoundSelector& compound, xmlNode* element);
+    static bool matchesFrom(const Selector& selector, size_t index, xmlNode* element);
+
+    static void applyUserAgentFont(const std::string& tag, ComputedStyle& style, const ComputedStyle& parent);
+    static void applyUserAgentBox(const std::string& tag, xmlNode* element, ComputedStyle& style);
+    static void applyDeclarations(const CssDeclarations& declarations, ComputedStyle& style, const ComputedStyle& parent);
+
+    std::vector<Rule> m_rules;
+
+    // Every style handed out by this resolver is interned here
+    mutable ComputedStyleStore m_store;
+};
+
+// Per-layout front end to a StyleResolver. Siblings with the same tag and
+// class list, no id or inline style, and the same parent style share one
+// computed style, since no supported selector or user agent rule can tell
+// them apart. Ancestor filters are built once per parent element. Not
+// thread-safe; use one per layout pass.
+class StyleSharingCache {
+public:
+    explicit StyleSharingCache(const StyleResolver& resolver);
+
+    std::shared_ptr<const ComputedStyle> resolve(xmlNode* element, const ComputedStyle& parent);
+
+    // Styles reused from an earlier sibling instead of being resolved
+    size_t getShared() const { return m_shared; }
+
+private:
+    // Recent distinct styles under one parent; a few slots cover alternating rows
+    static const size_t kCandidates = 4;
+
+    struct Candidate {
+        const xmlChar* tag;
+        std::string classes;
+        const ComputedStyle* parentStyle;
+        std::shared_ptr<const ComputedStyle> style;
+    };
+
+    struct ParentState {
+        AncestorFilter filter;    // The parent and all of its ancestors
+        Candidate candidates[kCandidates];
+        size_t next;
+    };
+
+    ParentState& parentState(xmlNode* parent);
+
+    const StyleResolver& m_resolver;
+    std::unordered_map<xmlNode*, ParentState> m_parents;
+    size_t m_shared;
+};
+
+} // namespace text2image
+
+#endif // TEXT2IMAGE_STYLE_RESOLVER_H
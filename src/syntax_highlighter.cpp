@@ -0,0 +1,673 @@
+/*
+ * Text2Image Syntax Highlighter Implementation
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the implementation of the SyntaxHighlighter class.
+ */
+
+#include "syntax_highlighter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <initializer_list>
+#include <string_view>
+
+namespace text2image {
+
+namespace {
+
+// Character classes driving the lexer's dispatch
+enum CharClass : uint8_t {
+    CC_OTHER = 0,
+    CC_SPACE,
+    CC_NEWLINE,
+    CC_IDENT,     // Letters, '_' and non-ASCII bytes
+    CC_DIGIT,
+    CC_QUOTE,     // ' " `
+    CC_SLASH,
+    CC_HASH,
+    CC_DOLLAR,
+    CC_AT
+};
+
+struct CharClassTable {
+    uint8_t classes[256];
+
+    constexpr CharClassTable() : classes() {
+        for (int c = 0; c < 256; ++c) {
+            uint8_t cls = CC_OTHER;
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v') cls = CC_SPACE;
+            else if (c == '\n') cls = CC_NEWLINE;
+            else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c >= 0x80) cls = CC_IDENT;
+            else if (c >= '0' && c <= '9') cls = CC_DIGIT;
+            else if (c == '\'' || c == '"' || c == '`') cls = CC_QUOTE;
+            else if (c == '/') cls = CC_SLASH;
+            else if (c == '#') cls = CC_HASH;
+            else if (c == '$') cls = CC_DOLLAR;
+            else if (c == '@') cls = CC_AT;
+            classes[c] = cls;
+        }
+    }
+};
+
+constexpr CharClassTable kCharClasses;
+
+inline uint8_t classOf(char c) {
+    return kCharClasses.classes[static_cast<unsigned char>(c)];
+}
+
+inline bool isIdentChar(char c) {
+    uint8_t cls = classOf(c);
+    return cls == CC_IDENT || cls == CC_DIGIT;
+}
+
+// Sorted word list searched without allocating
+class WordTable {
+public:
+    WordTable(std::initializer_list<const char*> words) {
+        m_words.reserve(words.size());
+        for (const char* word : words) {
+            m_words.emplace_back(word);
+        }
+        std::sort(m_words.begin(), m_words.end());
+    }
+
+    bool contains(const char* text, size_t length) const {
+        return std::binary_search(m_words.begin(), m_words.end(), std::string_view(text, length));
+    }
+
+private:
+    std::vector<std::string_view> m_words;
+};
+
+// Lexer configuration for one language
+struct LanguageSpec {
+    bool slashComments;       // "//" line comments and "/* */" blocks
+    bool nestedComments;      // Block comments nest (Rust)
+    bool hashComments;        // '#' starts a line comment
+    bool preprocessor;        // '#' at line start is a directive (C/C++)
+    bool singleQuoteStrings;  // '...' is a string rather than a character
+    bool backtickStrings;     // `...` is a string (JS templates, Go raw strings)
+    bool backtickEscapes;     // Backslash escapes apply inside backticks
+    bool tripleQuotes;        // Python triple-quoted strings and prefixes
+    bool decorators;          // @name is metadata
+    bool rust;                // Raw strings, lifetimes, attributes and macros
+    bool shell;               // $VAR expansions, literal single quotes
+    bool json;                // Strings before ':' are keys
+    bool capitalizedTypes;    // CamelCase identifiers are types
+    WordTable keywords;
+    WordTable types;
+    WordTable literals;
+    WordTable builtins;
+};
+
+const LanguageSpec& getSpec(HighlightLanguage language) {
+    static const LanguageSpec cpp = {
+        true, false, false, true, false, false, false, false, false, false, false, false, true,
+        {"alignas", "alignof", "asm", "auto", "break", "case", "catch", "class", "co_await", "co_return",
+         "co_yield", "concept", "const", "const_cast", "consteval", "constexpr", "constinit", "continue",
+         "decltype", "default", "delete", "do", "dynamic_cast", "else", "enum", "explicit", "export",
+         "extern", "final", "for", "friend", "goto", "if", "inline", "mutable", "namespace", "new",
+         "noexcept", "operator", "override", "private", "protected", "public", "register",
+         "reinterpret_cast", "requires", "return", "sizeof", "static", "static_assert", "static_cast",
+         "struct", "switch", "template", "this", "thread_local", "throw", "try", "typedef", "typeid",
+         "typename", "union", "using", "virtual", "volatile", "while"},
+        {"bool", "char", "char16_t", "char32_t", "char8_t", "double", "float", "int", "int16_t",
+         "int32_t", "int64_t", "int8_t", "intptr_t", "long", "ptrdiff_t", "short", "signed", "size_t",
+         "ssize_t", "uint16_t", "uint32_t", "uint64_t", "uint8_t", "uintptr_t", "unsigned", "void",
+         "wchar_t"},
+        {"FALSE", "NULL", "TRUE", "false", "nullptr", "true"},
+        {}
+    };
+
+    static const LanguageSpec javascript = {
+        true, false, false, false, true, true, true, false, true, false, false, false, true,
+        {"abstract", "as", "async", "await", "break", "case", "catch", "class", "const", "constructor",
+         "continue", "debugger", "declare", "default", "delete", "do", "else", "enum", "export",
+         "extends", "finally", "for", "from", "function", "get", "if", "implements", "import", "in",
+         "instanceof", "interface", "is", "keyof", "let", "namespace", "new", "of", "private",
+         "protected", "public", "readonly", "return", "satisfies", "set", "static", "super", "switch",
+         "this", "throw", "try", "type", "typeof", "var", "void", "while", "with", "yield"},
+        {"any", "bigint", "boolean", "never", "number", "object", "string", "symbol", "unknown"},
+        {"Infinity", "NaN", "false", "null", "true", "undefined"},
+        {"console", "document", "globalThis", "module", "process", "require", "window"}
+    };
+
+    static const LanguageSpec python = {
+        false, false, true, false, true, false, false, true, true, false, false, false, true,
+        {"and", "as", "assert", "async", "await", "break", "case", "class", "continue", "def", "del",
+         "elif", "else", "except", "finally", "for", "from", "global", "if", "import", "in", "is",
+         "lambda", "match", "nonlocal", "not", "or", "pass", "raise", "return", "try", "while", "with",
+         "yield"},
+        {"bool", "bytearray", "bytes", "complex", "dict", "float", "frozenset", "int", "list",
+         "object", "set", "str", "tuple", "type"},
+        {"Ellipsis", "False", "None", "NotImplemented", "True"},
+        {"abs", "all", "any", "enumerate", "filter", "getattr", "hasattr", "isinstance", "len", "map",
+         "max", "min", "open", "print", "range", "repr", "self", "setattr", "sorted", "sum", "super",
+         "zip"}
+    };
+
+    static const LanguageSpec go = {
+        true, false, false, false, false, true, false, false, false, false, false, false, false,
+        {"break", "case", "chan", "const", "continue", "default", "defer", "else", "fallthrough", "for",
+         "func", "go", "goto", "if", "import", "interface", "map", "package", "range", "return",
+         "select", "struct", "switch", "type", "var"},
+        {"any", "bool", "byte", "complex128", "complex64", "error", "float32", "float64", "int",
+         "int16", "int32", "int64", "int8", "rune", "string", "uint", "uint16", "uint32", "uint64",
+         "uint8", "uintptr"},
+        {"false", "iota", "nil", "true"},
+        {"append", "cap", "close", "copy", "delete", "len", "make", "new", "panic", "print", "println",
+         "recover"}
+    };
+
+    static const LanguageSpec rust = {
+        true, true, false, false, false, false, false, false, false, true, false, false, true,
+        {"as", "async", "await", "break", "const", "continue", "crate", "dyn", "else", "enum", "extern",
+         "fn", "for", "if", "impl", "in", "let", "loop", "match", "mod", "move", "mut", "pub", "ref",
+         "return", "self", "static", "struct", "super", "trait", "type", "union", "unsafe", "use",
+         "where", "while", "yield"},
+        {"Self", "bool", "char", "f32", "f64", "i128", "i16", "i32", "i64", "i8", "isize", "str",
+         "u128", "u16", "u32", "u64", "u8", "usize"},
+        {"false", "true"},
+        {}
+    };
+
+    static const LanguageSpec json = {
+        false, false, false, false, false, false, false, false, false, false, false, true, false,
+        {},
+        {},
+        {"false", "null", "true"},
+        {}
+    };
+
+    static const LanguageSpec shell = {
+        false, false, true, false, true, true, false, false, false, false, true, false, false,
+        {"case", "do", "done", "elif", "else", "esac", "export", "fi", "for", "function", "if", "in",
+         "local", "readonly", "return", "select", "then", "until", "while"},
+        {},
+        {"false", "true"},
+        {"alias", "cat", "cd", "chmod", "cp", "curl", "echo", "eval", "exec", "exit", "git", "grep",
+         "ls", "mkdir", "mv", "printf", "pwd", "read", "rm", "sed", "set", "shift", "source", "sudo",
+         "test", "trap", "unset"}
+    };
+
+    switch (language) {
+        case HighlightLanguage::C_CPP: return cpp;
+        case HighlightLanguage::JAVASCRIPT: return javascript;
+        case HighlightLanguage::PYTHON: return python;
+        case HighlightLanguage::GO: return go;
+        case HighlightLanguage::RUST: return rust;
+        case HighlightLanguage::JSON: return json;
+        case HighlightLanguage::SHELL: return shell;
+        default: return cpp;
+    }
+}
+
+// Appends spans, merging neighbours of the same kind
+class SpanWriter {
+public:
+    explicit SpanWriter(HighlightSpans& spans) : m_spans(spans) {}
+
+    void add(size_t start, size_t end, TokenKind kind) {
+        if (end <= start) {
+            return;
+        }
+        if (!m_spans.empty()) {
+            HighlightSpan& last = m_spans.back();
+            if (last.kind == kind && last.offset + last.length == start) {
+                last.length = static_cast<uint32_t>(end - last.offset);
+                return;
+            }
+        }
+        m_spans.push_back({static_cast<uint32_t>(start), static_cast<uint32_t>(end - start), kind});
+    }
+
+private:
+    HighlightSpans& m_spans;
+};
+
+size_t skipToLineEnd(const char* code, size_t length, size_t i) {
+    const char* newline = static_cast<const char*>(std::memchr(code + i, '\n', length - i));
+    return newline ? static_cast<size_t>(newline - code) : length;
+}
+
+// Scan a quoted literal starting at the opening quote; returns the end offset
+size_t scanQuoted(const char* code, size_t length, size_t i, char quote, bool escapes, bool multiline) {
+    for (size_t j = i + 1; j < length; ++j) {
+        char c = code[j];
+        if (escapes && c == '\\') {
+            ++j;
+        }
+        else if (c == quote) {
+            return j + 1;
+        }
+        else if (c == '\n' && !multiline) {
+            return j;
+        }
+    }
+    return length;
+}
+
+// Python triple-quoted string starting at i; returns the end offset
+size_t scanTripleQuoted(const char* code, size_t length, size_t i) {
+    char quote = code[i];
+    for (size_t j = i + 3; j < length; ++j) {
+        if (code[j] == '\\') {
+            ++j;
+        }
+        else if (code[j] == quote && j + 2 < length && code[j + 1] == quote && code[j + 2] == quote) {
+            return j + 3;
+        }
+    }
+    return length;
+}
+
+// Rust raw string r#"..."# with the 'r' at i; returns the end offset or 0
+size_t scanRustRawString(const char* code, size_t length, size_t i) {
+    size_t j = i + 1;
+    size_t hashes = 0;
+    while (j < length && code[j] == '#') {
+        ++hashes;
+        ++j;
+    }
+    if (j >= length || code[j] != '"') {
+        return 0;
+    }
+
+    for (++j; j < length; ++j) {
+        if (code[j] != '"') {
+            continue;
+        }
+        size_t k = 0;
+        while (k < hashes && j + 1 + k < length && code[j + 1 + k] == '#') {
+            ++k;
+        }
+        if (k == hashes) {
+            return j + 1 + hashes;
+        }
+    }
+    return length;
+}
+
+size_t scanBlockComment(const char* code, size_t length, size_t i, bool nested) {
+    int depth = 0;
+    for (size_t j = i; j + 1 < length; ++j) {
+        if (code[j] == '/' && code[j + 1] == '*') {
+            if (depth == 0 || nested) ++depth;
+            ++j;
+        }
+        else if (code[j] == '*' && code[j + 1] == '/') {
+            ++j;
+            if (--depth == 0) return j + 1;
+        }
+    }
+    return length;
+}
+
+size_t scanNumber(const char* code, size_t length, size_t i) {
+    size_t j = i;
+    while (j < length) {
+        char c = code[j];
+        if (isIdentChar(c)) {
+            ++j;
+        }
+        else if (c == '.' && j + 1 < length && classOf(code[j + 1]) == CC_DIGIT) {
+            ++j;
+        }
+        else if ((c == '+' || c == '-') && j > i && (code[j - 1] == 'e' || code[j - 1] == 'E') &&
+                 !(j > i + 1 && (code[i + 1] == 'x' || code[i + 1] == 'X'))) {
+            ++j;
+        }
+        else {
+            break;
+        }
+    }
+    return j;
+}
+
+size_t skipSpaces(const char* code, size_t length, size_t i) {
+    while (i < length && (code[i] == ' ' || code[i] == '\t')) {
+        ++i;
+    }
+    return i;
+}
+
+} // namespace
+
+SyntaxHighlighter::SyntaxHighlighter(size_t maxEntries)
+    : m_maxEntries(maxEntries)
+    , m_hits(0)
+    , m_misses(0) {
+}
+
+SyntaxHighlighter::~SyntaxHighlighter() {
+}
+
+HighlightLanguage SyntaxHighlighter::resolveLanguage(const std::string& name) {
+    std::string value(name);
+    std::transform(value.begin(), value.end(), value.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    // Accept class names as written on <code> elements
+    if (value.compare(0, 9, "language-") == 0) {
+        value.erase(0, 9);
+    }
+    else if (value.compare(0, 5, "lang-") == 0) {
+        value.erase(0, 5);
+    }
+
+    if (value == "c" || value == "cpp" || value == "c++" || value == "cxx" || value == "cc" ||
+        value == "h" || value == "hpp" || value == "objc") {
+        return HighlightLanguage::C_CPP;
+    }
+    if (value == "js" || value == "javascript" || value == "jsx" || value == "ts" ||
+        value == "typescript" || value == "tsx" || value == "mjs" || value == "node") {
+        return HighlightLanguage::JAVASCRIPT;
+    }
+    if (value == "py" || value == "python" || value == "python3") {
+        return HighlightLanguage::PYTHON;
+    }
+    if (value == "go" || value == "golang") {
+        return HighlightLanguage::GO;
+    }
+    if (value == "rs" || value == "rust") {
+        return HighlightLanguage::RUST;
+    }
+    if (value == "json" || value == "jsonc") {
+        return HighlightLanguage::JSON;
+    }
+    if (value == "sh" || value == "shell" || value == "bash" || value == "zsh" || value == "console") {
+        return HighlightLanguage::SHELL;
+    }
+    return HighlightLanguage::NONE;
+}
+
+void SyntaxHighlighter::tokenize(const char* code, size_t length, HighlightLanguage language, HighlightSpans& spans) {
+    SpanWriter out(spans);
+    if (language == HighlightLanguage::NONE) {
+        out.add(0, length, TokenKind::PLAIN);
+        return;
+    }
+
+    const LanguageSpec& spec = getSpec(language);
+    bool lineStart = true;
+    size_t i = 0;
+
+    while (i < length) {
+        const size_t start = i;
+        const char c = code[i];
+        const char next = (i + 1 < length) ? code[i + 1] : '\0';
+        TokenKind kind = TokenKind::PLAIN;
+
+        switch (classOf(c)) {
+            case CC_NEWLINE:
+                out.add(start, ++i, TokenKind::PLAIN);
+                lineStart = true;
+                continue;
+
+            case CC_SPACE:
+                while (i < length && classOf(code[i]) == CC_SPACE) ++i;
+                out.add(start, i, TokenKind::PLAIN);
+                continue;
+
+            case CC_SLASH:
+                if (spec.slashComments && next == '/') {
+                    i = skipToLineEnd(code, length, i);
+                    kind = TokenKind::COMMENT;
+                }
+                else if (spec.slashComments && next == '*') {
+                    i = scanBlockComment(code, length, i, spec.nestedComments);
+                    kind = TokenKind::COMMENT;
+                }
+                else {
+                    ++i;
+                }
+                break;
+
+            case CC_HASH:
+                if (spec.preprocessor && lineStart) {
+                    // Directives run to the end of the line, honouring continuations
+                    do {
+                        i = skipToLineEnd(code, length, i);
+                        if (i < length && i > start && code[i - 1] == '\\') ++i;
+                        else break;
+                    } while (i < length);
+                    kind = TokenKind::META;
+                }
+                else if (spec.rust && (next == '[' || (next == '!' && i + 2 < length && code[i + 2] == '['))) {
+                    int depth = 0;
+                    for (; i < length; ++i) {
+                        if (code[i] == '[') ++depth;
+                        else if (code[i] == ']' && --depth == 0) { ++i; break; }
+                    }
+                    kind = TokenKind::META;
+                }
+                else if (spec.hashComments && (!spec.shell || start == 0 ||
+                         classOf(code[start - 1]) == CC_SPACE || classOf(code[start - 1]) == CC_NEWLINE)) {
+                    i = skipToLineEnd(code, length, i);
+                    kind = TokenKind::COMMENT;
+                }
+                else {
+                    ++i;
+                }
+                break;
+
+            case CC_QUOTE:
+                if (c == '`') {
+                    if (spec.backtickStrings) {
+                        i = scanQuoted(code, length, i, '`', spec.backtickEscapes, true);
+                        kind = TokenKind::STRING;
+                    }
+                    else {
+                        ++i;
+                    }
+                }
+                else if (spec.tripleQuotes && next == c && i + 2 < length && code[i + 2] == c) {
+                    i = scanTripleQuoted(code, length, i);
+                    kind = TokenKind::STRING;
+                }
+                else if (c == '\'' && spec.rust && isIdentChar(next) &&
+                         !(i + 2 < length && code[i + 2] == '\'')) {
+                    // Lifetime or loop label
+                    ++i;
+                    while (i < length && isIdentChar(code[i])) ++i;
+                    kind = TokenKind::META;
+                }
+                else if (c == '\'' && spec.shell) {
+                    i = scanQuoted(code, length, i, '\'', false, true);
+                    kind = TokenKind::STRING;
+                }
+                else {
+                    bool multiline = spec.shell;
+                    i = scanQuoted(code, length, i, c, true, multiline);
+                    kind = TokenKind::STRING;
+
+                    if (spec.json && c == '"') {
+                        size_t after = skipSpaces(code, length, i);
+                        if (after < length && code[after] == ':') {
+                            kind = TokenKind::PROPERTY;
+                        }
+                    }
+                }
+                break;
+
+            case CC_DIGIT:
+                i = scanNumber(code, length, i);
+                kind = TokenKind::NUMBER;
+                break;
+
+            case CC_DOLLAR:
+                if (spec.shell && next == '{') {
+                    const char* close = static_cast<const char*>(std::memchr(code + i, '}', length - i));
+                    i = close ? static_cast<size_t>(close - code) + 1 : length;
+                    kind = TokenKind::VARIABLE;
+                }
+                else if (spec.shell && (isIdentChar(next) || std::strchr("@#?$!*-", next) != nullptr) && next != '\0') {
+                    ++i;
+                    if (isIdentChar(code[i])) {
+                        while (i < length && isIdentChar(code[i])) ++i;
+                    }
+                    else {
+                        ++i;
+                    }
+                    kind = TokenKind::VARIABLE;
+                }
+                else if (language == HighlightLanguage::JAVASCRIPT && isIdentChar(next)) {
+                    // '$' is an identifier character in JavaScript
+                    ++i;
+                    while (i < length && (isIdentChar(code[i]) || code[i] == '$')) ++i;
+                }
+                else {
+                    ++i;
+                }
+                break;
+
+            case CC_AT:
+                if (spec.decorators && classOf(next) == CC_IDENT) {
+                    ++i;
+                    while (i < length && (isIdentChar(code[i]) || code[i] == '.')) ++i;
+                    kind = TokenKind::META;
+                }
+                else {
+                    ++i;
+                }
+                break;
+
+            case CC_IDENT: {
+                while (i < length && (isIdentChar(code[i]) || (language == HighlightLanguage::JAVASCRIPT && code[i] == '$'))) {
+                    ++i;
+                }
+                const size_t wordLength = i - start;
+                const char following = (i < length) ? code[i] : '\0';
+
+                // String prefixes: Python r"", b'', f"" and Rust r#""#, b""
+                if (spec.tripleQuotes && wordLength <= 2 && (following == '"' || following == '\'') &&
+                    std::all_of(code + start, code + i, [](char ch) { return std::strchr("rRbBfFuU", ch) != nullptr; })) {
+                    if (i + 2 < length && code[i + 1] == following && code[i + 2] == following) {
+                        i = scanTripleQuoted(code, length, i);
+                    }
+                    else {
+                        i = scanQuoted(code, length, i, following, true, false);
+                    }
+                    kind = TokenKind::STRING;
+                    break;
+                }
+                if (spec.rust && (wordLength == 1 || wordLength == 2) && code[i - 1] == 'r' &&
+                    (wordLength == 1 || code[start] == 'b') && (following == '"' || following == '#')) {
+                    size_t end = scanRustRawString(code, length, i - 1);
+                    if (end > 0) {
+                        i = end;
+                        kind = TokenKind::STRING;
+                        break;
+                    }
+                }
+                if (spec.rust && wordLength == 1 && code[start] == 'b' && (following == '"' || following == '\'')) {
+                    i = scanQuoted(code, length, i, following, true, following == '"');
+                    kind = TokenKind::STRING;
+                    break;
+                }
+
+                if (spec.keywords.contains(code + start, wordLength)) {
+                    kind = TokenKind::KEYWORD;
+                }
+                else if (spec.types.contains(code + start, wordLength)) {
+                    kind = TokenKind::TYPE;
+                }
+                else if (spec.literals.contains(code + start, wordLength)) {
+                    kind = TokenKind::LITERAL;
+                }
+                else if (spec.builtins.contains(code + start, wordLength)) {
+                    kind = TokenKind::FUNCTION;
+                }
+                else if (spec.rust && following == '!' && !(i + 1 < length && code[i + 1] == '=')) {
+                    ++i;
+                    kind = TokenKind::FUNCTION;
+                }
+                else if (!spec.json && !spec.shell) {
+                    size_t after = skipSpaces(code, length, i);
+                    if (after < length && code[after] == '(') {
+                        kind = TokenKind::FUNCTION;
+                    }
+                    else if (spec.capitalizedTypes && std::isupper(static_cast<unsigned char>(code[start])) &&
+                             std::any_of(code + start + 1, code + i, [](char ch) { return std::islower(static_cast<unsigned char>(ch)); })) {
+                        kind = TokenKind::TYPE;
+                    }
+                }
+                break;
+            }
+
+            default:
+                if (spec.json && c == '-' && classOf(next) == CC_DIGIT) {
+                    i = scanNumber(code, length, i + 1);
+                    kind = TokenKind::NUMBER;
+                }
+                else {
+                    ++i;
+                }
+                break;
+        }
+
+        out.add(start, i, kind);
+        lineStart = false;
+    }
+}
+
+std::shared_ptr<const HighlightSpans> SyntaxHighlighter::highlight(const std::string& code, const std::string& language) {
+    HighlightLanguage lang = resolveLanguage(language);
+    if (lang == HighlightLanguage::NONE) {
+        // Nothing to lex, and not worth a cache slot
+        auto spans = std::make_shared<HighlightSpans>();
+        tokenize(code.data(), code.size(), lang, *spans);
+        return spans;
+    }
+
+    // FNV-1a over the code, seeded with the language
+    uint64_t key = 14695981039346656037ULL ^ static_cast<uint64_t>(lang);
+    for (unsigned char c : code) {
+        key = (key ^ c) * 1099511628211ULL;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(key);
+        if (it != m_entries.end() && it->second.language == lang && it->second.code == code) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lruPosition);
+            ++m_hits;
+            return it->second.spans;
+        }
+    }
+    ++m_misses;
+
+    // Lex outside the lock so concurrent renders only serialize on lookups
+    auto spans = std::make_shared<HighlightSpans>();
+    spans->reserve(code.size() / 4 + 1);
+    tokenize(code.data(), code.size(), lang, *spans);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(key);
+    if (it != m_entries.end()) {
+        // Hash collision or a concurrent insert: keep the newest entry
+        it->second.code = code;
+        it->second.language = lang;
+        it->second.spans = spans;
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lruPosition);
+        return spans;
+    }
+
+    m_lru.push_front(key);
+    m_entries.emplace(key, CacheEntry{code, lang, spans, m_lru.begin()});
+    while (m_entries.size() > m_maxEntries && !m_lru.empty()) {
+        m_entries.erase(m_lru.back());
+        m_lru.pop_back();
+    }
+    return spans;
+}
+
+void SyntaxHighlighter::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_lru.clear();
+}
+
+} // namespace text2image
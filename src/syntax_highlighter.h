@@ -0,0 +1,99 @@
+/*
+ * Text2Image Syntax Highlighter
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the table-driven lexers used to highlight code blocks
+ * and the cache that lets popular snippets be lexed only once.
+ */
+
+#ifndef TEXT2IMAGE_SYNTAX_HIGHLIGHTER_H
+#define TEXT2IMAGE_SYNTAX_HIGHLIGHTER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace text2image {
+
+// Languages with a dedicated lexer
+enum class HighlightLanguage : uint8_t {
+    NONE = 0,
+    C_CPP,
+    JAVASCRIPT,   // Also covers TypeScript, JSX and TSX
+    PYTHON,
+    GO,
+    RUST,
+    JSON,
+    SHELL
+};
+
+// Token classes, mapped to colors by the renderer
+enum class TokenKind : uint8_t {
+    PLAIN = 0,
+    KEYWORD,
+    TYPE,
+    LITERAL,      // true/false/null and friends
+    NUMBER,
+    STRING,
+    COMMENT,
+    META,         // Preprocessor, decorators, attributes, lifetimes
+    FUNCTION,     // Called or declared function names, macros, builtins
+    VARIABLE,     // Shell expansions
+    PROPERTY,     // JSON object keys
+    COUNT
+};
+
+// Styled run over the source text. Runs cover the whole input in order.
+struct HighlightSpan {
+    uint32_t offset;
+    uint32_t length;
+    TokenKind kind;
+};
+
+typedef std::vector<HighlightSpan> HighlightSpans;
+
+class SyntaxHighlighter {
+public:
+    explicit SyntaxHighlighter(size_t maxEntries = 256);
+    ~SyntaxHighlighter();
+
+    // Highlight code, reusing cached spans for repeated (code, language) pairs
+    std::shared_ptr<const HighlightSpans> highlight(const std::string& code, const std::string& language);
+
+    // Map a language name or alias ("cpp", "ts", "bash", ...) to a lexer
+    static HighlightLanguage resolveLanguage(const std::string& name);
+
+    // Lex without caching; appends spans covering [0, length)
+    static void tokenize(const char* code, size_t length, HighlightLanguage language, HighlightSpans& spans);
+
+    // Cache statistics
+    size_t getHits() const { return m_hits; }
+    size_t getMisses() const { return m_misses; }
+
+    void clear();
+
+private:
+    struct CacheEntry {
+        std::string code;
+        HighlightLanguage language;
+        std::shared_ptr<const HighlightSpans> spans;
+        std::list<uint64_t>::iterator lruPosition;
+    };
+
+    std::unordered_map<uint64_t, CacheEntry> m_entries;
+    std::list<uint64_t> m_lru;  // Most recently used first
+    size_t m_maxEntries;
+    std::atomic<size_t> m_hits;
+    std::atomic<size_t> m_misses;
+    std::mutex m_mutex;
+};
+
+} // namespace text2image
+
+#endif // TEXT2IMAGE_SYNTAX_HIGHLIGHTER_H
@@ -6,6 +6,7 @@
  */
 
 #include "text2image_internal.h"
+#include "render_snapshot.h"
 
 #include <cstdlib>
 #include <algorithm>
@@ -18,6 +19,7 @@ Task::Task(const std::string& html, const std::string& css, const Text2Image_Ren
     , m_options(options)
     , m_status(TaskStatus::PENDING)
     , m_priority(TaskPriority::NORMAL)
+    , m_atlasOutput(TEXT2IMAGE_ATLAS_SHEET)
     , m_callback(nullptr)
     , m_userData(nullptr) {
     // Generate a unique handle for this task
@@ -27,4 +29,28 @@ Task::Task(const std::string& html, const std::string& css, const Text2Image_Ren
 Task::~Task() {
 }
 
+void Task::setBase(std::shared_ptr<Task> base) {
+    std::lock_guard<std::mutex> lock(m_snapshotMutex);
+    m_base = std::move(base);
+}
+
+std::shared_ptr<const RenderSnapshot> Task::takeBaseSnapshot() {
+    std::shared_ptr<Task> base;
+    {
+        std::lock_guard<std::mutex> lock(m_snapshotMutex);
+        base.swap(m_base);
+    }
+    return base ? base->getSnapshot() : nullptr;
+}
+
+std::shared_ptr<const RenderSnapshot> Task::getSnapshot() const {
+    std::lock_guard<std::mutex> lock(m_snapshotMutex);
+    return m_snapshot;
+}
+
+void Task::setSnapshot(std::shared_ptr<const RenderSnapshot> snapshot) {
+    std::lock_guard<std::mutex> lock(m_snapshotMutex);
+    m_snapshot = std::move(snapshot);
+}
+
 } // namespace text2image
\ No newline at end of file
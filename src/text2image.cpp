@@ -49,6 +49,125 @@ Text2Image_TaskHandle Text2Image_CreateTask(const char* html, const char* css, c
     return task->getHandle();
 }
 
+Text2Image_TaskHandle Text2Image_CreateAtlasTask(const Text2Image_AtlasItem* items, int count, Text2Image_AtlasOutput output,
+                                                 const Text2Image_RenderOptions* options) {
+    if (!items || count <= 0) {
+        text2image::g_context.setLastError("Invalid parameters");
+        return nullptr;
+    }
+
+    // Use default options if none provided
+    Text2Image_RenderOptions defaultOptions = Text2Image_GetDefaultOptions();
+    if (!options) {
+        options = &defaultOptions;
+    }
+
+    auto task = text2image::g_context.createAtlasTask(items, count, output, options);
+    if (!task) {
+        return nullptr;
+    }
+
+    return task->getHandle();
+}
+
+Text2Image_TaskHandle Text2Image_CreateAnimationTask(const Text2Image_Frame* frames, int count, const char* css,
+                                                     const Text2Image_RenderOptions* options) {
+    if (!frames || count <= 0) {
+        text2image::g_context.setLastError("Invalid parameters");
+        return nullptr;
+    }
+
+    // Use default options if none provided
+    Text2Image_RenderOptions defaultOptions = Text2Image_GetDefaultOptions();
+    if (!options) {
+        options = &defaultOptions;
+    }
+
+    auto task = text2image::g_context.createAnimationTask(frames, count, css ? css : "", options);
+    if (!task) {
+        return nullptr;
+    }
+
+    return task->getHandle();
+}
+
+Text2Image_TaskHandle Text2Image_CreateThumbnailTask(const char* html, const char* css, const Text2Image_Thumbnail* thumbnails,
+                                                     int count, const Text2Image_RenderOptions* options) {
+    if (!html || !thumbnails || count <= 0) {
+        text2image::g_context.setLastError("Invalid parameters");
+        return nullptr;
+    }
+
+    // Use default options if none provided
+    Text2Image_RenderOptions defaultOptions = Text2Image_GetDefaultOptions();
+    if (!options) {
+        options = &defaultOptions;
+    }
+
+    auto task = text2image::g_context.createThumbnailTask(html, css ? css : "", thumbnails, count, options);
+    if (!task) {
+        return nullptr;
+    }
+
+    return task->getHandle();
+}
+
+Text2Image_TaskHandle Text2Image_CreateIncrementalTask(Text2Image_TaskHandle baseTask, const char* html, const char* css,
+                                                       const Text2Image_RenderOptions* options) {
+    if (!baseTask || !html) {
+        text2image::g_context.setLastError("Invalid parameters");
+        return nullptr;
+    }
+
+    // Use default options if none provided
+    Text2Image_RenderOptions defaultOptions = Text2Image_GetDefaultOptions();
+    if (!options) {
+        options = &defaultOptions;
+    }
+
+    auto task = text2image::g_context.createIncrementalTask(baseTask, html, css ? css : "", options);
+    if (!task) {
+        return nullptr;
+    }
+
+    return task->getHandle();
+}
+
+Text2Image_TaskHandle Text2Image_CreateTaskFromCompiled(const char* compiledPath, const Text2Image_RenderOptions* options) {
+    if (!compiledPath) {
+        text2image::g_context.setLastError("Compiled document path cannot be null");
+        return nullptr;
+    }
+
+    // Use default options if none provided
+    Text2Image_RenderOptions defaultOptions = Text2Image_GetDefaultOptions();
+    if (!options) {
+        options = &defaultOptions;
+    }
+
+    auto task = text2image::g_context.createTaskFromCompiled(compiledPath, options);
+    if (!task) {
+        return nullptr;
+    }
+
+    return task->getHandle();
+}
+
+bool Text2Image_Compile(Text2Image_TaskHandle task, const char* outputPath) {
+    if (!task || !outputPath) {
+        text2image::g_context.setLastError("Invalid parameters");
+        return false;
+    }
+
+    auto taskPtr = text2image::g_context.getTask(task);
+    if (!taskPtr) {
+        text2image::g_context.setLastError("Task not found");
+        return false;
+    }
+
+    return text2image::g_context.compile(taskPtr, outputPath);
+}
+
 bool Text2Image_Render(Text2Image_TaskHandle task, const char* outputPath) {
     if (!task) {
         text2image::g_context.setLastError("Invalid task handle");
@@ -116,6 +235,87 @@ bool Text2Image_GetResult(Text2Image_TaskHandle task, uint8_t** buffer, size_t*
     return true;
 }
 
+int Text2Image_GetPageCount(Text2Image_TaskHandle task) {
+    if (!task) {
+        text2image::g_context.setLastError("Invalid task handle");
+        return 0;
+    }
+
+    auto taskPtr = text2image::g_context.getTask(task);
+    if (!taskPtr) {
+        text2image::g_context.setLastError("Task not found");
+        return 0;
+    }
+
+    if (taskPtr->getStatus() != text2image::TaskStatus::COMPLETED) {
+        return 0;
+    }
+
+    return static_cast<int>(taskPtr->getPageCount());
+}
+
+bool Text2Image_GetPageResult(Text2Image_TaskHandle task, int pageIndex, uint8_t** buffer, size_t* size) {
+    if (!task || !buffer || !size || pageIndex < 0) {
+        text2image::g_context.setLastError("Invalid parameters");
+        return false;
+    }
+
+    auto taskPtr = text2image::g_context.getTask(task);
+    if (!taskPtr) {
+        text2image::g_context.setLastError("Task not found");
+        return false;
+    }
+
+    if (taskPtr->getStatus() != text2image::TaskStatus::COMPLETED) {
+        text2image::g_context.setLastError("Task not completed");
+        return false;
+    }
+
+    if (static_cast<size_t>(pageIndex) >= taskPtr->getPageCount()) {
+        text2image::g_context.setLastError("Page index out of range");
+        return false;
+    }
+
+    const auto& page = taskPtr->getPage(static_cast<size_t>(pageIndex));
+    if (page.empty()) {
+        text2image::g_context.setLastError("No result available");
+        return false;
+    }
+
+    *buffer = new uint8_t[page.size()];
+    std::memcpy(*buffer, page.data(), page.size());
+    *size = page.size();
+
+    return true;
+}
+
+bool Text2Image_GetAtlasRect(Text2Image_TaskHandle task, int index, Text2Image_AtlasRect* rect) {
+    if (!task || !rect || index < 0) {
+        text2image::g_context.setLastError("Invalid parameters");
+        return false;
+    }
+
+    auto taskPtr = text2image::g_context.getTask(task);
+    if (!taskPtr) {
+        text2image::g_context.setLastError("Task not found");
+        return false;
+    }
+
+    if (taskPtr->getStatus() != text2image::TaskStatus::COMPLETED) {
+        text2image::g_context.setLastError("Task not completed");
+        return false;
+    }
+
+    const auto& rects = taskPtr->getAtlasRects();
+    if (static_cast<size_t>(index) >= rects.size()) {
+        text2image::g_context.setLastError("Atlas item index out of range");
+        return false;
+    }
+
+    *rect = rects[static_cast<size_t>(index)];
+    return true;
+}
+
 void Text2Image_FreeBuffer(uint8_t* buffer) {
     if (buffer) {
         delete[] buffer;
@@ -141,6 +341,46 @@ void Text2Image_SetMaxThreads(int numThreads) {
     text2image::g_context.getThreadPool().setMaxThreads(static_cast<size_t>(numThreads));
 }
 
+bool Text2Image_SetResourceResolver(Text2Image_ResourceResolver resolver, void* userData) {
+    return text2image::g_context.setResourceResolver(resolver, userData);
+}
+
+bool Text2Image_SetLocalImageDirectory(const char* directory) {
+    return text2image::g_context.setLocalImageDirectory(directory);
+}
+
+bool Text2Image_SetFontCacheLimits(size_t byteLimit, int countLimit) {
+    return text2image::g_context.setFontCacheLimits(byteLimit, countLimit);
+}
+
+void Text2Image_PurgeFontCache() {
+    text2image::g_context.purgeFontCache();
+}
+
+bool Text2Image_GetMetrics(Text2Image_Metrics* metrics) {
+    if (!metrics) {
+        text2image::g_context.setLastError("Invalid parameters");
+        return false;
+    }
+
+    return text2image::g_context.getMetrics(*metrics);
+}
+
+bool Text2Image_MeasureText(const char* text, const Text2Image_FontSpec* font, float maxWidth,
+                            Text2Image_TextMetrics* metrics) {
+    return Text2Image_MeasureTextBatch(&text, 1, font, maxWidth, metrics);
+}
+
+bool Text2Image_MeasureTextBatch(const char* const* texts, int count, const Text2Image_FontSpec* font, float maxWidth,
+                                 Text2Image_TextMetrics* metrics) {
+    if (!texts || count <= 0 || !font || !metrics || !(font->fontSize > 0) || !(maxWidth >= 0)) {
+        text2image::g_context.setLastError("Invalid parameters");
+        return false;
+    }
+
+    return text2image::g_context.measureText(texts, count, *font, maxWidth, metrics);
+}
+
 Text2Image_RenderOptions Text2Image_GetDefaultOptions() {
     Text2Image_RenderOptions options;
     
@@ -172,5 +412,23 @@ Text2Image_RenderOptions Text2Image_GetDefaultOptions() {
     // Default timeout: 30 seconds
     options.timeout = 30000;
     
+    // Default input format: detect plain text, fall back to HTML
+    options.inputFormat = TEXT2IMAGE_INPUT_AUTO;
+    
+    // Default pagination: disabled (one image, clipped to the output size)
+    options.paginate = false;
+    
+    // Default debug output: disabled
+    options.debugOverdraw = false;
+    
+    // Default incremental rendering: disabled (nothing kept after rendering)
+    options.incremental = false;
+    
+    // Default quality: full
+    options.renderQuality = TEXT2IMAGE_RENDER_QUALITY_FULL;
+    
+    // Default device pixel ratio: one output pixel per CSS pixel
+    options.devicePixelRatio = 1.0f;
+    
     return options;
 }
\ No newline at end of file
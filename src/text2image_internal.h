@@ -27,6 +27,8 @@ namespace text2image {
 class RenderEngine;
 class Task;
 class ThreadPool;
+class CompiledDocument;
+struct RenderSnapshot;
 
 // Task priority levels
 enum class TaskPriority {
@@ -44,6 +46,29 @@ enum class TaskStatus {
     CANCELLED = 4
 };
 
+// Largest side of an atlas sheet, and so of any item in it
+const int kMaxAtlasSide = 8192;
+
+// One item of an atlas task, copied from the caller's Text2Image_AtlasItem
+struct AtlasItem {
+    std::string html;
+    std::string css;
+    int width;
+    int height;
+};
+
+// Most frames in one animation task
+const int kMaxAnimationFrames = 1024;
+
+// One frame of an animation task: a complete document and how long it shows
+struct AnimationFrameSource {
+    std::string html;
+    int duration;                // Milliseconds
+};
+
+// Most thumbnails in one thumbnail task
+const int kMaxThumbnails = 16;
+
 // Task structure
 class Task {
 public:
@@ -58,13 +83,41 @@ public:
     TaskStatus getStatus() const { return m_status.load(); }
     const std::string& getErrorMessage() const { return m_errorMessage; }
     const std::vector<uint8_t>& getResult() const { return m_result; }
+    size_t getPageCount() const { return m_pages.empty() ? (m_result.empty() ? 0 : 1) : m_pages.size(); }
+    const std::vector<uint8_t>& getPage(size_t index) const { return m_pages.empty() ? m_result : m_pages[index]; }
     TaskPriority getPriority() const { return m_priority; }
+    const std::shared_ptr<const CompiledDocument>& getCompiled() const { return m_compiled; }
+    bool hasPages() const { return !m_pages.empty(); }
+    const std::vector<AtlasItem>& getAtlasItems() const { return m_atlasItems; }
+    Text2Image_AtlasOutput getAtlasOutput() const { return m_atlasOutput; }
+    const std::vector<Text2Image_AtlasRect>& getAtlasRects() const { return m_atlasRects; }
+    const std::vector<AnimationFrameSource>& getFrames() const { return m_frames; }
+    const std::vector<Text2Image_Thumbnail>& getThumbnails() const { return m_thumbnails; }
 
     // Setters
     void setStatus(TaskStatus status) { m_status.store(status); }
     void setErrorMessage(const std::string& message) { m_errorMessage = message; }
-    void setResult(const std::vector<uint8_t>& result) { m_result = result; }
+    void setResult(const std::vector<uint8_t>& result) { m_result = result; m_pages.clear(); }
+    void setPages(std::vector<std::vector<uint8_t>> pages) {
+        m_pages = std::move(pages);
+        m_result = m_pages.empty() ? std::vector<uint8_t>() : m_pages.front();
+    }
     void setPriority(TaskPriority priority) { m_priority = priority; }
+    void setCompiled(std::shared_ptr<const CompiledDocument> document) { m_compiled = std::move(document); }
+    void setAtlas(std::vector<AtlasItem> items, Text2Image_AtlasOutput output) {
+        m_atlasItems = std::move(items);
+        m_atlasOutput = output;
+    }
+    void setAtlasRects(std::vector<Text2Image_AtlasRect> rects) { m_atlasRects = std::move(rects); }
+    void setFrames(std::vector<AnimationFrameSource> frames) { m_frames = std::move(frames); }
+    void setThumbnails(std::vector<Text2Image_Thumbnail> thumbnails) { m_thumbnails = std::move(thumbnails); }
+
+    // Incremental rendering. The base is dropped once its snapshot is taken,
+    // so a chain of frames never keeps more than the latest one alive.
+    void setBase(std::shared_ptr<Task> base);
+    std::shared_ptr<const RenderSnapshot> takeBaseSnapshot();
+    std::shared_ptr<const RenderSnapshot> getSnapshot() const;
+    void setSnapshot(std::shared_ptr<const RenderSnapshot> snapshot);
 
     // Render callback
     void setCallback(Text2Image_RenderCallback callback, void* userData) {
@@ -85,8 +138,18 @@ private:
     Text2Image_RenderOptions m_options;
     std::atomic<TaskStatus> m_status;
     std::string m_errorMessage;
-    std::vector<uint8_t> m_result;
+    std::vector<uint8_t> m_result;               // First page when paginated
+    std::vector<std::vector<uint8_t>> m_pages;   // Empty unless paginated
     TaskPriority m_priority;
+    std::shared_ptr<const CompiledDocument> m_compiled;  // Replaces m_html and m_css when set
+    std::vector<AtlasItem> m_atlasItems;                 // Replace m_html and m_css when not empty
+    Text2Image_AtlasOutput m_atlasOutput;
+    std::vector<Text2Image_AtlasRect> m_atlasRects;      // Item positions in the sheet, by item
+    std::vector<AnimationFrameSource> m_frames;          // Replace m_html when not empty
+    std::vector<Text2Image_Thumbnail> m_thumbnails;      // Extra pages derived from the render when not empty
+    std::shared_ptr<Task> m_base;                        // Task to render incrementally against
+    std::shared_ptr<const RenderSnapshot> m_snapshot;    // Kept by incremental renders
+    mutable std::mutex m_snapshotMutex;
     Text2Image_RenderCallback m_callback;
     void* m_userData;
 };
@@ -106,17 +169,25 @@ public:
     // Set maximum number of threads
     void setMaxThreads(size_t numThreads);
 
+    // Run body(i) for every i in [0, count) and wait for all of them. The
+    // calling thread takes part, so this makes progress even when every
+    // worker is busy. The first exception thrown by body is rethrown here.
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
 private:
     // Worker thread function
     void worker();
 
     std::vector<std::thread> m_workers;
     std::queue<std::shared_ptr<Task>> m_tasks;
+    std::queue<std::function<void()>> m_jobs;    // Helpers queued by parallelFor
     std::mutex m_mutex;
     std::condition_variable m_condition;
     std::atomic<bool> m_stop;
     std::atomic<size_t> m_activeThreads;
-    size_t m_maxThreads;
+    size_t m_maxThreads;                         // Guarded by m_mutex, as are the two below
+    size_t m_liveWorkers;                        // Workers not yet retired
+    std::vector<std::thread::id> m_retired;      // Retired workers still to be joined
 };
 
 // Render engine interface
@@ -133,6 +204,23 @@ public:
     // Render a task
     virtual bool render(std::shared_ptr<Task> task) = 0;
 
+    // Lay out a task's document and write it as a compiled document
+    virtual bool compile(std::shared_ptr<Task> task, const std::string& outputPath) = 0;
+
+    // Fetching of images embedded with <img>; an empty resolver reads local
+    // files inside the local image directory, if one is set
+    virtual void setResourceResolver(std::function<bool(const std::string&, std::vector<uint8_t>&)> resolver) = 0;
+    virtual bool setLocalImageDirectory(const std::string& directory) = 0;
+
+    // Font cache budget and statistics
+    virtual void setFontCacheLimits(size_t byteLimit, int countLimit) = 0;
+    virtual void purgeFontCache() = 0;
+    virtual void getMetrics(Text2Image_Metrics& metrics) = 0;
+
+    // Text measurement without rendering
+    virtual void measureText(const char* const* texts, int count, const Text2Image_FontSpec& font, float maxWidth,
+                             Text2Image_TextMetrics* metrics) = 0;
+
     // Get the engine name
     virtual std::string getName() const = 0;
 };
@@ -146,6 +234,14 @@ public:
     bool initialize() override;
     void shutdown() override;
     bool render(std::shared_ptr<Task> task) override;
+    bool compile(std::shared_ptr<Task> task, const std::string& outputPath) override;
+    void setResourceResolver(std::function<bool(const std::string&, std::vector<uint8_t>&)> resolver) override;
+    bool setLocalImageDirectory(const std::string& directory) override;
+    void setFontCacheLimits(size_t byteLimit, int countLimit) override;
+    void purgeFontCache() override;
+    void getMetrics(Text2Image_Metrics& metrics) override;
+    void measureText(const char* const* texts, int count, const Text2Image_FontSpec& font, float maxWidth,
+                     Text2Image_TextMetrics* metrics) override;
     std::string getName() const override { return "Skia"; }
 
 private:
@@ -164,6 +260,15 @@ public:
 
     // Task management
     std::shared_ptr<Task> createTask(const char* html, const char* css, const Text2Image_RenderOptions* options);
+    std::shared_ptr<Task> createTaskFromCompiled(const char* compiledPath, const Text2Image_RenderOptions* options);
+    std::shared_ptr<Task> createAtlasTask(const Text2Image_AtlasItem* items, int count, Text2Image_AtlasOutput output,
+                                          const Text2Image_RenderOptions* options);
+    std::shared_ptr<Task> createIncrementalTask(Text2Image_TaskHandle base, const char* html, const char* css,
+                                                const Text2Image_RenderOptions* options);
+    std::shared_ptr<Task> createAnimationTask(const Text2Image_Frame* frames, int count, const char* css,
+                                              const Text2Image_RenderOptions* options);
+    std::shared_ptr<Task> createThumbnailTask(const char* html, const char* css, const Text2Image_Thumbnail* thumbnails,
+                                              int count, const Text2Image_RenderOptions* options);
     void freeTask(Text2Image_TaskHandle handle);
     std::shared_ptr<Task> getTask(Text2Image_TaskHandle handle);
 
@@ -171,6 +276,22 @@ public:
     bool renderSync(std::shared_ptr<Task> task, const char* outputPath);
     bool renderAsync(std::shared_ptr<Task> task, const char* outputPath, Text2Image_RenderCallback callback, void* userData);
 
+    // Compilation
+    bool compile(std::shared_ptr<Task> task, const char* outputPath);
+
+    // Image fetching
+    bool setResourceResolver(Text2Image_ResourceResolver resolver, void* userData);
+    bool setLocalImageDirectory(const char* directory);
+
+    // Font cache budget and statistics
+    bool setFontCacheLimits(size_t byteLimit, int countLimit);
+    void purgeFontCache();
+    bool getMetrics(Text2Image_Metrics& metrics);
+
+    // Text measurement
+    bool measureText(const char* const* texts, int count, const Text2Image_FontSpec& font, float maxWidth,
+                     Text2Image_TextMetrics* metrics);
+
     // Error handling
     void setLastError(const std::string& error);
     const char* getLastError() const;
@@ -187,7 +308,7 @@ private:
     std::unordered_map<Text2Image_TaskHandle, std::shared_ptr<Task>> m_tasks;
     std::mutex m_tasksMutex;
     std::string m_lastError;
-    std::mutex m_errorMutex;
+    mutable std::mutex m_errorMutex;
     std::atomic<bool> m_initialized;
 };
 
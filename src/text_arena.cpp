@@ -0,0 +1,57 @@
+/*
+ * Text2Image Text Arena Implementation
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the implementation of the TextArena class.
+ */
+
+#include "text_arena.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace text2image {
+
+namespace {
+
+// Size of each block; longer runs get a block of their own
+const size_t kTextBlockSize = 64 * 1024;
+
+} // namespace
+
+TextArena::TextArena()
+    : m_cursor(nullptr),
+      m_end(nullptr) {
+}
+
+TextArena::~TextArena() {
+}
+
+char* TextArena::reserve(std::string_view& view, size_t length) {
+    const size_t room = static_cast<size_t>(m_end - m_cursor);
+    const bool newest = !view.empty() && view.data() + view.size() == m_cursor;
+    if (newest && room >= length) {
+        return m_cursor;
+    }
+
+    // Move the view to where it can grow: the rest of this block, or a new one
+    if (room < view.size() + length) {
+        const size_t size = std::max(kTextBlockSize, view.size() + length);
+        m_blocks.emplace_back(new char[size]);
+        m_cursor = m_blocks.back().get();
+        m_end = m_cursor + size;
+    }
+    if (!view.empty()) {
+        std::memcpy(m_cursor, view.data(), view.size());
+    }
+    view = std::string_view(m_cursor, view.size());
+    m_cursor += view.size();
+    return m_cursor;
+}
+
+void TextArena::commit(std::string_view& view, size_t length) {
+    view = std::string_view(m_cursor - view.size(), view.size() + length);
+    m_cursor += length;
+}
+
+} // namespace text2image
@@ -0,0 +1,46 @@
+/*
+ * Text2Image Text Arena
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the arena that holds the normalized text of one
+ * layout pass, handed to layout as string views.
+ */
+
+#ifndef TEXT2IMAGE_TEXT_ARENA_H
+#define TEXT2IMAGE_TEXT_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace text2image {
+
+// Bump allocator for text. Bytes are written into the newest block and
+// never move, so every view stays valid until the arena is destroyed.
+// Not thread-safe; use one per layout pass.
+class TextArena {
+public:
+    TextArena();
+    ~TextArena();
+
+    TextArena(const TextArena&) = delete;
+    TextArena& operator=(const TextArena&) = delete;
+
+    // Room for length bytes right after view, which is empty or came from
+    // this arena. A view that is not the newest text is copied first, so
+    // the two stay contiguous.
+    char* reserve(std::string_view& view, size_t length);
+
+    // Extend view, as returned by reserve, over the first length bytes written
+    void commit(std::string_view& view, size_t length);
+
+private:
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+    char* m_cursor;           // Next free byte of the newest block
+    char* m_end;
+};
+
+} // namespace text2image
+
+#endif // TEXT2IMAGE_TEXT_ARENA_H
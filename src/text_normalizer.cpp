@@ -0,0 +1,185 @@
+/*
+ * Text2Image Text Normalizer Implementation
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the implementation of the text normalization helpers.
+ */
+
+#include "text_normalizer.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXT2IMAGE_TEXT_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace text2image {
+
+namespace {
+
+// Longest reference decoded, from '&' to ';'
+const size_t kMaxReferenceLength = 11;
+
+bool isWhiteSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+void appendUtf8(std::string& out, uint32_t codepoint) {
+    if (codepoint < 0x80) {
+        out.push_back(static_cast<char>(codepoint));
+    }
+    else if (codepoint < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    }
+    else if (codepoint < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    }
+    else {
+        out.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    }
+}
+
+bool nameIs(const char* name, size_t length, const char* entity) {
+    return std::strlen(entity) == length && std::memcmp(name, entity, length) == 0;
+}
+
+#ifdef TEXT2IMAGE_TEXT_SSE2
+
+int countTrailingZeros(unsigned value) {
+    int count = 0;
+    while (!(value & 1)) {
+        value >>= 1;
+        ++count;
+    }
+    return count;
+}
+
+// A bit per byte of the 16 at text that is HTML white space. Tab, LF, FF
+// and CR are the range 9-13 less vertical tab; bytes from 0x80 up compare
+// as negative and fall outside it.
+__m128i whiteSpaceBytes(__m128i input) {
+    const __m128i control = _mm_and_si128(_mm_cmpgt_epi8(input, _mm_set1_epi8(8)),
+                                          _mm_cmplt_epi8(input, _mm_set1_epi8(14)));
+    const __m128i space = _mm_cmpeq_epi8(input, _mm_set1_epi8(' '));
+    return _mm_or_si128(_mm_andnot_si128(_mm_cmpeq_epi8(input, _mm_set1_epi8('\v')), control), space);
+}
+
+#endif // TEXT2IMAGE_TEXT_SSE2
+
+} // namespace
+
+size_t collapseWhiteSpace(const char* text, size_t length, bool& lastWasSpace, char* out, uint32_t* offsets) {
+    size_t written = 0;
+    size_t i = 0;
+    while (i < length) {
+#ifdef TEXT2IMAGE_TEXT_SSE2
+        // Output never runs ahead of input, so a full block store stays within out
+        if (length - i >= 16) {
+            const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+            unsigned spaces = static_cast<unsigned>(_mm_movemask_epi8(whiteSpaceBytes(input)));
+            size_t plain = spaces ? static_cast<size_t>(countTrailingZeros(spaces)) : 16;
+            if (plain > 0) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + written), input);
+                if (offsets) {
+                    for (size_t k = 0; k < plain; ++k) {
+                        offsets[written + k] = static_cast<uint32_t>(i + k);
+                    }
+                }
+                written += plain;
+                i += plain;
+                lastWasSpace = false;
+                continue;
+            }
+        }
+#endif
+
+        char c = text[i];
+        if (isWhiteSpace(c)) {
+            if (!lastWasSpace) {
+                if (offsets) offsets[written] = static_cast<uint32_t>(i);
+                out[written++] = ' ';
+                lastWasSpace = true;
+            }
+            ++i;
+            continue;
+        }
+        if (offsets) offsets[written] = static_cast<uint32_t>(i);
+        out[written++] = c;
+        lastWasSpace = false;
+        ++i;
+    }
+    return written;
+}
+
+size_t plainTextPrefix(const char* text, size_t length) {
+    size_t i = 0;
+#ifdef TEXT2IMAGE_TEXT_SSE2
+    while (length - i >= 16) {
+        const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+        const __m128i markup = _mm_or_si128(_mm_cmpeq_epi8(input, _mm_set1_epi8('&')),
+                                            _mm_cmpeq_epi8(input, _mm_set1_epi8('<')));
+        unsigned special = static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(whiteSpaceBytes(input), markup)));
+        if (special) {
+            return i + countTrailingZeros(special);
+        }
+        i += 16;
+    }
+#endif
+    while (i < length && !isWhiteSpace(text[i]) && text[i] != '&' && text[i] != '<') {
+        ++i;
+    }
+    return i;
+}
+
+size_t decodeCharacterReference(const char* text, size_t length, std::string& out) {
+    const void* found = std::memchr(text, ';', length < kMaxReferenceLength ? length : kMaxReferenceLength);
+    if (!found) {
+        return 0;
+    }
+    const size_t semicolon = static_cast<size_t>(static_cast<const char*>(found) - text);
+    const char* name = text + 1;
+    const size_t nameLength = semicolon - 1;
+
+    if (nameLength > 1 && name[0] == '#') {
+        const bool hex = name[1] == 'x' || name[1] == 'X';
+        size_t digit = hex ? 2 : 1;
+        if (digit == nameLength) {
+            return 0;
+        }
+        uint32_t codepoint = 0;
+        for (; digit < nameLength; ++digit) {
+            char c = name[digit];
+            uint32_t value;
+            if (c >= '0' && c <= '9') value = static_cast<uint32_t>(c - '0');
+            else if (hex && c >= 'a' && c <= 'f') value = static_cast<uint32_t>(c - 'a' + 10);
+            else if (hex && c >= 'A' && c <= 'F') value = static_cast<uint32_t>(c - 'A' + 10);
+            else return 0;
+            codepoint = codepoint * (hex ? 16 : 10) + value;
+            if (codepoint > 0x10FFFF) {
+                return 0;
+            }
+        }
+        if (codepoint == 0) {
+            return 0;
+        }
+        appendUtf8(out, codepoint);
+    }
+    else if (nameIs(name, nameLength, "amp")) out.push_back('&');
+    else if (nameIs(name, nameLength, "lt")) out.push_back('<');
+    else if (nameIs(name, nameLength, "gt")) out.push_back('>');
+    else if (nameIs(name, nameLength, "quot")) out.push_back('"');
+    else if (nameIs(name, nameLength, "apos")) out.push_back('\'');
+    else if (nameIs(name, nameLength, "nbsp")) appendUtf8(out, 0xA0);
+    else return 0;
+
+    return semicolon + 1;
+}
+
+} // namespace text2image
@@ -0,0 +1,54 @@
+/*
+ * Text2Image Text Normalizer
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains the white space collapsing and character reference
+ * decoding applied to document text before layout, and the UTF-8 decoder
+ * shared by the text scanners.
+ */
+
+#ifndef TEXT2IMAGE_TEXT_NORMALIZER_H
+#define TEXT2IMAGE_TEXT_NORMALIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace text2image {
+
+// Copy text to out with each run of HTML white space (space, tab, LF, FF,
+// CR) collapsed to one space, and none at all while lastWasSpace holds.
+// out needs room for length bytes; up to 16 bytes past the result may be
+// overwritten within that. offsets, when given, receives the index in text
+// of each byte written. Runs without white space are copied 16 bytes at a
+// time with SSE2. Returns the number of bytes written.
+size_t collapseWhiteSpace(const char* text, size_t length, bool& lastWasSpace, char* out, uint32_t* offsets = nullptr);
+
+// Length of the prefix of text with no white space, '&' or '<', which
+// text scanners can copy as it is
+size_t plainTextPrefix(const char* text, size_t length);
+
+// Decode the character reference at text, which starts with '&', appending
+// it to out as UTF-8. Supports numeric references and the entities amp,
+// lt, gt, quot, apos and nbsp. Returns the bytes consumed, or 0.
+size_t decodeCharacterReference(const char* text, size_t length, std::string& out);
+
+// Decode one UTF-8 sequence, advancing the cursor. Malformed input never
+// reads past end; values beyond U+10FFFF become U+FFFD.
+inline uint32_t nextCodepoint(const char*& p, const char* end) {
+    unsigned char c = static_cast<unsigned char>(*p++);
+    if (c < 0x80) {
+        return c;
+    }
+
+    int extra = (c >= 0xF0) ? 3 : (c >= 0xE0) ? 2 : (c >= 0xC0) ? 1 : 0;
+    uint32_t codepoint = c & (0x3F >> extra);
+    for (int i = 0; i < extra && p < end; ++i) {
+        codepoint = (codepoint << 6) | (static_cast<unsigned char>(*p++) & 0x3F);
+    }
+    return codepoint > 0x10FFFF ? 0xFFFD : codepoint;
+}
+
+} // namespace text2image
+
+#endif // TEXT2IMAGE_TEXT_NORMALIZER_H
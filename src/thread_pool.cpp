@@ -10,14 +10,18 @@
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <algorithm>
+#include <exception>
 
 namespace text2image {
 
 ThreadPool::ThreadPool(size_t numThreads)
     : m_stop(false)
     , m_activeThreads(0)
-    , m_maxThreads(numThreads) {
-    // Create worker threads
+    , m_maxThreads(numThreads)
+    , m_liveWorkers(numThreads) {
+    // Create worker threads; workers read m_workers under the lock
+    std::lock_guard<std::mutex> lock(m_mutex);
     for (size_t i = 0; i < numThreads; ++i) {
         m_workers.emplace_back(&ThreadPool::worker, this);
     }
@@ -53,81 +57,165 @@ void ThreadPool::shutdown() {
     // Notify all worker threads
     m_condition.notify_all();
     
+    // Take the worker threads under the lock; setMaxThreads may be changing them
+    std::vector<std::thread> workers;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        workers.swap(m_workers);
+        m_retired.clear();
+    }
+    
     // Wait for all worker threads to finish
-    for (std::thread& worker : m_workers) {
+    for (std::thread& worker : workers) {
         if (worker.joinable()) {
             worker.join();
         }
     }
-    
-    // Clear the worker threads
-    m_workers.clear();
 }
 
 void ThreadPool::setMaxThreads(size_t numThreads) {
-    if (numThreads == m_maxThreads) {
-        return;
-    }
-    
-    size_t currentSize = m_workers.size();
-    
-    if (numThreads > currentSize) {
-        // Add more threads
-        {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            m_maxThreads = numThreads;
+    bool shrinking;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stop || numThreads == m_maxThreads) {
+            return;
+        }
+        m_maxThreads = numThreads;
+        
+        // Join the workers retired by earlier decreases; they have already
+        // left worker() and need no lock to finish
+        for (std::thread::id id : m_retired) {
+            auto it = std::find_if(m_workers.begin(), m_workers.end(),
+                                   [id](const std::thread& worker) { return worker.get_id() == id; });
+            if (it != m_workers.end()) {
+                it->join();
+                m_workers.erase(it);
+            }
         }
+        m_retired.clear();
         
-        // Create new worker threads
-        for (size_t i = currentSize; i < numThreads; ++i) {
+        // Start only the threads missing from the live count
+        for (; m_liveWorkers < numThreads; ++m_liveWorkers) {
             m_workers.emplace_back(&ThreadPool::worker, this);
         }
+        shrinking = m_liveWorkers > numThreads;
     }
-    else if (numThreads < currentSize) {
-        // Reduce the number of threads
-        // Note: This is a bit tricky as we can't directly kill threads
-        // We'll set the maxThreads and let threads exit naturally
-        {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            m_maxThreads = numThreads;
-        }
-        
-        // Notify all threads so they can check the new maxThreads value
+    
+    // Idle workers wake to retire the surplus; busy ones retire when they finish
+    if (shrinking) {
         m_condition.notify_all();
     }
 }
 
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+
+    struct State {
+        const std::function<void(size_t)>* body;
+        size_t count;
+        std::atomic<size_t> next;
+        size_t done;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+
+    auto state = std::make_shared<State>();
+    state->body = &body;
+    state->count = count;
+    state->next = 0;
+    state->done = 0;
+
+    // Claim indices until none are left. body is only touched for claimed
+    // indices, and the caller waits for those, so late helpers are harmless.
+    auto run = [state]() {
+        size_t index;
+        while ((index = state->next.fetch_add(1)) < state->count) {
+            try {
+                (*state->body)(index);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (!state->error) {
+                    state->error = std::current_exception();
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (++state->done == state->count) {
+                state->finished.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_stop) {
+            helpers = std::min(count - 1, m_liveWorkers);
+            for (size_t i = 0; i < helpers; ++i) {
+                m_jobs.push(run);
+            }
+        }
+    }
+    for (size_t i = 0; i < helpers; ++i) {
+        m_condition.notify_one();
+    }
+
+    run();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&state] { return state->done == state->count; });
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
 void ThreadPool::worker() {
     while (true) {
         std::shared_ptr<Task> task;
+        std::function<void()> job;
         
         {
             std::unique_lock<std::mutex> lock(m_mutex);
             
-            // Wait until there's a task or we're shutting down
+            // Wait until there's work or we're shutting down
             m_condition.wait(lock, [this] {
-                return m_stop || !m_tasks.empty() || m_activeThreads >= m_maxThreads;
+                return m_stop || !m_jobs.empty() || !m_tasks.empty() || m_liveWorkers > m_maxThreads;
             });
             
-            // Check if we're shutting down or if we've reached max threads
-            if (m_stop || (m_tasks.empty() && m_activeThreads >= m_maxThreads)) {
-                // If we're reducing thread count, exit this thread
-                if (m_workers.size() > m_maxThreads) {
+            // parallelFor helpers go first; their caller is blocked on them
+            if (!m_jobs.empty()) {
+                job = std::move(m_jobs.front());
+                m_jobs.pop();
+            }
+            else if (m_tasks.empty()) {
+                // Exit on shutdown, or retire if we're reducing thread count
+                if (m_stop) {
                     return;
                 }
-                
-                // Otherwise, just wait again
-                if (m_tasks.empty()) {
-                    continue;
+                if (m_liveWorkers > m_maxThreads) {
+                    --m_liveWorkers;
+                    m_retired.push_back(std::this_thread::get_id());
+                    return;
                 }
+                continue;
             }
-            
-            // Get the next task from the queue
-            task = m_tasks.front();
-            m_tasks.pop();
-            
-            // Increment active threads count
-            ++m_activeThreads;
+            else {
+                // Get the next task from the queue
+                task = m_tasks.front();
+                m_tasks.pop();
+                
+                // Increment active threads count
+                ++m_activeThreads;
+            }
+        }
+        
+        if (job) {
+            job();
+            continue;
         }
         
         try {
@@ -0,0 +1,106 @@
+/*
+ * Text2Image Base64 Tests
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains tests for the base64 decoder used for data: URIs.
+ */
+
+#include "base64.h"
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using text2image::decodeBase64;
+
+namespace {
+
+int g_failures = 0;
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            ++g_failures;                                                       \
+        }                                                                       \
+    } while (0)
+
+const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::string encode(const std::vector<uint8_t>& data) {
+    std::string text;
+    for (size_t i = 0; i < data.size(); i += 3) {
+        uint32_t bits = static_cast<uint32_t>(data[i]) << 16;
+        if (i + 1 < data.size()) bits |= static_cast<uint32_t>(data[i + 1]) << 8;
+        if (i + 2 < data.size()) bits |= data[i + 2];
+        text.push_back(kAlphabet[(bits >> 18) & 0x3F]);
+        text.push_back(kAlphabet[(bits >> 12) & 0x3F]);
+        text.push_back(i + 1 < data.size() ? kAlphabet[(bits >> 6) & 0x3F] : '=');
+        text.push_back(i + 2 < data.size() ? kAlphabet[bits & 0x3F] : '=');
+    }
+    return text;
+}
+
+bool decode(const std::string& text, std::vector<uint8_t>& out) {
+    return decodeBase64(text.data(), text.size(), out);
+}
+
+std::vector<uint8_t> bytes(const std::string& text) {
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+void testKnownValues() {
+    std::vector<uint8_t> out;
+    CHECK(decode("", out) && out.empty());
+    CHECK(decode("Zg==", out) && out == bytes("f"));
+    CHECK(decode("Zm8=", out) && out == bytes("fo"));
+    CHECK(decode("Zm9v", out) && out == bytes("foo"));
+
+    // Padding is optional and white space is skipped, within blocks too
+    CHECK(decode("Zm9vYg", out) && out == bytes("foob"));
+    CHECK(decode("TWFu IGlz\r\nIGRp c3Rp\tbmd1aXNoZWQ=", out) && out == bytes("Man is distinguished"));
+}
+
+void testInvalidInput() {
+    std::vector<uint8_t> out;
+    CHECK(!decode("Zm9v!", out));
+    CHECK(!decode("Z", out));
+    CHECK(!decode("Zg==Zg==", out));
+    CHECK(!decode("QUJDREVGR0hJSktMTU5PUFFSU1RVVldY-", out));
+    CHECK(!decode("QUJDREVGR0hJSktM.TU5PUFFSU1RVVldY", out));
+}
+
+void testRoundTrip() {
+    // Lengths and white space placements cover every offset within a block
+    std::mt19937 random(1);
+    for (int round = 0; round < 2000; ++round) {
+        std::vector<uint8_t> data(random() % 200);
+        for (uint8_t& byte : data) {
+            byte = static_cast<uint8_t>(random());
+        }
+        std::string text = encode(data);
+        if (round % 2) {
+            for (size_t gap = random() % 30; gap < text.size(); gap += 1 + random() % 30) {
+                text.insert(gap, 1, (random() % 2) ? '\n' : ' ');
+            }
+        }
+        std::vector<uint8_t> out;
+        CHECK(decode(text, out) && out == data);
+    }
+}
+
+} // namespace
+
+int main() {
+    testKnownValues();
+    testInvalidInput();
+    testRoundTrip();
+
+    if (g_failures > 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("All base64 tests passed\n");
+    return 0;
+}
@@ -0,0 +1,136 @@
+/*
+ * Text2Image Markdown Parser Tests
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains regression tests for the MarkdownParser class.
+ */
+
+#include "markdown_parser.h"
+
+#include <libxml/HTMLtree.h>
+
+#include <cstdio>
+#include <string>
+
+using text2image::MarkdownParser;
+
+namespace {
+
+int g_failures = 0;
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            ++g_failures;                                                       \
+        }                                                                       \
+    } while (0)
+
+// Body markup of the document parsed from markdown
+std::string render(const std::string& markdown) {
+    xmlDocPtr doc = MarkdownParser::parse(markdown);
+    if (!doc) {
+        return std::string();
+    }
+    xmlChar* html = nullptr;
+    int size = 0;
+    htmlDocDumpMemory(doc, &html, &size);
+    std::string result(reinterpret_cast<const char*>(html), static_cast<size_t>(size));
+    xmlFree(html);
+    xmlFreeDoc(doc);
+
+    std::string markup;
+    for (char c : result) {
+        if (c != '\n') {
+            markup.push_back(c);
+        }
+    }
+    return markup;
+}
+
+bool contains(const std::string& text, const std::string& part) {
+    return text.find(part) != std::string::npos;
+}
+
+size_t countOf(const std::string& text, const std::string& part) {
+    size_t count = 0;
+    for (size_t pos = text.find(part); pos != std::string::npos; pos = text.find(part, pos + part.size())) {
+        ++count;
+    }
+    return count;
+}
+
+void testInline() {
+    std::string html = render("*a* **b** ***c*** ~~d~~ `e` [f](g)");
+    CHECK(contains(html, "<em>a</em>"));
+    CHECK(contains(html, "<strong>b</strong>"));
+    CHECK(contains(html, "<strong><em>c</em></strong>"));
+    CHECK(contains(html, "<del>d</del>"));
+    CHECK(contains(html, "<code>e</code>"));
+    CHECK(contains(html, "<a href=\"g\">f</a>"));
+
+    // A code span closes only on a run of its own length
+    CHECK(contains(render("*a `b* c`*"), "<em>a <code>b* c</code></em>"));
+}
+
+void testSetextAfterList() {
+    // "---" left of the item ends the list instead of underlining it
+    std::string html = render("- foo\n---");
+    CHECK(contains(html, "<ul><li>foo</li></ul><hr>"));
+    CHECK(!contains(html, "<h2>"));
+
+    CHECK(contains(render("- foo\n  ---"), "<h2>foo</h2>"));
+    CHECK(contains(render("foo\n---"), "<h2>foo</h2>"));
+}
+
+void testUnmatchedOpeners() {
+    std::string text;
+    while (text.size() < 200000) {
+        text += "*a [b _c `d ";
+    }
+    std::string html = render(text);
+    CHECK(!contains(html, "<em>"));
+    CHECK(!contains(html, "<a "));
+}
+
+void testDeepNesting() {
+    // Nested link labels: links stop at the nesting limit, the rest stays text
+    const size_t depth = 100000;
+    std::string links(depth, '[');
+    links += "x";
+    for (size_t i = 0; i < depth; ++i) {
+        links += "](a)";
+    }
+    std::string html = render(links);
+    CHECK(countOf(html, "<a href") == 32);
+    CHECK(contains(html, "[[[x](a)"));
+
+    // Emphasis inside link labels shares the same limit
+    std::string mixed;
+    for (size_t i = 0; i < depth; ++i) {
+        mixed += "[*";
+    }
+    mixed += "x";
+    for (size_t i = 0; i < depth; ++i) {
+        mixed += "*](a)";
+    }
+    html = render(mixed);
+    CHECK(countOf(html, "<a href") > 0);
+    CHECK(countOf(html, "<a href") <= 32);
+}
+
+} // namespace
+
+int main() {
+    testInline();
+    testSetextAfterList();
+    testUnmatchedOpeners();
+    testDeepNesting();
+
+    if (g_failures > 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("All markdown parser tests passed\n");
+    return 0;
+}
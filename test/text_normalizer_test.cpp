@@ -0,0 +1,154 @@
+/*
+ * Text2Image Text Normalizer Tests
+ * Copyright (c) 2025 Text2Image contributors
+ *
+ * This file contains tests for the white space collapsing, character
+ * reference decoding and UTF-8 decoding helpers.
+ */
+
+#include "text_normalizer.h"
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace text2image;
+
+namespace {
+
+int g_failures = 0;
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            ++g_failures;                                                       \
+        }                                                                       \
+    } while (0)
+
+bool isWhiteSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+// One byte at a time, as the SSE2 path must behave
+std::string collapseReference(const std::string& text, bool& lastWasSpace, std::vector<uint32_t>& offsets) {
+    std::string out;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (isWhiteSpace(text[i])) {
+            if (!lastWasSpace) {
+                out.push_back(' ');
+                offsets.push_back(static_cast<uint32_t>(i));
+                lastWasSpace = true;
+            }
+            continue;
+        }
+        out.push_back(text[i]);
+        offsets.push_back(static_cast<uint32_t>(i));
+        lastWasSpace = false;
+    }
+    return out;
+}
+
+std::string collapse(const std::string& text, bool& lastWasSpace, std::vector<uint32_t>& offsets) {
+    std::vector<char> out(text.size());
+    offsets.assign(text.size(), 0);
+    size_t written = collapseWhiteSpace(text.data(), text.size(), lastWasSpace, out.data(), offsets.data());
+    offsets.resize(written);
+    return std::string(out.data(), written);
+}
+
+void testCollapseWhiteSpace() {
+    bool lastWasSpace = true;
+    std::vector<uint32_t> offsets;
+    CHECK(collapse("  a \t\n b  ", lastWasSpace, offsets) == "a b ");
+    CHECK(lastWasSpace);
+    CHECK(collapse(" c", lastWasSpace, offsets) == "c");
+
+    // Vertical tab is not HTML white space; UTF-8 bytes are copied as they are
+    lastWasSpace = false;
+    CHECK(collapse("x\vy \xE4\xB8\xAD\xE6\x96\x87  z", lastWasSpace, offsets) == "x\vy \xE4\xB8\xAD\xE6\x96\x87 z");
+
+    // Random mixes of long plain runs and white space cross every block boundary
+    std::mt19937 random(1);
+    const char alphabet[] = "abcXYZ \t\n\r\f\v\x80\xE4-&<";
+    for (int round = 0; round < 2000; ++round) {
+        std::string text(random() % 80, ' ');
+        for (char& c : text) {
+            c = (random() % 4) ? 'p' : alphabet[random() % (sizeof(alphabet) - 1)];
+        }
+        bool start = random() % 2;
+        bool expectedLast = start;
+        bool actualLast = start;
+        std::vector<uint32_t> expectedOffsets;
+        std::vector<uint32_t> actualOffsets;
+        std::string expected = collapseReference(text, expectedLast, expectedOffsets);
+        CHECK(collapse(text, actualLast, actualOffsets) == expected);
+        CHECK(actualOffsets == expectedOffsets);
+        CHECK(actualLast == expectedLast);
+    }
+}
+
+void testPlainTextPrefix() {
+    const std::string text = "abcdefghijklmnopqrstuvwxyz&amp;";
+    CHECK(plainTextPrefix(text.data(), text.size()) == 26);
+    CHECK(plainTextPrefix("ab<c", 4) == 2);
+    CHECK(plainTextPrefix("abcdefghijklmnopq r", 19) == 17);
+    CHECK(plainTextPrefix("abc\vd", 5) == 5);
+}
+
+void testCharacterReferences() {
+    std::string out;
+    CHECK(decodeCharacterReference("&amp;rest", 9, out) == 5 && out == "&");
+    out.clear();
+    CHECK(decodeCharacterReference("&#x4E2D;", 8, out) == 8 && out == "\xE4\xB8\xAD");
+    out.clear();
+    CHECK(decodeCharacterReference("&#128512;", 9, out) == 9 && out == "\xF0\x9F\x98\x80");
+    out.clear();
+    CHECK(decodeCharacterReference("&nbsp;", 6, out) == 6 && out == "\xC2\xA0");
+
+    // Unknown names, empty or overflowing numbers and a missing ';' stay text
+    out.clear();
+    CHECK(decodeCharacterReference("&copy;", 6, out) == 0);
+    CHECK(decodeCharacterReference("&#x;", 4, out) == 0);
+    CHECK(decodeCharacterReference("&#0;", 4, out) == 0);
+    CHECK(decodeCharacterReference("&#x110000;", 10, out) == 0);
+    CHECK(decodeCharacterReference("&amp", 4, out) == 0);
+    CHECK(out.empty());
+}
+
+void testNextCodepoint() {
+    const std::string text = "a\xC3\xA9\xE4\xB8\xAD\xF0\x9F\x98\x80";
+    const char* p = text.data();
+    const char* end = p + text.size();
+    CHECK(nextCodepoint(p, end) == 'a');
+    CHECK(nextCodepoint(p, end) == 0xE9);
+    CHECK(nextCodepoint(p, end) == 0x4E2D);
+    CHECK(nextCodepoint(p, end) == 0x1F600);
+    CHECK(p == end);
+
+    // A truncated sequence stops at end; values past U+10FFFF are replaced
+    const std::string truncated = "\xE4\xB8";
+    p = truncated.data();
+    nextCodepoint(p, p + truncated.size());
+    CHECK(p == truncated.data() + truncated.size());
+    const std::string large = "\xF7\xBF\xBF\xBF";
+    p = large.data();
+    CHECK(nextCodepoint(p, p + large.size()) == 0xFFFD);
+}
+
+} // namespace
+
+int main() {
+    testCollapseWhiteSpace();
+    testPlainTextPrefix();
+    testCharacterReferences();
+    testNextCodepoint();
+
+    if (g_failures > 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("All text normalizer tests passed\n");
+    return 0;
+}